@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+
+# Soak test for endpoint churn: runs pciemgrd_loadgen --churn against a Root Complex for several rounds and fails
+# if the RC's resident memory keeps growing once the first round has warmed it up.
+#
+# Usage: churn_soak.py --daemon=<pciemgrd> --loadgen=<pciemgrd_loadgen> --camconf=<config.json>
+#                      [--rounds=5] [--duration=30] [--connections=200] [--churn=50] [--rate=500]
+#                      [--max-growth-kb=4096]
+
+import sys
+import time
+import socket
+import subprocess as sb
+
+
+RC_PORT = 7779
+
+options = {
+    "daemon": None,
+    "loadgen": None,
+    "camconf": None,
+    "rounds": 5,
+    "duration": 30,
+    "connections": 200,
+    "churn": 50,
+    "rate": 500,
+    "max-growth-kb": 4096,
+}
+
+
+def usage():
+    print(
+        "Usage: {} --daemon=<pciemgrd> --loadgen=<pciemgrd_loadgen> --camconf=<config.json>\n"
+        "          [--rounds=5] [--duration=30] [--connections=200] [--churn=50] [--rate=500] "
+        "[--max-growth-kb=4096]".format(sys.argv[0])
+    )
+    sys.exit(2)
+
+
+def parse_args():
+    for arg in sys.argv[1:]:
+        if not arg.startswith("--") or "=" not in arg:
+            usage()
+        key, value = arg[2:].split("=", 1)
+        if key not in options:
+            usage()
+        options[key] = value if isinstance(options[key], str) or options[key] is None else int(value)
+
+    for key in ("daemon", "loadgen", "camconf"):
+        if options[key] is None:
+            usage()
+
+
+def rss_kb(pid):
+    with open("/proc/{}/status".format(pid), "r") as fs:
+        for line in fs:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1])
+    raise RuntimeError("VmRSS not found for PID {}.".format(pid))
+
+
+def wait_for_port(timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", RC_PORT), timeout=1):
+                return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def run_round():
+    res = sb.run(
+        [
+            options["loadgen"],
+            "--port={}".format(RC_PORT),
+            "--connections={}".format(options["connections"]),
+            "--rate={}".format(options["rate"]),
+            "--duration={}".format(options["duration"]),
+            "--churn={}".format(options["churn"]),
+        ],
+        stdout=sb.PIPE,
+        stderr=sb.STDOUT,
+        text=True,
+    )
+    if res.returncode != 0:
+        print(res.stdout)
+        raise RuntimeError("pciemgrd_loadgen exited with {}.".format(res.returncode))
+
+
+def main():
+    parse_args()
+
+    rc = sb.Popen(
+        [options["daemon"], "-r", "--camconf={}".format(options["camconf"])],
+        stdout=sb.DEVNULL,
+        stderr=sb.DEVNULL,
+    )
+    try:
+        if not wait_for_port(10):
+            print("The RC did not start listening on port {}.".format(RC_PORT))
+            return 1
+
+        # The first round grows the heap, the slot map and the thread stacks to their working size.
+        run_round()
+        baseline = rss_kb(rc.pid)
+        print("Warm-up round done, RC RSS: {} KB.".format(baseline))
+
+        for i in range(1, options["rounds"] + 1):
+            run_round()
+            if rc.poll() is not None:
+                print("The RC exited with {} during round {}.".format(rc.returncode, i))
+                return 1
+            rss = rss_kb(rc.pid)
+            print("Round {}/{}: RC RSS {} KB ({:+} KB).".format(i, options["rounds"], rss, rss - baseline))
+
+        growth = rss_kb(rc.pid) - baseline
+        if growth > options["max-growth-kb"]:
+            print("FAIL: RC RSS grew by {} KB, more than {} KB.".format(growth, options["max-growth-kb"]))
+            return 1
+
+        print("OK: RC RSS grew by {} KB.".format(growth))
+        return 0
+    finally:
+        rc.terminate()
+        try:
+            rc.wait(timeout=10)
+        except sb.TimeoutExpired:
+            rc.kill()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
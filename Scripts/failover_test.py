@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+
+# Failover test for a primary RC and a hot standby on this host: checks that the standby keeps following a primary
+# which was only unreachable for a moment, and that it takes over the sessions and group memberships of one that
+# crashed.
+#
+# Usage: failover_test.py --daemon=<pciemgrd> --camconf=<config.json> [--blip-ms=1200] [--max-failover-ms=3000]
+
+import os
+import re
+import sys
+import time
+import signal
+import socket
+import struct
+import tempfile
+import subprocess as sb
+
+
+RC_PORT = 7779
+NODE_ID = 1
+GROUP_ID = 5
+
+# See NetPacket.h.
+PACKET_READY = 1
+PACKET_OK = 2
+PACKET_JOIN = 8
+PACKET_LEAVE = 9
+READY_FLAGS_SUBSCRIBE = 1
+READY_FLAGS_SESSION = 2
+HANDSHAKE_VERSION = 2
+
+options = {
+    "daemon": None,
+    "camconf": None,
+    "blip-ms": 1200,
+    "max-failover-ms": 3000,
+}
+
+
+def usage():
+    print(
+        "Usage: {} --daemon=<pciemgrd> --camconf=<config.json> [--blip-ms=1200] "
+        "[--max-failover-ms=3000]".format(sys.argv[0])
+    )
+    sys.exit(2)
+
+
+def parse_args():
+    for arg in sys.argv[1:]:
+        if not arg.startswith("--") or "=" not in arg:
+            usage()
+        key, value = arg[2:].split("=", 1)
+        if key not in options:
+            usage()
+        options[key] = value if isinstance(options[key], str) or options[key] is None else int(value)
+
+    for key in ("daemon", "camconf"):
+        if options[key] is None:
+            usage()
+
+
+def send_packet(s, ptype, data=b""):
+    s.sendall(struct.pack("<BBHI", ptype, 0, 0, len(data)) + data)
+
+
+def recv_exact(s, size):
+    data = b""
+    while len(data) < size:
+        chunk = s.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("The RC closed the connection.")
+        data += chunk
+    return data
+
+
+def recv_packet(s):
+    ptype, _, _, size = struct.unpack("<BBHI", recv_exact(s, 8))
+    return ptype, recv_exact(s, size)
+
+
+def connect(token):
+    """Connects as NODE_ID with a session, returns the socket, the session token and whether it was resumed."""
+    s = socket.create_connection(("127.0.0.1", RC_PORT), timeout=5)
+    ready = struct.pack("<Q", token) + struct.pack(
+        "<HBB", NODE_ID, READY_FLAGS_SUBSCRIBE | READY_FLAGS_SESSION, HANDSHAKE_VERSION
+    )
+    send_packet(s, PACKET_READY, ready)
+    ptype, data = recv_packet(s)
+    if ptype != PACKET_OK:
+        raise RuntimeError("The RC refused the handshake with a packet of type {}.".format(ptype))
+    return s, struct.unpack("<Q", data[-9:-1])[0], data[-1] != 0
+
+
+def change_membership(s, ptype, group_id):
+    send_packet(s, ptype, struct.pack("<H", group_id))
+    reply, _ = recv_packet(s)
+    return reply == PACKET_OK
+
+
+def wait_for(predicate, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if predicate():
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def port_open():
+    try:
+        with socket.create_connection(("127.0.0.1", RC_PORT), timeout=1):
+            return True
+    except OSError:
+        return False
+
+
+def count(log_path, pattern):
+    with open(log_path, "r", errors="replace") as fs:
+        return len(re.findall(pattern, fs.read()))
+
+
+def start_rc(extra, log):
+    return sb.Popen(
+        [options["daemon"], "-r", "--camconf={}".format(options["camconf"])] + extra,
+        stdout=log,
+        stderr=sb.STDOUT,
+    )
+
+
+def stop(proc):
+    if proc.poll() is not None:
+        return
+    proc.send_signal(signal.SIGCONT)
+    proc.terminate()
+    try:
+        proc.wait(timeout=10)
+    except sb.TimeoutExpired:
+        proc.kill()
+
+
+def main():
+    parse_args()
+
+    workdir = tempfile.mkdtemp(prefix="pciemgrd_failover_")
+    primary_log = os.path.join(workdir, "primary.log")
+    standby_log = os.path.join(workdir, "standby.log")
+    primary = start_rc([], open(primary_log, "w"))
+    standby = None
+    try:
+        if not wait_for(port_open, 10):
+            print("FAIL: the primary RC did not start listening on port {}.".format(RC_PORT))
+            return 1
+
+        standby = start_rc(["--standby=127.0.0.1"], open(standby_log, "w"))
+        if not wait_for(lambda: count(standby_log, "In sync with the primary RC") > 0, 10):
+            print("FAIL: the standby never got in sync, see {}.".format(standby_log))
+            return 1
+
+        client, token, _ = connect(0)
+        if not change_membership(client, PACKET_JOIN, GROUP_ID):
+            print("FAIL: joining group {} was refused.".format(GROUP_ID))
+            return 1
+        client.close()
+        print("Opened session {:016x} and joined group {}.".format(token, GROUP_ID))
+
+        # Freeze the primary for longer than the standby tolerates silence, it must probe and follow it again.
+        primary.send_signal(signal.SIGSTOP)
+        time.sleep(options["blip-ms"] / 1000)
+        primary.send_signal(signal.SIGCONT)
+        if not wait_for(lambda: count(standby_log, "Following the primary RC at .* again") > 0, 10):
+            print("FAIL: the standby did not follow the primary again after a {} ms blip, see {}.".format(
+                options["blip-ms"], standby_log))
+            return 1
+        if count(standby_log, "Took over as the RC") > 0 or standby.poll() is not None:
+            print("FAIL: the standby took over from a primary that was only frozen, see {}.".format(standby_log))
+            return 1
+        if not wait_for(lambda: count(standby_log, "In sync with the primary RC") > 1, 10):
+            print("FAIL: the standby did not get back in sync, see {}.".format(standby_log))
+            return 1
+        print("The standby followed the primary again after a {} ms blip.".format(options["blip-ms"]))
+
+        # Crash the primary, the standby takes over and the session can be resumed on it.
+        primary.kill()
+        primary.wait()
+        crashed_at = time.time()
+        while True:
+            try:
+                client, _, resumed = connect(token)
+                break
+            except OSError:
+                if time.time() - crashed_at > 30:
+                    print("FAIL: the standby never took over, see {}.".format(standby_log))
+                    return 1
+                time.sleep(0.01)
+        failover_ms = (time.time() - crashed_at) * 1000
+
+        if not resumed:
+            print("FAIL: session {:016x} was not resumed by the standby.".format(token))
+            return 1
+        # Leaving is refused unless the membership was replicated.
+        if not change_membership(client, PACKET_LEAVE, GROUP_ID):
+            print("FAIL: the standby did not take over the membership of group {}.".format(GROUP_ID))
+            return 1
+        client.close()
+
+        print("The standby took over in {:.0f} ms and resumed session {:016x}.".format(failover_ms, token))
+        if failover_ms > options["max-failover-ms"]:
+            print("FAIL: taking over took longer than {} ms.".format(options["max-failover-ms"]))
+            return 1
+
+        print("OK")
+        return 0
+    finally:
+        stop(primary)
+        if standby:
+            stop(standby)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
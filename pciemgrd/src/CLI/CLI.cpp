@@ -4,7 +4,7 @@
 #include <Utils/Utils.h>
 
 namespace pmgrd {
-    CLI::CLI(const std::vector<std::string_view>& args, lgx::Logger& logger) noexcept
+    CLI::CLI(const std::vector<std::string_view>& args, Logger& logger) noexcept
         : m_Args(args)
         , m_Logger(logger)
         , m_ArgOrder(0)
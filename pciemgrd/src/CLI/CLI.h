@@ -5,10 +5,9 @@
 #include <functional>
 #include <vector>
 
-#include <Logex.h>
-
 #include <Core/Error.h>
 #include <Core/Result.h>
+#include <Log/Logger.h>
 
 namespace pmgrd {
     class CLI
@@ -35,13 +34,13 @@ namespace pmgrd {
 
     private:
         const std::vector<std::string_view>& m_Args;
-        lgx::Logger&                         m_Logger;
+        Logger&                              m_Logger;
         std::vector<CLIArg>                  m_ArgMap;
         u8                                   m_ArgOrder;
         std::string_view                     m_BinaryName;
 
     public:
-        CLI(const std::vector<std::string_view>& args, lgx::Logger& logger) noexcept;
+        CLI(const std::vector<std::string_view>& args, Logger& logger) noexcept;
 
     public:
     public:
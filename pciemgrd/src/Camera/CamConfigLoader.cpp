@@ -0,0 +1,417 @@
+#include "CamConfigLoader.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <Utils/Utils.h>
+
+namespace pmgrd {
+    namespace {
+        /**
+         * @brief SAX handler that builds @ref Camera and @ref CrewStation objects while the file is being lexed.
+         *
+         * @details Only the parts of the document we care about are interpreted, everything else is skipped
+         * without being stored. The handler keeps a stack of frames describing where in the document we are.
+         * */
+        class CamConfigSax : public nlohmann::json_sax<nlohmann::json>
+        {
+        private:
+            enum class Frame : u8
+            {
+                Root,
+                Skip,
+                CrewStations,
+                CrewStation,
+                CrewGroups,
+                Concentrators,
+                Concentrator,
+                Cameras,
+                Camera
+            };
+
+            // Bit indices of the camera fields.
+            enum CameraField : u32
+            {
+                CameraField_Id          = 1 << 0,
+                CameraField_Width       = 1 << 1,
+                CameraField_Height      = 1 << 2,
+                CameraField_Fps         = 1 << 3,
+                CameraField_Depth       = 1 << 4,
+                CameraField_BufferCount = 1 << 5,
+                CameraField_ComprFmt    = 1 << 6,
+                CameraField_VideoFmt    = 1 << 7,
+                CameraField_VideoDev    = 1 << 8,
+                CameraField_Required    = (1 << 9) - 1,
+
+                // Optional placement of the camera pipeline.
+                CameraField_CpuSet = 1 << 9,
+                CameraField_Cgroup = 1 << 10
+            };
+
+        public:
+            std::list<Camera>      cameras;
+            std::list<CrewStation> crewStations;
+            Err                    err;
+            bool                   failed = false;
+
+        private:
+            std::vector<Frame> m_Stack;
+            std::string        m_Key;
+            bool               m_HasCrewStations  = false;
+            bool               m_HasConcentrators = false;
+
+            // Current crew station.
+            CrewStation m_Crew;
+            bool        m_CrewHasNodeId = false;
+
+            // Current concentrator.
+            std::list<Camera> m_CtrCameras;
+            NodeID            m_CtrNodeId     = 0;
+            bool              m_CtrHasNodeId  = false;
+            bool              m_CtrHasCameras = false;
+
+            // Current camera.
+            pmgrd::Camera m_Cam;
+            u32           m_CamFields = 0;
+
+        public:
+            [[nodiscard]] Result<Err> Finish() noexcept
+            {
+                if (failed)
+                    return err;
+                if (!m_HasCrewStations)
+                    return Err{ ErrType::InvalidCameraConfiguration, "Missing 'crewStations'." };
+                if (!m_HasConcentrators)
+                    return Err{ ErrType::InvalidCameraConfiguration, "Missing 'concentrators'." };
+                return Ok();
+            }
+
+        public:
+            bool null() override { return OnOther(); }
+            bool boolean(bool) override { return OnOther(); }
+            bool number_integer(number_integer_t) override { return OnOther(); }
+            bool number_unsigned(number_unsigned_t val) override { return OnNumber(val); }
+            bool number_float(number_float_t, const string_t&) override { return OnOther(); }
+            bool string(string_t& val) override { return OnString(val); }
+            bool binary(binary_t&) override { return OnOther(); }
+            bool key(string_t& val) override
+            {
+                m_Key = val;
+                return true;
+            }
+
+            bool start_object(std::size_t) override
+            {
+                if (m_Stack.empty())
+                {
+                    m_Stack.push_back(Frame::Root);
+                    return true;
+                }
+
+                switch (m_Stack.back())
+                {
+                    case Frame::Root:
+                        if (m_Key == "crewStations" || m_Key == "concentrators")
+                            return Fail("'{}' must be an array.", m_Key);
+                        break;
+                    case Frame::CrewStations:
+                        m_Crew          = CrewStation{};
+                        m_CrewHasNodeId = false;
+                        m_Stack.push_back(Frame::CrewStation);
+                        return true;
+                    case Frame::Concentrators:
+                        m_CtrCameras.clear();
+                        m_CtrHasNodeId  = false;
+                        m_CtrHasCameras = false;
+                        m_Stack.push_back(Frame::Concentrator);
+                        return true;
+                    case Frame::Cameras:
+                        m_Cam       = pmgrd::Camera{};
+                        m_CamFields = 0;
+                        m_Stack.push_back(Frame::Camera);
+                        return true;
+                    case Frame::CrewGroups: return Fail("'groups' must only contain group ids.");
+                    default: break;
+                }
+
+                if (ExpectsScalar())
+                    return Fail("'{}' has an invalid type.", m_Key);
+
+                m_Stack.push_back(Frame::Skip);
+                return true;
+            }
+
+            bool end_object() override
+            {
+                const auto frame = m_Stack.back();
+                m_Stack.pop_back();
+
+                switch (frame)
+                {
+                    case Frame::Camera:
+                        if ((m_CamFields & CameraField_Required) != CameraField_Required)
+                            return Fail("Camera#{} is missing one or more required fields.", m_Cam.id);
+                        m_CtrCameras.push_back(std::move(m_Cam));
+                        break;
+                    case Frame::CrewStation:
+                        if (!m_CrewHasNodeId)
+                            return Fail("Crew station is missing 'nodeId'.");
+                        crewStations.push_back(std::move(m_Crew));
+                        break;
+                    case Frame::Concentrator:
+                        if (!m_CtrHasNodeId)
+                            return Fail("Concentrator is missing 'nodeId'.");
+                        if (!m_CtrHasCameras)
+                            return Fail("Concentrator#{} is missing 'cameras'.", m_CtrNodeId);
+
+                        // The node id might come after the cameras, so patch them up only now.
+                        for (auto& cam : m_CtrCameras)
+                            cam.nodeId = m_CtrNodeId;
+                        cameras.splice(cameras.end(), m_CtrCameras);
+                        break;
+                    default: break;
+                }
+                return true;
+            }
+
+            bool start_array(std::size_t) override
+            {
+                if (m_Stack.empty())
+                    return Fail("The root element must be an object.");
+
+                auto next = Frame::Skip;
+                switch (m_Stack.back())
+                {
+                    case Frame::Root:
+                        if (m_Key == "crewStations")
+                        {
+                            m_HasCrewStations = true;
+                            next              = Frame::CrewStations;
+                        }
+                        else if (m_Key == "concentrators")
+                        {
+                            m_HasConcentrators = true;
+                            next               = Frame::Concentrators;
+                        }
+                        break;
+                    case Frame::CrewStation:
+                        if (m_Key == "groups")
+                            next = Frame::CrewGroups;
+                        break;
+                    case Frame::Concentrator:
+                        if (m_Key == "cameras")
+                        {
+                            m_CtrHasCameras = true;
+                            next            = Frame::Cameras;
+                        }
+                        break;
+                    default: break;
+                }
+
+                if (next == Frame::Skip && ExpectsScalar())
+                    return Fail("'{}' has an invalid type.", m_Key);
+
+                m_Stack.push_back(next);
+                return true;
+            }
+
+            bool end_array() override
+            {
+                m_Stack.pop_back();
+                return true;
+            }
+
+            bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+            {
+                const std::string_view what = ex.what();
+                err                         = Err{ ErrType::JsonParseError, "{}", what };
+                failed                      = true;
+                return false;
+            }
+
+        private:
+            template <typename... TArgs>
+            bool Fail(const std::string_view fmt, TArgs&&... args)
+            {
+                err    = Err{ ErrType::InvalidCameraConfiguration, fmt, std::forward<TArgs>(args)... };
+                failed = true;
+                return false;
+            }
+
+            template <typename T>
+            bool Assign(T& out, const u64 value)
+            {
+                if (value > std::numeric_limits<T>::max())
+                    return Fail("'{}' is out of range ({}).", m_Key, value);
+                out = static_cast<T>(value);
+                return true;
+            }
+
+            /**
+             * @brief Whether the current position requires a scalar value (or an object in the case of arrays
+             * of objects).
+             * */
+            [[nodiscard]] bool ExpectsScalar() const noexcept
+            {
+                if (m_Stack.empty())
+                    return true;
+
+                switch (m_Stack.back())
+                {
+                    case Frame::CrewStations:
+                    case Frame::Concentrators:
+                    case Frame::Cameras:
+                    case Frame::CrewGroups: return true;
+                    case Frame::CrewStation:
+                    case Frame::Concentrator: return m_Key == "nodeId";
+                    case Frame::Camera: return CameraFieldOf(m_Key) != 0;
+                    default: return false;
+                }
+            }
+
+            [[nodiscard]] static u32 CameraFieldOf(const std::string_view key) noexcept
+            {
+                if (key == "id")
+                    return CameraField_Id;
+                else if (key == "width")
+                    return CameraField_Width;
+                else if (key == "height")
+                    return CameraField_Height;
+                else if (key == "fps")
+                    return CameraField_Fps;
+                else if (key == "depth")
+                    return CameraField_Depth;
+                else if (key == "bufferCount")
+                    return CameraField_BufferCount;
+                else if (key == "comprFmt")
+                    return CameraField_ComprFmt;
+                else if (key == "videoFmt")
+                    return CameraField_VideoFmt;
+                else if (key == "videoDev")
+                    return CameraField_VideoDev;
+                else if (key == "cpuSet")
+                    return CameraField_CpuSet;
+                else if (key == "cgroup")
+                    return CameraField_Cgroup;
+                return 0;
+            }
+
+            bool OnOther()
+            {
+                if (ExpectsScalar())
+                    return Fail("'{}' has an invalid type.", m_Key);
+                return true;
+            }
+
+            bool OnNumber(const u64 value)
+            {
+                if (m_Stack.empty())
+                    return Fail("The root element must be an object.");
+
+                switch (m_Stack.back())
+                {
+                    case Frame::CrewStation:
+                        if (m_Key == "nodeId")
+                        {
+                            m_CrewHasNodeId = true;
+                            return Assign(m_Crew.nodeId, value);
+                        }
+                        break;
+                    case Frame::CrewGroups: {
+                        GroupID group_id;
+                        if (!Assign(group_id, value))
+                            return false;
+                        m_Crew.groups.push_back(group_id);
+                        return true;
+                    }
+                    case Frame::Concentrator:
+                        if (m_Key == "nodeId")
+                        {
+                            m_CtrHasNodeId = true;
+                            return Assign(m_CtrNodeId, value);
+                        }
+                        break;
+                    case Frame::Camera: {
+                        const auto field = CameraFieldOf(m_Key);
+                        m_CamFields |= field;
+                        switch (field)
+                        {
+                            case CameraField_Id: return Assign(m_Cam.id, value);
+                            case CameraField_Width: return Assign(m_Cam.width, value);
+                            case CameraField_Height: return Assign(m_Cam.height, value);
+                            case CameraField_Fps: return Assign(m_Cam.fps, value);
+                            case CameraField_Depth: return Assign(m_Cam.depth, value);
+                            case CameraField_BufferCount: return Assign(m_Cam.bufferCount, value);
+                            case CameraField_VideoDev: return Assign(m_Cam.videoDev, value);
+                            case CameraField_ComprFmt:
+                            case CameraField_VideoFmt:
+                            case CameraField_CpuSet:
+                            case CameraField_Cgroup: return Fail("'{}' must be a string.", m_Key);
+                            default: break;
+                        }
+                        break;
+                    }
+                    default: break;
+                }
+                return OnOther();
+            }
+
+            bool OnString(std::string& value)
+            {
+                if (!m_Stack.empty() && m_Stack.back() == Frame::Camera)
+                {
+                    const auto field = CameraFieldOf(m_Key);
+                    switch (field)
+                    {
+                        case CameraField_ComprFmt: m_Cam.comprFmt = std::move(value); break;
+                        case CameraField_VideoFmt: m_Cam.videoFmt = std::move(value); break;
+                        case CameraField_CpuSet:
+                            if (!utils::sys::ParseCpuList(value))
+                                return Fail("'cpuSet' is not a valid CPU list ({}).", value);
+                            m_Cam.cpuSet = std::move(value);
+                            break;
+                        case CameraField_Cgroup:
+                            if (!utils::sys::CgroupPath(value))
+                                return Fail("'cgroup' must be a path relative to {} ({}).", utils::sys::CgroupRoot,
+                                            value);
+                            m_Cam.cgroup = std::move(value);
+                            break;
+                        default: return OnOther();
+                    }
+                    m_CamFields |= field;
+                    return true;
+                }
+                return OnOther();
+            }
+        };
+    } // namespace
+
+    [[nodiscard]] ValuedResult<CamConfigLoadStats, Err> LoadCamConfig(const std::string&      path,
+                                                                      std::list<Camera>&      cameras,
+                                                                      std::list<CrewStation>& crewStations) noexcept
+    {
+        std::ifstream fs{ path, std::ios_base::in | std::ios_base::binary };
+        if (!fs.is_open())
+            return Err{ ErrType::JsonParseError, "Failed to load camera configuration file: {}", path };
+
+        CamConfigLoadStats stats;
+        std::error_code    ec;
+        stats.bytes = std::filesystem::file_size(path, ec);
+
+        const auto   start = std::chrono::steady_clock::now();
+        CamConfigSax sax;
+        nlohmann::json::sax_parse(fs, &sax);
+        if (auto result = sax.Finish(); !result)
+            return result.UnwrapErr();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        cameras      = std::move(sax.cameras);
+        crewStations = std::move(sax.crewStations);
+        return stats;
+    }
+} // namespace pmgrd
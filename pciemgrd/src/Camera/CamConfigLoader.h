@@ -0,0 +1,47 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <list>
+#include <string>
+
+#include <Camera/CamCrewStation.h>
+#include <Core/Error.h>
+#include <Core/Result.h>
+
+namespace pmgrd {
+    /**
+     * @brief Statistics gathered while streaming a camera configuration file.
+     * */
+    struct CamConfigLoadStats
+    {
+        usize  bytes   = 0;   ///< Size of the parsed file in bytes.
+        double seconds = 0.0; ///< Wall-clock time spent parsing.
+
+    public:
+        /**
+         * @brief Parse throughput in MB/s.
+         * */
+        [[nodiscard]] double Throughput() const noexcept
+        {
+            return (seconds > 0.0) ? (static_cast<double>(bytes) / (1024.0 * 1024.0)) / seconds : 0.0;
+        }
+    };
+
+    /**
+     * @brief Streams a camera configuration file straight into @ref Camera and @ref CrewStation objects.
+     *
+     * @details The file is parsed with a SAX handler, so no intermediate json DOM is ever built and the peak
+     * memory is bounded by the size of the output lists rather than the size of the file.
+     * The output lists are only touched when the whole file was parsed and validated successfully.
+     *
+     * @param path Path to the camera configuration file.
+     * @param cameras Receives every camera of every concentrator, with @ref Camera::nodeId set.
+     * @param crewStations Receives every crew station.
+     *
+     * @returns @ref ValuedResult of @ref CamConfigLoadStats or @ref Err.
+     * */
+    [[nodiscard]] ValuedResult<CamConfigLoadStats, Err> LoadCamConfig(const std::string&      path,
+                                                                      std::list<Camera>&      cameras,
+                                                                      std::list<CrewStation>& crewStations) noexcept;
+} // namespace pmgrd
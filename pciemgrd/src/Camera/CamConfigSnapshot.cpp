@@ -0,0 +1,88 @@
+#include "CamConfigSnapshot.h"
+
+#include <nlohmann/json.hpp>
+
+#include <Utils/Utils.h>
+
+namespace pmgrd {
+    namespace {
+        using NodeConfigs = std::unordered_map<NodeID, std::shared_ptr<const NodeConfig>>;
+
+        void DiffConfigs(const NodeConfigs& current, const NodeConfigs& previous, const ConfigKind kind,
+                         std::vector<ConfigChange>& changes)
+        {
+            for (const auto& [node_id, config] : current)
+            {
+                const auto it = previous.find(node_id);
+                if (it == previous.end() || it->second->version != config->version)
+                    changes.push_back({ node_id, kind });
+            }
+            for (const auto& [node_id, config] : previous)
+            {
+                if (!current.contains(node_id))
+                    changes.push_back({ node_id, kind });
+            }
+        }
+    } // namespace
+
+    NodeConfig::NodeConfig(std::string json) noexcept
+        : json(std::move(json))
+        , version(utils::Fnv1a64(this->json))
+    {
+        if (version == 0)
+            version = 1;
+    }
+
+    [[nodiscard]] std::shared_ptr<const NodeConfig> CamConfigSnapshot::Find(const ConfigKind kind,
+                                                                            const NodeID     nodeId) const noexcept
+    {
+        if (kind == ConfigKind::None)
+            return nullptr;
+
+        const auto& configs = (kind == ConfigKind::CrewStation) ? crewStations : concentrators;
+        const auto  it      = configs.find(nodeId);
+        return (it != configs.end()) ? it->second : nullptr;
+    }
+
+    [[nodiscard]] std::vector<ConfigChange> CamConfigSnapshot::Diff(const CamConfigSnapshot& previous) const
+    {
+        std::vector<ConfigChange> changes;
+        DiffConfigs(crewStations, previous.crewStations, ConfigKind::CrewStation, changes);
+        DiffConfigs(concentrators, previous.concentrators, ConfigKind::Concentrator, changes);
+        return changes;
+    }
+
+    [[nodiscard]] CamConfigSnapshot CamConfigSnapshot::Build(const std::list<Camera>&      cameras,
+                                                             const std::list<CrewStation>& crewStations)
+    {
+        CamConfigSnapshot snapshot;
+
+        // Index the cameras by id, the first camera with a given id wins.
+        std::unordered_map<u16, const Camera*> camera_index;
+        for (const auto& cam : cameras)
+            camera_index.emplace(cam.id, &cam);
+
+        for (const auto& crew : crewStations)
+        {
+            // A node listed twice keeps its first entry.
+            if (snapshot.crewStations.contains(crew.nodeId))
+                continue;
+
+            nlohmann::json crew_json = crew.groups;
+            snapshot.crewStations.emplace(crew.nodeId, std::make_shared<const NodeConfig>(crew_json.dump(4)));
+
+            // The concentrator streams the cameras belonging to the groups of the matching crew station.
+            nlohmann::json ctr_json;
+            ctr_json["nodeId"]  = crew.nodeId;
+            ctr_json["cameras"] = nlohmann::json::array();
+            for (const auto group_id : crew.groups)
+            {
+                if (const auto it = camera_index.find(group_id); it != camera_index.end())
+                    ctr_json["cameras"].push_back(*it->second);
+            }
+            snapshot.concentrators.emplace(crew.nodeId, std::make_shared<const NodeConfig>(ctr_json.dump(4)));
+        }
+
+        return snapshot;
+    }
+} // namespace pmgrd
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Camera/CamCrewStation.h>
+
+namespace pmgrd {
+    /**
+     * @brief The kind of configuration a node requests from the RC.
+     * */
+    enum class ConfigKind : u8
+    {
+        None,        ///< The node hasn't requested any configuration yet.
+        CrewStation, ///< @ref net::PacketType::GetCrewConfig
+        Concentrator ///< @ref net::PacketType::GetCtrConfig
+    };
+
+    /**
+     * @brief A serialised configuration ready to be sent to a node.
+     * */
+    struct NodeConfig
+    {
+    public:
+        std::string json;    ///< The serialised configuration.
+        u64         version; ///< Content hash of @ref json, never 0 which stands for "no configuration".
+
+    public:
+        NodeConfig() noexcept = default;
+        explicit NodeConfig(std::string json) noexcept;
+    };
+
+    /**
+     * @brief A node whose configuration differs between two snapshots.
+     * */
+    struct ConfigChange
+    {
+        NodeID     nodeId;
+        ConfigKind kind;
+    };
+
+    /**
+     * @brief Per-node configurations serialised once per (re)load of the camera configuration.
+     *
+     * @details Building the json for every request is wasteful since the configuration only changes on reload,
+     * so the RC keeps the serialised configuration of every node around and serves them as is. Configurations are
+     * immutable and shared, so that a reply only copies the pointer while the snapshot is locked and sends after
+     * unlocking it, a slow Endpoint must not hold up everyone asking for their configuration.
+     * */
+    struct CamConfigSnapshot
+    {
+    public:
+        std::unordered_map<NodeID, std::shared_ptr<const NodeConfig>> crewStations;  ///< Crew station configs by node.
+        std::unordered_map<NodeID, std::shared_ptr<const NodeConfig>> concentrators; ///< Concentrator configs by node.
+
+    public:
+        /**
+         * @brief Looks up the configuration of a node.
+         *
+         * @returns The shared @ref NodeConfig or nullptr if the node has no configuration of that kind.
+         * */
+        [[nodiscard]] std::shared_ptr<const NodeConfig> Find(const ConfigKind kind, const NodeID nodeId) const noexcept;
+
+        /**
+         * @brief Lists every node whose configuration is different in @p previous, including the ones
+         * that were added or removed.
+         * */
+        [[nodiscard]] std::vector<ConfigChange> Diff(const CamConfigSnapshot& previous) const;
+
+    public:
+        /**
+         * @brief Serialises the configuration of every crew station and concentrator.
+         * */
+        [[nodiscard]] static CamConfigSnapshot Build(const std::list<Camera>&      cameras,
+                                                     const std::list<CrewStation>& crewStations);
+    };
+} // namespace pmgrd
@@ -7,6 +7,7 @@
 #include <nlohmann/json.hpp>
 
 #include <Core/Error.h>
+#include <Core/Ids.h>
 #include <Core/Result.h>
 
 namespace pmgrd {
@@ -15,9 +16,9 @@ namespace pmgrd {
      * */
     struct Camera
     {
-        u8          id;          ///< The camera id.
-        u8          nodeId;      ///< The node to which the camera belongs to. @note Temporary!
-        u8          groupId;     ///< The group to which the camera belongs to.
+        u16         id;          ///< The camera id.
+        NodeID      nodeId;      ///< The node to which the camera belongs to. @note Temporary!
+        GroupID     groupId;     ///< The group to which the camera belongs to.
         u16         width;       ///< The width of the camera.
         u16         height;      ///< The height of the camera.
         u8          fps;         ///< The framerate which the camera suppors.
@@ -26,8 +27,42 @@ namespace pmgrd {
         std::string comprFmt;    ///< Idk
         std::string videoFmt;    ///< The video format which the camera supports.
         u8          videoDev;
+        std::string cpuSet;      ///< Optional CPU list (e.g. "2-3") the camera pipeline is pinned to.
+        std::string cgroup;      ///< Optional cgroup v2 the camera pipeline is placed into.
 
-        NLOHMANN_DEFINE_TYPE_INTRUSIVE(Camera, id, width, height, fps, depth, bufferCount, comprFmt, videoFmt, videoDev)
+        friend void to_json(nlohmann::json& j, const Camera& cam)
+        {
+            j = nlohmann::json{ { "id", cam.id },
+                                { "width", cam.width },
+                                { "height", cam.height },
+                                { "fps", cam.fps },
+                                { "depth", cam.depth },
+                                { "bufferCount", cam.bufferCount },
+                                { "comprFmt", cam.comprFmt },
+                                { "videoFmt", cam.videoFmt },
+                                { "videoDev", cam.videoDev } };
+            if (!cam.cpuSet.empty())
+                j["cpuSet"] = cam.cpuSet;
+            if (!cam.cgroup.empty())
+                j["cgroup"] = cam.cgroup;
+        }
+
+        friend void from_json(const nlohmann::json& j, Camera& cam)
+        {
+            j.at("id").get_to(cam.id);
+            j.at("width").get_to(cam.width);
+            j.at("height").get_to(cam.height);
+            j.at("fps").get_to(cam.fps);
+            j.at("depth").get_to(cam.depth);
+            j.at("bufferCount").get_to(cam.bufferCount);
+            j.at("comprFmt").get_to(cam.comprFmt);
+            j.at("videoFmt").get_to(cam.videoFmt);
+            j.at("videoDev").get_to(cam.videoDev);
+
+            // The placement is optional.
+            cam.cpuSet = j.value("cpuSet", std::string{});
+            cam.cgroup = j.value("cgroup", std::string{});
+        }
 
     public:
         /**
@@ -37,7 +72,7 @@ namespace pmgrd {
          * */
         [[nodiscard]] constexpr Result<Err> Validate() const noexcept
         {
-            if (id > 16 || fps > 30 || width > 1920 || height > 1080 || width < 640 || height < 480)
+            if (fps > 30 || width > 1920 || height > 1080 || width < 640 || height < 480)
                 return Err{ ErrType::InvalidCameraConfiguration };
             return Ok();
         }
@@ -48,8 +83,8 @@ namespace pmgrd {
      * */
     struct CrewStation
     {
-        u8              nodeId; ///< The id of the endpoint.
-        std::vector<u8> groups; ///< The groups which belong to this node.
+        NodeID               nodeId; ///< The id of the endpoint.
+        std::vector<GroupID> groups; ///< The groups which belong to this node.
 
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(CrewStation, nodeId, groups)
     };
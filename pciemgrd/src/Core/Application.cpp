@@ -2,7 +2,15 @@
 
 #include <Utils/Utils.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <random>
 #include <ranges>
 
 #include <fcntl.h>
@@ -14,6 +22,30 @@
 #include <nlohmann/json.hpp>
 
 namespace pmgrd {
+    namespace {
+        /**
+         * @brief Parses the group ids following the --join and --leave sub-commands, up to the next option.
+         * */
+        [[nodiscard]] ValuedResult<std::vector<GroupID>, Err>
+        ParseGroupArgs(const std::vector<std::string_view>& args) noexcept
+        {
+            std::vector<GroupID> group_ids;
+            for (usize i = 1; i < args.size() && !args[i].starts_with('-'); ++i)
+            {
+                GroupID    group_id;
+                const auto value     = args[i];
+                const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), group_id);
+                if (ec != std::errc{} || ptr != value.data() + value.size())
+                    return Err{ ErrType::InvalidOperation, "Invalid group id '{}'.", value };
+                group_ids.push_back(group_id);
+            }
+
+            if (group_ids.empty())
+                return Err{ ErrType::InvalidOperation, "{} expects at least one group id.", args[0] };
+            return group_ids;
+        }
+    } // namespace
+
     std::unique_ptr<Application> Application::s_Instance = nullptr;
 
     Application::Application(const std::vector<std::string_view>& args)
@@ -21,14 +53,26 @@ namespace pmgrd {
         , m_DaemonMode(false)
         , m_RootComplex(false)
         , m_LogFilePath("/var/log/pciepciemgr.log")
+        , m_ConfigCachePath(Application::DefaultConfigCachePath)
+        , m_ReplicationMetrics(m_Metrics)
+        , m_Backlog(Application::DefaultBacklog)
         , m_Concentrator(false)
         , m_CrewStation(false)
+        , m_Subscribe(false)
+        , m_Reconnect(false)
+        , m_SessionToken(0)
+        , m_Stopping(false)
+        , m_ConfigVersion(0)
+        , m_RealtimePriority(0)
     {
         net::CSSocket_Init();
 
         // Communication via TCP/IP.
         m_Socket = net::Socket_New(net::AddressFamily_InterNetwork, net::SocketType_Stream, net::ProtocolType_Tcp);
 
+        // Management traffic is small requests and replies, unless --socket-profile says otherwise.
+        m_SocketOptions = net::SocketProfile(CS_PROFILE_CONTROL_LOW_LATENCY).Unwrap();
+
         m_LoggerProperties.serializeToNonStdoutStreams = false;
         m_LoggerProperties.defaultPrefix               = "EP";
         m_LoggerProperties.flushOnLog                  = true;
@@ -43,7 +87,7 @@ namespace pmgrd {
         m_LoggerProperties.outputStreams = { &std::cout };
 
         // NOTE: DO NOT LOG BEFORE CLI ARGUMENTS HAVE BEEN PARSED!
-        m_Logger = std::make_unique<lgx::Logger>(m_LoggerProperties);
+        m_Logger = std::make_unique<Logger>(m_LoggerProperties);
         m_CLI    = std::make_unique<CLI>(m_Args, *m_Logger);
 
         // Set binary name.
@@ -54,6 +98,15 @@ namespace pmgrd {
                              "Execute as a daemon.",
                              CLI::ArgType::Option,
                              utils::BindDelegate(this, &Application::Arg_DaemonHandler) });
+        m_CLI->AddArgument({ { "--async-log", "-al" },
+                             "Format and write logs on a background thread, =block waits instead of dropping "
+                             "records when it falls behind.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_AsyncLogHandler) });
+        m_CLI->AddArgument({ { "--binlog", "-bl" },
+                             "Write logs unformatted to the specified binary log, see pciemgrd_logdecode.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_BinaryLogHandler) });
         m_CLI->AddArgument({ { "--rootcomplex", "-r" },
                              "Execute as the Root Complex.",
                              CLI::ArgType::Option,
@@ -66,6 +119,73 @@ namespace pmgrd {
                              "Connect as a Crew Station.",
                              CLI::ArgType::Option,
                              utils::BindDelegate(this, &Application::Arg_ConcentratorHandler) });
+        m_CLI->AddArgument({ { "--subscribe", "-sub" },
+                             "Keep receiving configuration updates pushed by the RC.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_SubscribeHandler) });
+        m_CLI->AddArgument({ { "--reconnect", "-rec" },
+                             "Reconnect to the RC with backoff whenever the connection drops and resume the session "
+                             "held before. Implies --subscribe.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_ReconnectHandler) });
+        m_CLI->AddArgument({ { "--cache", "-cc" },
+                             "Persist the configuration received from the RC to the specified file.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_CacheHandler) });
+        m_CLI->AddArgument({ { "--dispatcher-cpus", "-dc" },
+                             "Pin the packet dispatcher thread to the specified CPU list (e.g. 0-1).",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_DispatcherCpusHandler) });
+        m_CLI->AddArgument({ { "--io-cpus", "-ic" },
+                             "Pin the network I/O threads to the specified CPU list (e.g. 2,3).",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_IOCpusHandler) });
+        m_CLI->AddArgument({ { "--realtime", "-rt" },
+                             "Run the RC's network threads under SCHED_FIFO at the specified priority with locked "
+                             "memory.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_RealtimeHandler) });
+        m_CLI->AddArgument({ { "--metrics", "-mt" },
+                             "Export the RC's metrics in the OpenMetrics text format to the specified file, or to "
+                             "clients of a Unix socket with unix:<path>.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_MetricsHandler) });
+        m_CLI->AddArgument({ { "--trace", "-tr" },
+                             "Record request spans on the RC and write them in the Chrome trace-event format to the "
+                             "specified file on SIGUSR1. Keeps the last 262144 spans in at most 64 buffers of 4096 "
+                             "(about 15 MB), threads past 64 share them.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_TraceHandler) });
+        m_CLI->AddArgument({ { "--backlog", "-bk" },
+                             "Length of the RC's queue of connections waiting to be accepted.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_BacklogHandler) });
+        m_CLI->AddArgument({ { "--timeouts", "-to" },
+                             "Timeouts of network operations in ms, for all of them or e.g. "
+                             "connect:500,send:2000,receive:2000.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_TimeoutsHandler) });
+        m_CLI->AddArgument({ { "--socket-profile", "-sp" },
+                             "Socket options of the RC's listening socket or of the connection to the RC, "
+                             "control-low-latency (default), control-busy-poll (needs CAP_NET_ADMIN) or "
+                             "bulk-config.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_SocketProfileHandler) });
+        m_CLI->AddArgument({ { "--standby", "-sb" },
+                             "Run as a hot standby of the RC at the specified address, replicating its state and "
+                             "taking over its port when it fails. The RC has to list this host in --standby-peers.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_StandbyHandler) });
+        m_CLI->AddArgument({ { "--standby-peers", "-sbp" },
+                             "Addresses of the standby RCs allowed to replicate the RC's state (e.g. "
+                             "10.0.0.2,10.0.0.3), replication is refused to everyone else.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_StandbyPeersHandler) });
+        m_CLI->AddArgument({ { "--journal", "-jn" },
+                             "Journal the RC's group memberships to the specified directory and recover them from it "
+                             "on startup.",
+                             CLI::ArgType::Option,
+                             utils::BindDelegate(this, &Application::Arg_JournalHandler) });
         m_CLI->AddArgument({ { "--camconf", "-cf" },
                              "Load the specified camera configuration file.",
                              CLI::ArgType::Option,
@@ -95,7 +215,7 @@ namespace pmgrd {
                              CLI::ArgType::SubCommand,
                              utils::BindDelegate(this, &Application::Arg_GSTHandler) });
 
-        m_NetHandler = std::make_unique<net::NetHandler>(*m_Logger, m_Socket);
+        m_NetHandler = std::make_unique<net::NetHandler>(*m_Logger, m_Metrics, m_Socket);
 
         m_NetHandler->AddPacket(net::PacketType::String, utils::BindDelegate(this, &Application::Net_StringHandler));
         m_NetHandler->AddPacket(net::PacketType::Reboot, utils::BindDelegate(this, &Application::Net_RebootHandler));
@@ -105,10 +225,20 @@ namespace pmgrd {
                                 utils::BindDelegate(this, &Application::Net_GetCtrConfigHandler));
         m_NetHandler->AddPacket(net::PacketType::GetCrewConfig,
                                 utils::BindDelegate(this, &Application::Net_GetCrewConfigHandler));
+        m_NetHandler->AddPacket(net::PacketType::Stats, utils::BindDelegate(this, &Application::Net_StatsHandler));
+        m_NetHandler->AddPacket(net::PacketType::Trace, utils::BindDelegate(this, &Application::Net_TraceHandler));
+        m_NetHandler->AddPacket(net::PacketType::Clocks, utils::BindDelegate(this, &Application::Net_ClocksHandler));
+        m_NetHandler->AddPacket(net::PacketType::Replicate,
+                                utils::BindDelegate(this, &Application::Net_ReplicateHandler));
+        m_NetHandler->SetResumeDelegate(utils::BindDelegate(this, &Application::OnSessionResumed));
     }
 
     Application::~Application() noexcept
     {
+        m_ConfigWatcher.reset();
+        m_MetricsExporter.reset();
+        trace::Tracer::Get().StopDumpOnSignal();
+
         if (m_Socket)
         {
             m_NetHandler->Stop();
@@ -116,6 +246,10 @@ namespace pmgrd {
             m_Socket = nullptr;
         }
 
+        // Handlers publish and journal changes until the NetHandler has stopped.
+        m_Replication.reset();
+        m_Journal.reset();
+
         if (m_Started)
         {
             m_Started.store(false);
@@ -159,9 +293,103 @@ namespace pmgrd {
     {
         if (m_RootComplex)
         {
-            if (net::Socket_Listen(m_Socket, Application::RootMaximumEndpoints) == CS_SOCKET_ERROR)
+            if (!m_MetricsTarget.empty())
+            {
+                m_MetricsExporter = std::make_unique<MetricsExporter>(*m_Logger, m_Metrics, m_MetricsTarget);
+                if (const auto result = m_MetricsExporter->Start(); !result)
+                {
+                    const auto err = result.UnwrapErr();
+                    m_Logger->Warn("Metrics will not be exported.\n\t{}", err);
+                }
+            }
+
+            if (!m_TracePath.empty())
+            {
+                if (const auto result = trace::Tracer::Get().DumpOnSignal(*m_Logger, m_TracePath); !result)
+                {
+                    const auto err = result.UnwrapErr();
+                    m_Logger->Warn("The trace will only be available through '{} rc trace'.\n\t{}", GetBinaryName(),
+                                   err);
+                }
+            }
+
+            // A standby only binds the RC port once it has taken over.
+            const bool                            standby = !m_StandbyOf.empty();
+            std::chrono::steady_clock::time_point last_heard;
+            if (standby)
+                last_heard = StandBy();
+
+            // Serve the memberships from before a restart right away, a standby took over fresher ones.
+            if (!m_JournalPath.empty())
+            {
+                m_Journal      = std::make_unique<MembershipJournal>(*m_Logger, m_Metrics, m_JournalPath);
+                auto recovered = m_Journal->Recover();
+                if (!recovered)
+                    return recovered.UnwrapErr();
+
+                if (standby)
+                {
+                    TRY_UNWRAP(m_Journal->Reset(m_Groups));
+                }
+                else
+                    m_Groups = recovered.Unwrap();
+                m_Journal->Start();
+            }
+
+            TRY_UNWRAP(BindRC(standby));
+            if (net::Socket_Listen(m_Socket, m_Backlog) == CS_SOCKET_ERROR)
                 return Err{ ErrType::NetListenFailure };
 
+            if (standby)
+            {
+                const auto failover = std::chrono::steady_clock::now() - last_heard;
+                m_ReplicationMetrics.failover.Record(
+                    static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(failover).count()));
+                m_ReplicationMetrics.failovers.Add();
+                m_Logger->Info("Took over as the RC {:.1f} ms after the primary was last heard from.",
+                               std::chrono::duration<double, std::milli>(failover).count());
+            }
+
+            // Lock memory before the threads come up so that the control path never page faults.
+            if (m_RealtimePriority > 0)
+            {
+                if (const auto result = utils::sys::LockMemory(Application::RealtimeHeapPrefault); !result)
+                {
+                    const auto err = result.UnwrapErr();
+                    m_Logger->Warn("Memory will not be locked.\n\t{}", err);
+                }
+                else
+                    m_Logger->Info("Memory locked, {} bytes of heap pre-faulted.", Application::RealtimeHeapPrefault);
+                m_NetHandler->SetRealtimePriority(m_RealtimePriority);
+            }
+
+            // Push configuration changes to subscribed Endpoints as soon as the file is modified.
+            if (!m_CameraConfigPath.empty())
+            {
+                m_ConfigWatcher = std::make_unique<utils::FileWatcher>(
+                    m_CameraConfigPath,
+                    [this]()
+                    {
+                        if (const auto result = ReloadCameraConfig(); !result)
+                        {
+                            const auto err = result.UnwrapErr();
+                            m_Logger->Error("Failed to reload the camera configuration!\n\t{}", err);
+                        }
+                    });
+                if (const auto result = m_ConfigWatcher->Start(); !result)
+                {
+                    const auto err = result.UnwrapErr();
+                    m_Logger->Warn("Configuration changes will not be pushed.\n\t{}", err);
+                }
+            }
+
+            // Stream the group memberships and sessions to standby RCs, in the order they change.
+            m_Replication = std::make_unique<net::ReplicationPublisher>(*m_Logger, m_ReplicationMetrics);
+            m_Replication->Start();
+            m_NetHandler->GetSessions().SetChangeDelegate(
+                [this](const u64 token, const net::SessionState* state)
+                { m_Replication->Publish(net::ReplicationRecord::Session(token, state)); });
+
             m_NetHandler->BeginPacketDispatch();
             if (auto result = m_NetHandler->BeginAccept(); !result)
                 return result;
@@ -172,127 +400,647 @@ namespace pmgrd {
 
     Result<Err> Application::LoadCameraConfig() noexcept
     {
+        const trace::Span span{ "config", "LoadCameraConfig" };
         m_Logger->Log(lgx::Level::Info, "Loading '{}'...", m_CameraConfigPath);
-        std::ifstream fs{ m_CameraConfigPath };
-        if (fs.is_open())
+
+        std::list<Camera>      cameras;
+        std::list<CrewStation> crew_stations;
+        const auto             result = LoadCamConfig(m_CameraConfigPath, cameras, crew_stations);
+        if (!result)
+            return result.UnwrapErr();
+
+        const auto camera_count = cameras.size();
+        auto       snapshot     = CamConfigSnapshot::Build(cameras, crew_stations);
         {
-            std::string content = std::string((std::istreambuf_iterator<char>(fs)), (std::istreambuf_iterator<char>()));
-            nlohmann::json j    = nlohmann::json::parse(content);
+            std::scoped_lock lock{ m_ConfigMutex };
+            m_Cameras        = std::move(cameras);
+            m_CrewStations   = std::move(crew_stations);
+            m_ConfigSnapshot = std::move(snapshot);
+        }
 
-            if (j.contains("crewStations"))
-                m_CrewStations = j["crewStations"].get<std::list<CrewStation>>();
-            else
-                return Err{ ErrType::InvalidCameraConfiguration };
+        const auto stats = result.Unwrap();
+        m_Logger->Log(lgx::Level::Info, "Successfully loaded {} camera configuration(s) ({} bytes, {:.2f} MB/s)",
+                      camera_count, stats.bytes, stats.Throughput());
 
-            if (j.contains("concentrators"))
-            {
-                for (const auto& e : j["concentrators"])
-                {
-                    const auto node_id = e["nodeId"];
+        return Ok();
+    }
+
+    Result<Err> Application::ReloadCameraConfig() noexcept
+    {
+        CamConfigSnapshot previous;
+        {
+            std::scoped_lock lock{ m_ConfigMutex };
+            previous = m_ConfigSnapshot;
+        }
+
+        TRY_UNWRAP(LoadCameraConfig());
 
-                    Camera cam_obj;
-                    if (e.contains("cameras"))
+        // Collect what to push under the locks, the pushes themselves may each block for a whole send timeout.
+        struct Push
+        {
+            std::shared_ptr<Endpoint> endpoint;
+            ConfigKind                        kind;
+            std::shared_ptr<const NodeConfig> config;
+        };
+        std::vector<Push> pushes;
+        {
+            std::scoped_lock lock{ m_ConfigMutex };
+            const auto       changes = m_ConfigSnapshot.Diff(previous);
+            m_Logger->Info("Camera configuration reloaded, {} node configuration(s) changed.", changes.size());
+
+            // Only push to the Endpoints whose configuration actually changed.
+            for (const auto& change : changes)
+            {
+                m_NetHandler->ForEachEndpoint(
+                    change.nodeId,
+                    [this, &change, &pushes](Endpoint& ep)
                     {
-                        for (const auto& cam : e["cameras"])
+                        if (!ep.IsSubscribed() || !ep.IsConnected() || ep.GetConfigKind() != change.kind)
+                            return;
+
+                        auto config = m_ConfigSnapshot.Find(change.kind, ep.GetID());
+                        if (!config)
                         {
-                            cam_obj        = cam.get<Camera>();
-                            cam_obj.nodeId = node_id;
-                            m_Cameras.push_back(std::move(cam_obj));
+                            m_Logger->Warn("EP#{} no longer has a configuration.", ep.GetID());
+                            return;
                         }
-                    }
-                    else
-                        return Err{ ErrType::InvalidCameraConfiguration };
-                }
+                        pushes.push_back(Push{ ep.shared_from_this(), change.kind, std::move(config) });
+                    });
             }
-            else
-                return Err{ ErrType::InvalidCameraConfiguration };
+        }
 
-            m_Logger->Log(lgx::Level::Info, "Successfully loaded {} camera configuration(s)", m_Cameras.size());
+        for (const auto& push : pushes)
+        {
+            const auto ep_id = push.endpoint->GetID();
+            if (const auto result = PushConfig(*push.endpoint, push.kind, *push.config); !result)
+                m_Logger->Error("Failed to push the configuration to EP#{}.", ep_id);
+            else
+                PMGRD_LOG_LIMITED(*m_Logger, Info, "Pushed the new configuration to EP#{}.", ep_id);
         }
-        else
-            return Err{ ErrType::JsonParseError, "Failed to load camera configuration file: {}", m_CameraConfigPath };
 
         return Ok();
     }
 
-    Result<Err> Application::ConnectToRC() noexcept
+    void Application::CommitMembership(Endpoint& ep, const MembershipOp op, const GroupID group_id) noexcept
+    {
+        m_Replication->Publish(net::ReplicationRecord::Group(
+            (op == MembershipOp::Join) ? net::ReplicationOp::Join : net::ReplicationOp::Leave, group_id, ep.GetID()));
+
+        if (!m_Journal)
+        {
+            ep.Reply(Ok());
+            return;
+        }
+
+        // The reply of a tagged Endpoint waits for the commit, the dispatcher doesn't. Untagged Endpoints would take a
+        // deferred reply for the answer to a later request, they are acknowledged right away instead.
+        const bool deferred = ep.IsTagged();
+        m_Journal->Append(op, group_id, ep.GetID(),
+                          [this, ep = ep.shared_from_this(), tag = ep.GetRequestTag(), op, group_id,
+                           deferred](const Result<Err>& result)
+                          {
+                              if (!result)
+                                  PMGRD_LOG_LIMITED(*m_Logger, Warn,
+                                                    "EP#{} {} group {}, the change isn't durable until the next "
+                                                    "membership snapshot.",
+                                                    ep->GetID(), (op == MembershipOp::Join) ? "joined" : "left",
+                                                    group_id);
+                              if (!deferred)
+                                  return;
+
+                              net::Packet reply{ Ok() };
+                              reply.header.tag = tag;
+                              ep->Send(std::move(reply));
+                          });
+        if (!deferred)
+            ep.Reply(Ok());
+    }
+
+    void Application::OnSessionResumed(Endpoint& ep) noexcept
+    {
+        const auto kind = ep.GetConfigKind();
+        if (!ep.IsSubscribed() || kind == ConfigKind::None)
+            return;
+
+        std::shared_ptr<const NodeConfig> config;
+        {
+            std::scoped_lock lock{ m_ConfigMutex };
+            config = m_ConfigSnapshot.Find(kind, ep.GetID());
+        }
+        if (!config || config->version == ep.GetConfigVersion())
+            return;
+
+        if (const auto result = PushConfig(ep, kind, *config); !result)
+            m_Logger->Error("Failed to push the configuration missed by EP#{}.", ep.GetID());
+        else
+            PMGRD_LOG_LIMITED(*m_Logger, Info, "Pushed the configuration missed by EP#{} while it was away.",
+                              ep.GetID());
+    }
+
+    Result<Err> Application::ConnectToRC(const RequestsDelegate& requests) noexcept
     {
         const auto ip_endpoint = IPEndPoint_New(net::IPAddress_Parse(Application::RootServerIP),
                                                 net::AddressFamily_InterNetwork, Application::RootServerPort);
 
+        if (const auto applied = net::SetSocketOptions(m_Socket, m_SocketOptions); !applied)
+        {
+            const auto err = applied.UnwrapErr();
+            m_Logger->Warn("Not every socket option could be applied.\n\t{}", err);
+        }
+
+        // A socket only knows about milliseconds up to u16, longer timeouts are capped.
+        m_Socket->timeout = static_cast<u16>(std::min<i64>(net::Timeouts::Defaults().connect.count(), UINT16_MAX));
         if (net::Socket_Connect(m_Socket, ip_endpoint) == CS_SOCKET_ERROR)
-            return Err{ ErrType::NetConnectionTimeout, "Failed to connect to ({}:{}).", ip_endpoint.address.str,
-                        m_Ep.port };
+            return Err{ ErrType::NetConnectionTimeout, "Failed to connect to ({}:{}): {}", ip_endpoint.address.str,
+                        ip_endpoint.port, std::strerror(errno) };
 
-        // Grab Node ID from /etc/vlink.conf.
-        auto node_file = utils::fs::ReadToString("/etc/vlink.conf");
-        if (node_file)
-            m_NodeID = static_cast<u8>(std::stoi(utils::StrSplit(node_file.Unwrap(), '=')[1]));
-        else
-            return node_file.UnwrapErr();
+        TRY_UNWRAP(ReadNodeID());
 
         m_Logger->Info("Node ID: {}", m_NodeID);
         m_Logger->Info("Connected to Root Complex.");
         m_Logger->Info("Sending InitConn packet...");
 
+        net::EventLoop loop;
+        TRY_UNWRAP(loop.Open());
+
+        // Pushes may arrive as soon as the Endpoint is registered, they are applied as they come.
+        net::AsyncConnection rc{ loop, m_Socket,
+                                 [this](net::Packet&& packet) { ApplyPushedConfig(std::move(packet)); } };
+        TRY_UNWRAP(rc.Open());
+
+        return loop.Run(Handshake(rc, (requests) ? requests(rc) : std::vector<net::Task<Result<Err>>>{}));
+    }
+
+    net::Task<Result<Err>> Application::Handshake(net::AsyncConnection&               rc,
+                                                  std::vector<net::Task<Result<Err>>> requests) noexcept
+    {
         // Send Reply to register as an Endpoint.
-        net::Packet initconn{ net::PacketType::Ready };
-        initconn << m_NodeID;
-        TRY_UNWRAP(net::BeginSend(m_Socket, std::move(initconn)));
+        // Only a subscribed Endpoint keeps listening to the RC, and with it answering its pings.
+        u8 flags = (m_Subscribe) ? net::ReadyFlags_Subscribe | net::ReadyFlags_Ping : net::ReadyFlags_None;
+
+        // Large replies and pushes may come in chunks, both the AsyncConnection and ReceiveReply() reassemble them.
+        flags |= net::ReadyFlags_Stream | net::ReadyFlags_Tags;
+        if (m_Reconnect)
+            flags |= net::ReadyFlags_Session;
+        CO_TRY_UNWRAP(co_await rc.Send(net::MakeReady(m_NodeID, flags, m_SessionToken)));
 
         // Wait for Ready acknowledgement.
-        if (const auto result = net::BeginReceive(m_Socket); !result || result.Unwrap().Type() != net::PacketType::Ok)
-            return Err{ ErrType::NetReadyFailure };
+        auto ack = co_await rc.Receive();
+        if (!ack)
+            co_return ack.UnwrapErr();
+        if (ack.Unwrap().Type() != net::PacketType::Ok)
+            co_return Err{ ErrType::NetReadyFailure };
+
+        // An RC honouring tags appends the flags it accepted. Older ones don't, and their replies are matched in the
+        // order they come since they may carry garbage where the tag is.
+        auto        ok           = ack.Unwrap();
+        const usize session_size = (flags & net::ReadyFlags_Session) ? sizeof(u64) + sizeof(u8) : 0;
+        if (ok.data.size() == session_size + sizeof(u8))
+        {
+            u8 accepted;
+            ok >> accepted;
+            rc.SetTagged(accepted & net::ReadyFlags_Tags);
+        }
 
-        // Request for configuration.
-        if (m_CrewStation)
+        // An RC predating sessions acknowledges without one, fall back to configuring from scratch every time.
+        bool resumed = false;
+        if (session_size != 0 && ok.data.size() == session_size)
+        {
+            u8 resumed_flag;
+            ok >> resumed_flag >> m_SessionToken;
+
+            // The RC pushes whatever configuration was missed, nothing left to request.
+            resumed = resumed_flag != 0;
+            if (resumed)
+                m_Logger->Info("Resumed session {:016x} (configuration version {:016x}).", m_SessionToken,
+                               m_ConfigVersion);
+            else
+                m_Logger->Info("Opened session {:016x}.", m_SessionToken);
+        }
+
+        // The configuration and whatever else was requested are in flight together.
+        if ((m_CrewStation || m_Concentrator) && !resumed)
+            requests.insert(requests.begin(), FetchConfig(rc));
+
+        for (auto& result : co_await net::WhenAll(std::move(requests)))
         {
-            TRY_UNWRAP(net::BeginSend(m_Socket, net::PacketType::GetCrewConfig));
-            auto result = net::BeginReceive(m_Socket);
             if (!result)
-                return result.UnwrapErr();
+                co_return result.UnwrapErr();
+        }
+        co_return Ok();
+    }
 
-            // Check if the packet itself is an error.
-            auto the_horror = result.Unwrap();
-            if (!the_horror)
-                return Err::FromPacket(std::move(the_horror));
+    net::Task<Result<Err>> Application::FetchConfig(net::AsyncConnection& rc) noexcept
+    {
+        const auto  kind = (m_CrewStation) ? ConfigKind::CrewStation : ConfigKind::Concentrator;
+        net::Packet request{ (m_CrewStation) ? net::PacketType::GetCrewConfig : net::PacketType::GetCtrConfig };
+
+        // Tell the RC which version we have so that it doesn't resend an identical configuration.
+        request << m_ConfigVersion;
+        auto result = co_await rc.Request(std::move(request));
+        if (!result)
+            co_return result.UnwrapErr();
 
-            // Parse the configuration.
-            std::string jsonstr;
-            result.Unwrap() >> jsonstr;
+        // Check if the packet itself is an error.
+        auto the_horror = result.Unwrap();
+        if (!the_horror)
+            co_return Err::FromPacket(std::move(the_horror));
 
-            m_Logger->Log(__func__, lgx::Level::Info, "Crew config: {}", jsonstr);
+        if (the_horror.Type() == net::PacketType::NotModified)
+        {
+            m_Logger->Info("Configuration is up to date (version {:016x}).", m_ConfigVersion);
+            co_return Ok();
+        }
+
+        // RCs predating versions ignore ours and answer with the bare configuration, its version is its hash.
+        u64         version = 0;
+        std::string jsonstr;
+        if (the_horror.Type() == net::PacketType::Config)
+        {
+            if (the_horror.data.size() < sizeof(u64))
+                co_return Err{ ErrType::NetBadPacket, "The RC sent a Config packet of {} bytes.",
+                               the_horror.data.size() };
+            the_horror >> version >> jsonstr;
+        }
+        else if (the_horror.Type() == net::PacketType::String)
+        {
+            the_horror >> jsonstr;
+            version = NodeConfig{ jsonstr }.version;
         }
-        else if (m_Concentrator)
+        else
+            co_return Err{ ErrType::NetBadPacket, "The RC replied with an unexpected {} packet.",
+                           net::TypeToStr(the_horror) };
+        CO_TRY_UNWRAP(ApplyConfig(kind, jsonstr, version));
+
+        if (const auto stored = StoreConfigCache(kind, jsonstr, version); !stored)
+        {
+            const auto err = stored.UnwrapErr();
+            m_Logger->Warn("Failed to cache the configuration.\n\t{}", err);
+        }
+        co_return Ok();
+    }
+
+    net::Task<Result<Err>> Application::Query(net::AsyncConnection& rc, net::Packet request,
+                                              const net::PacketType expected, ReplyDelegate on_reply,
+                                              net::ChunkDelegate on_chunk) noexcept
+    {
+        // The RC is always going to respond with a packet indicating if the operating went well or not.
+        // This is done by checking the returned packet's type field, if it is of type PacketType::Error,
+        // then an Error occured, we can then deserialize the packet to receive the Err object.
+        auto reply = co_await rc.Request(std::move(request), std::move(on_chunk));
+        if (!reply)
+            co_return reply.UnwrapErr();
+
+        auto packet = reply.Unwrap();
+        if (!packet)
+            co_return Err::FromPacket(std::move(packet));
+        if (packet.Type() != expected)
+            co_return Err{ ErrType::NetBadPacket, "The RC replied with an unexpected {} packet.",
+                           net::TypeToStr(packet) };
+        co_return on_reply(std::move(packet));
+    }
+
+    Result<Err> Application::BindRC(const bool retry) noexcept
+    {
+        const auto ip_endpoint = IPEndPoint_New(net::IPAddress_New(net::IPAddressType_Any),
+                                                net::AddressFamily_InterNetwork, Application::RootServerPort);
+
+        m_Logger->Log(lgx::Level::Info, "Binding to (localhost:{})...", ip_endpoint.port);
+        while (true)
+        {
+            // Accepted Endpoints inherit the options of the listening socket.
+            if (const auto applied = net::SetSocketOptions(m_Socket, m_SocketOptions); !applied)
+            {
+                const auto err = applied.UnwrapErr();
+                PMGRD_LOG_LIMITED(*m_Logger, Warn, "Not every socket option could be applied.\n\t{}", err);
+            }
+
+            if (net::Socket_Bind(m_Socket, ip_endpoint) != CS_SOCKET_ERROR)
+                return Ok();
+
+            if (!retry)
+                return Err{ ErrType::NetSocketError, "Failed to bind to endpoint ({}:{}).", ip_endpoint.address.str,
+                            ip_endpoint.port };
+
+            // The primary may be hung rather than gone, the port frees up once it exits.
+            PMGRD_LOG_LIMITED(*m_Logger, Warn, "Port {} is still taken, retrying...", ip_endpoint.port);
+            std::this_thread::sleep_for(Application::BindRetryInterval);
+
+            // A failed bind closes the socket, the NetHandler keeps referring to the same object.
+            if (net::Socket_From(m_Socket, net::AddressFamily_InterNetwork, net::SocketType_Stream,
+                                 net::ProtocolType_Tcp) == CS_SOCKET_ERROR)
+                return Err{ ErrType::NetSocketError, "Failed to recreate the RC socket." };
+        }
+    }
+
+    std::chrono::steady_clock::time_point Application::StandBy() noexcept
+    {
+        m_Logger->Info("Standing by for the RC at {}.", m_StandbyOf);
+
+        net::ReplicationFollower follower{ *m_Logger, m_ReplicationMetrics };
+        follower.Follow(m_StandbyOf, Application::RootServerPort);
+
+        auto& state = follower.GetState();
+        if (!state.synced)
+            m_Logger->Warn("The primary RC failed before the standby was in sync, taking over what was replicated.");
+        m_Logger->Info("Taking over {} group(s) and {} session(s).", state.groups.size(), state.sessions.size());
+
+        m_Groups = std::move(state.groups);
+        for (const auto& [token, session] : state.sessions)
+            m_NetHandler->RestoreSession(token, session);
+
+        // The configuration may have changed while standing by.
+        if (!m_CameraConfigPath.empty())
+        {
+            if (const auto result = LoadCameraConfig(); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger->Error("Failed to reload the camera configuration!\n\t{}", err);
+            }
+        }
+
+        return follower.GetLastHeard();
+    }
+
+    Result<Err> Application::ReconnectToRC() noexcept
+    {
+        std::mt19937 rng{ std::random_device{}() };
+        auto         backoff = Application::ReconnectBackoffMin;
+        for (u32 attempt = 1;; ++attempt)
+        {
+            {
+                std::scoped_lock lock{ m_SocketMutex };
+                if (m_Stopping.load())
+                    return Err{ ErrType::InvalidState, "Stopped reconnecting to the RC." };
+
+                // A socket can't connect again once it has been connected.
+                net::Socket_Dispose(m_Socket);
+                m_Socket =
+                    net::Socket_New(net::AddressFamily_InterNetwork, net::SocketType_Stream, net::ProtocolType_Tcp);
+            }
+
+            const auto result = ConnectToRC();
+            if (result)
+            {
+                // Stopping may have shut down the socket before it connected, which doesn't unblock anything.
+                std::scoped_lock lock{ m_SocketMutex };
+                if (m_Stopping.load())
+                    return Err{ ErrType::InvalidState, "Stopped reconnecting to the RC." };
+
+                m_Logger->Info("Connected to the RC after {} attempt(s).", attempt);
+                return Ok();
+            }
+
+            const auto err = result.UnwrapErr();
+            m_Logger->Warn("Failed to connect to the RC (attempt {}).\n\t{}", attempt, err);
+
+            // Full jitter, Endpoints that lost the RC at the same time spread out instead of retrying in lockstep.
+            std::uniform_int_distribution<i64> jitter{ 0, backoff.count() };
+            const auto                         delay = std::chrono::milliseconds{ jitter(rng) };
+            backoff = std::min(backoff * 2, Application::ReconnectBackoffMax);
+
+            std::unique_lock lock{ m_SocketMutex };
+            if (m_StopCV.wait_for(lock, delay, [this]() { return m_Stopping.load(); }))
+                return Err{ ErrType::InvalidState, "Stopped reconnecting to the RC." };
+        }
+    }
+
+    void Application::ListenForUpdates(const bool cached) noexcept
+    {
+        bool connected = true;
+        if (cached)
+        {
+            const auto cached_version = m_ConfigVersion;
+            if (const auto result = ConnectToRC(); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger->Warn("Failed to revalidate the cached configuration.\n\t{}", err);
+                connected = false;
+            }
+            else if (m_ConfigVersion != cached_version)
+                m_Logger->Info("The cached configuration was stale.");
+        }
+
+        while (true)
+        {
+            // ReceiveReply() applies every ConfigUpdate on its own.
+            while (connected && m_Subscribe && ReceiveReply())
+                m_Logger->Warn("Ignoring an unexpected packet from the RC.");
+
+            if (!m_Reconnect || m_Stopping.load())
+                return;
+
+            m_Logger->Warn("Lost the connection to the RC, reconnecting...");
+            if (!ReconnectToRC())
+                return;
+            connected = true;
+        }
+    }
+
+    ValuedResult<net::Packet, Err> Application::ReceiveReply() noexcept
+    {
+        while (true)
         {
-            TRY_UNWRAP(net::BeginSend(m_Socket, net::PacketType::GetCtrConfig));
             auto result = net::BeginReceive(m_Socket);
             if (!result)
-                return result.UnwrapErr();
+                return result;
+
+            // Pushed configurations are only of any use whole.
+            if (result.Unwrap().Type() == net::PacketType::StreamBegin)
+            {
+                result = net::ReceiveStream(m_Socket, result.Unwrap());
+                if (!result)
+                    return result;
+            }
+
+            switch (result.Unwrap().Type())
+            {
+                case net::PacketType::ConfigUpdate: ApplyPushedConfig(result.Unwrap()); break;
+                case net::PacketType::Ping: AnswerPing(result.Unwrap(), net::ClockSync::Now()); break;
+                default: return result;
+            }
+        }
+    }
+
+    void Application::AnswerPing(net::Packet&& ping, const i64 received_at) noexcept
+    {
+        if (ping.data.size() != sizeof(i64))
+            return;
+
+        // Echoing the RC's timestamp as is, the RC works the round out on its own.
+        net::Packet pong{ net::PacketType::Pong, std::move(ping.data) };
+        pong << received_at << net::ClockSync::Now();
+        if (const auto sent = net::BeginSend(m_Socket, std::move(pong)); !sent)
+        {
+            const auto err = sent.UnwrapErr();
+            m_Logger->Warn("Failed to answer the RC's ping.\n\t{}", err);
+        }
+    }
+
+    void Application::ApplyPushedConfig(net::Packet&& packet) noexcept
+    {
+        if (packet.data.size() < sizeof(u8) + sizeof(u64))
+        {
+            m_Logger->Error("The RC pushed a malformed configuration of {} bytes.", packet.data.size());
+            return;
+        }
+
+        u8  kind;
+        u64 version;
+        packet >> kind >> version;
+
+        // Only the configuration this node asks for, anything else would also poison the cache.
+        const auto expected = (m_CrewStation) ? ConfigKind::CrewStation : ConfigKind::Concentrator;
+        if (kind != static_cast<u8>(expected))
+        {
+            m_Logger->Error("The RC pushed a configuration of kind {} to a node of kind {}.", kind,
+                            static_cast<u8>(expected));
+            return;
+        }
+
+        std::string jsonstr;
+        packet >> jsonstr;
+        if (const auto applied = ApplyConfig(expected, jsonstr, version); !applied)
+        {
+            const auto err = applied.UnwrapErr();
+            m_Logger->Error("Failed to apply the configuration pushed by the RC!\n\t{}", err);
+        }
+        else if (const auto stored = StoreConfigCache(expected, jsonstr, version); !stored)
+        {
+            const auto err = stored.UnwrapErr();
+            m_Logger->Warn("Failed to cache the configuration.\n\t{}", err);
+        }
+    }
+
+    Result<Err> Application::ApplyConfig(const ConfigKind kind, const std::string& jsonstr, const u64 version) noexcept
+    {
+        const auto j = nlohmann::json::parse(jsonstr, nullptr, false);
+        if (j.is_discarded())
+            return Err{ ErrType::JsonParseError, "The RC sent a malformed configuration." };
+
+        try
+        {
+            switch (kind)
+            {
+                case ConfigKind::CrewStation: {
+                    m_CurrentCrewConfig.nodeId = m_NodeID;
+                    m_CurrentCrewConfig.groups = j.get<std::vector<GroupID>>();
+
+                    m_Logger->Log(__func__, lgx::Level::Info, "Crew config: {}", jsonstr);
+                    break;
+                }
+                case ConfigKind::Concentrator: {
+                    // Deserialise it from json to list of cameras and validate them.
+                    auto cameras = j.at("cameras").get<std::list<Camera>>();
+                    for (auto& e : cameras)
+                    {
+                        e.nodeId = m_NodeID;
+                        TRY_UNWRAP(e.Validate());
+                        if (!e.cpuSet.empty())
+                            TRY_UNWRAP(utils::sys::ParseCpuList(e.cpuSet));
+                    }
+                    m_Cameras = std::move(cameras);
+
+                    // Only the pipelines of the cameras that changed get restarted.
+                    if (m_Supervisor)
+                        m_Supervisor->Reload(BuildPipelines());
+
+                    m_Logger->Log(__func__, lgx::Level::Info, "Concentrator config: {}", jsonstr);
+                    break;
+                }
+                default: return Err{ ErrType::InvalidOperation, "Unknown configuration kind." };
+            }
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            const std::string_view what = e.what();
+            return Err{ ErrType::JsonParseError, "{}", what };
+        }
+
+        m_ConfigVersion = version;
+        return Ok();
+    }
 
-            // Check if the packet itself is an error.
-            auto the_horror = result.Unwrap();
-            if (!the_horror)
-                return Err::FromPacket(std::move(the_horror));
+    Result<Err> Application::ReadNodeID() noexcept
+    {
+        // Grab Node ID from /etc/vlink.conf.
+        auto node_file = utils::fs::ReadToString("/etc/vlink.conf");
+        if (!node_file)
+            return node_file.UnwrapErr();
 
-            // Parse the configuration.
-            std::string jsonstr;
-            result.Unwrap() >> jsonstr;
+        const auto fields = utils::StrSplit(node_file.Unwrap(), '=');
+        if (fields.size() < 2)
+            return Err{ ErrType::InvalidState, "/etc/vlink.conf does not contain a node id." };
 
-            // Convert to json and deserialise it from json to vector of cameras.
-            nlohmann::json j = nlohmann::json::parse(jsonstr);
-            m_Cameras        = j["cameras"].get<std::list<Camera>>();
+        // Node ids are 16-bit, the trailing newline is ignored.
+        const auto& value    = fields[1];
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), m_NodeID);
+        if (ec != std::errc{} || (ptr != value.data() + value.size() && !std::isspace(*ptr)))
+            return Err{ ErrType::InvalidState, "Invalid node id '{}' in /etc/vlink.conf.", value };
+        return Ok();
+    }
+
+    Result<Err> Application::LoadConfigCache(const ConfigKind kind) noexcept
+    {
+        TRY_UNWRAP(ReadNodeID());
 
-            // Validate cameras.
-            for (const auto& e : m_Cameras)
-                TRY_UNWRAP(e.Validate());
+        const auto content = utils::fs::ReadToString(m_ConfigCachePath);
+        if (!content)
+            return content.UnwrapErr();
 
-            m_Logger->Log(__func__, lgx::Level::Info, "Crew config: {}", jsonstr);
+        const auto j = nlohmann::json::parse(content.Unwrap(), nullptr, false);
+        if (j.is_discarded() || !j.is_object())
+            return Err{ ErrType::JsonParseError, "'{}' is corrupted.", m_ConfigCachePath };
+
+        try
+        {
+            const auto cached_kind = static_cast<ConfigKind>(j.at("kind").get<u8>());
+            const auto node_id     = j.at("nodeId").get<NodeID>();
+            const auto version     = j.at("version").get<u64>();
+            auto       jsonstr     = j.at("config").get<std::string>();
+
+            if (cached_kind != kind || node_id != m_NodeID)
+                return Err{ ErrType::InvalidState, "'{}' belongs to another node.", m_ConfigCachePath };
+            if (NodeConfig{ jsonstr }.version != version)
+                return Err{ ErrType::InvalidState, "'{}' does not match its version.", m_ConfigCachePath };
+
+            TRY_UNWRAP(ApplyConfig(kind, jsonstr, version));
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            const std::string_view what = e.what();
+            return Err{ ErrType::JsonParseError, "{}", what };
         }
 
+        m_Logger->Info("Loaded the cached configuration (version {:016x}).", m_ConfigVersion);
         return Ok();
     }
 
+    Result<Err> Application::StoreConfigCache(const ConfigKind kind, const std::string& jsonstr,
+                                              const u64 version) noexcept
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path{ m_ConfigCachePath }.parent_path(), ec);
+
+        nlohmann::json j;
+        j["kind"]    = static_cast<u8>(kind);
+        j["nodeId"]  = m_NodeID;
+        j["version"] = version;
+        j["config"]  = jsonstr;
+        return utils::fs::WriteAtomic(m_ConfigCachePath, j.dump());
+    }
+
+    std::vector<PipelineSpec> Application::BuildPipelines() const noexcept
+    {
+        const auto launcher = (m_Supervisor) ? m_Supervisor->GetLauncher() : PipelineSupervisor::DefaultLauncher;
+
+        std::vector<PipelineSpec> specs;
+        specs.reserve(m_Cameras.size());
+        for (const auto& cam : m_Cameras)
+            specs.push_back(BuildGstPipeline(cam, launcher));
+        return specs;
+    }
+
     [[nodiscard]] Result<Err> Application::Arg_DaemonHandler(
         [[maybe_unused]] std::vector<std::string_view> args) noexcept
     {
@@ -312,6 +1060,25 @@ namespace pmgrd {
         return Ok();
     }
 
+    [[nodiscard]] Result<Err> Application::Arg_AsyncLogHandler(std::vector<std::string_view> args) noexcept
+    {
+        auto policy = Logger::OverflowPolicy::Drop;
+        if (const auto parts = utils::StrSplit(args[0], '='); parts.size() > 1)
+        {
+            if (parts[1] == "block")
+                policy = Logger::OverflowPolicy::Block;
+            else if (parts[1] != "drop")
+                return Err{ ErrType::UnknownArgument, "Unknown overflow policy '{}'.", parts[1] };
+        }
+
+        return m_Logger->StartAsync(Logger::DefaultCapacity, policy);
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_BinaryLogHandler(std::vector<std::string_view> args) noexcept
+    {
+        return m_Logger->StartBinary(std::string{ utils::StrSplit(args[0], '=')[1] }, BinaryLog::DefaultCapacity);
+    }
+
     [[nodiscard]] Result<Err> Application::Arg_RCHandler([[maybe_unused]] std::vector<std::string_view> args) noexcept
     {
         m_RootComplex = true;
@@ -323,51 +1090,84 @@ namespace pmgrd {
         const auto prefix = m_Logger->GetDefaultPrefix();
         m_Logger->SetDefaultPrefix((prefix.back() == 'd') ? "RPd" : "RP");
 
-        const auto ip_endpoint = IPEndPoint_New(net::IPAddress_New(net::IPAddressType_Any),
-                                                net::AddressFamily_InterNetwork, Application::RootServerPort);
+        return Ok();
+    }
 
-        m_Logger->Log(lgx::Level::Info, "Binding to (localhost:{})...", ip_endpoint.port);
-        if (net::Socket_Bind(m_Socket, ip_endpoint) == CS_SOCKET_ERROR)
-            return Err{ ErrType::NetSocketError, "Failed to bind to endpoint ({}:{}).", ip_endpoint.address.str,
-                        m_Ep.port };
+    [[nodiscard]] Result<Err> Application::Arg_StandbyHandler(std::vector<std::string_view> args) noexcept
+    {
+        m_StandbyOf = utils::StrSplit(args[0], '=')[1];
+        if (m_StandbyOf.empty())
+            return Err{ ErrType::InvalidOperation, "The address of the primary RC is required." };
+        return Ok();
+    }
 
+    [[nodiscard]] Result<Err> Application::Arg_StandbyPeersHandler(std::vector<std::string_view> args) noexcept
+    {
+        for (const auto peer : utils::StrSplit(utils::StrSplit(args[0], '=')[1], ','))
+        {
+            if (!peer.empty())
+                m_StandbyPeers.emplace_back(peer);
+        }
+        if (m_StandbyPeers.empty())
+            return Err{ ErrType::InvalidOperation, "The address of at least one standby RC is required." };
         return Ok();
     }
 
-    [[nodiscard]] Result<Err> Application::Arg_JoinHandler([[maybe_unused]] std::vector<std::string_view> args) noexcept
+    [[nodiscard]] Result<Err> Application::Arg_JournalHandler(std::vector<std::string_view> args) noexcept
     {
-        if (auto result = ConnectToRC(); !result)
-            return result;
+        m_JournalPath = utils::StrSplit(args[0], '=')[1];
+        if (m_JournalPath.empty())
+            return Err{ ErrType::InvalidOperation, "The journal directory is required." };
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_JoinHandler(std::vector<std::string_view> args) noexcept
+    {
+        const auto group_ids = ParseGroupArgs(args);
+        if (!group_ids)
+            return group_ids.UnwrapErr();
 
-        // BUG: args[1] might not be a number or it might not exist at all.
-        net::Packet packet{ net::PacketType::Join };
-        packet << std::stoi(args[1].data());
-        net::BeginSend(m_Socket, std::move(packet));
-        if (auto result = net::BeginReceive(m_Socket).Unwrap(); result.Type() == net::PacketType::Err)
-            return Err::FromPacket(std::move(result));
+        TRY_UNWRAP(ConnectToRC([this, &group_ids](net::AsyncConnection& rc)
+                               { return ChangeMembership(rc, net::PacketType::Join, group_ids.Unwrap()); }));
 
         m_Logger->Log(lgx::Level::Info, "Successfully joined.");
         return Ok();
     }
 
-    [[nodiscard]] Result<Err> Application::Arg_LeaveHandler(
-        [[maybe_unused]] std::vector<std::string_view> args) noexcept
+    [[nodiscard]] Result<Err> Application::Arg_LeaveHandler(std::vector<std::string_view> args) noexcept
     {
-        if (auto result = ConnectToRC(); !result)
-            return result;
+        const auto group_ids = ParseGroupArgs(args);
+        if (!group_ids)
+            return group_ids.UnwrapErr();
 
-        // BUG: args[1] might not be a number or it might not exist at all.
-        net::Packet packet{ net::PacketType::Leave };
-        packet << std::stoi(args[1].data());
-        net::BeginSend(m_Socket, std::move(packet));
-        auto result1 = net::BeginReceive(m_Socket);
-        if (auto result = result1.Unwrap(); result.Type() == net::PacketType::Err)
-            return Err::FromPacket(std::move(result));
+        TRY_UNWRAP(ConnectToRC([this, &group_ids](net::AsyncConnection& rc)
+                               { return ChangeMembership(rc, net::PacketType::Leave, group_ids.Unwrap()); }));
 
         m_Logger->Log(lgx::Level::Info, "Successfully left.");
         return Ok();
     }
 
+    std::vector<net::Task<Result<Err>>> Application::ChangeMembership(net::AsyncConnection&       rc,
+                                                                      const net::PacketType       type,
+                                                                      const std::vector<GroupID>& group_ids) noexcept
+    {
+        // Every group is requested at once rather than waiting for the RC to acknowledge them one by one.
+        std::vector<net::Task<Result<Err>>> requests;
+        for (const auto group_id : group_ids)
+        {
+            net::Packet packet{ type };
+            packet << group_id;
+            requests.push_back(Query(rc, std::move(packet), net::PacketType::Ok,
+                                     [this, type, group_id](net::Packet&&) -> Result<Err>
+                                     {
+                                         m_Logger->Info("{} group {}.",
+                                                        (type == net::PacketType::Join) ? "Joined" : "Left", group_id);
+                                         return Ok();
+                                     }));
+        }
+        return requests;
+    }
+
     [[nodiscard]] Result<Err> Application::Arg_CamconfHandler(std::vector<std::string_view> args) noexcept
     {
         m_CameraConfigPath = utils::StrSplit(args[0], '=')[1];
@@ -377,86 +1177,116 @@ namespace pmgrd {
 
     [[nodiscard]] Result<Err> Application::Arg_SendStrHandler(std::vector<std::string_view> args) noexcept
     {
-        if (auto result = ConnectToRC(); !result)
-            return result;
-
         auto        msg = utils::StrSplit(args[0], '=')[1];
         net::Packet packet;
         packet.header.type = net::PacketType::String;
         packet << msg;
-        net::BeginSend(m_Socket, std::move(packet));
 
-        // The RC is always going to respond with a packet indicating if the operating went well or not.
-        // This is done by checking the returned packet's type field, if it is of type PacketType::Error,
-        // then an Error occured, we can then deserialize the packet to receive the Err object.
-        // Otherwise PacketType::Ok is returned.
-        auto recv_packet = net::BeginReceive(m_Socket);
-        if (recv_packet)
-        {
-            auto packet = recv_packet.Unwrap();
-            if (packet.header.type == net::PacketType::Ok)
-                m_Logger->Info("Operation succeeded.");
-            else
+        return ConnectToRC(
+            [this, &packet](net::AsyncConnection& rc)
             {
-                return Err::FromPacket(std::move(packet));
-            }
-        }
-        else
-            return Err{ ErrType::NetBadPacket };
-
-        return Ok();
+                std::vector<net::Task<Result<Err>>> requests;
+                requests.push_back(Query(rc, std::move(packet), net::PacketType::Ok,
+                                         [this](net::Packet&&) -> Result<Err>
+                                         {
+                                             m_Logger->Info("Operation succeeded.");
+                                             return Ok();
+                                         }));
+                return requests;
+            });
     }
 
     [[nodiscard]] Result<Err> Application::Arg_RCCommandHandler(std::vector<std::string_view> args) noexcept
     {
-        if (auto result = ConnectToRC(); !result)
-            return result;
-
         // pciemgr rc reboot
-        if (args.size() > 1)
+        if (args.size() < 2)
+        {
+            // TODO: Optimize sub-command handling.
+            m_Logger->Info("Usage: {} rc | root <command>\nList of available commands:\n\treboot\tReboots the Root "
+                           "Complex.\n\tstats\tPrints the Root Complex's metrics.\n\ttrace [file]\tWrites the Root Complex's "
+                           "spans in the Chrome trace-event format.\n\tclocks\tPrints the round-trip time to every "
+                           "subscribed Endpoint and how far its clock is ahead of the Root Complex's.",
+                           GetBinaryName());
+            return Ok();
+        }
+
+        // Text replies are printed as they come in, however large they are.
+        const auto print_chunk = [](const u8* data, const usize size) -> Result<Err>
+        {
+            fmt::print("{}", std::string_view{ reinterpret_cast<const char*>(data), size });
+            return Ok();
+        };
+
+        net::PacketType    type;
+        ReplyDelegate      on_reply;
+        net::ChunkDelegate on_chunk;
+        const auto         cmd = utils::StrLower(args[1]);
+        if (cmd == "reboot")
+        {
+            type     = net::PacketType::Reboot;
+            on_reply = [this](net::Packet&&) -> Result<Err>
+            {
+                m_Logger->Info("RC rebooting...");
+                return Ok();
+            };
+        }
+        else if (cmd == "stats")
         {
-            const auto cmd = args[1];
-            if (utils::StrLower(cmd) == "reboot")
+            type     = net::PacketType::Stats;
+            on_chunk = print_chunk;
+            on_reply = [](net::Packet&& packet) -> Result<Err>
             {
-                // TODO: Write a command handler?
-                net::BeginSend(m_Socket, net::Packet{ net::PacketType::Reboot });
-                auto reply = net::BeginReceive(m_Socket);
-                if (reply)
+                std::string text;
+                packet >> text;
+                fmt::print("{}", text);
+                return Ok();
+            };
+        }
+        else if (cmd == "clocks")
+        {
+            type     = net::PacketType::Clocks;
+            on_chunk = print_chunk;
+            on_reply = [](net::Packet&& packet) -> Result<Err>
+            {
+                std::string text;
+                packet >> text;
+                fmt::print("{}", text);
+                return Ok();
+            };
+        }
+        else if (cmd == "trace")
+        {
+            // A trace written to a file is only replaced once it's complete.
+            type     = net::PacketType::Trace;
+            on_chunk = (args.size() > 2) ? net::ChunkDelegate{} : print_chunk;
+            on_reply = [this, &args](net::Packet&& packet) -> Result<Err>
+            {
+                std::string json;
+                packet >> json;
+                if (args.size() > 2)
                 {
-                    auto packet = reply.Unwrap();
-                    switch (packet.header.type)
-                    {
-                        default:
-                        case net::PacketType::Ok: {
-                            m_Logger->Info("RC rebooting...");
-                            break;
-                        }
-                        case net::PacketType::Err: {
-                            // Receive the error from the server.
-                            return Err::FromPacket(std::move(packet));
-                        }
-                    }
+                    TRY_UNWRAP(utils::fs::WriteAtomic(std::string{ args[2] }, json));
+                    m_Logger->Info("Trace written to '{}'.", args[2]);
                 }
                 else
-                {
-                    m_Logger->Error("RC failed to acknowledge the command.");
-                    return Err{ ErrType::Timeout };
-                }
-            }
-            else
-            {
-                return Err{ ErrType::UnknownSubCommand };
-            }
+                    fmt::print("{}", json);
+                return Ok();
+            };
         }
         else
         {
-            // TODO: Optimize sub-command handling.
-            m_Logger->Info(
-                "Usage: {} rc | root <command>\nList of available commands:\n\treboot\tReboots the Root Complex.",
-                GetBinaryName());
-            return Ok();
+            return Err{ ErrType::UnknownSubCommand };
         }
-        return Ok();
+
+        // Every command but reboot is answered with a packet of its own type.
+        const auto expected = (type == net::PacketType::Reboot) ? net::PacketType::Ok : type;
+        return ConnectToRC(
+            [&](net::AsyncConnection& rc)
+            {
+                std::vector<net::Task<Result<Err>>> requests;
+                requests.push_back(Query(rc, net::Packet{ type }, expected, std::move(on_reply), std::move(on_chunk)));
+                return requests;
+            });
     }
 
     [[nodiscard]] Result<Err> Application::Arg_CrewStationHandler(
@@ -477,13 +1307,106 @@ namespace pmgrd {
         return Ok();
     }
 
+    [[nodiscard]] Result<Err> Application::Arg_SubscribeHandler(
+        [[maybe_unused]] std::vector<std::string_view> args) noexcept
+    {
+        m_Subscribe = true;
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_ReconnectHandler(
+        [[maybe_unused]] std::vector<std::string_view> args) noexcept
+    {
+        m_Reconnect = true;
+        m_Subscribe = true;
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_CacheHandler(std::vector<std::string_view> args) noexcept
+    {
+        m_ConfigCachePath = utils::StrSplit(args[0], '=')[1];
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_DispatcherCpusHandler(std::vector<std::string_view> args) noexcept
+    {
+        auto cpus = utils::sys::ParseCpuList(utils::StrSplit(args[0], '=')[1]);
+        if (!cpus)
+            return cpus.UnwrapErr();
+
+        m_NetHandler->SetDispatcherAffinity(cpus.Unwrap());
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_IOCpusHandler(std::vector<std::string_view> args) noexcept
+    {
+        auto cpus = utils::sys::ParseCpuList(utils::StrSplit(args[0], '=')[1]);
+        if (!cpus)
+            return cpus.UnwrapErr();
+
+        m_NetHandler->SetIOAffinity(cpus.Unwrap());
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_RealtimeHandler(std::vector<std::string_view> args) noexcept
+    {
+        const auto value     = utils::StrSplit(args[0], '=')[1];
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), m_RealtimePriority);
+        if (ec != std::errc{} || ptr != value.data() + value.size() || m_RealtimePriority <= 0)
+            return Err{ ErrType::InvalidOperation, "Invalid real-time priority '{}'.", value };
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_MetricsHandler(std::vector<std::string_view> args) noexcept
+    {
+        m_MetricsTarget = utils::StrSplit(args[0], '=')[1];
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_TraceHandler(std::vector<std::string_view> args) noexcept
+    {
+        m_TracePath = utils::StrSplit(args[0], '=')[1];
+        trace::Tracer::Get().Enable(trace::Tracer::DefaultEventBudget);
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_BacklogHandler(std::vector<std::string_view> args) noexcept
+    {
+        const auto value     = utils::StrSplit(args[0], '=')[1];
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), m_Backlog);
+        if (ec != std::errc{} || ptr != value.data() + value.size() || m_Backlog <= 0)
+            return Err{ ErrType::InvalidOperation, "Invalid backlog '{}'.", value };
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_TimeoutsHandler(std::vector<std::string_view> args) noexcept
+    {
+        auto&      defaults = net::Timeouts::Defaults();
+        const auto timeouts = net::Timeouts::Parse(utils::StrSplit(args[0], '=')[1], defaults);
+        if (!timeouts)
+            return timeouts.UnwrapErr();
+
+        defaults = timeouts.Unwrap();
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_SocketProfileHandler(std::vector<std::string_view> args) noexcept
+    {
+        const auto options = net::SocketProfile(utils::StrSplit(args[0], '=')[1]);
+        if (!options)
+            return options.UnwrapErr();
+
+        m_SocketOptions = options.Unwrap();
+        return Ok();
+    }
+
     [[nodiscard]] Result<Err> Application::Net_StringHandler([[maybe_unused]] Endpoint& ep,
                                                              net::Packet&&              packet) noexcept
     {
         std::string msg;
         packet >> msg;
-        m_Logger->Log(lgx::Level::Info, "Ep sent a string: {}", msg);
-        ep.Send(Ok());
+        PMGRD_LOG(*m_Logger, Info, "Ep sent a string: {}", msg);
+        ep.Reply(Ok());
         return Ok();
     }
 
@@ -494,7 +1417,7 @@ namespace pmgrd {
 
         // Send a fake success packet because this method is never going to return unless the reboot fails (which is
         // unlikely).
-        ep.Send(Ok());
+        ep.Reply(Ok());
 
         // Synchronise filesystems.
         sync();
@@ -508,17 +1431,15 @@ namespace pmgrd {
 
     [[nodiscard]] Result<Err> Application::Net_JoinHandler(Endpoint& ep, [[maybe_unused]] net::Packet&& packet) noexcept
     {
-        m_Logger->Log(__func__, lgx::Level::Info, "Node#{} requested to join.", ep.GetID());
+        PMGRD_LOG_LIMITED(*m_Logger, Info, "Node#{} requested to join.", ep.GetID());
 
-        u8 group_id;
-        packet >> group_id;
-        auto it = std::find(m_Groups[group_id].begin(), m_Groups[group_id].end(), ep.GetID());
-        if (it == m_Groups[group_id].end())
-            m_Groups[group_id].push_back(ep.GetID());
-        else
-            return Err{ ErrType::InvalidOperation, "Already in group {}.", group_id };
+        const auto group_id = net::ParseGroupID(std::move(packet));
+        if (!group_id)
+            return group_id.UnwrapErr();
 
-        ep.Send(Ok());
+        if (!m_Groups[group_id.Unwrap()].insert(ep.GetID()).second)
+            return Err{ ErrType::InvalidOperation, "Already in group {}.", group_id.Unwrap() };
+        CommitMembership(ep, MembershipOp::Join, group_id.Unwrap());
 
         return Ok();
     }
@@ -526,140 +1447,237 @@ namespace pmgrd {
     [[nodiscard]] Result<Err> Application::Net_LeaveHandler(Endpoint&                      ep,
                                                             [[maybe_unused]] net::Packet&& packet) noexcept
     {
-        m_Logger->Log(__func__, lgx::Level::Info, "Node#{} requested to leave.", ep.GetID());
+        PMGRD_LOG_LIMITED(*m_Logger, Info, "Node#{} requested to leave.", ep.GetID());
 
-        u8 group_id;
-        packet >> group_id;
-        auto it = std::find(m_Groups[group_id].begin(), m_Groups[group_id].end(), ep.GetID());
-        if (it != m_Groups[group_id].end())
-            m_Groups[group_id].erase(it);
-        else
-            return Err{ ErrType::InvalidOperation, "Not in group {}. Join first.", group_id };
+        const auto group_id = net::ParseGroupID(std::move(packet));
+        if (!group_id)
+            return group_id.UnwrapErr();
 
-        ep.Send(Ok());
+        const auto it = m_Groups.find(group_id.Unwrap());
+        if (it == m_Groups.end() || !it->second.erase(ep.GetID()))
+            return Err{ ErrType::InvalidOperation, "Not in group {}. Join first.", group_id.Unwrap() };
+
+        // Only groups with members are kept around.
+        if (it->second.empty())
+            m_Groups.erase(it);
+        CommitMembership(ep, MembershipOp::Leave, group_id.Unwrap());
 
         return Ok();
     }
 
-    [[nodiscard]] Result<Err> Application::Net_GetCrewConfigHandler(Endpoint&                      ep,
-                                                                    [[maybe_unused]] net::Packet&& packet) noexcept
+    [[nodiscard]] Result<Err> Application::Net_GetCrewConfigHandler(Endpoint& ep, net::Packet&& packet) noexcept
     {
         const auto ep_id = ep.GetID();
+        PMGRD_LOG_LIMITED(*m_Logger, Info, "EP#{} requested for crew configuration.", ep_id);
 
-        LoadCameraConfig();
+        std::shared_ptr<const NodeConfig> config;
+        {
+            std::scoped_lock lock{ m_ConfigMutex };
+            config = m_ConfigSnapshot.Find(ConfigKind::CrewStation, ep_id);
+        }
+        if (!config)
+            return Err{ ErrType::NotFound, "Node#{} is not a crew station.", ep_id };
 
-        m_Logger->Info("EP#{} requested for crew configuration.", ep_id);
+        ep.SetConfigKind(ConfigKind::CrewStation);
+        return SendConfig(ep, *config, std::move(packet));
+    }
 
-        auto it = std::find_if(m_CrewStations.begin(), m_CrewStations.end(),
-                               [ep_id](const auto& crew) { return crew.nodeId == ep_id; });
+    [[nodiscard]] Result<Err> Application::Net_GetCtrConfigHandler(Endpoint& ep, net::Packet&& packet) noexcept
+    {
+        const auto ep_id = ep.GetID();
+        PMGRD_LOG_LIMITED(*m_Logger, Info, "EP#{} requested for concentrator configuration.", ep_id);
 
-        nlohmann::json j = it->groups;
-        if (it != m_CrewStations.end())
-            ep.Send(net::Packet{ net::PacketType::String, j.dump(4) });
-        else
-            return Err{ ErrType::NotFound, "Node#{} is not a crew station.", ep_id };
+        std::shared_ptr<const NodeConfig> config;
+        {
+            std::scoped_lock lock{ m_ConfigMutex };
+            config = m_ConfigSnapshot.Find(ConfigKind::Concentrator, ep_id);
+        }
+        if (!config)
+            return Err{ ErrType::InvalidOperation, "Ep# {} did not match any crew stations.", ep_id };
 
-        return Ok();
+        ep.SetConfigKind(ConfigKind::Concentrator);
+        return SendConfig(ep, *config, std::move(packet));
     }
 
-    [[nodiscard]] Result<Err> Application::Net_GetCtrConfigHandler(Endpoint&                      ep,
-                                                                   [[maybe_unused]] net::Packet&& packet) noexcept
+    [[nodiscard]] Result<Err> Application::Net_StatsHandler(Endpoint&                      ep,
+                                                            [[maybe_unused]] net::Packet&& packet) noexcept
     {
-        const auto ep_id = ep.GetID();
-        m_Logger->Info("EP#{} requested for concentrator configuration.", ep_id);
+        return ep.Reply(net::Packet{ net::PacketType::Stats, m_Metrics.ToOpenMetrics() });
+    }
 
-        LoadCameraConfig();
+    [[nodiscard]] Result<Err> Application::Net_TraceHandler(Endpoint&                      ep,
+                                                            [[maybe_unused]] net::Packet&& packet) noexcept
+    {
+        auto& tracer = trace::Tracer::Get();
+        if (!tracer.IsEnabled())
+            return Err{ ErrType::InvalidState, "Tracing is disabled, start the RC with --trace." };
 
-        nlohmann::json j;
-        auto           crew_it = std::find_if(m_CrewStations.begin(), m_CrewStations.end(),
-                                              [ep_id](const auto& crew) { return crew.nodeId == ep_id; });
+        return ep.Reply(net::Packet{ net::PacketType::Trace, tracer.ToChromeJson() });
+    }
 
-        if (crew_it != m_CrewStations.end())
-        {
-            j["nodeId"] = crew_it->nodeId;
-            for (const auto group_id : crew_it->groups)
+    [[nodiscard]] Result<Err> Application::Net_ClocksHandler(Endpoint&                      ep,
+                                                             [[maybe_unused]] net::Packet&& packet) noexcept
+    {
+        const auto now = std::chrono::system_clock::now();
+        const auto ms  = [](const i64 ns) { return static_cast<double>(ns) / 1e6; };
+
+        std::string text;
+        auto        it = std::back_inserter(text);
+        fmt::format_to(it, "{:<8}{:<24}{:>10}{:>10}{:>12}{:>10}{:>8}\n", "NODE", "ADDRESS", "RTT ms", "MIN ms",
+                       "OFFSET ms", "ROUNDS", "AGE s");
+        m_NetHandler->ForEachEndpoint(
+            [&](Endpoint& other)
             {
-                auto cam_it = std::find_if(m_Cameras.begin(), m_Cameras.end(),
-                                           [group_id](const auto& cam) { return cam.id == group_id; });
-                if (cam_it != m_Cameras.end())
-                    j["cameras"].push_back(*cam_it);
-            }
-        }
-        else
-            return Err{ ErrType::InvalidOperation, "Ep# {} did not match any crew stations.", ep_id };
+                // Endpoints that don't answer pings are never sent any.
+                const auto estimate = other.GetClock().Estimate();
+                if (estimate.pings == 0)
+                    return;
+
+                const auto* socket  = other.GetSocket();
+                const auto  address = fmt::format("{}:{}", socket->remote_ep.address.str, socket->remote_ep.port);
+                const auto  rounds  = fmt::format("{}/{}", estimate.samples, estimate.pings);
+                if (estimate.samples == 0)
+                {
+                    fmt::format_to(it, "{:<8}{:<24}{:>10}{:>10}{:>12}{:>10}{:>8}\n", other.GetID(), address, "-", "-",
+                                   "-", rounds, "-");
+                    return;
+                }
 
-        ep.Send(net::Packet{ j.dump(4) });
-        return Ok();
+                const auto age = std::chrono::duration<double>(now - estimate.lastSample).count();
+                fmt::format_to(it, "{:<8}{:<24}{:>10.3f}{:>10.3f}{:>+12.3f}{:>10}{:>8.1f}\n", other.GetID(), address,
+                               ms(estimate.rtt), ms(estimate.minRtt), ms(estimate.offset), rounds, age);
+            });
+        return ep.Reply(net::Packet{ net::PacketType::Clocks, text });
     }
 
-    [[nodiscard]] Result<Err> Application::Arg_GSTHandler([[maybe_unused]] std::vector<std::string_view> args) noexcept
+    [[nodiscard]] Result<Err> Application::Net_ReplicateHandler(Endpoint&                      ep,
+                                                                [[maybe_unused]] net::Packet&& packet) noexcept
     {
-        if (auto result = ConnectToRC(); !result)
-            return result;
+        // The stream carries every session token, which is all it takes to resume a session. Only configured
+        // standbys get it, and only over the node 0 registration they use.
+        const std::string_view address = ep.GetSocket()->remote_ep.address.str;
+        if (ep.GetID() != 0 || ep.IsSubscribed() ||
+            std::find(m_StandbyPeers.begin(), m_StandbyPeers.end(), address) == m_StandbyPeers.end())
+        {
+            PMGRD_LOG_LIMITED(*m_Logger, Warn, "Refused to replicate to ({}:{}) as EP#{}.", address,
+                              ep.GetSocket()->remote_ep.port, ep.GetID());
+            return Err{ ErrType::InvalidOperation, "Not a standby RC of this RC." };
+        }
 
-        std::vector<pid_t> pids;
-        pids.reserve(m_Cameras.size());
+        m_Logger->Info("({}:{}) attached as a standby RC.", address, ep.GetSocket()->remote_ep.port);
 
-        for (const auto& cam : m_Cameras)
+        // The connection turns into a stream of snapshots and batches, trade latency for throughput.
+        const auto bulk = net::SocketProfile(CS_PROFILE_BULK_CONFIG).Unwrap();
+        if (const auto applied = net::SetSocketOptions(ep.GetSocket(), bulk); !applied)
         {
-            const auto str = std::vector<std::string>{
-                "gst-launch-1.0",
-                "nvv4l2camerasrc",
-                fmt::format("device=/dev/video{}", cam.videoDev),
-                "!",
-                "'video/x-raw(memory:NVMM)',",
-                fmt::format("width={},", cam.width),
-                fmt::format("height={},", cam.height),
-                fmt::format("framerate={}/1,", cam.fps),
-                fmt::format("'format=(string){}", cam.videoFmt),
-                "!",
-                "nvvidconv",
-                "flip-method=0",
-                "!",
-                "videoconvert",
-                "!",
-                "video/x-raw,",
-                fmt::format("width={},", cam.width),
-                fmt::format("height={},", cam.height),
-                fmt::format("framerate={}/1,", cam.fps),
-                fmt::format("'format=(string){}", cam.videoFmt),
-                "!",
-                "ttmcastsink",
-                "camera-id=1",
-                fmt::format("device=/dev/video{}", cam.videoDev),
-            };
-            auto pargs = std::vector<char*>{};
-            for (auto& e : str)
-                pargs.push_back(const_cast<char*>(e.data()));
-            pargs.push_back(nullptr);
+            const auto err = applied.UnwrapErr();
+            m_Logger->Warn("Streaming to the standby RC with its current socket options.\n\t{}", err);
+        }
 
-            pid_t pid = fork();
+        // Group memberships only change on this thread, sessions only under the lock held by Snapshot(), so no
+        // change can slip in between taking the snapshot and attaching the standby.
+        std::vector<net::ReplicationRecord> snapshot;
+        snapshot.push_back(net::ReplicationRecord::Marker(net::ReplicationOp::SnapshotBegin));
+        for (const auto& [group_id, members] : m_Groups)
+        {
+            for (const auto node_id : members)
+                snapshot.push_back(net::ReplicationRecord::Group(net::ReplicationOp::Join, group_id, node_id));
+        }
 
-            switch (pid)
+        m_NetHandler->GetSessions().Snapshot(
+            [this, &ep, &snapshot](const std::vector<std::pair<u64, net::SessionState>>& sessions)
             {
-                case 0: {
-                    execvp("gst-launch-1.0", pargs.data());
-                    Panic("Failed to launch gst-launch-1.0");
-                    break;
-                }
-                case -1: return Err{ ErrType::ForkFailed };
-                default: break;
+                for (const auto& [token, session] : sessions)
+                    snapshot.push_back(net::ReplicationRecord::Session(token, &session));
+                snapshot.push_back(net::ReplicationRecord::Marker(net::ReplicationOp::SnapshotEnd));
+                m_Replication->Attach(ep.shared_from_this(), std::move(snapshot));
+            });
+
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::SendConfig(Endpoint& ep, const NodeConfig& config,
+                                                      net::Packet&& request) noexcept
+    {
+        // Legacy Endpoints don't send the version they have and expect the bare configuration.
+        if (request.data.size() < sizeof(u64))
+            return ep.Reply(net::Packet{ net::PacketType::String, config.json });
+
+        u64 version;
+        request >> version;
+        ep.SetConfigVersion(config.version);
+        m_NetHandler->SyncSession(ep);
+        if (version == config.version)
+            return ep.Reply(net::Packet{ net::PacketType::NotModified });
+
+        net::Packet reply;
+        {
+            const trace::Span span{ "config", "Serialize" };
+            reply = net::Packet{ net::PacketType::Config, config.json };
+            reply << config.version;
+        }
+        return ep.Reply(std::move(reply));
+    }
+
+    [[nodiscard]] Result<Err> Application::PushConfig(Endpoint& ep, const ConfigKind kind,
+                                                      const NodeConfig& config) noexcept
+    {
+        net::Packet update{ net::PacketType::ConfigUpdate, config.json };
+        update << config.version << static_cast<u8>(kind);
+        TRY_UNWRAP(ep.Send(std::move(update)));
+
+        ep.SetConfigVersion(config.version);
+        m_NetHandler->SyncSession(ep);
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Application::Arg_GSTHandler([[maybe_unused]] std::vector<std::string_view> args) noexcept
+    {
+        // Bring the pipelines up from the cached configuration right away and revalidate it against the RC in the
+        // background, so that the cameras don't stay dark while the RC is slow or restarting.
+        bool cached = false;
+        if (m_Concentrator)
+        {
+            if (const auto result = LoadConfigCache(ConfigKind::Concentrator); result)
+                cached = true;
+            else
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger->Info("No usable cached configuration.\n\t{}", err);
             }
+        }
 
-            pids.push_back(pid);
-            std::ostringstream os;
-            for (const auto& e : str)
-                os << e;
+        if (!cached)
+            TRY_UNWRAP((m_Reconnect) ? ReconnectToRC() : ConnectToRC());
 
-            m_Logger->Log(lgx::Info, "GST ({}) Arguments: {}", pid, os.str());
+        m_Supervisor = std::make_unique<PipelineSupervisor>(*m_Logger);
+        if (const auto result = m_Supervisor->StopOnSignals(); !result)
+        {
+            const auto err = result.UnwrapErr();
+            m_Logger->Warn("The pipelines will be orphaned on SIGTERM.\n\t{}", err);
         }
+        TRY_UNWRAP(m_Supervisor->Start(BuildPipelines()));
+
+        // Revalidate the cached configuration and keep applying the configuration pushed by the RC while the
+        // pipelines are running.
+        std::thread update_listener;
+        if (cached || m_Subscribe)
+            update_listener = std::thread{ [this, cached]() { ListenForUpdates(cached); } };
 
-        // TODO: Wait for each process asynchronously via threads?
-        for (const auto& p : pids)
+        // Supervise the pipelines until SIGTERM or SIGINT. Without a listener nothing can add cameras, so there's no
+        // point in staying around once every pipeline has finished.
+        m_Supervisor->Run(update_listener.joinable());
+
+        if (update_listener.joinable())
         {
-            i32 status;
-            waitpid(p, &status, 0);
-            m_Logger->Log(lgx::Info, "PID {} exited with status code: {}.", p, status);
+            // Unblock the listener and keep it from reconnecting.
+            {
+                std::scoped_lock lock{ m_SocketMutex };
+                m_Stopping.store(true);
+                net::Socket_Shutdown(m_Socket, CS_SD_BOTH);
+            }
+            m_StopCV.notify_all();
+            update_listener.join();
         }
 
         return Ok();
@@ -2,23 +2,41 @@
 
 #include <CommonDef.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
-
-#include <Logex.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <CLI/CLI.h>
+#include <Camera/CamConfigLoader.h>
+#include <Camera/CamConfigSnapshot.h>
 #include <Camera/CamCrewStation.h>
 #include <Core/Error.h>
+#include <Core/Ids.h>
+#include <Core/MembershipJournal.h>
+#include <Core/Metrics.h>
+#include <Core/MetricsExporter.h>
 #include <Core/Result.h>
+#include <Core/Tracer.h>
 #include <Endpoint/Endpoint.h>
+#include <Log/Logger.h>
+#include <Net/AsyncConnection.h>
 #include <Net/NetHandler.h>
 #include <Net/NetPacket.h>
+#include <Net/PacketStream.h>
+#include <Net/Replication.h>
+#include <Net/Task.h>
+#include <Pipeline/PipelineSupervisor.h>
+#include <Utils/FileWatcher.h>
 
 /**
  * @namespace pmgrd
@@ -35,6 +53,16 @@ namespace pmgrd {
      */
     class Application
     {
+    public:
+        /**
+         * @brief Builds the requests to keep in flight once registered with the RC, see @ref ConnectToRC.
+         * */
+        using RequestsDelegate = std::function<std::vector<net::Task<Result<Err>>>(net::AsyncConnection& rc)>;
+        /**
+         * @brief Handles the reply to a request sent with @ref Query.
+         * */
+        using ReplyDelegate = std::function<Result<Err>(net::Packet&& reply)>;
+
     public:
         /**
          * @brief The pre-defined RC daemon's server port.
@@ -45,33 +73,80 @@ namespace pmgrd {
          * */
         static constexpr auto RootServerIP = "127.0.0.1";
         /**
-         * @brief Maximum Endpoint that can connect to the RC's daemon.
+         * @brief Default length of the RC's queue of connections waiting to be accepted, see --backlog.
+         *
+         * @note The kernel silently caps it to net.core.somaxconn.
+         * */
+        static constexpr i32 DefaultBacklog = 4096;
+        /**
+         * @brief Where Endpoints persist the last validated configuration received from the RC.
+         * */
+        static constexpr auto DefaultConfigCachePath = "/var/cache/pciemgr/config.json";
+        /**
+         * @brief How much heap is pre-faulted in real-time mode.
+         * */
+        static constexpr usize RealtimeHeapPrefault = 16 * 1024 * 1024;
+        /**
+         * @brief Upper bound of the first delay between two attempts to reconnect to the RC, see --reconnect.
+         * */
+        static constexpr auto ReconnectBackoffMin = std::chrono::milliseconds{ 100 };
+        /**
+         * @brief Upper bound the delay between two attempts to reconnect to the RC doubles up to.
          * */
-        static constexpr auto RootMaximumEndpoints = 10;
+        static constexpr auto ReconnectBackoffMax = std::chrono::milliseconds{ 10'000 };
+        /**
+         * @brief How often a standby that took over retries binding the RC port while the primary still holds it.
+         * */
+        static constexpr auto BindRetryInterval = std::chrono::milliseconds{ 50 };
 
     private:
-        const std::vector<std::string_view>& m_Args;
-        std::unique_ptr<CLI>                 m_CLI;
-        std::string_view                     m_BinName;
-        bool                                 m_DaemonMode;
-        bool                                 m_RootComplex;
-        std::string                          m_LogFilePath;
-        lgx::Logger::Properties              m_LoggerProperties;
-        std::unique_ptr<lgx::Logger>         m_Logger;
-        std::ofstream                        m_LogFile;
-        net::Socket*                         m_Socket;
-        net::IPEndPoint                      m_Ep;
-        std::atomic<bool>                    m_Started;
-        std::string                          m_CameraConfigPath;
-        std::unique_ptr<net::NetHandler>     m_NetHandler;
-        u8                                   m_NodeID;
-        bool                                 m_Concentrator;
-        bool                                 m_CrewStation;
-        std::array<std::list<u8>, 63>        m_Groups;
-        std::list<Camera>                    m_Cameras;
-        std::list<CrewStation>               m_CrewStations;
-        CrewStation                          m_CurrentCrewConfig;
-        Camera                               m_CurrentConcentratorConfig;
+        const std::vector<std::string_view>&                    m_Args;
+        std::unique_ptr<CLI>                                    m_CLI;
+        std::string_view                                        m_BinName;
+        bool                                                    m_DaemonMode;
+        bool                                                    m_RootComplex;
+        std::string                                             m_LogFilePath;
+        lgx::Logger::Properties                                 m_LoggerProperties;
+        std::unique_ptr<Logger>                                 m_Logger;
+        std::ofstream                                           m_LogFile;
+        net::Socket*                                            m_Socket;
+        net::SocketOptions                                      m_SocketOptions;
+        net::IPEndPoint                                         m_Ep;
+        std::atomic<bool>                                       m_Started;
+        std::string                                             m_CameraConfigPath;
+        std::string                                             m_ConfigCachePath;
+        MetricsRegistry                                         m_Metrics;
+        std::string                                             m_MetricsTarget;
+        std::unique_ptr<MetricsExporter>                        m_MetricsExporter;
+        std::string                                             m_TracePath;
+        std::unique_ptr<net::NetHandler>                        m_NetHandler;
+        net::ReplicationMetrics                                 m_ReplicationMetrics;
+        std::unique_ptr<net::ReplicationPublisher>              m_Replication;
+        std::string                                             m_StandbyOf;
+        std::vector<std::string>                                m_StandbyPeers;
+        std::string                                             m_JournalPath;
+        std::unique_ptr<MembershipJournal>                      m_Journal;
+        i32                                                     m_Backlog;
+        NodeID                                                  m_NodeID;
+        bool                                                    m_Concentrator;
+        bool                                                    m_CrewStation;
+        bool                                                    m_Subscribe;
+        bool                                                    m_Reconnect;
+        u64                                                     m_SessionToken;
+        std::atomic<bool>                                       m_Stopping;
+        std::mutex                                              m_SocketMutex;
+        std::condition_variable                                 m_StopCV;
+        u64                                                     m_ConfigVersion;
+        i32                                                     m_RealtimePriority;
+        std::unordered_map<GroupID, std::unordered_set<NodeID>> m_Groups;
+        std::list<Camera>                                       m_Cameras;
+        std::list<CrewStation>                                  m_CrewStations;
+        CamConfigSnapshot                                       m_ConfigSnapshot;
+        std::mutex                                              m_ConfigMutex;
+        std::unique_ptr<utils::FileWatcher>                     m_ConfigWatcher;
+        std::unique_ptr<PipelineSupervisor>                     m_Supervisor;
+        CrewStation                                             m_CurrentCrewConfig;
+        Camera                                                  m_CurrentConcentratorConfig;
 
     private:
         static std::unique_ptr<Application> s_Instance;
@@ -104,6 +179,14 @@ namespace pmgrd {
          *  */
         Result<Err> LoadCameraConfig() noexcept;
 
+        /**
+         *  @brief Reloads the camera configuration and pushes the new configuration of every affected node
+         *  to its subscribed @ref Endpoint s.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> ReloadCameraConfig() noexcept;
+
         /**
          *  @brief Tries to connect to the RC server.
          *
@@ -111,10 +194,144 @@ namespace pmgrd {
          *  which contains its ID from /etc/vlink.conf to the RC to register itself as an @ref Endpoint on the RC side.
          *  Afterwards it sends a @ref net::PacketType::GetConfig where the RC tries to match it with a @ref Crew
          *  Station and then responds with a @ref json object containing its @ref Camera.
+         *  When subscribing, the RC keeps pushing the configuration whenever it changes.
+         *
+         *  The exchange runs on an @ref net::EventLoop of its own, the configuration request and those built by
+         *  @p requests are all sent right after registering and their replies awaited together.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> ConnectToRC(const RequestsDelegate& requests = {}) noexcept;
+
+        /**
+         *  @brief Registers with the RC, then runs the configuration request and @p requests concurrently.
+         *
+         *  @returns @ref Result of the first @ref Err among them.
+         *  */
+        net::Task<Result<Err>> Handshake(net::AsyncConnection&               rc,
+                                         std::vector<net::Task<Result<Err>>> requests) noexcept;
+
+        /**
+         *  @brief Requests the configuration of this node and applies it unless ours is still current.
+         *  */
+        net::Task<Result<Err>> FetchConfig(net::AsyncConnection& rc) noexcept;
+
+        /**
+         *  @brief Sends @p request and hands the reply to @p on_reply, provided it is of the @p expected type.
+         *
+         *  @param on_chunk Takes the payload of the reply as it arrives should the RC stream it, @p on_reply then
+         *  gets the reply without it.
+         *
+         *  @returns @ref Result of @ref Err, the one sent by the RC if it replied with one.
+         *  */
+        net::Task<Result<Err>> Query(net::AsyncConnection& rc, net::Packet request, const net::PacketType expected,
+                                     ReplyDelegate on_reply, net::ChunkDelegate on_chunk = {}) noexcept;
+
+        /**
+         *  @brief Builds a @ref net::PacketType::Join or @ref net::PacketType::Leave request for each group.
+         *  */
+        std::vector<net::Task<Result<Err>>> ChangeMembership(net::AsyncConnection& rc, const net::PacketType type,
+                                                             const std::vector<GroupID>& group_ids) noexcept;
+
+        /**
+         *  @brief Connects to the RC on a fresh socket until it succeeds or the Endpoint is stopping.
+         *
+         *  @details Attempts are spaced by a random delay up to a bound that starts at @ref ReconnectBackoffMin and
+         *  doubles up to @ref ReconnectBackoffMax, so that Endpoints that lost the RC at the same time don't
+         *  reconnect in lockstep. The first attempt is made right away, the session held since the last
+         *  connection is resumed if the RC still has it.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates the Endpoint stopped before connecting.
+         *  */
+        Result<Err> ReconnectToRC() noexcept;
+
+        /**
+         *  @brief Applies the configuration pushed by the RC until the connection drops, reconnecting with
+         *  --reconnect.
+         *
+         *  @param cached Whether the running configuration came from the cache and is yet to be revalidated.
+         *  */
+        void ListenForUpdates(const bool cached) noexcept;
+
+        /**
+         *  @brief Receives the reply to the last request sent to the RC.
+         *
+         *  @details @ref net::PacketType::ConfigUpdate packets pushed by the RC in the meantime are applied
+         *  and skipped, @ref net::PacketType::Ping packets are answered and skipped. Streamed packets are
+         *  reassembled first.
+         *
+         *  @returns @ref ValuedResult of @ref net::Packet or @ref Err.
+         *  */
+        ValuedResult<net::Packet, Err> ReceiveReply() noexcept;
+
+        /**
+         *  @brief Answers a @ref net::PacketType::Ping of the RC with a @ref net::PacketType::Pong.
+         *
+         *  @param received_at When @p ping was received, see @ref net::ClockSync::Now.
+         *  */
+        void AnswerPing(net::Packet&& ping, const i64 received_at) noexcept;
+
+        /**
+         *  @brief Applies and caches a @ref net::PacketType::ConfigUpdate pushed by the RC.
+         *  */
+        void ApplyPushedConfig(net::Packet&& packet) noexcept;
+
+        /**
+         *  @brief Deserialises and applies a configuration sent by the RC.
+         *
+         *  @param kind The kind of configuration.
+         *  @param jsonstr The serialised configuration.
+         *  @param version The version of the configuration.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> ApplyConfig(const ConfigKind kind, const std::string& jsonstr, const u64 version) noexcept;
+
+        /**
+         *  @brief Reads the node id of this Endpoint from /etc/vlink.conf.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> ReadNodeID() noexcept;
+
+        /**
+         *  @brief Applies the configuration persisted by @ref StoreConfigCache.
+         *
+         *  @details The cache is only used if it belongs to this node, is of the requested kind and its content
+         *  still matches its version.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> LoadConfigCache(const ConfigKind kind) noexcept;
+
+        /**
+         *  @brief Atomically persists a configuration received from the RC to @ref m_ConfigCachePath.
+         *
+         *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         *  */
+        Result<Err> StoreConfigCache(const ConfigKind kind, const std::string& jsonstr, const u64 version) noexcept;
+
+        /**
+         *  @brief Builds the pipeline of every camera in @ref m_Cameras.
+         *  */
+        std::vector<PipelineSpec> BuildPipelines() const noexcept;
+
+        /**
+         *  @brief Binds the RC port, letting it be rebound right away when the previous RC left connections
+         *  in TIME_WAIT.
+         *
+         *  @param retry Keep retrying while another RC holds the port instead of failing.
          *
          *  @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
          *  */
-        Result<Err> ConnectToRC() noexcept;
+        Result<Err> BindRC(const bool retry) noexcept;
+
+        /**
+         *  @brief Follows the primary RC given by --standby until it fails and takes over its state.
+         *
+         *  @returns When the primary was last heard from.
+         *  */
+        std::chrono::steady_clock::time_point StandBy() noexcept;
 
     public:
         /**
@@ -142,6 +359,8 @@ namespace pmgrd {
     private:
         [[nodiscard]] Result<Err> Arg_DaemonHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_RCHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_AsyncLogHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_BinaryLogHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_JoinHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_LeaveHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_CamconfHandler(std::vector<std::string_view> args) noexcept;
@@ -149,6 +368,20 @@ namespace pmgrd {
         [[nodiscard]] Result<Err> Arg_RCCommandHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_CrewStationHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_ConcentratorHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_SubscribeHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_ReconnectHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_CacheHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_DispatcherCpusHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_IOCpusHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_RealtimeHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_MetricsHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_TraceHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_BacklogHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_TimeoutsHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_SocketProfileHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_StandbyHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_StandbyPeersHandler(std::vector<std::string_view> args) noexcept;
+        [[nodiscard]] Result<Err> Arg_JournalHandler(std::vector<std::string_view> args) noexcept;
         [[nodiscard]] Result<Err> Arg_GSTHandler(std::vector<std::string_view> args) noexcept;
 
     private:
@@ -158,6 +391,29 @@ namespace pmgrd {
         [[nodiscard]] Result<Err> Net_LeaveHandler(Endpoint& ep, net::Packet&& packet) noexcept;
         [[nodiscard]] Result<Err> Net_GetCrewConfigHandler(Endpoint& ep, net::Packet&& packet) noexcept;
         [[nodiscard]] Result<Err> Net_GetCtrConfigHandler(Endpoint& ep, net::Packet&& packet) noexcept;
+        [[nodiscard]] Result<Err> Net_StatsHandler(Endpoint& ep, net::Packet&& packet) noexcept;
+        [[nodiscard]] Result<Err> Net_TraceHandler(Endpoint& ep, net::Packet&& packet) noexcept;
+        [[nodiscard]] Result<Err> Net_ClocksHandler(Endpoint& ep, net::Packet&& packet) noexcept;
+        [[nodiscard]] Result<Err> Net_ReplicateHandler(Endpoint& ep, net::Packet&& packet) noexcept;
+
+    private:
+        [[nodiscard]] Result<Err> SendConfig(Endpoint& ep, const NodeConfig& config, net::Packet&& request) noexcept;
+        [[nodiscard]] Result<Err> PushConfig(Endpoint& ep, const ConfigKind kind, const NodeConfig& config) noexcept;
+
+        /**
+         * @brief Replicates and journals a change of @p ep's group memberships and acknowledges it.
+         *
+         * @details The acknowledgement does not imply durability. A tagged @p ep is acknowledged once the journal
+         * commit completed, successfully or not, since a change that failed to be written is still in effect and
+         * only becomes durable with the journal's next snapshot. An untagged @p ep takes its replies in request
+         * order and is acknowledged right away, before the change reached the disk.
+         * */
+        void CommitMembership(Endpoint& ep, const MembershipOp op, const GroupID group_id) noexcept;
+
+        /**
+         * @brief Pushes the configuration to a subscribed @p ep that resumed its session if it changed meanwhile.
+         * */
+        void OnSessionResumed(Endpoint& ep) noexcept;
 
     public:
         /**
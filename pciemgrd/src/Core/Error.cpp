@@ -1,5 +1,7 @@
 #include "Error.h"
 
+#include <iterator>
+
 #include <Net/NetPacket.h>
 
 namespace pmgrd {
@@ -25,9 +27,9 @@ namespace pmgrd {
         "NetConnectionTimeout",
         "NetBadPacket",
         "NetListenFailure",
-        "NetReadFailure",
         "NetWriteFailure",
-        "NetInitConFailure",
+        "NetReadFailure",
+        "NetReadyFailure",
 
         // Camera releated
         "InvalidCameraConfiguration",
@@ -39,6 +41,8 @@ namespace pmgrd {
         "ForkFailed"
         };
         /* clang-format on */
+        static_assert(std::size(err_str_arr) == ErrTypeCount, "Every ErrType needs an entry.");
+
         return err_str_arr[static_cast<u8>(type)];
     }
 
@@ -53,6 +53,11 @@ namespace pmgrd {
         ForkFailed
     };
 
+    /**
+     * @brief Number of @ref ErrType s, must follow the last one.
+     * */
+    inline constexpr usize ErrTypeCount = static_cast<usize>(ErrType::ForkFailed) + 1;
+
     [[nodiscard]] const char* ErrTypeToStr(const ErrType type) noexcept;
 
     struct Err
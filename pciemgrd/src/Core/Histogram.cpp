@@ -0,0 +1,68 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace pmgrd {
+    void Histogram::Record(const u64 value) noexcept
+    {
+        m_Buckets[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_Count.fetch_add(1, std::memory_order_relaxed);
+        m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+        u64 max = m_Max.load(std::memory_order_relaxed);
+        while (value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+            ;
+    }
+
+    void Histogram::Reset() noexcept
+    {
+        for (auto& bucket : m_Buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        m_Count.store(0, std::memory_order_relaxed);
+        m_Sum.store(0, std::memory_order_relaxed);
+        m_Max.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] u64 Histogram::Percentile(const double quantile) const noexcept
+    {
+        const u64 count = Count();
+        if (count == 0)
+            return 0;
+
+        // Rank of the sample we're after, 1-based.
+        const auto rank = std::max<u64>(1, static_cast<u64>(std::ceil(std::clamp(quantile, 0.0, 1.0) * count)));
+
+        u64 seen = 0;
+        for (u32 i = 0; i < Histogram::BucketCount; ++i)
+        {
+            seen += m_Buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(UpperBound(i), Max());
+        }
+        return Max();
+    }
+
+    [[nodiscard]] u32 Histogram::IndexOf(const u64 value) noexcept
+    {
+        // Values below SubBucketCount get a bucket each.
+        if (value < Histogram::SubBucketCount)
+            return static_cast<u32>(value);
+
+        const u32 msb   = 63 - static_cast<u32>(std::countl_zero(value));
+        const u32 shift = msb - Histogram::SubBucketBits;
+        return (shift + 1) * Histogram::SubBucketCount +
+               static_cast<u32>((value >> shift) - Histogram::SubBucketCount);
+    }
+
+    [[nodiscard]] u64 Histogram::UpperBound(const u32 index) noexcept
+    {
+        if (index < Histogram::SubBucketCount)
+            return index;
+
+        const u32 shift = index / Histogram::SubBucketCount - 1;
+        const u64 sub   = index % Histogram::SubBucketCount + Histogram::SubBucketCount;
+        return ((sub + 1) << shift) - 1;
+    }
+} // namespace pmgrd
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <array>
+#include <atomic>
+
+namespace pmgrd {
+    /**
+     * @brief Fixed size log-linear histogram for latency samples.
+     *
+     * @details Every power of two range is split into @ref SubBucketCount linear buckets, so the relative error
+     * of a reported percentile is bounded by 1 / @ref SubBucketCount (~3%) over the whole u64 range while
+     * recording stays a couple of arithmetic ops and a relaxed atomic increment. Recording is wait-free and
+     * thread-safe, reading is thread-safe but not a consistent snapshot while samples are being recorded.
+     * */
+    class Histogram
+    {
+    public:
+        static constexpr u32 SubBucketBits  = 5;
+        static constexpr u32 SubBucketCount = 1 << Histogram::SubBucketBits;
+        static constexpr u32 BucketCount    = (64 - Histogram::SubBucketBits + 1) * Histogram::SubBucketCount;
+
+    private:
+        std::array<std::atomic<u64>, Histogram::BucketCount> m_Buckets{};
+        std::atomic<u64>                                     m_Count{ 0 };
+        std::atomic<u64>                                     m_Sum{ 0 };
+        std::atomic<u64>                                     m_Max{ 0 };
+
+    public:
+        /**
+         * @brief Records a single sample.
+         * */
+        void Record(const u64 value) noexcept;
+
+        /**
+         * @brief Clears every sample.
+         * */
+        void Reset() noexcept;
+
+    public:
+        [[nodiscard]] u64 Count() const noexcept { return m_Count.load(std::memory_order_relaxed); }
+        [[nodiscard]] u64 Sum() const noexcept { return m_Sum.load(std::memory_order_relaxed); }
+        [[nodiscard]] u64 Max() const noexcept { return m_Max.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Returns the value below which @p quantile of the samples fall.
+         *
+         * @param quantile Quantile in [0, 1], e.g. 0.99 for p99.
+         * @returns The upper bound of the bucket containing the quantile, or 0 if there are no samples.
+         * */
+        [[nodiscard]] u64 Percentile(const double quantile) const noexcept;
+
+        /**
+         * @brief Invokes @p fn with the upper bound and count of every non-empty bucket, in ascending order.
+         * */
+        template <typename Fn>
+        void ForEachBucket(Fn&& fn) const
+        {
+            for (u32 i = 0; i < Histogram::BucketCount; ++i)
+            {
+                if (const auto count = m_Buckets[i].load(std::memory_order_relaxed); count != 0)
+                    fn(UpperBound(i), count);
+            }
+        }
+
+    public:
+        [[nodiscard]] static u32 IndexOf(const u64 value) noexcept;
+        [[nodiscard]] static u64 UpperBound(const u32 index) noexcept;
+    };
+} // namespace pmgrd
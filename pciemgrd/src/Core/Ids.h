@@ -0,0 +1,29 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <limits>
+
+namespace pmgrd {
+    /**
+     * @brief Identifies a node, read by every Endpoint from /etc/vlink.conf and sent in its Ready packet.
+     *
+     * @note Legacy Endpoints only send the low byte, see @ref net::ReadyInfo.
+     * */
+    using NodeID = u16;
+
+    /**
+     * @brief Identifies a multicast group a node can join.
+     * */
+    using GroupID = u16;
+
+    /**
+     * @brief The largest @ref NodeID a node can be given.
+     * */
+    inline constexpr NodeID MaxNodeID = std::numeric_limits<NodeID>::max();
+
+    /**
+     * @brief The largest @ref GroupID a group can be given.
+     * */
+    inline constexpr GroupID MaxGroupID = std::numeric_limits<GroupID>::max();
+} // namespace pmgrd
@@ -0,0 +1,444 @@
+#include "MembershipJournal.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Core/Tracer.h>
+#include <Utils/Utils.h>
+
+namespace pmgrd {
+    namespace {
+        constexpr char SnapshotMagic[8] = { 'P', 'M', 'G', 'R', 'S', 'N', 'A', 'P' };
+        constexpr u32  SnapshotVersion  = 1;
+
+        struct SnapshotHeader
+        {
+            char magic[8];
+            u32  version;
+            u32  headerSize;
+            u64  sequence; ///< Sequence of the last log record the snapshot includes.
+            u64  count;    ///< Number of @ref SnapshotEntry following the header.
+            u64  checksum; ///< FNV-1a of the entries.
+        };
+
+        struct SnapshotEntry
+        {
+            GroupID groupId;
+            NodeID  nodeId;
+        };
+
+        struct LogRecord
+        {
+            u64          sequence;
+            GroupID      groupId;
+            NodeID       nodeId;
+            MembershipOp op;
+            u8           reserved[3];
+            u64          checksum; ///< FNV-1a of the fields above.
+        };
+
+        static_assert(sizeof(SnapshotEntry) == 4 && sizeof(LogRecord) == 24, "The journal layout must be packed.");
+
+        [[nodiscard]] std::string_view Bytes(const void* data, const usize size) noexcept
+        {
+            return std::string_view{ static_cast<const char*>(data), size };
+        }
+
+        [[nodiscard]] u64 ChecksumOf(const LogRecord& record) noexcept
+        {
+            return utils::Fnv1a64(Bytes(&record, offsetof(LogRecord, checksum)));
+        }
+
+        [[nodiscard]] u64 ElapsedNs(const MembershipJournal::Clock::time_point since) noexcept
+        {
+            return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        MembershipJournal::Clock::now() - since)
+                                        .count());
+        }
+
+        /**
+         * @brief Read-only mapping of a whole file, empty if the file doesn't exist or is empty.
+         * */
+        class FileMapping
+        {
+        private:
+            const u8* m_Data = nullptr;
+            usize     m_Size = 0;
+
+        public:
+            FileMapping() noexcept = default;
+            FileMapping(const FileMapping&)            = delete;
+            FileMapping& operator=(const FileMapping&) = delete;
+            ~FileMapping() noexcept
+            {
+                if (m_Data)
+                    munmap(const_cast<u8*>(m_Data), m_Size);
+            }
+
+        public:
+            [[nodiscard]] Result<Err> Map(const i32 fd, const std::string& path) noexcept
+            {
+                struct stat st{};
+                if (fstat(fd, &st) == -1)
+                    return Err{ ErrType::IOError, "Unable to stat '{}': {}", path, std::strerror(errno) };
+                if (st.st_size == 0)
+                    return Ok();
+
+                void* const data = mmap(nullptr, static_cast<usize>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                    return Err{ ErrType::IOError, "Failed to map '{}': {}", path, std::strerror(errno) };
+
+                // Both files are read front to back exactly once.
+                madvise(data, static_cast<usize>(st.st_size), MADV_SEQUENTIAL);
+                m_Data = static_cast<const u8*>(data);
+                m_Size = static_cast<usize>(st.st_size);
+                return Ok();
+            }
+
+            [[nodiscard]] const u8* Data() const noexcept { return m_Data; }
+            [[nodiscard]] usize     Size() const noexcept { return m_Size; }
+        };
+    } // namespace
+
+    MembershipJournal::Metrics::Metrics(MetricsRegistry& registry)
+        : records(registry.AddCounter("pmgrd_journal_records", "Membership changes written to the journal."))
+        , commits(registry.AddCounter("pmgrd_journal_commits", "Batches of membership changes synced to the journal."))
+        , commitLatency(registry.AddHistogram("pmgrd_journal_commit_seconds",
+                                              "Time to write and sync a batch of membership changes."))
+        , snapshots(registry.AddCounter("pmgrd_journal_snapshots", "Membership snapshots written."))
+        , recovery(registry.AddHistogram("pmgrd_journal_recovery_seconds",
+                                         "Time to load the membership snapshot and replay the journal."))
+    {
+    }
+
+    MembershipJournal::MembershipJournal(Logger& logger, MetricsRegistry& metrics, const std::string& directory)
+        : m_Logger(logger)
+        , m_Metrics(metrics)
+        , m_WalPath((std::filesystem::path{ directory } / "membership.wal").string())
+        , m_SnapshotPath((std::filesystem::path{ directory } / "membership.snap").string())
+        , m_Fd(-1)
+        , m_Committed(0)
+        , m_LogRecords(0)
+        , m_Unjournaled(false)
+        , m_Run(false)
+    {
+    }
+
+    MembershipJournal::~MembershipJournal() noexcept
+    {
+        Stop();
+
+        if (m_Fd != -1)
+            close(m_Fd);
+    }
+
+    [[nodiscard]] ValuedResult<MembershipJournal::Groups, Err> MembershipJournal::Recover() noexcept
+    {
+        const trace::Span span{ "journal", "Recover" };
+        const auto        start = Clock::now();
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path{ m_WalPath }.parent_path(), ec);
+
+        m_Members.clear();
+        m_Committed = 0;
+        if (const i32 fd = open(m_SnapshotPath.c_str(), O_RDONLY | O_CLOEXEC); fd != -1)
+        {
+            FileMapping snapshot;
+            const auto  mapped = snapshot.Map(fd, m_SnapshotPath);
+            close(fd);
+            TRY_UNWRAP(mapped);
+
+            SnapshotHeader header{};
+            if (snapshot.Size() < sizeof(header))
+                return Err{ ErrType::IOError, "The membership snapshot '{}' is truncated.", m_SnapshotPath };
+            std::memcpy(&header, snapshot.Data(), sizeof(header));
+
+            if (std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) != 0 ||
+                header.version != SnapshotVersion || header.headerSize < sizeof(header) ||
+                header.headerSize > snapshot.Size() ||
+                snapshot.Size() - header.headerSize != header.count * sizeof(SnapshotEntry))
+                return Err{ ErrType::IOError, "'{}' is not a membership snapshot.", m_SnapshotPath };
+
+            const auto entries = Bytes(snapshot.Data() + header.headerSize, header.count * sizeof(SnapshotEntry));
+            if (utils::Fnv1a64(entries) != header.checksum)
+                return Err{ ErrType::IOError, "The membership snapshot '{}' is corrupt.", m_SnapshotPath };
+
+            // Entries are sorted, every insertion lands at the end.
+            for (usize i = 0; i < header.count; ++i)
+            {
+                SnapshotEntry entry;
+                std::memcpy(&entry, entries.data() + i * sizeof(entry), sizeof(entry));
+                m_Members.emplace_hint(m_Members.end(), entry.groupId, entry.nodeId);
+            }
+            m_Committed = header.sequence;
+        }
+        else if (errno != ENOENT)
+            return Err{ ErrType::IOError, "Unable to open '{}': {}", m_SnapshotPath, std::strerror(errno) };
+
+        const u64   snapshot_sequence = m_Committed;
+        const usize snapshot_members  = m_Members.size();
+
+        m_Fd = open(m_WalPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (m_Fd == -1)
+            return Err{ ErrType::IOError, "Unable to open '{}' for writing.", m_WalPath };
+
+        // Replay what was committed after the snapshot. Records the snapshot already includes are left over from
+        // a compaction interrupted before the log was emptied.
+        usize replayed = 0;
+        usize valid    = 0;
+        usize size     = 0;
+        {
+            FileMapping log;
+            TRY_UNWRAP(log.Map(m_Fd, m_WalPath));
+            size = log.Size();
+
+            for (; valid + sizeof(LogRecord) <= log.Size(); valid += sizeof(LogRecord))
+            {
+                LogRecord record;
+                std::memcpy(&record, log.Data() + valid, sizeof(record));
+                if (record.checksum != ChecksumOf(record))
+                    break;
+                if (record.sequence <= snapshot_sequence)
+                    continue;
+                if (record.sequence != m_Committed + 1)
+                    break;
+
+                Apply(record.op, record.groupId, record.nodeId);
+                m_Committed = record.sequence;
+                ++replayed;
+            }
+        }
+
+        if (valid != size)
+        {
+            m_Logger.Warn("Discarding {} byte(s) of torn membership journal after sequence {}.", size - valid,
+                          m_Committed);
+            if (ftruncate(m_Fd, static_cast<off_t>(valid)) == -1)
+                return Err{ ErrType::IOError, "Failed to truncate '{}': {}", m_WalPath, std::strerror(errno) };
+        }
+
+        m_LogRecords   = valid / sizeof(LogRecord);
+        m_LastSnapshot = Clock::now();
+
+        Groups groups;
+        for (const auto& [group_id, node_id] : m_Members)
+            groups[group_id].insert(node_id);
+
+        const auto elapsed = ElapsedNs(start);
+        m_Metrics.recovery.Record(elapsed);
+        m_Logger.Info("Recovered {} membership(s) of {} group(s) in {:.2f} ms, {} from the snapshot and {} "
+                      "replayed change(s).",
+                      m_Members.size(), groups.size(), static_cast<double>(elapsed) / 1e6, snapshot_members,
+                      replayed);
+        return groups;
+    }
+
+    [[nodiscard]] Result<Err> MembershipJournal::Reset(const Groups& groups) noexcept
+    {
+        if (m_Fd == -1)
+            return Err{ ErrType::InvalidState, "The membership journal hasn't been recovered yet." };
+
+        m_Members.clear();
+        for (const auto& [group_id, members] : groups)
+        {
+            for (const auto node_id : members)
+                m_Members.emplace(group_id, node_id);
+        }
+        return Compact();
+    }
+
+    void MembershipJournal::Start() noexcept
+    {
+        if (m_Thread.joinable() || m_Fd == -1)
+            return;
+
+        m_Run    = true;
+        m_Thread = std::thread{ &MembershipJournal::ThreadHandler, this };
+    }
+
+    void MembershipJournal::Stop() noexcept
+    {
+        {
+            std::scoped_lock lock{ m_Mutex };
+            m_Run = false;
+        }
+        m_CV.notify_all();
+
+        if (!m_Thread.joinable())
+            return;
+        m_Thread.join();
+
+        if (m_LogRecords != 0 || m_Unjournaled)
+        {
+            if (const auto result = Compact(); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Error("Failed to snapshot the group memberships.\n\t{}", err);
+            }
+        }
+    }
+
+    void MembershipJournal::Append(const MembershipOp op, const GroupID group_id, const NodeID node_id,
+                                   Completion done) noexcept
+    {
+        {
+            std::scoped_lock lock{ m_Mutex };
+            m_Pending.push_back(Pending{ op, group_id, node_id, std::move(done) });
+        }
+        m_CV.notify_one();
+    }
+
+    void MembershipJournal::ThreadHandler() noexcept
+    {
+        trace::Tracer::Get().SetThreadName("Journal");
+
+        std::vector<Pending> batch;
+        std::unique_lock     lock{ m_Mutex };
+        while (true)
+        {
+            m_CV.wait_for(lock, MembershipJournal::CompactInterval,
+                          [this]() { return !m_Run || !m_Pending.empty(); });
+            if (m_Pending.empty() && !m_Run)
+                break;
+
+            // Everything appended while the previous batch was syncing goes out with a single sync.
+            batch.swap(m_Pending);
+            lock.unlock();
+
+            if (!batch.empty())
+            {
+                const auto result = Commit(batch);
+                if (!result)
+                {
+                    const auto err = result.UnwrapErr();
+                    PMGRD_LOG_LIMITED(m_Logger, Error, "Failed to journal {} membership change(s).\n\t{}",
+                                      batch.size(), err);
+                    m_Unjournaled = true;
+                }
+
+                // Changes that failed are still in effect on the RC, the next snapshot makes them durable.
+                for (auto& pending : batch)
+                {
+                    Apply(pending.op, pending.groupId, pending.nodeId);
+                    if (pending.done)
+                        pending.done(result);
+                }
+                batch.clear();
+            }
+
+            if (m_LogRecords >= MembershipJournal::CompactRecords ||
+                ((m_LogRecords != 0 || m_Unjournaled) &&
+                 Clock::now() - m_LastSnapshot >= MembershipJournal::CompactInterval))
+            {
+                if (const auto result = Compact(); !result)
+                {
+                    const auto err = result.UnwrapErr();
+                    PMGRD_LOG_LIMITED(m_Logger, Error, "Failed to snapshot the group memberships.\n\t{}", err);
+                }
+            }
+
+            lock.lock();
+        }
+    }
+
+    [[nodiscard]] Result<Err> MembershipJournal::Commit(const std::vector<Pending>& batch) noexcept
+    {
+        const trace::Span span{ "journal", "Commit" };
+        const auto        start = Clock::now();
+
+        std::vector<LogRecord> records(batch.size());
+        for (usize i = 0; i < batch.size(); ++i)
+        {
+            auto& record    = records[i];
+            record          = LogRecord{};
+            record.sequence = m_Committed + 1 + i;
+            record.groupId  = batch[i].groupId;
+            record.nodeId   = batch[i].nodeId;
+            record.op       = batch[i].op;
+            record.checksum = ChecksumOf(record);
+        }
+
+        const auto* data    = reinterpret_cast<const u8*>(records.data());
+        const usize size    = records.size() * sizeof(LogRecord);
+        usize       written = 0;
+        while (written < size)
+        {
+            const auto res = write(m_Fd, data + written, size - written);
+            if (res == -1 && errno == EINTR)
+                continue;
+            else if (res == -1)
+                break;
+            written += static_cast<usize>(res);
+        }
+
+        if (written != size || fdatasync(m_Fd) == -1)
+        {
+            const i32 error = errno;
+
+            // Drop whatever made it so that the sequence numbers of the next batch follow the last durable one. If
+            // that fails too, replay stops at the torn batch and the next snapshot brings the log back in sequence.
+            if (ftruncate(m_Fd, static_cast<off_t>(m_LogRecords * sizeof(LogRecord))) == -1)
+                PMGRD_LOG_LIMITED(m_Logger, Warn, "Failed to drop a torn batch from '{}': {}", m_WalPath,
+                                  std::strerror(errno));
+            return Err{ ErrType::IOError, "Failed to write '{}': {}", m_WalPath, std::strerror(error) };
+        }
+
+        m_Committed += batch.size();
+        m_LogRecords += batch.size();
+        m_Metrics.records.Add(batch.size());
+        m_Metrics.commits.Add();
+        m_Metrics.commitLatency.Record(ElapsedNs(start));
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> MembershipJournal::Compact() noexcept
+    {
+        const trace::Span span{ "journal", "Compact" };
+
+        std::string    content(sizeof(SnapshotHeader) + m_Members.size() * sizeof(SnapshotEntry), '\0');
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+        header.version    = SnapshotVersion;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.sequence   = m_Committed;
+        header.count      = m_Members.size();
+
+        char* out = content.data() + sizeof(SnapshotHeader);
+        for (const auto& [group_id, node_id] : m_Members)
+        {
+            const SnapshotEntry entry{ group_id, node_id };
+            std::memcpy(out, &entry, sizeof(entry));
+            out += sizeof(entry);
+        }
+        header.checksum = utils::Fnv1a64(std::string_view{ content }.substr(sizeof(SnapshotHeader)));
+        std::memcpy(content.data(), &header, sizeof(header));
+
+        // Only empty the log once the snapshot including it is durable, replay skips what it already includes.
+        TRY_UNWRAP(utils::fs::WriteAtomic(m_SnapshotPath, content));
+        if (ftruncate(m_Fd, 0) == -1)
+            return Err{ ErrType::IOError, "Failed to truncate '{}': {}", m_WalPath, std::strerror(errno) };
+
+        m_LogRecords   = 0;
+        m_Unjournaled  = false;
+        m_LastSnapshot = Clock::now();
+        m_Metrics.snapshots.Add();
+        return Ok();
+    }
+
+    void MembershipJournal::Apply(const MembershipOp op, const GroupID group_id, const NodeID node_id) noexcept
+    {
+        if (op == MembershipOp::Join)
+            m_Members.emplace(group_id, node_id);
+        else
+            m_Members.erase({ group_id, node_id });
+    }
+} // namespace pmgrd
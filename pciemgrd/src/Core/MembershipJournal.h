@@ -0,0 +1,165 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Histogram.h>
+#include <Core/Ids.h>
+#include <Core/Metrics.h>
+#include <Core/Result.h>
+#include <Log/Logger.h>
+
+namespace pmgrd {
+    /**
+     * @brief A change to the group memberships recorded by @ref MembershipJournal.
+     * */
+    enum class MembershipOp : u8
+    {
+        Join = 1,
+        Leave,
+    };
+
+    /**
+     * @brief Write-ahead log of the RC's group memberships, so that a restarted RC serves them right away instead
+     * of waiting for every Endpoint to join again.
+     *
+     * @details Every Join and Leave is appended to membership.wal and its completion invoked once it is on disk or
+     * failed to be written. The journal doesn't decide what the Endpoint is told, the RC's Ok to a Join or Leave
+     * does not imply that the change is durable, see Application::CommitMembership. Records
+     * are written by a thread of their own which commits everything appended while the previous commit was
+     * syncing with a single write and fdatasync, so a burst of changes costs a handful of syncs rather than one
+     * each. The thread keeps its own copy of the memberships and, every @ref CompactRecords records or
+     * @ref CompactInterval, replaces membership.snap with it and empties the log. Changes that couldn't be written
+     * are kept in that copy as well, a snapshot is retried every @ref CompactInterval until one includes them.
+     *
+     * The snapshot is a header followed by the (group, node) pairs sorted, so recovering maps it and walks it
+     * once, then replays the records of the log that came after it. Records carry a sequence number and a
+     * checksum, replay stops at the first torn or out of sequence one and the log is truncated there.
+     *
+     * @note @ref Append is thread-safe, the rest must be called from the thread owning the journal.
+     * */
+    class MembershipJournal
+    {
+    public:
+        using Clock  = std::chrono::steady_clock;
+        using Groups = std::unordered_map<GroupID, std::unordered_set<NodeID>>;
+
+        /**
+         * @brief Invoked on the journal thread once a change is durable, or with the @ref Err that kept it from
+         * being written. A change that couldn't be written is still applied, the next snapshot makes it durable.
+         * */
+        using Completion = std::function<void(const Result<Err>& result)>;
+
+        struct Metrics
+        {
+            Counter&   records;
+            Counter&   commits;
+            Histogram& commitLatency; ///< Writing and syncing a batch of records, in ns.
+            Counter&   snapshots;
+            Histogram& recovery; ///< Mapping the snapshot and replaying the log on startup, in ns.
+
+        public:
+            explicit Metrics(MetricsRegistry& registry);
+        };
+
+    public:
+        /**
+         * @brief Log records after which the snapshot is rewritten.
+         * */
+        static constexpr usize CompactRecords = 64 * 1024;
+        /**
+         * @brief Longest the log is left growing before the snapshot is rewritten.
+         * */
+        static constexpr auto CompactInterval = std::chrono::seconds{ 60 };
+
+    private:
+        struct Pending
+        {
+            MembershipOp op;
+            GroupID      groupId;
+            NodeID       nodeId;
+            Completion   done;
+        };
+
+    private:
+        Logger&                              m_Logger;
+        Metrics                              m_Metrics;
+        std::string                          m_WalPath;
+        std::string                          m_SnapshotPath;
+        i32                                  m_Fd;
+        std::set<std::pair<GroupID, NodeID>> m_Members;
+        u64                                  m_Committed;
+        usize                                m_LogRecords;
+        bool                                 m_Unjournaled; ///< m_Members has changes neither logged nor snapshot.
+        Clock::time_point                    m_LastSnapshot;
+        std::mutex                           m_Mutex;
+        std::condition_variable              m_CV;
+        std::vector<Pending>                 m_Pending;
+        bool                                 m_Run;
+        std::thread                          m_Thread;
+
+    public:
+        MembershipJournal(Logger& logger, MetricsRegistry& metrics, const std::string& directory);
+        MembershipJournal(const MembershipJournal&)            = delete;
+        MembershipJournal& operator=(const MembershipJournal&) = delete;
+        ~MembershipJournal() noexcept;
+
+    public:
+        /**
+         * @brief Maps the snapshot, replays the log that came after it and opens the log for appending.
+         *
+         * @returns @ref ValuedResult of the recovered memberships or @ref Err if the snapshot is corrupt.
+         * */
+        [[nodiscard]] ValuedResult<Groups, Err> Recover() noexcept;
+
+        /**
+         * @brief Replaces everything journaled so far with @p groups, e.g. after taking over from a primary RC.
+         *
+         * @note Must be called after @ref Recover and before @ref Start.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Reset(const Groups& groups) noexcept;
+
+        void Start() noexcept;
+
+        /**
+         * @brief Commits what is still pending and leaves a fresh snapshot behind.
+         * */
+        void Stop() noexcept;
+
+        /**
+         * @brief Queues a change, @p done is invoked once it is durable.
+         *
+         * @note Changes are committed in the order they were appended.
+         * */
+        void Append(const MembershipOp op, const GroupID group_id, const NodeID node_id, Completion done) noexcept;
+
+    private:
+        void ThreadHandler() noexcept;
+
+        /**
+         * @brief Writes and syncs @p batch to the log, leaving the log as it was if it fails.
+         * */
+        [[nodiscard]] Result<Err> Commit(const std::vector<Pending>& batch) noexcept;
+
+        /**
+         * @brief Replaces the snapshot with @ref m_Members and empties the log.
+         * */
+        [[nodiscard]] Result<Err> Compact() noexcept;
+
+        void Apply(const MembershipOp op, const GroupID group_id, const NodeID node_id) noexcept;
+    };
+} // namespace pmgrd
@@ -0,0 +1,157 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <fmt/format.h>
+
+namespace pmgrd {
+    [[nodiscard]] u64 Counter::Value() const noexcept
+    {
+        u64 sum = 0;
+        for (const auto& shard : m_Shards)
+            sum += shard.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    [[nodiscard]] usize Counter::ThreadShard() noexcept
+    {
+        // Threads are handed out shards round-robin the first time they count anything.
+        static std::atomic<usize> s_NextShard{ 0 };
+        thread_local const usize  shard = s_NextShard.fetch_add(1, std::memory_order_relaxed) % Counter::ShardCount;
+        return shard;
+    }
+
+    Counter& MetricsRegistry::AddCounter(std::string name, std::string help, std::string labels)
+    {
+        std::scoped_lock lock{ m_Mutex };
+        auto&            counter = m_Counters.emplace_back();
+        Register(std::move(name), std::move(help), std::move(labels), Kind::Counter, &counter);
+        return counter;
+    }
+
+    Gauge& MetricsRegistry::AddGauge(std::string name, std::string help, std::string labels)
+    {
+        std::scoped_lock lock{ m_Mutex };
+        Gauge*           gauge = nullptr;
+        if (m_FreeGauges.empty())
+            gauge = &m_Gauges.emplace_back();
+        else
+        {
+            gauge = m_FreeGauges.back();
+            m_FreeGauges.pop_back();
+        }
+        Register(std::move(name), std::move(help), std::move(labels), Kind::Gauge, gauge);
+        return *gauge;
+    }
+
+    Histogram& MetricsRegistry::AddHistogram(std::string name, std::string help, std::string labels)
+    {
+        std::scoped_lock lock{ m_Mutex };
+        auto&            histogram = m_Histograms.emplace_back();
+        Register(std::move(name), std::move(help), std::move(labels), Kind::Histogram, &histogram);
+        return histogram;
+    }
+
+    void MetricsRegistry::RemoveGauge(const std::string& name, Gauge& gauge)
+    {
+        std::scoped_lock lock{ m_Mutex };
+        const auto       it = m_FamilyIndex.find(name);
+        if (it == m_FamilyIndex.end())
+            return;
+
+        // Families stay in place even when emptied, the index refers to them by position.
+        auto& entries = m_Families[it->second].entries;
+        if (std::erase_if(entries, [&gauge](const Entry& e) { return e.metric == &gauge; }) == 0)
+            return;
+
+        gauge.Set(0);
+        m_FreeGauges.push_back(&gauge);
+    }
+
+    void MetricsRegistry::Register(std::string&& name, std::string&& help, std::string&& labels, const Kind kind,
+                                   const void* metric)
+    {
+        auto [it, added] = m_FamilyIndex.try_emplace(name, m_Families.size());
+        if (added)
+            m_Families.push_back({ std::move(name), std::move(help), kind, {} });
+        m_Families[it->second].entries.push_back({ std::move(labels), metric });
+    }
+
+    [[nodiscard]] std::string MetricsRegistry::ToOpenMetrics() const
+    {
+        std::scoped_lock lock{ m_Mutex };
+
+        const auto labels = [](const std::string& base, const std::string_view extra)
+        {
+            if (base.empty() && extra.empty())
+                return std::string{};
+            if (base.empty() || extra.empty())
+                return fmt::format("{{{}{}}}", base, extra);
+            return fmt::format("{{{},{}}}", base, extra);
+        };
+        const auto seconds = [](const u64 ns) { return static_cast<double>(ns) / 1e9; };
+
+        std::string out;
+        auto        it     = std::back_inserter(out);
+        const auto  render = [&](const Family& f, const Entry& e)
+        {
+            switch (f.kind)
+            {
+                case Kind::Counter: {
+                    const auto& counter = *static_cast<const Counter*>(e.metric);
+                    fmt::format_to(it, "{}_total{} {}\n", f.name, labels(e.labels, {}), counter.Value());
+                    break;
+                }
+                case Kind::Gauge: {
+                    const auto& gauge = *static_cast<const Gauge*>(e.metric);
+                    fmt::format_to(it, "{}{} {}\n", f.name, labels(e.labels, {}), gauge.Value());
+                    break;
+                }
+                case Kind::Histogram: {
+                    const auto& histogram = *static_cast<const Histogram*>(e.metric);
+
+                    // Every source bucket lands in the first exported bucket covering its upper bound, the last
+                    // slot collecting whatever lies above them all. Exported buckets are cumulative, and +Inf and
+                    // _count come from the same read of the source buckets so that they always agree.
+                    constexpr auto& bounds = MetricsRegistry::ExportedBuckets;
+                    std::array<u64, bounds.size() + 1> buckets{};
+                    histogram.ForEachBucket(
+                        [&](const u64 upper_bound, const u64 count)
+                        {
+                            const auto b = std::lower_bound(bounds.begin(), bounds.end(), upper_bound) - bounds.begin();
+                            buckets[static_cast<usize>(b)] += count;
+                        });
+
+                    u64 cumulative = 0;
+                    for (usize b = 0; b < bounds.size(); ++b)
+                    {
+                        cumulative += buckets[b];
+                        const auto le = fmt::format("le=\"{}\"", seconds(bounds[b]));
+                        fmt::format_to(it, "{}_bucket{} {}\n", f.name, labels(e.labels, le), cumulative);
+                    }
+                    cumulative += buckets[bounds.size()];
+                    fmt::format_to(it, "{}_bucket{} {}\n", f.name, labels(e.labels, "le=\"+Inf\""), cumulative);
+                    fmt::format_to(it, "{}_count{} {}\n", f.name, labels(e.labels, {}), cumulative);
+                    fmt::format_to(it, "{}_sum{} {}\n", f.name, labels(e.labels, {}), seconds(histogram.Sum()));
+                    break;
+                }
+            }
+        };
+
+        // The samples of a family must be contiguous and preceded by its metadata.
+        for (const auto& f : m_Families)
+        {
+            if (f.entries.empty())
+                continue;
+
+            constexpr const char* types[] = { "counter", "gauge", "histogram" };
+            fmt::format_to(it, "# TYPE {} {}\n", f.name, types[static_cast<u8>(f.kind)]);
+            fmt::format_to(it, "# HELP {} {}\n", f.name, f.help);
+            for (const auto& e : f.entries)
+                render(f, e);
+        }
+        out += "# EOF\n";
+        return out;
+    }
+} // namespace pmgrd
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Core/Histogram.h>
+
+namespace pmgrd {
+    /**
+     * @brief Monotonic counter sharded per thread.
+     *
+     * @details Every thread increments the shard it was assigned on first use, shards live on cache lines of their
+     * own so that threads counting the same thing don't bounce a line between them. Reading sums the shards.
+     * */
+    class Counter
+    {
+    public:
+        static constexpr usize ShardCount = 16;
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::atomic<u64> value{ 0 };
+        };
+
+    private:
+        std::array<Shard, Counter::ShardCount> m_Shards;
+
+    public:
+        void Add(const u64 n = 1) noexcept { m_Shards[ThreadShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+        [[nodiscard]] u64 Value() const noexcept;
+
+    private:
+        [[nodiscard]] static usize ThreadShard() noexcept;
+    };
+
+    /**
+     * @brief Value that can go up and down, e.g. a queue depth.
+     * */
+    class Gauge
+    {
+    private:
+        std::atomic<i64> m_Value{ 0 };
+
+    public:
+        void Set(const i64 value) noexcept { m_Value.store(value, std::memory_order_relaxed); }
+        void Add(const i64 n) noexcept { m_Value.fetch_add(n, std::memory_order_relaxed); }
+
+        [[nodiscard]] i64 Value() const noexcept { return m_Value.load(std::memory_order_relaxed); }
+    };
+
+    /**
+     * @brief Owns the daemon's metrics and renders them in the OpenMetrics text format.
+     *
+     * @details Metrics are registered once up front and referenced directly afterwards, registering is the only
+     * operation taking a lock. Metrics sharing a name form a family and must only differ by their labels, they are
+     * kept together as they are registered so that rendering walks each family once. Histograms record nanoseconds
+     * and are exported in seconds.
+     * */
+    class MetricsRegistry
+    {
+    public:
+        /**
+         * @brief Upper bounds of the exported histogram buckets, in nanoseconds.
+         * */
+        static constexpr std::array<u64, 16> ExportedBuckets = {
+            1'000,      5'000,      10'000,      50'000,      100'000,     500'000,       1'000'000,     5'000'000,
+            10'000'000, 50'000'000, 100'000'000, 250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000, 10'000'000'000
+        };
+
+    private:
+        enum class Kind : u8
+        {
+            Counter,
+            Gauge,
+            Histogram
+        };
+
+        struct Entry
+        {
+            std::string labels; ///< Rendered labels without braces, e.g. type="Ready".
+            const void* metric;
+        };
+
+        struct Family
+        {
+            std::string        name;
+            std::string        help;
+            Kind               kind;
+            std::vector<Entry> entries;
+        };
+
+    private:
+        mutable std::mutex                     m_Mutex;
+        std::vector<Family>                    m_Families;
+        std::unordered_map<std::string, usize> m_FamilyIndex; ///< Index of each family in m_Families by name.
+        std::deque<Counter>                    m_Counters;
+        std::deque<Gauge>                      m_Gauges;
+        std::vector<Gauge*>                    m_FreeGauges; ///< Removed gauges, handed out again by AddGauge.
+        std::deque<Histogram>                  m_Histograms;
+
+    public:
+        /**
+         * @param name Name of the metric without the _total suffix, e.g. pmgrd_packets_received.
+         * @param help Description of the metric, the first one registered for a name is used.
+         * @param labels Labels without braces, e.g. type="Ready".
+         * */
+        Counter&   AddCounter(std::string name, std::string help, std::string labels = {});
+        Gauge&     AddGauge(std::string name, std::string help, std::string labels = {});
+        Histogram& AddHistogram(std::string name, std::string help, std::string labels = {});
+
+        /**
+         * @brief Stops exporting @p gauge of the family @p name and reuses it for the next gauge registered.
+         *
+         * @note @p gauge must no longer be referenced once removed.
+         * */
+        void RemoveGauge(const std::string& name, Gauge& gauge);
+
+        /**
+         * @brief Renders every metric in the OpenMetrics text format, terminated by # EOF.
+         * */
+        [[nodiscard]] std::string ToOpenMetrics() const;
+
+    private:
+        void Register(std::string&& name, std::string&& help, std::string&& labels, const Kind kind,
+                      const void* metric);
+    };
+} // namespace pmgrd
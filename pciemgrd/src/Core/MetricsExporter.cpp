@@ -0,0 +1,150 @@
+#include "MetricsExporter.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Utils/Utils.h>
+
+namespace pmgrd {
+    MetricsExporter::MetricsExporter(Logger& logger, const MetricsRegistry& registry, const std::string_view target)
+        : m_Logger(logger)
+        , m_Registry(registry)
+        , m_Target(target)
+        , m_UnixSocket(target.starts_with(MetricsExporter::UnixPrefix))
+        , m_ListenFd(-1)
+        , m_WakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , m_Run(false)
+    {
+        if (m_UnixSocket)
+            m_Target.erase(0, std::strlen(MetricsExporter::UnixPrefix));
+    }
+
+    MetricsExporter::~MetricsExporter() noexcept
+    {
+        Stop();
+        if (m_WakeFd != -1)
+            close(m_WakeFd);
+    }
+
+    [[nodiscard]] Result<Err> MetricsExporter::Start() noexcept
+    {
+        if (m_Thread.joinable())
+            return Err{ ErrType::InvalidState, "The metrics exporter has already been started." };
+        if (m_WakeFd == -1)
+            return Err{ ErrType::IOError, "Failed to create the metrics exporter's eventfd: {}", std::strerror(errno) };
+
+        if (m_UnixSocket)
+        {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (m_Target.empty() || m_Target.size() >= sizeof(addr.sun_path))
+                return Err{ ErrType::InvalidOperation, "Invalid metrics socket path '{}'.", m_Target };
+            std::memcpy(addr.sun_path, m_Target.c_str(), m_Target.size() + 1);
+
+            m_ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_ListenFd == -1)
+                return Err{ ErrType::NetSocketError, "Failed to create the metrics socket: {}", std::strerror(errno) };
+
+            // A stale socket left behind by a previous run would make bind fail.
+            unlink(m_Target.c_str());
+            if (bind(m_ListenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == -1 ||
+                listen(m_ListenFd, 8) == -1)
+            {
+                const auto err = Err{ ErrType::NetListenFailure, "Failed to listen on '{}': {}", m_Target,
+                                      std::strerror(errno) };
+                close(m_ListenFd);
+                m_ListenFd = -1;
+                return err;
+            }
+        }
+
+        m_Run.store(true);
+        m_Thread = std::thread{ &MetricsExporter::Run, this };
+        m_Logger.Log(lgx::Level::Info, "Exporting metrics to {}{}.", m_UnixSocket ? MetricsExporter::UnixPrefix : "",
+                     m_Target);
+        return Ok();
+    }
+
+    void MetricsExporter::Stop() noexcept
+    {
+        if (!m_Thread.joinable())
+            return;
+
+        m_Run.store(false);
+        const u64                   value = 1;
+        [[maybe_unused]] const auto res   = write(m_WakeFd, &value, sizeof(value));
+        m_Thread.join();
+
+        if (m_UnixSocket)
+        {
+            close(m_ListenFd);
+            m_ListenFd = -1;
+            unlink(m_Target.c_str());
+        }
+        else
+            Dump();
+    }
+
+    void MetricsExporter::Run() noexcept
+    {
+        const i32 timeout =
+            m_UnixSocket ? -1 : static_cast<i32>(std::chrono::milliseconds{ MetricsExporter::DumpInterval }.count());
+
+        pollfd pfds[2] = { { .fd = m_WakeFd, .events = POLLIN, .revents = 0 },
+                           { .fd = m_ListenFd, .events = POLLIN, .revents = 0 } };
+        while (m_Run.load())
+        {
+            if (!m_UnixSocket)
+                Dump();
+
+            const i32 res = poll(pfds, m_UnixSocket ? 2 : 1, timeout);
+            if (res == -1 && errno != EINTR)
+            {
+                m_Logger.Log(lgx::Level::Error, "Metrics exporter failed to poll: {}", std::strerror(errno));
+                break;
+            }
+
+            if (m_UnixSocket && (pfds[1].revents & POLLIN))
+                Serve();
+        }
+    }
+
+    void MetricsExporter::Dump() noexcept
+    {
+        if (const auto result = utils::fs::WriteAtomic(m_Target, m_Registry.ToOpenMetrics()); !result)
+        {
+            const auto err = result.UnwrapErr();
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "Failed to dump the metrics.\n\t{}", err);
+        }
+    }
+
+    void MetricsExporter::Serve() noexcept
+    {
+        const i32 client = accept4(m_ListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client == -1)
+            return;
+
+        // Scrapers read until EOF, a client that stops reading only fails its own scrape.
+        const timeval send_timeout{ .tv_sec = 1, .tv_usec = 0 };
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+        const auto text    = m_Registry.ToOpenMetrics();
+        usize      written = 0;
+        while (written < text.size())
+        {
+            const auto res = send(client, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+            if (res == -1 && errno == EINTR)
+                continue;
+            else if (res == -1)
+                break;
+            written += static_cast<usize>(res);
+        }
+        close(client);
+    }
+} // namespace pmgrd
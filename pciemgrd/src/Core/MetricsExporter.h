@@ -0,0 +1,63 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <Core/Error.h>
+#include <Core/Metrics.h>
+#include <Core/Result.h>
+#include <Log/Logger.h>
+
+namespace pmgrd {
+    /**
+     * @brief Makes a @ref MetricsRegistry available for scraping in the OpenMetrics text format.
+     *
+     * @details A target of the form unix:<path> listens on a Unix stream socket and writes a fresh dump to every
+     * client that connects before closing the connection, e.g. socat - UNIX-CONNECT:<path>. Any other target is a
+     * file which is atomically replaced every @ref DumpInterval and once more when stopped.
+     * */
+    class MetricsExporter
+    {
+    public:
+        static constexpr auto UnixPrefix   = "unix:";
+        static constexpr auto DumpInterval = std::chrono::seconds{ 10 };
+
+    private:
+        Logger&                m_Logger;
+        const MetricsRegistry& m_Registry;
+        std::string            m_Target;
+        bool                   m_UnixSocket;
+        i32                    m_ListenFd;
+        i32                    m_WakeFd;
+        std::atomic<bool>      m_Run;
+        std::thread            m_Thread;
+
+    public:
+        MetricsExporter(Logger& logger, const MetricsRegistry& registry, const std::string_view target);
+        MetricsExporter(const MetricsExporter&)            = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+        ~MetricsExporter() noexcept;
+
+    public:
+        /**
+         * @brief Binds the socket if needed and starts exporting on a background thread.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Start() noexcept;
+
+        /**
+         * @brief Stops exporting, writing a final dump when exporting to a file.
+         * */
+        void Stop() noexcept;
+
+    private:
+        void Run() noexcept;
+        void Dump() noexcept;
+        void Serve() noexcept;
+    };
+} // namespace pmgrd
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace pmgrd {
+    /**
+     * @brief Refers to a value stored in a @ref SlotMap.
+     *
+     * @details The generation is bumped every time a slot is vacated, so a handle outliving its value never
+     * resolves to whatever reuses the slot afterwards. A default constructed handle never resolves.
+     * */
+    struct SlotHandle
+    {
+        u32 index      = 0;
+        u32 generation = 0;
+
+    public:
+        [[nodiscard]] bool operator==(const SlotHandle&) const noexcept = default;
+    };
+
+    /**
+     * @brief Stores values in reusable slots addressed by generational @ref SlotHandle s.
+     *
+     * @details Lookups and erasures are O(1), vacated slots are kept on a free list and reused by the next
+     * @ref Emplace so the storage only ever grows up to the peak number of values held at once.
+     *
+     * @note Not thread-safe. Pointers returned by @ref Get are invalidated by @ref Emplace.
+     * */
+    template <typename T>
+    class SlotMap
+    {
+    private:
+        static constexpr u32 NoFreeSlot = std::numeric_limits<u32>::max();
+
+        struct Slot
+        {
+            std::optional<T> value;
+            u32              generation = 1;
+            u32              nextFree   = NoFreeSlot;
+        };
+
+    private:
+        std::vector<Slot> m_Slots;
+        u32               m_FreeHead = NoFreeSlot;
+        usize             m_Size     = 0;
+
+    public:
+        /**
+         * @brief Constructs a value in a free slot, growing the storage only if there is none.
+         *
+         * @returns The @ref SlotHandle of the new value.
+         * */
+        template <typename... TArgs>
+        SlotHandle Emplace(TArgs&&... args)
+        {
+            u32 index;
+            if (m_FreeHead != NoFreeSlot)
+            {
+                index      = m_FreeHead;
+                m_FreeHead = m_Slots[index].nextFree;
+            }
+            else
+            {
+                index = static_cast<u32>(m_Slots.size());
+                m_Slots.emplace_back();
+            }
+
+            auto& slot = m_Slots[index];
+            slot.value.emplace(std::forward<TArgs>(args)...);
+            ++m_Size;
+            return SlotHandle{ index, slot.generation };
+        }
+
+        /**
+         * @returns Pointer to the value of @p handle or nullptr if it has been erased since.
+         * */
+        [[nodiscard]] T* Get(const SlotHandle handle) noexcept
+        {
+            if (handle.index >= m_Slots.size())
+                return nullptr;
+
+            auto& slot = m_Slots[handle.index];
+            return (slot.value && slot.generation == handle.generation) ? &*slot.value : nullptr;
+        }
+        [[nodiscard]] const T* Get(const SlotHandle handle) const noexcept
+        {
+            return const_cast<SlotMap*>(this)->Get(handle);
+        }
+
+        /**
+         * @brief Destroys the value of @p handle and puts its slot up for reuse.
+         *
+         * @returns Whether @p handle still referred to a value.
+         * */
+        bool Erase(const SlotHandle handle) noexcept
+        {
+            if (!Get(handle))
+                return false;
+
+            auto& slot = m_Slots[handle.index];
+            slot.value.reset();
+
+            // Generation 0 is reserved for default constructed handles.
+            if (++slot.generation == 0)
+                slot.generation = 1;
+
+            slot.nextFree = m_FreeHead;
+            m_FreeHead    = handle.index;
+            --m_Size;
+            return true;
+        }
+
+        /**
+         * @brief Invokes @p fn with the handle and value of every occupied slot.
+         * */
+        template <typename TFn>
+        void ForEach(TFn&& fn)
+        {
+            for (u32 i = 0; i < m_Slots.size(); ++i)
+            {
+                if (auto& slot = m_Slots[i]; slot.value)
+                    fn(SlotHandle{ i, slot.generation }, *slot.value);
+            }
+        }
+
+        /**
+         * @brief Number of values held.
+         * */
+        [[nodiscard]] usize Size() const noexcept { return m_Size; }
+
+        /**
+         * @brief Number of slots allocated, the peak of @ref Size.
+         * */
+        [[nodiscard]] usize Capacity() const noexcept { return m_Slots.size(); }
+    };
+} // namespace pmgrd
@@ -0,0 +1,303 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iterator>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <Utils/Utils.h>
+
+namespace pmgrd::trace {
+    namespace {
+        // The signal handler can only reach the tracer through a global, it only writes to the eventfd.
+        std::atomic<i32> s_SignalWakeFd{ -1 };
+
+        void AppendJsonString(std::string& out, const std::string_view str)
+        {
+            out += '"';
+            for (const char c : str)
+            {
+                if (c == '"' || c == '\\')
+                    out += '\\';
+                if (static_cast<u8>(c) < 0x20)
+                    fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<u8>(c));
+                else
+                    out += c;
+            }
+            out += '"';
+        }
+    } // namespace
+
+    Tracer::Tracer() noexcept
+        : m_Enabled(false)
+        , m_Capacity(Tracer::DefaultEventBudget / Tracer::MaxBuffers)
+        , m_Origin(Clock::now())
+        , m_NextAsyncId(1)
+        , m_Logger(nullptr)
+        , m_WakeFd(-1)
+    {
+    }
+
+    Tracer::~Tracer() noexcept
+    {
+        StopDumpOnSignal();
+    }
+
+    [[nodiscard]] Tracer& Tracer::Get() noexcept
+    {
+        static Tracer s_Tracer;
+        return s_Tracer;
+    }
+
+    void Tracer::Enable(const usize event_budget) noexcept
+    {
+        m_Capacity = std::max<usize>(event_budget / Tracer::MaxBuffers, 1);
+        m_Origin   = Clock::now();
+        m_Enabled.store(true);
+    }
+
+    void Tracer::SetThreadName(std::string name) noexcept
+    {
+        if (!IsEnabled())
+            return;
+
+        auto&            buffer = LocalBuffer();
+        std::scoped_lock lock{ m_BuffersMutex };
+        buffer.name = std::move(name);
+    }
+
+    void Tracer::Record(const Event& event) noexcept
+    {
+        auto& buffer = LocalBuffer();
+        while (buffer.writing.test_and_set(std::memory_order_acquire))
+            ;
+        const u64 head = buffer.head.load(std::memory_order_relaxed);
+
+        // Pairs with the fence in ToChromeJson, a reader that sees part of this write also sees the head before it.
+        std::atomic_thread_fence(std::memory_order_release);
+        buffer.events[head % m_Capacity] = event;
+        buffer.head.store(head + 1, std::memory_order_release);
+        buffer.writing.clear(std::memory_order_release);
+    }
+
+    void Tracer::RecordAsync(const std::string_view category, const std::string_view name,
+                             const Clock::time_point start, const Clock::time_point end) noexcept
+    {
+        if (IsEnabled())
+            Record({ category, name, start, end, m_NextAsyncId.fetch_add(1, std::memory_order_relaxed) });
+    }
+
+    [[nodiscard]] Tracer::ThreadBuffer& Tracer::LocalBuffer() noexcept
+    {
+        // Hands the buffer back when the thread exits.
+        struct Owner
+        {
+            ThreadBuffer* buffer = nullptr;
+            ~Owner() noexcept
+            {
+                if (buffer)
+                    Tracer::Get().RetireBuffer(*buffer);
+            }
+        };
+
+        thread_local Owner t_Owner;
+        if (!t_Owner.buffer)
+            t_Owner.buffer = &AcquireBuffer();
+        return *t_Owner.buffer;
+    }
+
+    [[nodiscard]] Tracer::ThreadBuffer& Tracer::AcquireBuffer() noexcept
+    {
+        const i32        tid = gettid();
+        std::scoped_lock lock{ m_BuffersMutex };
+
+        if (m_Buffers.size() < Tracer::MaxBuffers)
+        {
+            auto buffer    = std::make_unique<ThreadBuffer>();
+            buffer->tid    = tid;
+            buffer->name   = fmt::format("Thread {}", tid);
+            buffer->events = std::make_unique<Event[]>(m_Capacity);
+            buffer->users  = 1;
+            return *m_Buffers.emplace_back(std::move(buffer));
+        }
+
+        // Out of buffers, the spans of the thread that left first make room for ours.
+        if (!m_Retired.empty())
+        {
+            auto& buffer = *m_Retired.front();
+            m_Retired.pop_front();
+            buffer.tid   = tid;
+            buffer.name  = fmt::format("Thread {}", tid);
+            buffer.users = 1;
+            buffer.head.store(0, std::memory_order_relaxed);
+            return buffer;
+        }
+
+        // Every buffer is in use, share the one with the fewest threads on it.
+        auto& buffer = **std::min_element(m_Buffers.begin(), m_Buffers.end(),
+                                          [](const auto& a, const auto& b) { return a->users < b->users; });
+        ++buffer.users;
+        buffer.name = fmt::format("Shared by {} threads", buffer.users);
+        return buffer;
+    }
+
+    void Tracer::RetireBuffer(ThreadBuffer& buffer) noexcept
+    {
+        std::scoped_lock lock{ m_BuffersMutex };
+        if (--buffer.users == 0)
+            m_Retired.push_back(&buffer);
+    }
+
+    [[nodiscard]] std::string Tracer::ToChromeJson() const
+    {
+        const auto pid = getpid();
+        const auto us  = [this](const Clock::time_point t)
+        { return std::chrono::duration<double, std::micro>(t - m_Origin).count(); };
+
+        std::string out   = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        auto        it    = std::back_inserter(out);
+        bool        empty = true;
+        const auto  begin = [&]()
+        {
+            if (!empty)
+                out += ",\n";
+            empty = false;
+        };
+
+        std::scoped_lock   lock{ m_BuffersMutex };
+        std::vector<Event> events;
+        for (const auto& buffer : m_Buffers)
+        {
+            begin();
+            fmt::format_to(it, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":",
+                           pid, buffer->tid);
+            AppendJsonString(out, buffer->name);
+            out += "}}";
+
+            // The owning thread keeps recording, copy what's there and drop whatever it overwrote meanwhile. The
+            // slot of now_head may be half written, so it's dropped along with the ones already overwritten.
+            const u64 head   = buffer->head.load(std::memory_order_acquire);
+            const u64 oldest = head > m_Capacity ? head - m_Capacity : 0;
+            events.clear();
+            for (u64 i = oldest; i < head; ++i)
+                events.push_back(buffer->events[i % m_Capacity]);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const u64 now_head = buffer->head.load(std::memory_order_relaxed);
+            const u64 valid    = now_head + 1 > m_Capacity ? now_head + 1 - m_Capacity : 0;
+            const u64 skip     = (valid > oldest) ? std::min<u64>(valid - oldest, events.size()) : 0;
+
+            for (usize i = skip; i < events.size(); ++i)
+            {
+                const auto& e = events[i];
+                begin();
+                if (e.asyncId == 0)
+                {
+                    fmt::format_to(it,
+                                   "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                                   "\"pid\":{},\"tid\":{}}}",
+                                   e.name, e.category, us(e.start), us(e.end) - us(e.start), pid, buffer->tid);
+                }
+                else
+                {
+                    fmt::format_to(it,
+                                   "{{\"name\":\"{0}\",\"cat\":\"{1}\",\"ph\":\"b\",\"id\":{2},\"ts\":{3:.3f},"
+                                   "\"pid\":{5},\"tid\":{6}}},\n"
+                                   "{{\"name\":\"{0}\",\"cat\":\"{1}\",\"ph\":\"e\",\"id\":{2},\"ts\":{4:.3f},"
+                                   "\"pid\":{5},\"tid\":{6}}}",
+                                   e.name, e.category, e.asyncId, us(e.start), us(e.end), pid, buffer->tid);
+                }
+            }
+        }
+        out += "]}\n";
+        return out;
+    }
+
+    [[nodiscard]] Result<Err> Tracer::DumpOnSignal(Logger& logger, std::string path) noexcept
+    {
+        if (m_DumpThread.joinable())
+            return Err{ ErrType::InvalidState, "Trace dumps on SIGUSR1 have already been set up." };
+
+        m_WakeFd = eventfd(0, EFD_CLOEXEC);
+        if (m_WakeFd == -1)
+            return Err{ ErrType::IOError, "Failed to create the tracer's eventfd: {}", std::strerror(errno) };
+
+        m_Logger   = &logger;
+        m_DumpPath = std::move(path);
+        s_SignalWakeFd.store(m_WakeFd);
+
+        struct sigaction action{};
+        action.sa_handler = &Tracer::OnSignal;
+        action.sa_flags   = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGUSR1, &action, nullptr) == -1)
+        {
+            s_SignalWakeFd.store(-1);
+            close(m_WakeFd);
+            m_WakeFd = -1;
+            return Err{ ErrType::InvalidOperation, "Failed to install the SIGUSR1 handler: {}", std::strerror(errno) };
+        }
+
+        m_DumpThread = std::thread{ &Tracer::DumpThread, this };
+        return Ok();
+    }
+
+    void Tracer::StopDumpOnSignal() noexcept
+    {
+        if (!m_DumpThread.joinable())
+            return;
+
+        signal(SIGUSR1, SIG_DFL);
+        s_SignalWakeFd.store(-1);
+
+        const u64                   value = Tracer::StopSignal;
+        [[maybe_unused]] const auto res   = write(m_WakeFd, &value, sizeof(value));
+        m_DumpThread.join();
+        close(m_WakeFd);
+        m_WakeFd = -1;
+    }
+
+    void Tracer::DumpThread() noexcept
+    {
+        while (true)
+        {
+            u64 value = 0;
+            if (read(m_WakeFd, &value, sizeof(value)) == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            // Added by StopDumpOnSignal.
+            if (value >= Tracer::StopSignal)
+                break;
+
+            if (const auto result = utils::fs::WriteAtomic(m_DumpPath, ToChromeJson()); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger->Warn("Failed to write the trace.\n\t{}", err);
+            }
+            else
+                m_Logger->Info("Trace written to '{}'.", m_DumpPath);
+        }
+    }
+
+    void Tracer::OnSignal(int) noexcept
+    {
+        // Only async-signal-safe calls in here.
+        const int saved_errno = errno;
+        if (const i32 fd = s_SignalWakeFd.load(); fd != -1)
+        {
+            const u64                   value = 1;
+            [[maybe_unused]] const auto res   = write(fd, &value, sizeof(value));
+        }
+        errno = saved_errno;
+    }
+} // namespace pmgrd::trace
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Log/Logger.h>
+
+namespace pmgrd::trace {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A span recorded by a thread.
+     *
+     * @note Names and categories are not copied, they must have static storage.
+     * */
+    struct Event
+    {
+        std::string_view  category;
+        std::string_view  name;
+        Clock::time_point start;
+        Clock::time_point end;
+        u64               asyncId; ///< 0 for spans nested on their thread, otherwise the span gets a track of its own.
+    };
+
+    /**
+     * @brief Collects spans into per-thread ring buffers and renders them as Chrome trace-event JSON, which can be
+     * loaded into Perfetto or chrome://tracing.
+     *
+     * @details Tracing is off until @ref Enable is called, a disabled @ref Span costs a relaxed load. The event
+     * budget is split evenly over at most @ref MaxBuffers ring buffers, so only the most recent spans are kept and
+     * tracing costs the same however many Endpoint threads there are. Every thread gets a buffer of its own while
+     * there are some left, publishing its write position is the only synchronisation with readers besides an
+     * uncontended spinlock. Buffers outlive their threads so that short-lived Endpoint threads still show up in
+     * later dumps, once all of them are taken the buffer of the longest gone thread is handed to the next new
+     * thread, and with none of them gone threads share the least shared buffer.
+     * */
+    class Tracer
+    {
+    public:
+        static constexpr usize DefaultEventBudget = 256 * 1024;
+        static constexpr usize MaxBuffers         = 64;
+
+    private:
+        /**
+         * @brief Added to the eventfd to stop the dump thread, signals only ever add 1.
+         * */
+        static constexpr u64 StopSignal = u64{ 1 } << 32;
+
+    private:
+        struct ThreadBuffer
+        {
+            i32                      tid;
+            std::string              name;
+            std::unique_ptr<Event[]> events;
+            std::atomic<u64>         head{ 0 };
+            std::atomic_flag         writing;   ///< Serialises the threads sharing the buffer.
+            usize                    users = 0; ///< Threads recording into the buffer.
+        };
+
+    private:
+        std::atomic<bool>                          m_Enabled;
+        usize                                      m_Capacity;
+        Clock::time_point                          m_Origin;
+        std::atomic<u64>                           m_NextAsyncId;
+        mutable std::mutex                         m_BuffersMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+        std::deque<ThreadBuffer*>                  m_Retired;
+
+        // Dumping on SIGUSR1.
+        Logger*     m_Logger;
+        std::string m_DumpPath;
+        i32         m_WakeFd;
+        std::thread m_DumpThread;
+
+    private:
+        Tracer() noexcept;
+
+    public:
+        Tracer(const Tracer&)            = delete;
+        Tracer& operator=(const Tracer&) = delete;
+        ~Tracer() noexcept;
+
+    public:
+        [[nodiscard]] static Tracer& Get() noexcept;
+
+        /**
+         * @brief Starts recording, keeping the last @p event_budget spans spread over up to @ref MaxBuffers buffers.
+         *
+         * @note Must be called before any other thread records.
+         * */
+        void Enable(const usize event_budget) noexcept;
+
+        [[nodiscard]] bool IsEnabled() const noexcept { return m_Enabled.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Names the calling thread in the trace.
+         * */
+        void SetThreadName(std::string name) noexcept;
+
+        void Record(const Event& event) noexcept;
+
+        /**
+         * @brief Records a span that isn't nested on the calling thread, e.g. the time a packet spent queued.
+         * */
+        void RecordAsync(const std::string_view category, const std::string_view name, const Clock::time_point start,
+                         const Clock::time_point end) noexcept;
+
+        /**
+         * @brief Renders every recorded span as Chrome trace-event JSON.
+         * */
+        [[nodiscard]] std::string ToChromeJson() const;
+
+        /**
+         * @brief Writes the trace to @p path every time the process receives SIGUSR1.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> DumpOnSignal(Logger& logger, std::string path) noexcept;
+
+        /**
+         * @brief Stops dumping on SIGUSR1.
+         * */
+        void StopDumpOnSignal() noexcept;
+
+    private:
+        [[nodiscard]] ThreadBuffer& LocalBuffer() noexcept;
+        [[nodiscard]] ThreadBuffer& AcquireBuffer() noexcept;
+        void                        RetireBuffer(ThreadBuffer& buffer) noexcept;
+        void                        DumpThread() noexcept;
+        static void                 OnSignal(int) noexcept;
+    };
+
+    /**
+     * @brief Records the lifetime of the object as a span of the calling thread.
+     * */
+    class Span
+    {
+    private:
+        std::string_view  m_Category;
+        std::string_view  m_Name;
+        Clock::time_point m_Start;
+        bool              m_Active;
+
+    public:
+        Span(const std::string_view category, const std::string_view name) noexcept
+            : m_Category(category)
+            , m_Name(name)
+            , m_Active(Tracer::Get().IsEnabled())
+        {
+            if (m_Active)
+                m_Start = Clock::now();
+        }
+        Span(const Span&)            = delete;
+        Span& operator=(const Span&) = delete;
+        ~Span() noexcept
+        {
+            if (m_Active)
+                Tracer::Get().Record({ m_Category, m_Name, m_Start, Clock::now(), 0 });
+        }
+    };
+} // namespace pmgrd::trace
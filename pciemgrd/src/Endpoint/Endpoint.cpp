@@ -1,9 +1,18 @@
 #include "Endpoint.h"
 
 namespace pmgrd {
-    Endpoint::Endpoint(const u8 id, net::Socket* const socket) noexcept
+    Endpoint::Endpoint(const NodeID id, net::Socket* const socket, const bool subscribed,
+                       net::NetMetrics* const metrics) noexcept
         : m_Id(id)
         , m_Socket(socket)
+        , m_Subscribed(subscribed)
+        , m_ConfigKind(ConfigKind::None)
+        , m_ConfigVersion(0)
+        , m_Session()
+        , m_Streaming(false)
+        , m_Tagged(false)
+        , m_Metrics(metrics)
+        , m_RequestTag(0)
     {
     }
 
@@ -2,32 +2,122 @@
 
 #include <CommonDef.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <thread>
 
+#include <Camera/CamConfigSnapshot.h>
 #include <Core/Error.h>
+#include <Core/Ids.h>
 #include <Core/Result.h>
+#include <Net/ClockSync.h>
+#include <Net/NetMetrics.h>
 #include <Net/NetPacket.h>
+#include <Net/SessionTable.h>
 
 namespace pmgrd {
-    struct Endpoint
+    struct Endpoint : public std::enable_shared_from_this<Endpoint>
     {
     private:
-        u8           m_Id;
-        net::Socket* m_Socket;
+        NodeID                  m_Id;
+        net::Socket*            m_Socket;
+        bool                    m_Subscribed;
+        std::atomic<ConfigKind> m_ConfigKind;
+        std::atomic<u64>        m_ConfigVersion;
+        net::SessionLease       m_Session;
+        bool                    m_Streaming;
+        bool                    m_Tagged;
+        std::mutex              m_SendMutex;
+        net::NetMetrics*        m_Metrics;
+        u16                     m_RequestTag;
+        net::ClockSync          m_Clock;
 
     public:
         Endpoint() noexcept = default;
-        Endpoint(const u8 id, net::Socket* const socket) noexcept;
+        Endpoint(const NodeID id, net::Socket* const socket, const bool subscribed = false,
+                 net::NetMetrics* const metrics = nullptr) noexcept;
         ~Endpoint() noexcept;
 
     public:
-        [[nodiscard]] u8           GetID() const noexcept { return m_Id; }
+        [[nodiscard]] NodeID       GetID() const noexcept { return m_Id; }
         [[nodiscard]] net::Socket* GetSocket() const noexcept { return m_Socket; }
+        [[nodiscard]] bool         IsSubscribed() const noexcept { return m_Subscribed; }
+        [[nodiscard]] ConfigKind   GetConfigKind() const noexcept { return m_ConfigKind.load(); }
+        [[nodiscard]] u64          GetConfigVersion() const noexcept { return m_ConfigVersion.load(); }
+
+        [[nodiscard]] const net::SessionLease& GetSession() const noexcept { return m_Session; }
 
         [[nodiscard]] bool IsConnected() const noexcept { return m_Socket && m_Socket->connected; }
 
+        /**
+         * @brief Round-trip time and clock offset of the Endpoint, measured if it announced @ref ReadyFlags_Ping.
+         * */
+        [[nodiscard]] net::ClockSync&       GetClock() noexcept { return m_Clock; }
+        [[nodiscard]] const net::ClockSync& GetClock() const noexcept { return m_Clock; }
+
+        /**
+         * @brief Remembers which configuration the Endpoint requested so that updates can be pushed to it.
+         * */
+        void SetConfigKind(const ConfigKind kind) noexcept { m_ConfigKind.store(kind); }
+
+        /**
+         * @brief Remembers the version of the configuration last sent, kept in the Endpoint's session.
+         * */
+        void SetConfigVersion(const u64 version) noexcept { m_ConfigVersion.store(version); }
+
+        /**
+         * @brief Binds the Endpoint to a session, a 0 token if it didn't open one. Must be called before it's shared.
+         * */
+        void SetSession(const net::SessionLease& lease) noexcept { m_Session = lease; }
+
+        /**
+         * @brief Whether the Endpoint announced @ref net::ReadyFlags_Stream. Must be called before it's shared.
+         * */
+        void SetStreaming(const bool streaming) noexcept { m_Streaming = streaming; }
+
+        /**
+         * @brief Whether the Endpoint announced @ref net::ReadyFlags_Tags, untagged Endpoints expect their replies in
+         * request order. Must be called before it's shared.
+         * */
+        [[nodiscard]] bool IsTagged() const noexcept { return m_Tagged; }
+        void               SetTagged(const bool tagged) noexcept { m_Tagged = tagged; }
+
+        /**
+         * @brief Tag of the request being dispatched, echoed by @ref Reply.
+         *
+         * @note Dispatcher thread only, handlers replying from another thread must capture it beforehand.
+         * */
+        [[nodiscard]] u16 GetRequestTag() const noexcept { return m_RequestTag; }
+        void              SetRequestTag(const u16 tag) noexcept { m_RequestTag = tag; }
+
     public:
-        inline Result<Err> Send(net::Packet&& packet) noexcept { return net::BeginSend(m_Socket, std::move(packet)); }
+        /**
+         * @brief Sends a packet to the Endpoint, streamed in chunks if it's large and the Endpoint takes them.
+         *
+         * @note Thread-safe, replies and configuration pushes can originate from different threads.
+         * */
+        inline Result<Err> Send(net::Packet&& packet) noexcept
+        {
+            const auto       header = packet.header;
+            std::scoped_lock lock{ m_SendMutex };
+            const bool       stream =
+                m_Streaming && packet.data.size() > net::StreamChunkSize && net::IsStreamable(header.type);
+            TRY_UNWRAP((stream) ? net::SendStream(m_Socket, header, packet.Data(), packet.data.size())
+                                : net::BeginSend(m_Socket, std::move(packet)));
+
+            if (m_Metrics)
+                m_Metrics->RecordOut(header);
+            return Ok();
+        }
+
+        /**
+         * @brief Sends the reply to the request being dispatched, tagged like the request.
+         * */
+        inline Result<Err> Reply(net::Packet&& packet) noexcept
+        {
+            packet.header.tag = m_RequestTag;
+            return Send(std::move(packet));
+        }
     };
 } // namespace pmgrd
@@ -0,0 +1,236 @@
+#include "BinaryLog.h"
+
+#include <cerrno>
+#include <ctime>
+#include <functional>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace pmgrd {
+    namespace {
+        [[nodiscard]] constexpr usize AlignRecord(const usize size) noexcept
+        {
+            return (size + binlog::RecordAlignment - 1) & ~(binlog::RecordAlignment - 1);
+        }
+
+        [[nodiscard]] constexpr usize AlignRecordDown(const usize size) noexcept
+        {
+            return size & ~(binlog::RecordAlignment - 1);
+        }
+
+        [[nodiscard]] binlog::Level ToBinLevel(const lgx::Level level) noexcept
+        {
+            switch (level)
+            {
+                case lgx::Level::Warn: return binlog::Level::Warn;
+                case lgx::Level::Error: return binlog::Level::Error;
+                case lgx::Level::Fatal: return binlog::Level::Fatal;
+                default: return binlog::Level::Info;
+            }
+        }
+
+        [[nodiscard]] i64 ClockNs(const clockid_t clock) noexcept
+        {
+            timespec ts{};
+            clock_gettime(clock, &ts);
+            return static_cast<i64>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+        }
+    } // namespace
+
+    BinaryLog::BinaryLog() noexcept
+        : m_Fd(-1)
+        , m_Base(nullptr)
+        , m_Capacity(0)
+        , m_Ring(nullptr)
+        , m_RingSize(0)
+        , m_NextFormatId(1)
+        , m_Formats(std::make_unique<FormatSlot[]>(BinaryLog::MaxFormats))
+    {
+    }
+
+    BinaryLog::~BinaryLog() noexcept
+    {
+        if (m_Base)
+        {
+            msync(m_Base, m_Capacity, MS_SYNC);
+            munmap(m_Base, m_Capacity);
+        }
+        if (m_Fd != -1)
+            close(m_Fd);
+    }
+
+    [[nodiscard]] Result<Err> BinaryLog::Open(const std::string& path, const usize capacity) noexcept
+    {
+        if (m_Base)
+            return Err{ ErrType::InvalidState, "The binary log is already open." };
+        if (capacity < BinaryLog::MinCapacity)
+            return Err{ ErrType::InvalidOperation, "Invalid binary log capacity {}, it must be at least {}.",
+                        capacity, BinaryLog::MinCapacity };
+
+        const i32 fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return Err{ ErrType::IOError, "Unable to open '{}' for writing.", path };
+
+        // Allocate the blocks up front so that writing to the mapping can't SIGBUS on a full disk later on.
+        if (const i32 res = posix_fallocate(fd, 0, static_cast<off_t>(capacity)); res != 0)
+        {
+            close(fd);
+            return Err{ ErrType::IOError, "Failed to allocate {} bytes for '{}': {}", capacity, path,
+                        std::strerror(res) };
+        }
+
+        void* const base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            close(fd);
+            return Err{ ErrType::IOError, "Failed to map '{}': {}", path, std::strerror(errno) };
+        }
+
+        // Formats get a region of their own that the event ring never wraps over.
+        const usize format_size = AlignRecordDown(std::min(BinaryLog::FormatRegionSize, capacity / 4));
+
+        auto& header = *static_cast<binlog::FileHeader*>(base);
+        std::memcpy(header.magic, binlog::Magic, sizeof(header.magic));
+        header.version         = binlog::Version;
+        header.headerSize      = static_cast<u32>(AlignRecord(sizeof(binlog::FileHeader)));
+        header.capacity        = capacity;
+        header.realtimeBaseNs  = ClockNs(CLOCK_REALTIME);
+        header.monotonicBaseNs = ClockNs(CLOCK_MONOTONIC);
+        header.ringOffset      = header.headerSize + format_size;
+        header.ringSize        = AlignRecordDown(capacity - header.ringOffset);
+        header.formatOffset    = 0;
+        header.writeOffset     = 0;
+        header.dropped         = 0;
+
+        m_Fd       = fd;
+        m_Base     = static_cast<u8*>(base);
+        m_Capacity = capacity;
+        m_Ring     = m_Base + header.ringOffset;
+        m_RingSize = header.ringSize;
+        return Ok();
+    }
+
+    [[nodiscard]] u32 BinaryLog::FormatId(const lgx::Level level, const std::string_view func,
+                                          const std::string_view fmt) noexcept
+    {
+        const auto matches = [&](const FormatSlot& slot)
+        { return slot.func == func.data() && slot.level == level && slot.id != 0; };
+
+        // Lock-free lookup, slots are only ever published once with their format pointer stored last.
+        const usize hash = std::hash<const void*>{}(fmt.data()) ^ std::hash<const void*>{}(func.data());
+        for (usize i = 0; i < BinaryLog::MaxFormats; ++i)
+        {
+            auto&       slot = m_Formats[(hash + i) % BinaryLog::MaxFormats];
+            const auto* key  = slot.fmt.load(std::memory_order_acquire);
+            if (!key)
+                break;
+            if (key == fmt.data() && matches(slot))
+                return slot.id;
+        }
+
+        // First time this call site logs, define its format.
+        std::scoped_lock lock{ m_FormatMutex };
+        for (usize i = 0; i < BinaryLog::MaxFormats; ++i)
+        {
+            auto&       slot = m_Formats[(hash + i) % BinaryLog::MaxFormats];
+            const auto* key  = slot.fmt.load(std::memory_order_relaxed);
+            if (key == fmt.data() && matches(slot))
+                return slot.id;
+            if (key)
+                continue;
+
+            const auto fmt_len  = static_cast<u16>(std::min<usize>(fmt.size(), std::numeric_limits<u16>::max()));
+            const auto func_len = static_cast<u16>(std::min<usize>(func.size(), std::numeric_limits<u16>::max()));
+            usize      size     = sizeof(binlog::RecordHeader) + binlog::FormatBodySize + fmt_len + func_len;
+            u8*        record   = ReserveFormat(size);
+            if (!record)
+                return 0;
+
+            const u32 id  = m_NextFormatId++;
+            u8*       out = record + sizeof(binlog::RecordHeader);
+            out           = Put(out, id);
+            out           = Put(out, static_cast<u8>(ToBinLevel(level)));
+            out           = Put(out, u8{ 0 });
+            out           = Put(out, fmt_len);
+            out           = Put(out, func_len);
+            std::memcpy(out, fmt.data(), fmt_len);
+            std::memcpy(out + fmt_len, func.data(), func_len);
+            Commit(record, binlog::RecordKind::Format);
+
+            slot.func  = func.data();
+            slot.level = level;
+            slot.id    = id;
+            slot.fmt.store(fmt.data(), std::memory_order_release);
+            return id;
+        }
+
+        // Out of slots.
+        std::atomic_ref<u64>{ Header().dropped }.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    [[nodiscard]] u8* BinaryLog::ReserveFormat(usize& size) noexcept
+    {
+        const usize padding = AlignRecord(size) - size;
+        size += padding;
+
+        // Formats are never overwritten, once their region is full new call sites can't log anymore.
+        const usize start = std::atomic_ref<u64>{ Header().formatOffset }.fetch_add(size, std::memory_order_relaxed);
+        if (start + size > Header().ringOffset - Header().headerSize)
+        {
+            std::atomic_ref<u64>{ Header().dropped }.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return Begin(m_Base + Header().headerSize + start, start, size, padding);
+    }
+
+    [[nodiscard]] u8* BinaryLog::ReserveEvent(usize& size) noexcept
+    {
+        const usize padding = AlignRecord(size) - size;
+        size += padding;
+
+        if (size > m_RingSize)
+        {
+            std::atomic_ref<u64>{ Header().dropped }.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        // A record that doesn't fit before the end of the ring also reserves the rest of it and goes to its start.
+        std::atomic_ref<u64> offset{ Header().writeOffset };
+        u64                  start = offset.load(std::memory_order_relaxed);
+        usize                skip  = 0;
+        do
+        {
+            const usize pos = start % m_RingSize;
+            skip            = pos + size > m_RingSize ? m_RingSize - pos : 0;
+        } while (!offset.compare_exchange_weak(start, start + skip + size, std::memory_order_relaxed));
+
+        if (skip != 0)
+            Commit(Begin(m_Ring + start % m_RingSize, start, skip, 0), binlog::RecordKind::Skip);
+
+        start += skip;
+        return Begin(m_Ring + start % m_RingSize, start, size, padding);
+    }
+
+    u8* BinaryLog::Begin(u8* const record, const u64 position, const usize size, const usize padding) noexcept
+    {
+        // The space may still hold a record the ring wrapped over, mark it as being written before the rest changes.
+        auto* header = reinterpret_cast<binlog::RecordHeader*>(record);
+        std::atomic_ref<u8>{ header->kind }.store(static_cast<u8>(binlog::RecordKind::Uncommitted),
+                                                   std::memory_order_relaxed);
+        std::atomic_signal_fence(std::memory_order_release);
+        header->padding  = static_cast<u8>(padding);
+        header->size     = static_cast<u32>(size);
+        header->position = position;
+        return record;
+    }
+
+    void BinaryLog::Commit(u8* const record, const binlog::RecordKind kind) noexcept
+    {
+        auto* header = reinterpret_cast<binlog::RecordHeader*>(record);
+        std::atomic_ref<u8>{ header->kind }.store(static_cast<u8>(kind), std::memory_order_release);
+    }
+} // namespace pmgrd
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+#include <Logex.h>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Log/BinaryLogFormat.h>
+
+namespace pmgrd {
+    /**
+     * @brief Memory-mapped binary event log with deferred formatting.
+     *
+     * @details Events are never formatted by the daemon, a call costs reserving space with a single atomic add
+     * on the write offset, and copying the format id, a timestamp and the raw arguments into the mapping.
+     * The kernel writes the pages back in the background. Format strings are identified by their address, so
+     * they must have static storage which string literals do. Arguments that aren't numbers or strings are
+     * formatted to a string up front.
+     *
+     * Events go to a ring that wraps around once full, so the file keeps the most recent events however long the
+     * process runs. Format records live in a region of their own at the start of the file that is never
+     * overwritten, so every event left in the ring can still be decoded. Formats that don't fit into it are
+     * dropped along with their events and counted in the header.
+     *
+     * The file is rendered to text by the pciemgrd_logdecode tool.
+     * */
+    class BinaryLog
+    {
+    public:
+        static constexpr usize DefaultCapacity  = 64 * 1024 * 1024;
+        static constexpr usize MaxFormats       = 4096;
+        static constexpr usize MinCapacity      = 64 * 1024;
+        static constexpr usize FormatRegionSize = 1024 * 1024; ///< Capped to a quarter of the capacity.
+
+    private:
+        struct FormatSlot
+        {
+            std::atomic<const char*> fmt{ nullptr };
+            const char*              func  = nullptr;
+            lgx::Level               level = lgx::Level::Info;
+            u32                      id    = 0;
+        };
+
+    private:
+        i32                           m_Fd;
+        u8*                           m_Base;
+        usize                         m_Capacity;
+        u8*                           m_Ring;
+        usize                         m_RingSize;
+        std::mutex                    m_FormatMutex;
+        u32                           m_NextFormatId;
+        std::unique_ptr<FormatSlot[]> m_Formats;
+
+    public:
+        BinaryLog() noexcept;
+        BinaryLog(const BinaryLog&)            = delete;
+        BinaryLog& operator=(const BinaryLog&) = delete;
+        ~BinaryLog() noexcept;
+
+    public:
+        /**
+         * @brief Creates (or truncates) and maps the log file.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Open(const std::string& path, const usize capacity) noexcept;
+
+    public:
+        [[nodiscard]] u64 GetDropped() const noexcept
+        {
+            return std::atomic_ref<u64>{ Header().dropped }.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Appends an event.
+         * */
+        template <typename... TArgs>
+        void Write(const lgx::Level level, const std::string_view func, const std::string_view fmt,
+                   const TArgs&... args) noexcept
+        {
+            const u32 id = FormatId(level, func, fmt);
+            if (id == 0)
+                return;
+
+            // Types that have no raw encoding are formatted now, the rest are copied as is.
+            auto stored = std::tuple<decltype(Encodable(args))...>{ Encodable(args)... };
+
+            usize size = sizeof(binlog::RecordHeader) + binlog::EventBodySize;
+            std::apply([&size](const auto&... a) { ((size += EncodedSize(a)), ...); }, stored);
+
+            u8* record = ReserveEvent(size);
+            if (!record)
+                return;
+
+            u8* out = record + sizeof(binlog::RecordHeader);
+            out     = Put(out, id);
+            out     = Put(out, u32{ 0 });
+            out     = Put(out, static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                std::chrono::steady_clock::now().time_since_epoch())
+                                                .count()));
+            std::apply([&out](const auto&... a) { ((out = Encode(out, a)), ...); }, stored);
+
+            Commit(record, binlog::RecordKind::Event);
+        }
+
+    private:
+        [[nodiscard]] binlog::FileHeader& Header() const noexcept
+        {
+            return *reinterpret_cast<binlog::FileHeader*>(m_Base);
+        }
+
+        /**
+         * @brief Looks up the id of a format string, writing its definition the first time it's seen.
+         *
+         * @returns The id or 0 if the format couldn't be registered.
+         * */
+        [[nodiscard]] u32 FormatId(const lgx::Level level, const std::string_view func,
+                                   const std::string_view fmt) noexcept;
+
+        /**
+         * @brief Reserves an aligned record of at least @p size bytes in the format region, nullptr if it's full.
+         * */
+        [[nodiscard]] u8* ReserveFormat(usize& size) noexcept;
+
+        /**
+         * @brief Reserves an aligned record of at least @p size bytes in the event ring, nullptr if it's larger
+         * than the ring.
+         * */
+        [[nodiscard]] u8* ReserveEvent(usize& size) noexcept;
+
+        /**
+         * @brief Fills in the header of a record reserved at @p position of its region.
+         * */
+        static u8* Begin(u8* const record, const u64 position, const usize size, const usize padding) noexcept;
+
+        /**
+         * @brief Publishes a record reserved by @ref ReserveFormat or @ref ReserveEvent.
+         * */
+        static void Commit(u8* const record, const binlog::RecordKind kind) noexcept;
+
+    private:
+        template <typename T>
+        static auto Encodable(const T& value)
+        {
+            if constexpr (std::is_arithmetic_v<T>)
+                return value;
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+                return std::string_view{ value };
+            else
+                return fmt::format("{}", value);
+        }
+
+        template <typename T>
+        [[nodiscard]] static usize EncodedSize(const T& value) noexcept
+        {
+            if constexpr (std::is_arithmetic_v<T>)
+                return sizeof(u8) + sizeof(u64);
+            else
+                return sizeof(u8) + sizeof(u32) + std::string_view{ value }.size();
+        }
+
+        template <typename T>
+        static u8* Put(u8* out, const T& value) noexcept
+        {
+            std::memcpy(out, &value, sizeof(T));
+            return out + sizeof(T);
+        }
+
+        template <typename T>
+        static u8* Encode(u8* out, const T& value) noexcept
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                return Put(Put(out, binlog::ArgType::Bool), static_cast<u64>(value));
+            else if constexpr (std::is_same_v<T, char>)
+                return Put(Put(out, binlog::ArgType::Char), static_cast<u64>(value));
+            else if constexpr (std::is_floating_point_v<T>)
+                return Put(Put(out, binlog::ArgType::Float), static_cast<double>(value));
+            else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+                return Put(Put(out, binlog::ArgType::Int), static_cast<i64>(value));
+            else if constexpr (std::is_integral_v<T>)
+                return Put(Put(out, binlog::ArgType::UInt), static_cast<u64>(value));
+            else
+            {
+                const std::string_view str{ value };
+                out = Put(Put(out, binlog::ArgType::String), static_cast<u32>(str.size()));
+                std::memcpy(out, str.data(), str.size());
+                return out + str.size();
+            }
+        }
+    };
+} // namespace pmgrd
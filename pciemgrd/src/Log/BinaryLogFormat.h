@@ -0,0 +1,97 @@
+#pragma once
+
+#include <CommonDef.h>
+
+/**
+ * @file BinaryLogFormat.h
+ * @brief On-disk layout of the binary event log, shared by the daemon and pciemgrd_logdecode.
+ *
+ * The file starts with a @ref FileHeader followed by two regions of 16 byte aligned records. Every record starts
+ * with a @ref RecordHeader whose kind is written last, so a record with kind @ref RecordKind::Uncommitted was
+ * being written when the process died. A format string is written once as a @ref RecordKind::Format record
+ * to the format region the first time it is logged, events only carry its id, a timestamp and their raw
+ * arguments.
+ *
+ * Events go to a ring filling the rest of the file, which wraps around and overwrites the oldest events. A
+ * record never crosses the end of the ring, the space it didn't fit into is filled with a @ref RecordKind::Skip
+ * record. Every record carries its position, the bytes reserved in its region before it, so that a reader can
+ * find the first whole record past the newest ones of a ring that wrapped: it is the first one whose position
+ * matches its offset in the ring.
+ *
+ * Format record body: u32 id, u8 level, u8 reserved, u16 format length, u16 function length, format bytes,
+ * function bytes.
+ *
+ * Event record body: u32 format id, u32 reserved, u64 CLOCK_MONOTONIC timestamp in nanoseconds, then every
+ * argument as a u8 @ref ArgType followed by 8 bytes for scalars or a u32 length and the bytes for strings.
+ */
+namespace pmgrd::binlog {
+    inline constexpr char Magic[8] = { 'P', 'M', 'G', 'R', 'B', 'L', 'O', 'G' };
+    inline constexpr u32  Version  = 2;
+
+    enum class Level : u8
+    {
+        Info,
+        Warn,
+        Error,
+        Fatal
+    };
+
+    enum class RecordKind : u8
+    {
+        Uncommitted,
+        Format,
+        Event,
+        Skip ///< Fills the end of the ring a record didn't fit into.
+    };
+
+    enum class ArgType : u8
+    {
+        Bool,
+        Char,
+        Int,
+        UInt,
+        Float,
+        String
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        u32  version;
+        u32  headerSize;
+        u64  capacity;        ///< Size of the file.
+        i64  realtimeBaseNs;  ///< CLOCK_REALTIME when the file was created.
+        i64  monotonicBaseNs; ///< CLOCK_MONOTONIC when the file was created.
+        u64  ringOffset;      ///< Where the format region ends and the event ring starts.
+        u64  ringSize;        ///< Size of the event ring, up to the end of the file.
+        u64  formatOffset;    ///< Bytes reserved in the format region, may exceed it once full.
+        u64  writeOffset;     ///< Bytes ever reserved in the event ring, its position in the ring modulo ringSize.
+        u64  dropped;         ///< Records that didn't fit, formats once their region is full or oversized events.
+    };
+
+    struct RecordHeader
+    {
+        u8  kind;    ///< @ref RecordKind
+        u8  padding; ///< Bytes at the end of the record that are only there for alignment.
+        u8  reserved[2];
+        u32 size;     ///< Size of the record including this header, a multiple of @ref RecordAlignment.
+        u64 position; ///< Bytes reserved in the record's region before it.
+    };
+
+    inline constexpr usize RecordAlignment = 16;
+    static_assert(sizeof(RecordHeader) == RecordAlignment, "The end of the ring must always fit a Skip record.");
+    inline constexpr usize FormatBodySize  = 10;
+    inline constexpr usize EventBodySize   = 16;
+
+    [[nodiscard]] constexpr const char* LevelToStr(const Level level) noexcept
+    {
+        switch (level)
+        {
+            case Level::Info: return "Info";
+            case Level::Warn: return "Warn";
+            case Level::Error: return "Error";
+            case Level::Fatal: return "Fatal";
+            default: return "?";
+        }
+    }
+} // namespace pmgrd::binlog
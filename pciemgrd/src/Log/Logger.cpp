@@ -0,0 +1,208 @@
+#include "Logger.h"
+
+#include <bit>
+#include <chrono>
+
+namespace pmgrd {
+    Logger::Logger(const lgx::Logger::Properties& properties)
+        : m_Sink(std::make_unique<lgx::Logger>(properties))
+        , m_Mask(0)
+        , m_Policy(OverflowPolicy::Drop)
+        , m_Async(false)
+        , m_Run(false)
+        , m_Dropped(0)
+        , m_EnqueuePos(0)
+        , m_Producers(0)
+        , m_Consumed(0)
+    {
+    }
+
+    Logger::~Logger() noexcept
+    {
+        FlushSuppressed();
+        StopAsync();
+    }
+
+    [[nodiscard]] Result<Err> Logger::StartAsync(const usize capacity, const OverflowPolicy policy) noexcept
+    {
+        if (IsAsync())
+            return Err{ ErrType::InvalidState, "Asynchronous logging has already been started." };
+        if (capacity < 2)
+            return Err{ ErrType::InvalidOperation, "The log ring must hold at least 2 records." };
+
+        const usize size = std::bit_ceil(capacity);
+        m_Records        = std::make_unique<Record[]>(size);
+        for (usize i = 0; i < size; ++i)
+            m_Records[i].sequence.store(i, std::memory_order_relaxed);
+
+        m_Mask   = size - 1;
+        m_Policy = policy;
+        m_EnqueuePos.store(0, std::memory_order_relaxed);
+        m_Consumed.store(0, std::memory_order_relaxed);
+        m_Run.store(true);
+        m_Writer = std::thread{ &Logger::WriterThread, this };
+        m_Async.store(true, std::memory_order_release);
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> Logger::StartBinary(const std::string& path, const usize capacity) noexcept
+    {
+        if (m_Binary)
+            return Err{ ErrType::InvalidState, "Binary logging has already been started." };
+
+        auto binary = std::make_unique<BinaryLog>();
+        TRY_UNWRAP(binary->Open(path, capacity));
+
+        m_Binary = std::move(binary);
+        return Ok();
+    }
+
+    void Logger::StopAsync() noexcept
+    {
+        if (!m_Writer.joinable())
+            return;
+
+        // New records go straight to the sink from now on. Producers that saw the logger as asynchronous may still
+        // be claiming or publishing, the ring must outlive them and the writer must drain what they publish.
+        m_Async.store(false);
+        while (m_Producers.load() != 0)
+            std::this_thread::yield();
+
+        m_Run.store(false);
+        m_Writer.join();
+        m_Records.reset();
+    }
+
+    void Logger::Flush() noexcept
+    {
+        if (!IsAsync() || std::this_thread::get_id() == m_Writer.get_id())
+            return;
+
+        const usize target = m_EnqueuePos.load(std::memory_order_acquire);
+        while (m_Consumed.load(std::memory_order_acquire) < target && IsAsync())
+            std::this_thread::yield();
+    }
+
+    void Logger::FlushSuppressed() noexcept
+    {
+        RateLimiter::ForEach(
+            [this](RateLimiter& limiter)
+            {
+                if (const u64 suppressed = limiter.TakeSuppressed(); suppressed != 0)
+                    Log(limiter.GetSite(), limiter.GetLevel(), "Suppressed {} similar message(s).", suppressed);
+            });
+    }
+
+    [[nodiscard]] Logger::Record* Logger::Claim() noexcept
+    {
+        usize pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Record&     record = m_Records[pos & m_Mask];
+            const usize seq    = record.sequence.load(std::memory_order_acquire);
+            const auto  diff   = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                // The slot is free, try to take it before another producer does.
+                if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return &record;
+            }
+            else if (diff < 0)
+            {
+                // The writer hasn't consumed this slot yet, the ring is full.
+                if (m_Policy == OverflowPolicy::Drop)
+                {
+                    m_Dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                std::this_thread::yield();
+                pos = m_EnqueuePos.load(std::memory_order_relaxed);
+            }
+            else
+                pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    void Logger::Publish(Record& record) noexcept
+    {
+        const usize pos = record.sequence.load(std::memory_order_relaxed);
+        record.sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    bool Logger::Drain() noexcept
+    {
+        std::scoped_lock lock{ m_SinkMutex };
+
+        bool  wrote = false;
+        usize pos   = m_Consumed.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Record& record = m_Records[pos & m_Mask];
+            if (record.sequence.load(std::memory_order_acquire) != pos + 1)
+                break;
+
+            record.write(record, *m_Sink);
+            record.sequence.store(pos + m_Mask + 1, std::memory_order_release);
+            m_Consumed.store(++pos, std::memory_order_release);
+            wrote = true;
+        }
+        return wrote;
+    }
+
+    void Logger::WriterThread() noexcept
+    {
+        using namespace std::chrono_literals;
+
+        u64  reported_drops  = 0;
+        auto idle            = 0us;
+        auto next_suppressed = std::chrono::steady_clock::now() + RateLimiter::DefaultPeriod;
+        while (m_Run.load())
+        {
+            if (Drain())
+                idle = 0us;
+            else
+            {
+                // Back off while idle, nobody waits on the records being written.
+                idle = std::min(std::max(idle * 2, 10us), 1000us);
+                std::this_thread::sleep_for(idle);
+            }
+
+            if (const auto dropped = GetDropped(); dropped != reported_drops)
+            {
+                std::scoped_lock lock{ m_SinkMutex };
+                m_Sink->Log(lgx::Level::Warn, "Dropped {} log record(s), the log ring was full.",
+                            dropped - reported_drops);
+                reported_drops = dropped;
+            }
+
+            if (const auto now = std::chrono::steady_clock::now(); now >= next_suppressed)
+            {
+                WriteSuppressed();
+                next_suppressed = now + RateLimiter::DefaultPeriod;
+            }
+        }
+
+        // StopAsync waited for the producers, whatever they published is in the ring.
+        while (m_Consumed.load(std::memory_order_relaxed) != m_EnqueuePos.load(std::memory_order_acquire))
+        {
+            if (!Drain())
+                std::this_thread::yield();
+        }
+    }
+
+    void Logger::WriteSuppressed() noexcept
+    {
+        // Straight to the sink, the writer would wait on itself if it queued records with the Block policy.
+        RateLimiter::ForEach(
+            [this](RateLimiter& limiter)
+            {
+                if (const u64 suppressed = limiter.TakeSuppressed(); suppressed != 0)
+                {
+                    std::scoped_lock lock{ m_SinkMutex };
+                    Write(*m_Sink, limiter.GetLevel(), limiter.GetSite(), "Suppressed {} similar message(s).",
+                          suppressed);
+                }
+            });
+    }
+} // namespace pmgrd
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include <Logex.h>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Log/BinaryLog.h>
+#include <Log/RateLimiter.h>
+
+/**
+ * @brief Least severe level compiled into the daemon: 0 Info, 1 Warn, 2 Error. Fatal is always compiled in.
+ *
+ * Set through the PMGRD_MIN_LOG_LEVEL CMake option.
+ * */
+#ifndef PMGRD_MIN_LOG_LEVEL
+    #define PMGRD_MIN_LOG_LEVEL 0
+#endif
+
+/**
+ * @brief Logs through @p logger unless @p level is below @ref PMGRD_MIN_LOG_LEVEL, in which case the arguments
+ * are never evaluated. @p level is the name of a @ref lgx::Level, e.g. PMGRD_LOG(logger, Info, "{}", x).
+ * */
+#define PMGRD_LOG(logger, level, ...)                                                                                  \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (::pmgrd::IsLogLevelEnabled(lgx::Level::level))                                                   \
+            (logger).Log(lgx::Level::level, __VA_ARGS__);                                                              \
+    } while (false)
+
+/**
+ * @brief @ref PMGRD_LOG prefixed by the calling function's name.
+ * */
+#define PMGRD_LOG_FN(logger, level, ...)                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (::pmgrd::IsLogLevelEnabled(lgx::Level::level))                                                   \
+            (logger).Log(__func__, lgx::Level::level, __VA_ARGS__);                                                    \
+    } while (false)
+
+/**
+ * @brief @ref PMGRD_LOG_FN limited to @ref RateLimiter::DefaultBurst messages per
+ * @ref RateLimiter::DefaultPeriod for this call site. The first message let through after some were suppressed
+ * is preceded by how many were. Counts no later message gets to report are written by @ref Logger::FlushSuppressed.
+ * */
+#define PMGRD_LOG_LIMITED(logger, level, ...)                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (::pmgrd::IsLogLevelEnabled(lgx::Level::level))                                                   \
+        {                                                                                                              \
+            static ::pmgrd::RateLimiter pmgrd_limiter{ ::pmgrd::RateLimiter::DefaultBurst,                             \
+                                                       ::pmgrd::RateLimiter::DefaultPeriod, __func__,                  \
+                                                       lgx::Level::level };                                            \
+            if (u64 pmgrd_suppressed = 0; pmgrd_limiter.Allow(pmgrd_suppressed))                                       \
+            {                                                                                                          \
+                if (pmgrd_suppressed != 0)                                                                             \
+                    (logger).Log(__func__, lgx::Level::level, "Suppressed {} similar message(s).", pmgrd_suppressed);  \
+                (logger).Log(__func__, lgx::Level::level, __VA_ARGS__);                                                \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+namespace pmgrd {
+    [[nodiscard]] constexpr bool IsLogLevelEnabled(const lgx::Level level) noexcept
+    {
+        switch (level)
+        {
+            case lgx::Level::Warn: return PMGRD_MIN_LOG_LEVEL <= 1;
+            case lgx::Level::Error: return PMGRD_MIN_LOG_LEVEL <= 2;
+            case lgx::Level::Fatal: return true;
+            default: return PMGRD_MIN_LOG_LEVEL <= 0;
+        }
+    }
+
+    /**
+     * @brief Front-end of the @ref lgx::Logger used throughout the daemon.
+     *
+     * @details By default every call is forwarded to the underlying @ref lgx::Logger and is formatted and written
+     * synchronously by the caller. Once @ref StartAsync has been called, callers only copy their arguments into a
+     * bounded lock-free ring (a Vyukov MPSC queue) and a background thread formats and writes the records in
+     * order. What happens when the ring is full is decided by the @ref OverflowPolicy.
+     *
+     * In binary mode (see @ref StartBinary) records are written unformatted to a @ref BinaryLog instead, only errors
+     * are written to the underlying @ref lgx::Logger as well.
+     *
+     * Every write to the underlying @ref lgx::Logger, whether by a caller or the background thread, is serialised
+     * by a single mutex.
+     *
+     * @note In asynchronous and binary mode the format string must outlive the call, which string literals always
+     * do. Arguments are copied, string-like arguments are copied into a std::string.
+     * */
+    class Logger
+    {
+    public:
+        /**
+         * @brief What producers do when the ring is full.
+         * */
+        enum class OverflowPolicy : u8
+        {
+            Drop, ///< Drop the record and count it, the count is logged by the background thread.
+            Block ///< Wait for the background thread to make room.
+        };
+
+    public:
+        static constexpr usize DefaultCapacity = 8192;
+        static constexpr usize RecordSize      = 256;
+
+    private:
+        struct Record;
+        using WriteFn = void (*)(Record&, lgx::Logger&);
+
+        // Records are cache line aligned so that producers writing neighbouring records don't contend.
+        struct alignas(64) Record
+        {
+            std::atomic<usize> sequence;
+            WriteFn            write;
+            alignas(std::max_align_t) std::byte payload[Logger::RecordSize - 2 * sizeof(void*)];
+        };
+
+        struct ProducerGuard
+        {
+            std::atomic<u32>& producers;
+            ~ProducerGuard() noexcept { producers.fetch_sub(1, std::memory_order_release); }
+        };
+
+        template <typename T>
+        using StoredArg =
+            std::conditional_t<std::is_convertible_v<const T&, std::string_view>, std::string, std::decay_t<T>>;
+
+        template <typename... TArgs>
+        struct Payload
+        {
+            lgx::Level           level;
+            std::string_view     func;
+            std::string_view     fmt;
+            std::tuple<TArgs...> args;
+        };
+
+    private:
+        std::unique_ptr<lgx::Logger> m_Sink;
+        std::unique_ptr<Record[]>    m_Records;
+        usize                        m_Mask;
+        OverflowPolicy               m_Policy;
+        std::atomic<bool>            m_Async;
+        std::atomic<bool>            m_Run;
+        std::atomic<u64>             m_Dropped;
+        std::mutex                   m_SinkMutex;
+        std::thread                  m_Writer;
+        std::unique_ptr<BinaryLog>   m_Binary;
+
+        // The producers' and the writer's positions live on cache lines of their own, the count of producers in
+        // flight shares the producers' line.
+        alignas(64) std::atomic<usize> m_EnqueuePos;
+        std::atomic<u32>               m_Producers;
+        alignas(64) std::atomic<usize> m_Consumed;
+
+    public:
+        Logger(const lgx::Logger::Properties& properties);
+        ~Logger() noexcept;
+
+    public:
+        [[nodiscard]] bool IsAsync() const noexcept { return m_Async.load(std::memory_order_relaxed); }
+        [[nodiscard]] u64  GetDropped() const noexcept { return m_Dropped.load(std::memory_order_relaxed); }
+
+        void SetOutputStreams(std::vector<std::ostream*> streams)
+        {
+            Flush();
+            std::scoped_lock lock{ m_SinkMutex };
+            m_Sink->SetOutputStreams(std::move(streams));
+        }
+        void SetDefaultPrefix(std::string prefix)
+        {
+            Flush();
+            std::scoped_lock lock{ m_SinkMutex };
+            m_Sink->SetDefaultPrefix(std::move(prefix));
+        }
+        [[nodiscard]] auto GetDefaultPrefix() const { return m_Sink->GetDefaultPrefix(); }
+
+    public:
+        /**
+         * @brief Switches to asynchronous logging.
+         *
+         * @param capacity Number of records the ring can hold, rounded up to a power of two.
+         * @param policy What to do when the ring is full.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> StartAsync(const usize capacity, const OverflowPolicy policy) noexcept;
+
+        /**
+         * @brief Writes every record to the binary log at @p path from now on.
+         *
+         * @note Must be called before any other thread logs.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> StartBinary(const std::string& path, const usize capacity) noexcept;
+
+        /**
+         * @brief Writes every pending record and switches back to synchronous logging.
+         * */
+        void StopAsync() noexcept;
+
+        /**
+         * @brief Blocks until every record logged so far has been written.
+         * */
+        void Flush() noexcept;
+
+        /**
+         * @brief Reports the messages suppressed by @ref PMGRD_LOG_LIMITED that no later message has reported yet.
+         *
+         * @details Called periodically by the background thread in asynchronous mode and when the logger is
+         * destroyed, otherwise it's up to the owner to call it from time to time.
+         * */
+        void FlushSuppressed() noexcept;
+
+    public:
+        template <typename... TArgs>
+        void Log(const lgx::Level level, const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(level, {}, fmt, std::forward<TArgs>(args)...);
+        }
+
+        template <typename... TArgs>
+        void Log(const std::string_view func, const lgx::Level level, const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(level, func, fmt, std::forward<TArgs>(args)...);
+        }
+
+        template <typename... TArgs>
+        void Info(const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(lgx::Level::Info, {}, fmt, std::forward<TArgs>(args)...);
+        }
+
+        template <typename... TArgs>
+        void Warn(const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(lgx::Level::Warn, {}, fmt, std::forward<TArgs>(args)...);
+        }
+
+        template <typename... TArgs>
+        void Error(const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(lgx::Level::Error, {}, fmt, std::forward<TArgs>(args)...);
+        }
+
+        template <typename... TArgs>
+        void Fatal(const std::string_view fmt, TArgs&&... args)
+        {
+            Submit(lgx::Level::Fatal, {}, fmt, std::forward<TArgs>(args)...);
+        }
+
+    private:
+        template <typename... TArgs>
+        void Submit(const lgx::Level level, const std::string_view func, const std::string_view fmt, TArgs&&... args)
+        {
+            if (m_Binary)
+            {
+                m_Binary->Write(level, func, fmt, args...);
+                if (level != lgx::Level::Error && level != lgx::Level::Fatal)
+                    return;
+            }
+
+            // Announce ourselves before looking at the mode, StopAsync waits for every announced producer before
+            // the ring goes away.
+            m_Producers.fetch_add(1);
+
+            // Fatal records usually precede an exit, write them right away after everything before them.
+            if (!m_Async.load() || level == lgx::Level::Fatal)
+            {
+                m_Producers.fetch_sub(1, std::memory_order_release);
+                Flush();
+                std::scoped_lock lock{ m_SinkMutex };
+                Write(*m_Sink, level, func, fmt, args...);
+                return;
+            }
+
+            const ProducerGuard guard{ m_Producers };
+
+            using PayloadType = Payload<StoredArg<TArgs>...>;
+            if constexpr (sizeof(PayloadType) <= sizeof(Record::payload))
+            {
+                Enqueue<PayloadType>(level, func, fmt, std::forward<TArgs>(args)...);
+            }
+            else
+            {
+                // Too big to be stored inline, pay for formatting here instead.
+                std::string msg = fmt::vformat(fmt, fmt::make_format_args(args...));
+                Enqueue<Payload<std::string>>(level, func, "{}", std::move(msg));
+            }
+        }
+
+        template <typename PayloadType, typename... TArgs>
+        void Enqueue(const lgx::Level level, const std::string_view func, const std::string_view fmt,
+                     TArgs&&... args)
+        {
+            Record* record = Claim();
+            if (!record)
+                return;
+
+            new (record->payload)
+                PayloadType{ level, func, fmt, decltype(PayloadType::args)(std::forward<TArgs>(args)...) };
+            record->write = [](Record& r, lgx::Logger& sink)
+            {
+                auto* payload = std::launder(reinterpret_cast<PayloadType*>(r.payload));
+                std::apply([&](auto&... a) { Write(sink, payload->level, payload->func, payload->fmt, a...); },
+                           payload->args);
+                payload->~PayloadType();
+            };
+            Publish(*record);
+        }
+
+        template <typename... TArgs>
+        static void Write(lgx::Logger& sink, const lgx::Level level, const std::string_view func,
+                          const std::string_view fmt, TArgs&... args)
+        {
+            if (func.empty())
+                sink.Log(level, fmt, args...);
+            else
+                sink.Log(func, level, fmt, args...);
+        }
+
+        /**
+         * @brief Reserves the next free record, nullptr if the record was dropped.
+         * */
+        [[nodiscard]] Record* Claim() noexcept;
+        void                  Publish(Record& record) noexcept;
+        void                  WriterThread() noexcept;
+        void                  WriteSuppressed() noexcept;
+        bool                  Drain() noexcept;
+    };
+} // namespace pmgrd
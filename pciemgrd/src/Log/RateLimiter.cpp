@@ -0,0 +1,24 @@
+#include "RateLimiter.h"
+
+namespace pmgrd {
+    [[nodiscard]] bool RateLimiter::Allow(u64& suppressed) noexcept
+    {
+        const i64 now =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+
+        // Whoever moves the window forward resets the count for everyone.
+        i64 start = m_WindowStart.load(std::memory_order_relaxed);
+        if (now - start >= m_PeriodNs && m_WindowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+            m_Count.store(0, std::memory_order_relaxed);
+
+        if (m_Count.fetch_add(1, std::memory_order_relaxed) < m_Burst)
+        {
+            suppressed = m_Suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        m_Suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+} // namespace pmgrd
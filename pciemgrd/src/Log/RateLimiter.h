@@ -0,0 +1,85 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <string_view>
+
+#include <Logex.h>
+
+namespace pmgrd {
+    /**
+     * @brief Fixed window rate limiter for a single logging call site.
+     *
+     * @details At most @ref m_Burst messages are let through per window, the rest are counted and the count is
+     * handed to the next message that gets through so that it can report them. Thread-safe and lock-free, a
+     * window boundary racing with other callers may let a couple of extra messages through.
+     *
+     * Every limiter registers itself so that counts left behind once messages stop can be reported anyway, see
+     * @ref ForEach and @ref TakeSuppressed. Limiters live in function-local statics and are never unregistered.
+     * */
+    class RateLimiter
+    {
+    public:
+        static constexpr u32                       DefaultBurst  = 10;
+        static constexpr std::chrono::milliseconds DefaultPeriod = std::chrono::seconds{ 1 };
+
+    private:
+        const u32        m_Burst;
+        const i64        m_PeriodNs;
+        std::atomic<i64> m_WindowStart;
+        std::atomic<u32> m_Count;
+        std::atomic<u64> m_Suppressed;
+        std::string_view m_Site;
+        lgx::Level       m_Level;
+        RateLimiter*     m_Next;
+
+        static inline std::atomic<RateLimiter*> s_Head{ nullptr };
+
+    public:
+        RateLimiter(const u32 burst, const std::chrono::nanoseconds period, const std::string_view site,
+                    const lgx::Level level) noexcept
+            : m_Burst(burst)
+            , m_PeriodNs(period.count())
+            , m_WindowStart(std::numeric_limits<i64>::min() / 2)
+            , m_Count(0)
+            , m_Suppressed(0)
+            , m_Site(site)
+            , m_Level(level)
+            , m_Next(s_Head.load(std::memory_order_relaxed))
+        {
+            while (!s_Head.compare_exchange_weak(m_Next, this, std::memory_order_release, std::memory_order_relaxed))
+                ;
+        }
+
+    public:
+        [[nodiscard]] std::string_view GetSite() const noexcept { return m_Site; }
+        [[nodiscard]] lgx::Level       GetLevel() const noexcept { return m_Level; }
+
+    public:
+        /**
+         * @brief Decides whether a message may be logged.
+         *
+         * @param suppressed Set to the number of messages suppressed since the last one that was let through.
+         * @returns true if the message may be logged.
+         * */
+        [[nodiscard]] bool Allow(u64& suppressed) noexcept;
+
+        /**
+         * @brief Takes the number of messages suppressed since the last one that was let through.
+         * */
+        [[nodiscard]] u64 TakeSuppressed() noexcept { return m_Suppressed.exchange(0, std::memory_order_relaxed); }
+
+        /**
+         * @brief Calls @p fn with every limiter constructed so far. Thread-safe.
+         * */
+        template <typename Fn>
+        static void ForEach(Fn&& fn)
+        {
+            for (auto* limiter = s_Head.load(std::memory_order_acquire); limiter; limiter = limiter->m_Next)
+                fn(*limiter);
+        }
+    };
+} // namespace pmgrd
@@ -0,0 +1,354 @@
+#include "AsyncConnection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+namespace pmgrd::net {
+    namespace {
+        [[nodiscard]] bool SetNonBlocking(const i32 fd, const bool non_blocking) noexcept
+        {
+            const i32 flags = fcntl(fd, F_GETFL);
+            if (flags == -1)
+                return false;
+            return fcntl(fd, F_SETFL, non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) != -1;
+        }
+    } // namespace
+
+    bool AsyncConnection::PacketAwaiter::await_ready() noexcept
+    {
+        if (!connection.m_Failure)
+            return false;
+
+        waiter.packet.emplace(*connection.m_Failure);
+        return true;
+    }
+
+    void AsyncConnection::PacketAwaiter::await_suspend(const std::coroutine_handle<> handle) noexcept
+    {
+        waiter.handle = handle;
+        connection.m_Waiters.push_back(&waiter);
+        if (!connection.m_Reading)
+            connection.m_Pump = connection.Pump().handle;
+    }
+
+    bool AsyncConnection::SendTurn::await_ready() noexcept
+    {
+        if (connection.m_Sending)
+            return false;
+
+        connection.m_Sending = true;
+        return true;
+    }
+
+    void AsyncConnection::SendTurn::await_suspend(const std::coroutine_handle<> handle) noexcept
+    {
+        connection.m_SendQueue.push_back(handle);
+    }
+
+    AsyncConnection::AsyncConnection(EventLoop& loop, Socket* socket, PushDelegate on_push,
+                                     const Timeouts& timeouts) noexcept
+        : m_Loop(loop)
+        , m_Fd(static_cast<i32>(socket->_native_handle))
+        , m_Timeouts(timeouts)
+        , m_OnPush(std::move(on_push))
+        , m_NextTag(0)
+        , m_Tagged(false)
+        , m_Reading(false)
+        , m_Sending(false)
+    {
+    }
+
+    AsyncConnection::~AsyncConnection() noexcept
+    {
+        m_Loop.Forget(m_Fd);
+
+        // Only left suspended if the connection failed while it was waiting for the rest of a packet.
+        if (m_Reading)
+            m_Pump.destroy();
+
+        [[maybe_unused]] const auto res = SetNonBlocking(m_Fd, false);
+    }
+
+    [[nodiscard]] Result<Err> AsyncConnection::Open() noexcept
+    {
+        if (!SetNonBlocking(m_Fd, true))
+            return Err{ ErrType::NetSocketError, "Failed to make the connection non-blocking: {}",
+                        std::strerror(errno) };
+        return Ok();
+    }
+
+    [[nodiscard]] Task<Result<Err>> AsyncConnection::Send(Packet packet) noexcept
+    {
+        if (m_Failure)
+            co_return *m_Failure;
+
+        co_await SendTurn{ *this };
+
+        // A single write, so that Nagle doesn't hold the payload back until the header is acknowledged.
+        std::vector<u8> bytes(sizeof(PacketHeader) + packet.data.size());
+        std::memcpy(bytes.data(), &packet.header, sizeof(PacketHeader));
+        std::copy(packet.data.begin(), packet.data.end(), bytes.begin() + sizeof(PacketHeader));
+        auto result = co_await WriteAll(bytes.data(), bytes.size(), Clock::now() + m_Timeouts.send);
+
+        // Hand the turn over to the next packet, if any.
+        if (m_SendQueue.empty())
+            m_Sending = false;
+        else
+        {
+            m_Loop.Schedule(m_SendQueue.front());
+            m_SendQueue.pop_front();
+        }
+
+        if (!result)
+            Fail(result.UnwrapErr());
+        co_return result;
+    }
+
+    [[nodiscard]] Task<ValuedResult<Packet, Err>> AsyncConnection::Receive() noexcept
+    {
+        co_return co_await PacketAwaiter{ *this, Waiter{ 0, Clock::now() + m_Timeouts.receive } };
+    }
+
+    [[nodiscard]] Task<ValuedResult<Packet, Err>> AsyncConnection::Request(Packet        packet,
+                                                                           ChunkDelegate on_chunk) noexcept
+    {
+        // Nothing is read before the waiter is in place, the reply can't arrive ahead of it.
+        const u16 tag     = NextTag();
+        packet.header.tag = tag;
+        CO_TRY_UNWRAP(co_await Send(std::move(packet)));
+
+        Waiter waiter{ tag, Clock::now() + m_Timeouts.receive };
+        waiter.onChunk = std::move(on_chunk);
+        co_return co_await PacketAwaiter{ *this, std::move(waiter) };
+    }
+
+    [[nodiscard]] u16 AsyncConnection::NextTag() noexcept
+    {
+        // 0 is reserved for untagged packets.
+        if (++m_NextTag == 0)
+            ++m_NextTag;
+        return m_NextTag;
+    }
+
+    Detached AsyncConnection::Pump() noexcept
+    {
+        m_Reading = true;
+        while (!m_Waiters.empty() || m_Stream.IsActive())
+        {
+            // Idle until the RC starts sending or the first waiter gives up, which leaves the stream intact. A
+            // streamed packet has to keep coming like the rest of any other packet.
+            const auto deadline = (m_Stream.IsActive()) ? Clock::now() + m_Timeouts.receive : NextDeadline();
+            if (auto ready = co_await m_Loop.Readable(m_Fd, deadline); !ready)
+            {
+                const auto err = ready.UnwrapErr();
+                if (err.Type() != ErrType::Timeout)
+                {
+                    Fail(err);
+                    break;
+                }
+                if (m_Stream.IsActive())
+                {
+                    Fail(Err{ ErrType::Timeout, "The RC stalled in the middle of a streamed {} packet.",
+                              TypeToStr(m_Stream.Header().type) });
+                    break;
+                }
+                Expire(Clock::now());
+                continue;
+            }
+
+            // Once the packet started coming in, the rest of it has to follow in time.
+            auto packet = co_await ReadPacket(Clock::now() + m_Timeouts.receive);
+            if (!packet)
+            {
+                Fail(packet.UnwrapErr());
+                break;
+            }
+            Route(packet.Unwrap());
+        }
+        m_Reading = false;
+    }
+
+    [[nodiscard]] Task<ValuedResult<Packet, Err>> AsyncConnection::ReadPacket(const Deadline deadline) noexcept
+    {
+        Packet packet;
+        CO_TRY_UNWRAP(
+            co_await ReadExactly(reinterpret_cast<u8*>(&packet.header), sizeof(packet.header), deadline));
+
+        // Nothing is allocated for a payload no packet may carry, nor can the stream be followed past it.
+        if (packet.header.dataLen > MaxPacketSize)
+            co_return Err{ ErrType::NetBadPacket, "The RC sent a {} packet of {} bytes, over the limit of {} bytes.",
+                           TypeToStr(packet), packet.header.dataLen, MaxPacketSize };
+
+        packet.data.resize(packet.header.dataLen);
+        if (!packet.data.empty())
+            CO_TRY_UNWRAP(co_await ReadExactly(packet.data.data(), packet.data.size(), deadline));
+        co_return std::move(packet);
+    }
+
+    [[nodiscard]] Task<Result<Err>> AsyncConnection::ReadExactly(u8* data, const usize size,
+                                                                 const Deadline deadline) noexcept
+    {
+        usize received = 0;
+        while (received < size)
+        {
+            const auto n = recv(m_Fd, data + received, size - received, 0);
+            if (n > 0)
+            {
+                received += static_cast<usize>(n);
+                continue;
+            }
+
+            if (n == 0)
+                co_return Err{ ErrType::NetReadFailure, "The RC closed the connection." };
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                co_return Err{ ErrType::NetReadFailure, "Failed to receive from the RC: {}", std::strerror(errno) };
+
+            CO_TRY_UNWRAP(co_await m_Loop.Readable(m_Fd, deadline));
+        }
+        co_return Ok();
+    }
+
+    [[nodiscard]] Task<Result<Err>> AsyncConnection::WriteAll(const u8* data, const usize size,
+                                                              const Deadline deadline) noexcept
+    {
+        usize sent = 0;
+        while (sent < size)
+        {
+            const auto n = send(m_Fd, data + sent, size - sent, MSG_NOSIGNAL);
+            if (n >= 0)
+            {
+                sent += static_cast<usize>(n);
+                continue;
+            }
+
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                co_return Err{ ErrType::NetWriteFailure, "Failed to send to the RC: {}", std::strerror(errno) };
+
+            CO_TRY_UNWRAP(co_await m_Loop.Writable(m_Fd, deadline));
+        }
+        co_return Ok();
+    }
+
+    void AsyncConnection::Route(Packet&& packet) noexcept
+    {
+        switch (packet.Type())
+        {
+            case PacketType::StreamBegin:
+            case PacketType::StreamChunk:
+            case PacketType::StreamEnd: RouteStream(std::move(packet)); return;
+            default: break;
+        }
+
+        const u16 tag = TagOf(packet);
+        if (tag == 0 && packet.Type() == PacketType::ConfigUpdate && m_OnPush)
+        {
+            m_OnPush(std::move(packet));
+            return;
+        }
+
+        // Pings are answered once the Endpoint listens for pushes, the RC copes with the ones missed until then.
+        if (tag == 0 && packet.Type() == PacketType::Ping)
+            return;
+
+        // Replies nobody waits for anymore are dropped.
+        const auto it = FindWaiter(tag);
+        if (it == m_Waiters.end())
+            return;
+
+        auto* waiter = *it;
+        m_Waiters.erase(it);
+        waiter->packet.emplace(std::move(packet));
+        m_Loop.Schedule(waiter->handle);
+    }
+
+    void AsyncConnection::RouteStream(Packet&& packet) noexcept
+    {
+        const u16 tag = TagOf(packet);
+        if (packet.Type() == PacketType::StreamBegin)
+        {
+            // Untagged streams are pushes or replies to requests that can't take chunks, they are reassembled.
+            ChunkDelegate on_chunk;
+            if (const auto it = FindWaiter(tag); tag != 0 && it != m_Waiters.end())
+                on_chunk = (*it)->onChunk;
+
+            if (auto begun = m_Stream.Begin(std::move(packet), std::move(on_chunk)); !begun)
+                Fail(begun.UnwrapErr());
+            return;
+        }
+
+        // A reply that's still coming only has to keep coming. Once its waiter gave up, the chunks are dropped
+        // instead of being handed to whatever the waiter left behind.
+        if (tag != 0 && m_Stream.IsActive() && m_Stream.Header().tag == tag)
+        {
+            if (const auto it = FindWaiter(tag); it != m_Waiters.end())
+                (*it)->deadline = Clock::now() + m_Timeouts.receive;
+            else
+                m_Stream.Discard();
+        }
+
+        // Whatever follows a stream that went wrong can't be told apart from packets.
+        const auto done = m_Stream.Feed(std::move(packet));
+        if (!done)
+            Fail(done.UnwrapErr());
+        else if (done.Unwrap())
+            Route(m_Stream.Take());
+    }
+
+    [[nodiscard]] std::deque<AsyncConnection::Waiter*>::iterator AsyncConnection::FindWaiter(const u16 tag) noexcept
+    {
+        // Untagged replies come from an RC answering in order, they belong to whoever has waited the longest.
+        if (tag == 0)
+            return m_Waiters.begin();
+        return std::find_if(m_Waiters.begin(), m_Waiters.end(),
+                            [tag](const Waiter* waiter) { return waiter->tag == tag; });
+    }
+
+    [[nodiscard]] Deadline AsyncConnection::NextDeadline() const noexcept
+    {
+        Deadline nearest = NoDeadline;
+        for (const auto* waiter : m_Waiters)
+            nearest = std::min(nearest, waiter->deadline);
+        return nearest;
+    }
+
+    void AsyncConnection::Expire(const Deadline now) noexcept
+    {
+        for (auto it = m_Waiters.begin(); it != m_Waiters.end();)
+        {
+            auto* waiter = *it;
+            if (waiter->deadline > now)
+            {
+                ++it;
+                continue;
+            }
+
+            // A reply still coming is dropped by Route() once nobody waits for it anymore.
+            waiter->packet.emplace(
+                Err{ ErrType::Timeout, "The RC didn't reply within {} ms.", m_Timeouts.receive.count() });
+            m_Loop.Schedule(waiter->handle);
+            it = m_Waiters.erase(it);
+        }
+    }
+
+    void AsyncConnection::Fail(const Err& err) noexcept
+    {
+        if (!m_Failure)
+            m_Failure = err;
+
+        for (auto* waiter : m_Waiters)
+        {
+            waiter->packet.emplace(*m_Failure);
+            m_Loop.Schedule(waiter->handle);
+        }
+        m_Waiters.clear();
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <optional>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Net/EventLoop.h>
+#include <Net/NetPacket.h>
+#include <Net/PacketStream.h>
+#include <Net/Task.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief Connection to the RC driven by an @ref EventLoop, lets a single thread keep several requests in flight.
+     *
+     * @details Every @ref Request is sent with a tag of its own and completes once the reply carrying the same tag
+     * arrives, whatever order the replies come back in. Packets are read by a coroutine that only runs while
+     * somebody waits for one and always stops at a packet boundary, so the socket can go back to blocking I/O
+     * once the connection is gone. Tags are only trusted once @ref SetTagged was called, RCs predating them may
+     * leave garbage where the tag is, so until then every reply goes to whoever has been waiting the longest,
+     * which is correct as long as such an RC answers in order. @ref PacketType::ConfigUpdate packets the
+     * RC pushes are handed to the @ref PushDelegate instead. Large packets the RC streams are reassembled before
+     * being routed, unless the @ref Request they answer takes their payload chunk by chunk.
+     *
+     * Every operation is bounded by its @ref Timeouts. A request whose reply doesn't arrive in time fails with
+     * @ref ErrType::Timeout on its own, while a packet that stalls half-way through or a send that can't complete
+     * fails the whole connection, since the stream can't be followed anymore.
+     *
+     * @note Not thread-safe, must only be used from the thread running the @ref EventLoop.
+     * */
+    class AsyncConnection
+    {
+    public:
+        using PushDelegate = std::function<void(Packet&&)>;
+
+    private:
+        struct Waiter
+        {
+            u16                                      tag      = 0;
+            Deadline                                 deadline = NoDeadline;
+            std::coroutine_handle<>                  handle   = {};
+            std::optional<ValuedResult<Packet, Err>> packet   = {};
+            ChunkDelegate                            onChunk  = {};
+        };
+
+        /**
+         * @brief Awaits the packet for a @ref Waiter.
+         * */
+        struct PacketAwaiter
+        {
+            AsyncConnection& connection;
+            Waiter           waiter;
+
+        public:
+            bool                      await_ready() noexcept;
+            void                      await_suspend(const std::coroutine_handle<> handle) noexcept;
+            ValuedResult<Packet, Err> await_resume() noexcept { return std::move(*waiter.packet); }
+        };
+
+        /**
+         * @brief Awaits the turn to send, so that the bytes of concurrent packets don't interleave.
+         * */
+        struct SendTurn
+        {
+            AsyncConnection& connection;
+
+        public:
+            bool await_ready() noexcept;
+            void await_suspend(const std::coroutine_handle<> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+    private:
+        EventLoop&                          m_Loop;
+        i32                                 m_Fd;
+        Timeouts                            m_Timeouts;
+        PushDelegate                        m_OnPush;
+        u16                                 m_NextTag;
+        bool                                m_Tagged;
+        std::deque<Waiter*>                 m_Waiters;
+        bool                                m_Reading;
+        std::coroutine_handle<>             m_Pump;
+        bool                                m_Sending;
+        std::deque<std::coroutine_handle<>> m_SendQueue;
+        PacketStream                        m_Stream;
+        std::optional<Err>                  m_Failure;
+
+    public:
+        AsyncConnection(EventLoop& loop, Socket* socket, PushDelegate on_push = {},
+                        const Timeouts& timeouts = Timeouts::Defaults()) noexcept;
+        AsyncConnection(const AsyncConnection&)            = delete;
+        AsyncConnection& operator=(const AsyncConnection&) = delete;
+
+        /**
+         * @brief Gives the socket back in blocking mode.
+         * */
+        ~AsyncConnection() noexcept;
+
+    public:
+        /**
+         * @brief Switches the socket to non-blocking mode.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Open() noexcept;
+
+        /**
+         * @brief Matches replies by their tag from now on, once the RC acknowledged @ref ReadyFlags_Tags.
+         * */
+        void SetTagged(const bool tagged) noexcept { m_Tagged = tagged; }
+
+        /**
+         * @brief Sends @p packet once the packets sent before it are out.
+         * */
+        [[nodiscard]] Task<Result<Err>> Send(Packet packet) noexcept;
+
+        /**
+         * @brief Receives the next untagged packet that isn't a configuration push, e.g. the Ready acknowledgement.
+         * */
+        [[nodiscard]] Task<ValuedResult<Packet, Err>> Receive() noexcept;
+
+        /**
+         * @brief Sends @p packet tagged and receives the reply to it.
+         *
+         * @param on_chunk Takes the payload of a streamed reply as it arrives, the reply then comes without it.
+         *
+         * @returns @ref ValuedResult of the reply, which may be a @ref PacketType::Err packet, or @ref Err if the
+         * connection failed.
+         * */
+        [[nodiscard]] Task<ValuedResult<Packet, Err>> Request(Packet packet, ChunkDelegate on_chunk = {}) noexcept;
+
+    private:
+        [[nodiscard]] u16 NextTag() noexcept;
+
+        /**
+         * @brief The tag of @p packet, 0 while tags aren't trusted.
+         * */
+        [[nodiscard]] u16 TagOf(const Packet& packet) const noexcept { return (m_Tagged) ? packet.header.tag : 0; }
+
+        /**
+         * @brief Reads packets and hands them to their @ref Waiter s for as long as there are any.
+         * */
+        Detached Pump() noexcept;
+
+        [[nodiscard]] Task<ValuedResult<Packet, Err>> ReadPacket(const Deadline deadline) noexcept;
+        [[nodiscard]] Task<Result<Err>> ReadExactly(u8* data, const usize size, const Deadline deadline) noexcept;
+        [[nodiscard]] Task<Result<Err>> WriteAll(const u8* data, const usize size, const Deadline deadline) noexcept;
+
+        void Route(Packet&& packet) noexcept;
+
+        /**
+         * @brief Adds a packet of a stream to @ref m_Stream and routes the streamed packet once complete.
+         * */
+        void RouteStream(Packet&& packet) noexcept;
+
+        /**
+         * @brief The @ref Waiter a packet tagged @p tag belongs to, the one waiting the longest if untagged.
+         * */
+        [[nodiscard]] std::deque<Waiter*>::iterator FindWaiter(const u16 tag) noexcept;
+
+        /**
+         * @brief The deadline of the @ref Waiter giving up the soonest.
+         * */
+        [[nodiscard]] Deadline NextDeadline() const noexcept;
+
+        /**
+         * @brief Fails the @ref Waiter s whose deadline is at or before @p now with @ref ErrType::Timeout.
+         * */
+        void Expire(const Deadline now) noexcept;
+
+        /**
+         * @brief Fails every @ref Waiter and everything awaited afterwards with @p err.
+         * */
+        void Fail(const Err& err) noexcept;
+    };
+} // namespace pmgrd::net
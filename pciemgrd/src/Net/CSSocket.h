@@ -52,13 +52,19 @@ typedef uintptr_t socket_t;
 #define CS_SD_BOTH         SD_BOTH
 #define CS_SD_READ         SD_RECEIVE
 #define CS_SD_WRITE        SD_SEND
+#define CS_SOCK_CLOEXEC    0
+#define CS_ACCEPT(s, a, l) accept(s, a, l)
 
 #elif defined(__linux__) || defined(__APPLE__)
 #define CS_PLATFORM_UNIX
 
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -75,6 +81,15 @@ typedef intptr_t socket_t;
 #define CS_SD_BOTH         SHUT_RDWR
 #define CS_SD_READ         SHUT_TRD
 #define CS_SD_WRITE        SHUT_WR
+
+// Sockets must not leak into child processes (e.g. supervised pipelines).
+#ifdef __linux__
+#define CS_SOCK_CLOEXEC    SOCK_CLOEXEC
+#define CS_ACCEPT(s, a, l) accept4(s, a, l, SOCK_CLOEXEC)
+#else
+#define CS_SOCK_CLOEXEC    0
+#define CS_ACCEPT(s, a, l) accept(s, a, l)
+#endif
 #endif
 
 #ifdef __cplusplus
@@ -154,6 +169,29 @@ typedef struct _cs_ip_endpoint
     uint16_t      port;
 } IPEndPoint;
 
+// Options applied to a socket on listen, accept and connect, a field left at 0 keeps the system default.
+// Options a platform lacks are skipped.
+typedef struct _cs_socket_options
+{
+    uint8_t  reuse_address;      // SO_REUSEADDR: Bind again right away while old connections linger in TIME_WAIT.
+    uint8_t  no_delay;           // TCP_NODELAY: Don't let Nagle hold small writes back until the last one is ACKed.
+    uint8_t  quick_ack;          // TCP_QUICKACK: ACK right away instead of delaying, needs re-arming after receiving.
+    uint8_t  keepalive;          // SO_KEEPALIVE: Probe idle connections to find out about dead peers.
+    uint16_t keepalive_idle;     // TCP_KEEPIDLE: Seconds of idleness before the first probe.
+    uint16_t keepalive_interval; // TCP_KEEPINTVL: Seconds between probes.
+    uint16_t keepalive_count;    // TCP_KEEPCNT: Unanswered probes before the connection is dropped.
+    uint32_t user_timeout;       // TCP_USER_TIMEOUT: Milliseconds data may stay unACKed before dropping the connection.
+    int32_t  send_buffer;        // SO_SNDBUF: Bytes, set before listen or connect to count towards window scaling.
+    int32_t  receive_buffer;     // SO_RCVBUF: Bytes, as above.
+    int32_t  busy_poll;          // SO_BUSY_POLL: Microseconds to busy poll the device on a blocking receive,
+                                 // above net.core.busy_poll it needs CAP_NET_ADMIN and is skipped without it.
+} SocketOptions;
+
+// Names of the predefined SocketOptions, see SocketOptions_FromProfile.
+#define CS_PROFILE_CONTROL_LOW_LATENCY "control-low-latency"
+#define CS_PROFILE_CONTROL_BUSY_POLL   "control-busy-poll"
+#define CS_PROFILE_BULK_CONFIG         "bulk-config"
+
 // Socket struct, holds the state of the current socket.
 // such as the family: The network family.
 // socket type: Data-Gram (for sending small packets), Stream (for sending stream of packets).
@@ -162,6 +200,7 @@ typedef struct _cs_ip_endpoint
 // remote endpoint: What endpoint is the socket connected to.
 // connected: If the socket is still connected to the remote.
 // timeout: How long to wait when connecting.
+// options: Options applied to the socket, inherited by the sockets it accepts.
 // _native_socket: Native socket handler, the user is not supposed to interact with this field.
 typedef struct _cs_socket
 {
@@ -172,6 +211,7 @@ typedef struct _cs_socket
     IPEndPoint    remote_ep;
     uint8_t       connected;
     uint16_t      timeout;
+    SocketOptions options;
 
     socket_t _native_handle;
 } Socket;
@@ -235,9 +275,10 @@ inline Socket* Socket_New(const AddressFamily family, const SocketType stype, co
     s->ptype     = ptype;
     s->connected = false;
     s->timeout   = 5000;
+    memset(&s->options, 0, sizeof(s->options));
 
     s->_native_handle = CS_INVALID_SOCKET;
-    s->_native_handle = socket(s->family, s->stype, s->ptype);
+    s->_native_handle = socket(s->family, (int)s->stype | CS_SOCK_CLOEXEC, s->ptype);
     if (s->_native_handle == CS_INVALID_SOCKET)
     {
         Debug(fputs("CS_Sockets: Failed to create socket.\n", stderr));
@@ -266,7 +307,7 @@ inline int32_t Socket_From(Socket* s, const AddressFamily family, const SocketTy
     s->timeout   = 5000;
 
     s->_native_handle = CS_INVALID_SOCKET;
-    s->_native_handle = socket(s->family, s->stype, s->ptype);
+    s->_native_handle = socket(s->family, (int)s->stype | CS_SOCK_CLOEXEC, s->ptype);
     if (s->_native_handle == CS_INVALID_SOCKET)
     {
         CS_CLOSE_SOCKET(s->_native_handle);
@@ -275,6 +316,138 @@ inline int32_t Socket_From(Socket* s, const AddressFamily family, const SocketTy
     return CS_SOCKET_SUCCESS;
 }
 
+// Fill options with the named profile, a connection's needs rather than a list of knobs:
+// control-low-latency: Small requests and replies, no Nagle and dead peers noticed in seconds. Not TCP_QUICKACK,
+//                      replies follow requests right away and carry their ACK, an immediate one would be an extra
+//                      segment for every request (see BM_TcpRoundTrip in pciemgrd_bench).
+// control-busy-poll: control-low-latency busy polling the device for 50us on blocking receives. Needs CAP_NET_ADMIN
+//                    unless net.core.busy_poll is at least as high, without either it's control-low-latency.
+// bulk-config: Configuration transfers and replication streams, large buffers and more patience. Packets are written
+//              whole, so Nagle stays off too, it would only hold back the tail of every one of them.
+inline int32_t SocketOptions_FromProfile(const char* name, SocketOptions* options)
+{
+    memset(options, 0, sizeof(SocketOptions));
+    const bool busy_poll = strcmp(name, CS_PROFILE_CONTROL_BUSY_POLL) == 0;
+    if (busy_poll || strcmp(name, CS_PROFILE_CONTROL_LOW_LATENCY) == 0)
+    {
+        options->reuse_address      = true;
+        options->no_delay           = true;
+        options->keepalive          = true;
+        options->keepalive_idle     = 10;
+        options->keepalive_interval = 2;
+        options->keepalive_count    = 3;
+        options->user_timeout       = 10000;
+        options->busy_poll          = (busy_poll) ? 50 : 0;
+        return CS_SOCKET_SUCCESS;
+    }
+    if (strcmp(name, CS_PROFILE_BULK_CONFIG) == 0)
+    {
+        options->reuse_address      = true;
+        options->no_delay           = true;
+        options->keepalive          = true;
+        options->keepalive_idle     = 30;
+        options->keepalive_interval = 5;
+        options->keepalive_count    = 4;
+        options->user_timeout       = 30000;
+        options->send_buffer        = 4 * 1024 * 1024;
+        options->receive_buffer     = 4 * 1024 * 1024;
+        return CS_SOCKET_SUCCESS;
+    }
+    Debug(fprintf(stderr, "CS_Socket: Unknown socket profile %s.\n", name));
+    return CS_SOCKET_ERROR;
+}
+
+// Set a single integer option, keeping the errno of the first failure in *res.
+inline void _cs_set_int_option(Socket* s, const int32_t level, const int32_t name, const int32_t value, int32_t* res,
+                               int32_t* error)
+{
+    if (setsockopt(s->_native_handle, level, name, (const char*)&value, sizeof(value)) == CS_SOCKET_ERROR &&
+        *res != CS_SOCKET_ERROR)
+    {
+        *res   = CS_SOCKET_ERROR;
+        *error = errno;
+    }
+}
+
+// Re-arm TCP_QUICKACK, which the kernel leaves on its own once the connection looks interactive.
+inline void Socket_RearmQuickAck(Socket* s)
+{
+#ifdef TCP_QUICKACK
+    const int32_t one = 1;
+    setsockopt(s->_native_handle, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+#else
+    (void)s;
+#endif
+}
+
+// Remember options and apply them to the socket. Every option is attempted, on failure errno tells why the first
+// failed one did.
+inline int32_t Socket_SetOptions(Socket* s, const SocketOptions* options)
+{
+    if (!_cs_g_initialized)
+    {
+        Debug(fputs("CS_Sockets not initialized.\n", stderr));
+        return CS_SOCKET_ERROR;
+    }
+
+    s->options    = *options;
+    int32_t res   = CS_SOCKET_SUCCESS;
+    int32_t error = 0;
+    if (options->reuse_address)
+        _cs_set_int_option(s, SOL_SOCKET, SO_REUSEADDR, 1, &res, &error);
+    if (options->send_buffer)
+        _cs_set_int_option(s, SOL_SOCKET, SO_SNDBUF, options->send_buffer, &res, &error);
+    if (options->receive_buffer)
+        _cs_set_int_option(s, SOL_SOCKET, SO_RCVBUF, options->receive_buffer, &res, &error);
+    if (options->keepalive)
+        _cs_set_int_option(s, SOL_SOCKET, SO_KEEPALIVE, 1, &res, &error);
+
+    // Everything else only applies to TCP.
+    if (s->ptype == ProtocolType_Tcp)
+    {
+        if (options->no_delay)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_NODELAY, 1, &res, &error);
+#ifdef TCP_KEEPIDLE
+        if (options->keepalive && options->keepalive_idle)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_KEEPIDLE, options->keepalive_idle, &res, &error);
+#endif
+#ifdef TCP_KEEPINTVL
+        if (options->keepalive && options->keepalive_interval)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_KEEPINTVL, options->keepalive_interval, &res, &error);
+#endif
+#ifdef TCP_KEEPCNT
+        if (options->keepalive && options->keepalive_count)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_KEEPCNT, options->keepalive_count, &res, &error);
+#endif
+#ifdef TCP_USER_TIMEOUT
+        if (options->user_timeout)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_USER_TIMEOUT, (int32_t)options->user_timeout, &res, &error);
+#endif
+#ifdef TCP_QUICKACK
+        if (options->quick_ack)
+            _cs_set_int_option(s, IPPROTO_TCP, TCP_QUICKACK, 1, &res, &error);
+#endif
+    }
+#ifdef SO_BUSY_POLL
+    // Only an optimisation, unprivileged processes go without it.
+    if (options->busy_poll &&
+        setsockopt(s->_native_handle, SOL_SOCKET, SO_BUSY_POLL, (const char*)&options->busy_poll,
+                   sizeof(options->busy_poll)) == CS_SOCKET_ERROR &&
+        errno != EPERM && res != CS_SOCKET_ERROR)
+    {
+        res   = CS_SOCKET_ERROR;
+        error = errno;
+    }
+#endif
+
+    if (res == CS_SOCKET_ERROR)
+    {
+        Debug(fputs("CS_Sockets: Failed to set a socket option.\n", stderr));
+        errno = error;
+    }
+    return res;
+}
+
 // Destructor for Socket.
 inline void Socket_Dispose(Socket* s)
 {
@@ -373,8 +546,7 @@ inline int32_t Socket_Listen(Socket* s, const size_t max_clients)
     return CS_SOCKET_SUCCESS;
 }
 
-// Try to connection to an endpoint.
-// TODO: Implement timeout system.
+// Try to connection to an endpoint, giving up after timeout milliseconds (if non-zero) with errno set to ETIMEDOUT.
 inline int32_t Socket_Connect(Socket* s, IPEndPoint ep)
 {
     if (!_cs_g_initialized)
@@ -384,8 +556,44 @@ inline int32_t Socket_Connect(Socket* s, IPEndPoint ep)
     }
 
     s->remote_ep = ep;
-    const int32_t res  = connect(s->_native_handle, (struct sockaddr*)&s->remote_ep.address.ipv4_addr,
-                           sizeof(s->remote_ep.address.ipv4_addr));
+#ifdef CS_PLATFORM_UNIX
+    // Connect without blocking and wait for the outcome ourselves, so that the wait can be bounded.
+    const int32_t flags = fcntl(s->_native_handle, F_GETFL);
+    if (s->timeout > 0 && flags != -1)
+        fcntl(s->_native_handle, F_SETFL, flags | O_NONBLOCK);
+#endif
+    int32_t res = connect(s->_native_handle, (struct sockaddr*)&s->remote_ep.address.ipv4_addr,
+                          sizeof(s->remote_ep.address.ipv4_addr));
+#ifdef CS_PLATFORM_UNIX
+    if (s->timeout > 0 && flags != -1)
+    {
+        if (res == CS_SOCKET_ERROR && errno == EINPROGRESS)
+        {
+            struct pollfd pfd;
+            pfd.fd     = s->_native_handle;
+            pfd.events = POLLOUT;
+
+            int32_t ready;
+            do
+                ready = poll(&pfd, 1, s->timeout);
+            while (ready == -1 && errno == EINTR);
+
+            int32_t   error = ETIMEDOUT;
+            socklen_t len   = sizeof(error);
+            if (ready > 0)
+                getsockopt(s->_native_handle, SOL_SOCKET, SO_ERROR, &error, &len);
+            else if (ready == -1)
+                error = errno;
+
+            res   = (error == 0) ? CS_SOCKET_SUCCESS : CS_SOCKET_ERROR;
+            errno = error;
+        }
+
+        const int32_t saved_errno = errno;
+        fcntl(s->_native_handle, F_SETFL, flags);
+        errno = saved_errno;
+    }
+#endif
     if (res == CS_SOCKET_ERROR)
     {
         Debug(fputs("CS_Sockets: Connection with the remote failed.\n", stderr));
@@ -410,7 +618,7 @@ inline Socket* Socket_Accept(Socket* s)
 
     socklen_t addr_len = sizeof(client->remote_ep.address.ipv4_addr);
     client->_native_handle =
-        accept(s->_native_handle, (struct sockaddr*)&client->remote_ep.address.ipv4_addr, &addr_len);
+        CS_ACCEPT(s->_native_handle, (struct sockaddr*)&client->remote_ep.address.ipv4_addr, &addr_len);
 
     if (client->_native_handle == CS_INVALID_SOCKET)
     {
@@ -423,11 +631,17 @@ inline Socket* Socket_Accept(Socket* s)
     client->remote_ep.addressFamily = (AddressFamily)client->remote_ep.address.ipv4_addr.sin_family;
     client->remote_ep.port          = client->remote_ep.address.ipv4_addr.sin_port;
     strcpy(client->remote_ep.address.str, inet_ntoa(client->remote_ep.address.ipv4_addr.sin_addr));
+
+    // Not every option is inherited from the listening socket, TCP_QUICKACK never is. Failing to set one doesn't
+    // make the connection unusable.
+    Socket_SetOptions(client, &s->options);
     return client;
 }
 
 // Try and receive data from the Socket, shut the socket down if receive fails indicating that the client has
 // disconnected. If successful, return the amount of bytes received.
+// The descriptor is only closed by Socket_Dispose, closing it here would let another socket reuse its number while
+// this one can still be disposed or written to from another thread.
 inline int32_t Socket_Receive(Socket* s, uint8_t* buffer, const size_t buffer_size, const int32_t flags)
 {
     if (!_cs_g_initialized)
@@ -440,7 +654,7 @@ inline int32_t Socket_Receive(Socket* s, uint8_t* buffer, const size_t buffer_si
     if (received_bytes == 0 || received_bytes == CS_SOCKET_ERROR)
     {
         s->connected = false;
-        CS_CLOSE_SOCKET(s->_native_handle);
+        shutdown(s->_native_handle, CS_SD_BOTH);
         return CS_SOCKET_ERROR;
     }
     return received_bytes;
@@ -460,7 +674,7 @@ inline int32_t Socket_Send(Socket* s, const uint8_t* buffer, const size_t buffer
     if (sent_bytes == CS_SOCKET_ERROR)
     {
         s->connected = false;
-        CS_CLOSE_SOCKET(s->_native_handle);
+        shutdown(s->_native_handle, CS_SD_BOTH);
     }
     return sent_bytes;
 }
@@ -0,0 +1,63 @@
+#include "ClockSync.h"
+
+#include <algorithm>
+
+namespace pmgrd::net {
+    ClockSync::ClockSync() noexcept
+        : m_Window{}
+        , m_Samples(0)
+        , m_Pings(0)
+        , m_SmoothedRtt(0)
+    {
+    }
+
+    void ClockSync::Sent() noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        ++m_Pings;
+    }
+
+    [[nodiscard]] ValuedResult<ClockSample, Err> ClockSync::Record(const i64 t1, const i64 t2, const i64 t3,
+                                                                   const i64 t4) noexcept
+    {
+        // Either clock may have been stepped in between, such a round tells nothing.
+        const ClockSample sample{ (t4 - t1) - (t3 - t2), ((t2 - t1) + (t3 - t4)) / 2 };
+        if (t3 < t2 || sample.rtt < 0)
+            return Err{ ErrType::NetBadPacket, "Inconsistent ping timestamps {} {} {} {}.", t1, t2, t3, t4 };
+
+        std::scoped_lock lock{ m_Mutex };
+        m_Window[m_Samples % ClockSync::Window] = sample;
+
+        // Gain of 1/8 like TCP's SRTT, a single slow round barely moves it.
+        m_SmoothedRtt = (m_Samples == 0) ? sample.rtt : m_SmoothedRtt + (sample.rtt - m_SmoothedRtt) / 8;
+        m_LastSample  = std::chrono::system_clock::now();
+        ++m_Samples;
+        return sample;
+    }
+
+    [[nodiscard]] ClockEstimate ClockSync::Estimate() const noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        ClockEstimate    estimate;
+        estimate.samples    = m_Samples;
+        estimate.pings      = m_Pings;
+        estimate.lastSample = m_LastSample;
+        if (m_Samples == 0)
+            return estimate;
+
+        const auto end  = m_Window.begin() + std::min<u64>(m_Samples, ClockSync::Window);
+        const auto best = std::min_element(m_Window.begin(), end, [](const ClockSample& a, const ClockSample& b)
+                                           { return a.rtt < b.rtt; });
+        estimate.rtt    = m_SmoothedRtt;
+        estimate.minRtt = best->rtt;
+        estimate.offset = best->offset;
+        return estimate;
+    }
+
+    [[nodiscard]] i64 ClockSync::Now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief What a single @ref PacketType::Ping round yielded, in nanoseconds.
+     * */
+    struct ClockSample
+    {
+        i64 rtt    = 0; ///< Round-trip time, without the time the peer held on to the ping.
+        i64 offset = 0; ///< How far the peer's clock is ahead of ours.
+    };
+
+    /**
+     * @brief The current estimate for a peer, in nanoseconds.
+     * */
+    struct ClockEstimate
+    {
+        i64                                   rtt        = 0; ///< Smoothed round-trip time.
+        i64                                   minRtt     = 0; ///< Lowest round-trip time of the window.
+        i64                                   offset     = 0; ///< Offset of the sample with the lowest round-trip time.
+        u64                                   samples    = 0; ///< Rounds completed since the peer connected.
+        u64                                   pings      = 0; ///< Pings sent since the peer connected.
+        std::chrono::system_clock::time_point lastSample = {};
+    };
+
+    /**
+     * @brief Rolling estimate of the round-trip time to a peer and of how its clock compares to ours, NTP style.
+     *
+     * @details A round yields four timestamps, t1 when the ping left and t4 when the pong arrived on our clock, t2
+     * when the ping arrived and t3 when the pong left on the peer's. The round-trip time is (t4 - t1) - (t3 - t2)
+     * and the offset ((t2 - t1) + (t3 - t4)) / 2, exact when both directions take as long and off by at most half
+     * the round-trip time otherwise. Like NTP's clock filter, the offset comes from the sample with the lowest
+     * round-trip time of the last @ref Window ones, the one least skewed by queueing, while the round-trip time
+     * is smoothed the way TCP does.
+     *
+     * @note Thread-safe.
+     * */
+    class ClockSync
+    {
+    public:
+        /**
+         * @brief How many of the latest samples the offset is picked from.
+         * */
+        static constexpr usize Window = 8;
+
+    private:
+        mutable std::mutex                         m_Mutex;
+        std::array<ClockSample, ClockSync::Window> m_Window;
+        u64                                        m_Samples;
+        u64                                        m_Pings;
+        i64                                        m_SmoothedRtt;
+        std::chrono::system_clock::time_point      m_LastSample;
+
+    public:
+        ClockSync() noexcept;
+
+    public:
+        /**
+         * @brief Counts a ping sent to the peer, for telling how many went unanswered.
+         * */
+        void Sent() noexcept;
+
+        /**
+         * @brief Adds the round made of the timestamps @p t1 to @p t4, see @ref ClockSync.
+         *
+         * @returns @ref ValuedResult of the @ref ClockSample or @ref Err if the timestamps contradict each other.
+         * */
+        [[nodiscard]] ValuedResult<ClockSample, Err> Record(const i64 t1, const i64 t2, const i64 t3,
+                                                            const i64 t4) noexcept;
+
+        [[nodiscard]] ClockEstimate Estimate() const noexcept;
+
+    public:
+        /**
+         * @brief The wall clock timestamps are taken from, in nanoseconds since the epoch.
+         * */
+        [[nodiscard]] static i64 Now() noexcept;
+    };
+} // namespace pmgrd::net
@@ -0,0 +1,168 @@
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace pmgrd::net {
+    bool EventLoop::IOAwaiter::await_suspend(const std::coroutine_handle<> handle) noexcept
+    {
+        this->handle = handle;
+
+        auto& watch = loop.m_Watches[fd];
+        auto& list  = (write) ? watch.writers : watch.readers;
+        list.push_back(this);
+
+        if (auto updated = loop.Update(fd, watch); !updated)
+        {
+            // Carry on right away with the error instead of waiting for nothing.
+            list.pop_back();
+            result = updated.UnwrapErr();
+            return false;
+        }
+        return true;
+    }
+
+    EventLoop::EventLoop() noexcept
+        : m_Epoll(-1)
+    {
+    }
+
+    EventLoop::~EventLoop() noexcept
+    {
+        if (m_Epoll != -1)
+            close(m_Epoll);
+    }
+
+    [[nodiscard]] Result<Err> EventLoop::Open() noexcept
+    {
+        if (m_Epoll == -1 && (m_Epoll = epoll_create1(EPOLL_CLOEXEC)) == -1)
+            return Err{ ErrType::IOError, "Failed to create the event loop's epoll: {}", std::strerror(errno) };
+        return Ok();
+    }
+
+    void EventLoop::Forget(const i32 fd) noexcept
+    {
+        const auto it = m_Watches.find(fd);
+        if (it == m_Watches.end())
+            return;
+
+        if (it->second.added)
+            epoll_ctl(m_Epoll, EPOLL_CTL_DEL, fd, nullptr);
+        m_Watches.erase(it);
+    }
+
+    [[nodiscard]] Result<Err> EventLoop::Poll() noexcept
+    {
+        const bool waiting = std::any_of(m_Watches.begin(), m_Watches.end(),
+                                         [](const auto& entry) { return entry.second.added; });
+        if (!waiting)
+            return Err{ ErrType::InvalidState, "The event loop has nothing left to wait for." };
+
+        // Sleep until the nearest deadline at the latest.
+        Deadline nearest = NoDeadline;
+        for (const auto& [fd, watch] : m_Watches)
+        {
+            for (const auto* awaiter : watch.readers)
+                nearest = std::min(nearest, awaiter->deadline);
+            for (const auto* awaiter : watch.writers)
+                nearest = std::min(nearest, awaiter->deadline);
+        }
+
+        i32 timeout = -1;
+        if (nearest != NoDeadline)
+        {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(nearest - Clock::now());
+            timeout         = static_cast<i32>(std::clamp<i64>(left.count(), 0, std::numeric_limits<i32>::max()));
+        }
+
+        epoll_event events[64];
+        const i32   n = epoll_wait(m_Epoll, events, std::size(events), timeout);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                return Ok();
+            return Err{ ErrType::IOError, "The event loop failed to poll: {}", std::strerror(errno) };
+        }
+
+        for (i32 i = 0; i < n; ++i)
+        {
+            const i32  fd = events[i].data.fd;
+            const auto it = m_Watches.find(fd);
+            if (it == m_Watches.end())
+                continue;
+
+            // Errors and hang-ups wake up both sides, whoever reads or writes next finds out what happened.
+            auto&     watch  = it->second;
+            const u32 failed = EPOLLERR | EPOLLHUP;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | failed))
+            {
+                for (auto* awaiter : watch.readers)
+                    m_Ready.push_back(awaiter->handle);
+                watch.readers.clear();
+            }
+            if (events[i].events & (EPOLLOUT | failed))
+            {
+                for (auto* awaiter : watch.writers)
+                    m_Ready.push_back(awaiter->handle);
+                watch.writers.clear();
+            }
+            TRY_UNWRAP(Update(fd, watch));
+        }
+        return Expire(Clock::now());
+    }
+
+    [[nodiscard]] Result<Err> EventLoop::Expire(const Deadline now) noexcept
+    {
+        for (auto& [fd, watch] : m_Watches)
+        {
+            bool expired = false;
+            for (auto* list : { &watch.readers, &watch.writers })
+            {
+                const auto it = std::stable_partition(list->begin(), list->end(), [now](const IOAwaiter* awaiter)
+                                                      { return awaiter->deadline > now; });
+                for (auto expired_it = it; expired_it != list->end(); ++expired_it)
+                {
+                    (*expired_it)->result = Err{ ErrType::Timeout };
+                    m_Ready.push_back((*expired_it)->handle);
+                }
+                expired |= it != list->end();
+                list->erase(it, list->end());
+            }
+
+            if (expired)
+                TRY_UNWRAP(Update(fd, watch));
+        }
+        return Ok();
+    }
+
+    [[nodiscard]] Result<Err> EventLoop::Update(const i32 fd, Watch& watch) noexcept
+    {
+        u32 interest = 0;
+        if (!watch.readers.empty())
+            interest |= EPOLLIN | EPOLLRDHUP;
+        if (!watch.writers.empty())
+            interest |= EPOLLOUT;
+
+        if (interest == 0)
+        {
+            if (watch.added && epoll_ctl(m_Epoll, EPOLL_CTL_DEL, fd, nullptr) == -1)
+                return Err{ ErrType::IOError, "Failed to stop watching socket {}: {}", fd, std::strerror(errno) };
+            watch.added = false;
+            return Ok();
+        }
+
+        epoll_event ev{};
+        ev.events  = interest;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_Epoll, (watch.added) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == -1)
+            return Err{ ErrType::IOError, "Failed to watch socket {}: {}", fd, std::strerror(errno) };
+        watch.added = true;
+        return Ok();
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <coroutine>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Net/NetPacket.h>
+#include <Net/Task.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief Single-threaded loop resuming the coroutines of @ref Task s as their sockets become ready.
+     *
+     * @details Coroutines waiting for a socket suspend on @ref Readable or @ref Writable, the loop watches the
+     * socket with epoll for as long as anybody waits on it and resumes them from @ref Run once it is ready or
+     * their deadline passed, whichever comes first. Coroutines that are ready to continue are resumed in the
+     * order they were scheduled, one at a time, so nothing touched by them needs to be locked.
+     *
+     * @note Not thread-safe, everything must happen on the thread calling @ref Run.
+     * */
+    class EventLoop
+    {
+    public:
+        /**
+         * @brief Awaits a socket becoming readable or writable.
+         *
+         * @returns @ref Result of @ref Err, @ref ErrType::Timeout if the deadline passed first.
+         * */
+        struct IOAwaiter
+        {
+            EventLoop&              loop;
+            i32                     fd;
+            bool                    write;
+            Deadline                deadline;
+            std::coroutine_handle<> handle = {};
+            Result<Err>             result = Ok();
+
+        public:
+            bool        await_ready() const noexcept { return false; }
+            bool        await_suspend(const std::coroutine_handle<> handle) noexcept;
+            Result<Err> await_resume() noexcept { return std::move(result); }
+        };
+
+    private:
+        struct Watch
+        {
+            std::vector<IOAwaiter*> readers;
+            std::vector<IOAwaiter*> writers;
+            bool                    added = false;
+        };
+
+    private:
+        i32                                 m_Epoll;
+        std::deque<std::coroutine_handle<>> m_Ready;
+        std::unordered_map<i32, Watch>      m_Watches;
+
+    public:
+        EventLoop() noexcept;
+        EventLoop(const EventLoop&)            = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+        ~EventLoop() noexcept;
+
+    public:
+        /**
+         * @brief Creates the epoll instance of the loop.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Open() noexcept;
+
+        /**
+         * @brief Resumes @p handle from the loop once the coroutines scheduled before it have run.
+         * */
+        void Schedule(const std::coroutine_handle<> handle) noexcept { m_Ready.push_back(handle); }
+
+        [[nodiscard]] IOAwaiter Readable(const i32 fd, const Deadline deadline = NoDeadline) noexcept
+        {
+            return IOAwaiter{ *this, fd, false, deadline };
+        }
+        [[nodiscard]] IOAwaiter Writable(const i32 fd, const Deadline deadline = NoDeadline) noexcept
+        {
+            return IOAwaiter{ *this, fd, true, deadline };
+        }
+
+        /**
+         * @brief Stops watching @p fd, which must have nobody waiting on it anymore, e.g. before it is closed.
+         * */
+        void Forget(const i32 fd) noexcept;
+
+        /**
+         * @brief Runs @p task and everything it starts until @p task completes.
+         *
+         * @returns The value of @p task, or @ref Err if it can never complete because nothing it waits on can
+         * happen anymore.
+         * */
+        template <typename T>
+        [[nodiscard]] T Run(Task<T> task) noexcept
+        {
+            Schedule(task.GetHandle());
+            while (!task.IsDone())
+            {
+                if (m_Ready.empty())
+                {
+                    if (auto result = Poll(); !result)
+                        return result.UnwrapErr();
+                    continue;
+                }
+
+                const auto handle = m_Ready.front();
+                m_Ready.pop_front();
+                handle.resume();
+            }
+            return task.TakeValue();
+        }
+
+    private:
+        /**
+         * @brief Waits for a watched socket to become ready or the nearest deadline, and schedules whoever waits
+         * on it.
+         * */
+        [[nodiscard]] Result<Err> Poll() noexcept;
+
+        /**
+         * @brief Fails and schedules everyone whose deadline is at or before @p now.
+         * */
+        [[nodiscard]] Result<Err> Expire(const Deadline now) noexcept;
+
+        /**
+         * @brief Makes epoll watch @p fd for what @p watch waits on, or stops watching it if nothing.
+         * */
+        [[nodiscard]] Result<Err> Update(const i32 fd, Watch& watch) noexcept;
+    };
+} // namespace pmgrd::net
@@ -0,0 +1,370 @@
+#include "HandshakeReactor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace pmgrd::net {
+    namespace {
+        [[nodiscard]] bool SetNonBlocking(const i32 fd, const bool non_blocking) noexcept
+        {
+            const i32 flags = fcntl(fd, F_GETFL);
+            if (flags == -1)
+                return false;
+            return fcntl(fd, F_SETFL, non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) != -1;
+        }
+    } // namespace
+
+    HandshakeReactor::HandshakeReactor(Logger& logger, NetMetrics& metrics, ReadyDelegate on_ready,
+                                       SetupDelegate setup)
+        : m_Logger(logger)
+        , m_Metrics(metrics)
+        , m_OnReady(std::move(on_ready))
+        , m_Setup(std::move(setup))
+        , m_Epoll(-1)
+        , m_WakeFd(-1)
+        , m_Run(false)
+        , m_Failed(false)
+    {
+    }
+
+    HandshakeReactor::~HandshakeReactor() noexcept
+    {
+        Stop();
+        if (m_Epoll != -1)
+            close(m_Epoll);
+        if (m_WakeFd != -1)
+            close(m_WakeFd);
+    }
+
+    [[nodiscard]] Result<Err> HandshakeReactor::Start() noexcept
+    {
+        if (m_Thread.joinable())
+            return Err{ ErrType::InvalidState, "The handshake reactor has already been started." };
+
+        if (m_Epoll == -1 && (m_Epoll = epoll_create1(EPOLL_CLOEXEC)) == -1)
+            return Err{ ErrType::IOError, "Failed to create the handshake epoll instance: {}", std::strerror(errno) };
+        if (m_WakeFd == -1 && (m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+            return Err{ ErrType::IOError, "Failed to create the handshake eventfd: {}", std::strerror(errno) };
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = m_WakeFd;
+        if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_WakeFd, &ev) == -1 && errno != EEXIST)
+            return Err{ ErrType::IOError, "Failed to watch the handshake eventfd: {}", std::strerror(errno) };
+
+        m_Run.store(true);
+        m_Thread = std::thread{ &HandshakeReactor::Run, this };
+        m_Worker = std::thread{ &HandshakeReactor::Work, this };
+        return Ok();
+    }
+
+    void HandshakeReactor::Stop() noexcept
+    {
+        if (!m_Thread.joinable())
+            return;
+
+        m_Run.store(false);
+        const u64                   value = 1;
+        [[maybe_unused]] const auto res   = write(m_WakeFd, &value, sizeof(value));
+        m_Thread.join();
+
+        // Taking the lock makes sure the worker either sees m_Run cleared or is already waiting.
+        {
+            std::scoped_lock lock{ m_ReadyMutex };
+        }
+        m_ReadyCV.notify_all();
+        m_Worker.join();
+
+        for (auto& [socket, ready] : m_Ready)
+            net::Socket_Dispose(socket);
+        m_Ready.clear();
+
+        std::scoped_lock lock{ m_IncomingMutex };
+        for (auto* socket : m_Incoming)
+            net::Socket_Dispose(socket);
+        m_Incoming.clear();
+    }
+
+    void HandshakeReactor::Add(net::Socket* socket) noexcept
+    {
+        if (HasFailed())
+        {
+            m_Metrics.handshakeFailures.Add();
+            net::Socket_Dispose(socket);
+            return;
+        }
+
+        {
+            std::scoped_lock lock{ m_IncomingMutex };
+            m_Incoming.push_back(socket);
+        }
+
+        const u64                   value = 1;
+        [[maybe_unused]] const auto res   = write(m_WakeFd, &value, sizeof(value));
+    }
+
+    void HandshakeReactor::Run() noexcept
+    {
+        m_Setup("Handshake");
+
+        epoll_event events[64];
+        u32         restarts = 0;
+        while (m_Run.load())
+        {
+            // Sleep until the oldest handshake expires at the latest.
+            i32 timeout = -1;
+            if (!m_Pending.empty())
+            {
+                const auto oldest = std::min_element(m_Pending.begin(), m_Pending.end(),
+                                                     [](const auto& a, const auto& b)
+                                                     { return a.second.acceptedAt < b.second.acceptedAt; });
+                const auto expires_at = oldest->second.acceptedAt + HandshakeReactor::Timeout;
+                const auto left       = std::chrono::ceil<std::chrono::milliseconds>(expires_at - Clock::now());
+                timeout               = static_cast<i32>(std::max<i64>(left.count(), 0));
+            }
+
+            const i32 n = epoll_wait(m_Epoll, events, std::size(events), timeout);
+            if (n == -1 && errno != EINTR)
+            {
+                m_Logger.Log(lgx::Level::Error, "Handshake reactor failed to poll: {}", std::strerror(errno));
+                if (++restarts > HandshakeReactor::MaxRestarts || !Restart())
+                {
+                    m_Logger.Log(lgx::Level::Error, "Handshake reactor gave up, no more Endpoints will be accepted.");
+                    m_Failed.store(true);
+                    break;
+                }
+                continue;
+            }
+            restarts = 0;
+
+            for (i32 i = 0; i < n; ++i)
+            {
+                if (events[i].data.fd == m_WakeFd)
+                {
+                    u64                         value;
+                    [[maybe_unused]] const auto res = read(m_WakeFd, &value, sizeof(value));
+                    Adopt();
+                }
+                else
+                    Read(events[i].data.fd);
+            }
+
+            ExpireBefore(Clock::now() - HandshakeReactor::Timeout);
+        }
+
+        // Whatever is still pending will never complete.
+        while (!m_Pending.empty())
+            Drop(m_Pending.begin()->first, "shutting down");
+    }
+
+    void HandshakeReactor::Work() noexcept
+    {
+        m_Setup("Handshake worker");
+
+        std::unique_lock lock{ m_ReadyMutex };
+        while (true)
+        {
+            m_ReadyCV.wait(lock, [this]() { return !m_Ready.empty() || !m_Run.load(); });
+            if (!m_Run.load())
+                break;
+
+            auto [socket, ready] = std::move(m_Ready.front());
+            m_Ready.pop_front();
+
+            lock.unlock();
+            m_OnReady(socket, std::move(ready));
+            lock.lock();
+        }
+    }
+
+    bool HandshakeReactor::Restart() noexcept
+    {
+        const i32 epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll == -1)
+        {
+            m_Logger.Log(lgx::Level::Error, "Failed to recreate the handshake epoll instance: {}",
+                         std::strerror(errno));
+            return false;
+        }
+        close(m_Epoll);
+        m_Epoll = epoll;
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = m_WakeFd;
+        if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_WakeFd, &ev) == -1)
+        {
+            m_Logger.Log(lgx::Level::Error, "Failed to watch the handshake eventfd: {}", std::strerror(errno));
+            return false;
+        }
+
+        // Pending handshakes carry on where they left off, epoll is level-triggered so no byte is missed.
+        std::vector<i32> lost;
+        for (const auto& [fd, pending] : m_Pending)
+        {
+            ev.events  = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &ev) == -1)
+                lost.push_back(fd);
+        }
+        for (const auto fd : lost)
+            Drop(fd, "it could not be watched anymore");
+        return true;
+    }
+
+    void HandshakeReactor::Adopt() noexcept
+    {
+        std::vector<net::Socket*> incoming;
+        {
+            std::scoped_lock lock{ m_IncomingMutex };
+            incoming.swap(m_Incoming);
+        }
+
+        const auto now = Clock::now();
+        for (auto* socket : incoming)
+        {
+            const i32 fd = static_cast<i32>(socket->_native_handle);
+            if (m_Pending.size() >= HandshakeReactor::MaxPending)
+            {
+                PMGRD_LOG_LIMITED(m_Logger, Warn, "({}:{}) refused, {} handshakes are already pending.",
+                                  socket->remote_ep.address.str, socket->remote_ep.port, m_Pending.size());
+                m_Metrics.handshakeFailures.Add();
+                net::Socket_Dispose(socket);
+                continue;
+            }
+
+            epoll_event ev{};
+            ev.events  = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (!SetNonBlocking(fd, true) || epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &ev) == -1)
+            {
+                PMGRD_LOG_LIMITED(m_Logger, Error, "({}:{}) could not be watched for its handshake: {}",
+                                  socket->remote_ep.address.str, socket->remote_ep.port, std::strerror(errno));
+                m_Metrics.handshakeFailures.Add();
+                net::Socket_Dispose(socket);
+                continue;
+            }
+
+            m_Pending.emplace(fd, Pending{ socket, {}, now });
+            m_Metrics.pendingHandshakes.Add(1);
+        }
+    }
+
+    void HandshakeReactor::Read(const i32 fd) noexcept
+    {
+        const auto it = m_Pending.find(fd);
+        if (it == m_Pending.end())
+            return;
+
+        auto& pending = it->second;
+        while (true)
+        {
+            // Only read as far as the Ready packet goes, whatever follows belongs to the Endpoint thread.
+            usize wanted = sizeof(net::PacketHeader);
+            if (pending.buffer.size() >= sizeof(net::PacketHeader))
+            {
+                net::PacketHeader header;
+                std::memcpy(&header, pending.buffer.data(), sizeof(header));
+                if (header.type != net::PacketType::Ready || header.dataLen == 0 ||
+                    header.dataLen > HandshakeReactor::MaxReadySize)
+                {
+                    Drop(fd, "it did not send a Ready packet");
+                    return;
+                }
+                wanted += header.dataLen;
+            }
+
+            if (pending.buffer.size() == wanted && wanted > sizeof(net::PacketHeader))
+            {
+                Complete(fd);
+                return;
+            }
+
+            const usize prev_size = pending.buffer.size();
+            pending.buffer.resize(wanted);
+            const auto res = recv(fd, pending.buffer.data() + prev_size, wanted - prev_size, 0);
+            pending.buffer.resize(prev_size + static_cast<usize>(std::max<ssize_t>(res, 0)));
+
+            if (res == 0)
+            {
+                Drop(fd, "it disconnected");
+                return;
+            }
+            else if (res == -1 && errno == EINTR)
+                continue;
+            else if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            else if (res == -1)
+            {
+                Drop(fd, std::strerror(errno));
+                return;
+            }
+        }
+    }
+
+    void HandshakeReactor::ExpireBefore(const Clock::time_point deadline) noexcept
+    {
+        std::vector<i32> expired;
+        for (const auto& [fd, pending] : m_Pending)
+        {
+            if (pending.acceptedAt < deadline)
+                expired.push_back(fd);
+        }
+        for (const auto fd : expired)
+            Drop(fd, "it timed out");
+    }
+
+    void HandshakeReactor::Drop(const i32 fd, const std::string_view reason) noexcept
+    {
+        const auto it     = m_Pending.find(fd);
+        auto*      socket = it->second.socket;
+        PMGRD_LOG_LIMITED(m_Logger, Warn, "({}:{}) failed its handshake, {}. Disconnecting...",
+                          socket->remote_ep.address.str, socket->remote_ep.port, reason);
+
+        epoll_ctl(m_Epoll, EPOLL_CTL_DEL, fd, nullptr);
+        net::Socket_Dispose(socket);
+        m_Pending.erase(it);
+        m_Metrics.pendingHandshakes.Add(-1);
+        m_Metrics.handshakeFailures.Add();
+    }
+
+    void HandshakeReactor::Complete(const i32 fd) noexcept
+    {
+        const auto it      = m_Pending.find(fd);
+        auto       pending = std::move(it->second);
+        m_Pending.erase(it);
+        m_Metrics.pendingHandshakes.Add(-1);
+
+        epoll_ctl(m_Epoll, EPOLL_CTL_DEL, fd, nullptr);
+        if (!SetNonBlocking(fd, false))
+        {
+            PMGRD_LOG_LIMITED(m_Logger, Error, "({}:{}) could not be switched back to blocking mode: {}",
+                              pending.socket->remote_ep.address.str, pending.socket->remote_ep.port,
+                              std::strerror(errno));
+            m_Metrics.handshakeFailures.Add();
+            net::Socket_Dispose(pending.socket);
+            return;
+        }
+
+        net::Packet ready;
+        std::memcpy(&ready.header, pending.buffer.data(), sizeof(ready.header));
+        ready.data.assign(pending.buffer.begin() + sizeof(ready.header), pending.buffer.end());
+
+        m_Metrics.handshakeLatency.Record(static_cast<u64>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - pending.acceptedAt).count()));
+
+        // Registering acknowledges the handshake and takes the Endpoint lock, both of which may block.
+        {
+            std::scoped_lock lock{ m_ReadyMutex };
+            m_Ready.emplace_back(pending.socket, std::move(ready));
+        }
+        m_ReadyCV.notify_one();
+    }
+} // namespace pmgrd::net
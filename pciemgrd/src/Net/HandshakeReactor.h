@@ -0,0 +1,133 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Log/Logger.h>
+#include <Net/NetMetrics.h>
+#include <Net/NetPacket.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief Waits for the @ref PacketType::Ready packet of freshly accepted sockets on a thread of its own.
+     *
+     * @details Accepted sockets are handed over with @ref Add and switched to non-blocking mode, a single epoll
+     * loop then reads the handshakes of every pending socket as their bytes trickle in. A socket that hasn't sent
+     * a complete Ready packet within @ref Timeout, sends something else or sends more than a Ready packet can hold
+     * is dropped, so slow or hostile clients never hold up the accepting thread nor each other.
+     * Completed handshakes are switched back to blocking mode and handed to the @ref ReadyDelegate on a worker
+     * thread, so a delegate blocking on the acknowledgement or on a lock never stalls the other handshakes.
+     *
+     * Should epoll fail, the loop starts over on a new epoll instance. Once that fails too the reactor gives up,
+     * see @ref HasFailed, and refuses every socket it is handed.
+     * */
+    class HandshakeReactor
+    {
+    public:
+        using Clock         = std::chrono::steady_clock;
+        using ReadyDelegate = std::function<void(net::Socket*, net::Packet&&)>;
+        using SetupDelegate = std::function<void(const std::string_view)>;
+
+    public:
+        /**
+         * @brief How long a client has to send its Ready packet once accepted.
+         * */
+        static constexpr auto Timeout = std::chrono::seconds{ 5 };
+        /**
+         * @brief Handshakes that can be pending at once, further sockets are closed right away.
+         * */
+        static constexpr usize MaxPending = 1024;
+        /**
+         * @brief Largest Ready payload accepted, well above the node id and flags Endpoints send.
+         * */
+        static constexpr u32 MaxReadySize = 64;
+        /**
+         * @brief Epoll instances created in a row after a failure before the reactor gives up.
+         * */
+        static constexpr u32 MaxRestarts = 3;
+
+    private:
+        struct Pending
+        {
+            net::Socket*      socket;
+            std::vector<u8>   buffer;
+            Clock::time_point acceptedAt;
+        };
+
+    private:
+        Logger&                          m_Logger;
+        NetMetrics&                      m_Metrics;
+        ReadyDelegate                    m_OnReady;
+        SetupDelegate                    m_Setup;
+        i32                              m_Epoll;
+        i32                              m_WakeFd;
+        std::atomic<bool>                m_Run;
+        std::atomic<bool>                m_Failed;
+        std::thread                      m_Thread;
+        std::mutex                       m_IncomingMutex;
+        std::vector<net::Socket*>        m_Incoming;
+        std::unordered_map<i32, Pending> m_Pending;
+
+        // Completed handshakes waiting for the worker.
+        std::thread                                      m_Worker;
+        std::mutex                                       m_ReadyMutex;
+        std::condition_variable                          m_ReadyCV;
+        std::deque<std::pair<net::Socket*, net::Packet>> m_Ready;
+
+    public:
+        /**
+         * @param on_ready Called on the worker thread with every completed handshake.
+         * @param setup Called first thing on the reactor's and the worker's threads with their name.
+         * */
+        HandshakeReactor(Logger& logger, NetMetrics& metrics, ReadyDelegate on_ready, SetupDelegate setup);
+        HandshakeReactor(const HandshakeReactor&)            = delete;
+        HandshakeReactor& operator=(const HandshakeReactor&) = delete;
+        ~HandshakeReactor() noexcept;
+
+    public:
+        /**
+         * @brief Starts the reactor's thread.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Start() noexcept;
+
+        /**
+         * @brief Stops the reactor's thread and closes every socket still in its handshake.
+         * */
+        void Stop() noexcept;
+
+        /**
+         * @brief Hands an accepted socket over to the reactor, which takes ownership of it.
+         *
+         * @note Thread-safe.
+         * */
+        void Add(net::Socket* socket) noexcept;
+
+        /**
+         * @brief Whether the reactor gave up on epoll and no longer takes sockets.
+         * */
+        [[nodiscard]] bool HasFailed() const noexcept { return m_Failed.load(); }
+
+    private:
+        void Run() noexcept;
+        void Work() noexcept;
+        bool Restart() noexcept;
+        void Adopt() noexcept;
+        void Read(const i32 fd) noexcept;
+        void ExpireBefore(const Clock::time_point deadline) noexcept;
+        void Drop(const i32 fd, const std::string_view reason) noexcept;
+        void Complete(const i32 fd) noexcept;
+    };
+} // namespace pmgrd::net
@@ -1,25 +1,81 @@
 #include "NetHandler.h"
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <nlohmann/json.hpp>
 
+#include <Core/Tracer.h>
+#include <Utils/Utils.h>
+
 namespace pmgrd::net {
-    NetHandler::NetHandler(lgx::Logger& logger, net::Socket* socket) noexcept
+    namespace {
+        [[nodiscard]] SessionState SessionStateOf(const Endpoint& ep) noexcept
+        {
+            return SessionState{ ep.GetID(), ep.IsSubscribed(), ep.GetConfigKind(), ep.GetConfigVersion() };
+        }
+    } // namespace
+
+    NetHandler::NetHandler(Logger& logger, MetricsRegistry& metrics, net::Socket* socket)
         : m_Logger(logger)
         , m_Socket(socket)
         , m_Run(true)
+        , m_RealtimePriority(0)
+        , m_Metrics(metrics)
+        , m_Handshakes(
+              logger, m_Metrics, [this](net::Socket* socket, net::Packet&& ready)
+              { RegisterEndpoint(socket, std::move(ready)); },
+              [this](const std::string_view name) { SetupThread(m_IOCpus, name); })
+        , m_ReportedCount(0)
     {
     }
 
     NetHandler::~NetHandler() noexcept
     {
+        // No new Endpoint threads once the handshakes are stopped.
+        m_Handshakes.Stop();
+
         if (m_PacketDispatcherThread.joinable())
             m_PacketDispatcherThread.join();
 
-        for (auto& e : m_EndpointThreads)
+        // Wake the Endpoint threads up from their receive, they release their slot on the way out.
+        {
+            std::scoped_lock lock{ m_EndpointMutex };
+            m_Endpoints.ForEach([](EndpointHandle, EndpointSlot& slot)
+                                { shutdown(static_cast<i32>(slot.endpoint->GetSocket()->_native_handle), SHUT_RDWR); });
+        }
+
+        while (true)
+        {
+            std::unique_lock lock{ m_EndpointMutex };
+            if (m_Endpoints.Size() == 0)
+                break;
+
+            // Join the thread of whichever Endpoint is left, outside the lock since it needs it to release its slot.
+            std::thread thread;
+            m_Endpoints.ForEach(
+                [&thread](EndpointHandle, EndpointSlot& slot)
+                {
+                    if (!thread.joinable() && slot.thread.joinable())
+                        thread = std::move(slot.thread);
+                });
+            lock.unlock();
+
+            if (!thread.joinable())
+                break;
+            thread.join();
+        }
+        JoinFinishedThreads();
+    }
+
+    void NetHandler::Stop() noexcept
+    {
         {
-            if (e.joinable())
-                e.join();
+            std::scoped_lock lock{ m_PacketQueueMutex };
+            m_Run.store(false);
         }
+        m_PacketQueueCV.notify_all();
+        m_Handshakes.Stop();
     }
 
     void NetHandler::AddPacket(const net::PacketType type, PacketDelegate delegate) noexcept
@@ -29,95 +85,438 @@ namespace pmgrd::net {
 
     Result<Err> NetHandler::BeginAccept() noexcept
     {
+        SetupThread(m_IOCpus, "Accept");
+        TRY_UNWRAP(m_Handshakes.Start());
+
         while (m_Run.load())
         {
-            m_Logger.Log(lgx::Level::Info, "Waiting for an endpoint...");
+            PMGRD_LOG_LIMITED(m_Logger, Info, "Waiting for an endpoint...");
 
             net::Socket* potential_ep = net::Socket_Accept(m_Socket);
             if (potential_ep)
             {
-                m_Logger.Log(__func__, lgx::Level::Info, "A connection is being made by ({}:{})...",
-                             potential_ep->remote_ep.address.str, potential_ep->remote_ep.port);
-                m_Logger.Log(__func__, lgx::Level::Info, "Waiting for a Ready packet from ({}:{})...",
-                             potential_ep->remote_ep.address.str, potential_ep->remote_ep.port);
+                PMGRD_LOG_LIMITED(m_Logger, Info, "A connection is being made by ({}:{})...",
+                                  potential_ep->remote_ep.address.str, potential_ep->remote_ep.port);
 
-                // Try and receive the Ready packet.
-                if (auto initcon = net::BeginReceive(potential_ep); !initcon)
-                {
-                    m_Logger.Log(__func__, lgx::Level::Error,
-                                 "({}:{}) failed to respond with a Ready packet! Disconnecting...",
-                                 potential_ep->remote_ep.address.str, potential_ep->remote_ep.port);
-                    net::Socket_Dispose(potential_ep);
-                }
-                else
+                // Wait for the Ready packet on the reactor, a client that never sends it can't hold up the others.
+                m_Handshakes.Add(potential_ep);
+                if (m_Handshakes.HasFailed())
+                    return Err{ ErrType::NetListenFailure, "No handshake can be received anymore." };
+            }
+        }
+        return Ok();
+    }
+
+    void NetHandler::RegisterEndpoint(net::Socket* socket, net::Packet&& ready) noexcept
+    {
+        m_Metrics.RecordIn(ready.header);
+
+        auto parsed = net::ParseReady(std::move(ready));
+        if (!parsed)
+        {
+            const auto err = parsed.UnwrapErr();
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "({}:{}) sent an invalid Ready packet. Disconnecting...\n\t{}",
+                              socket->remote_ep.address.str, socket->remote_ep.port, err);
+            net::Packet reply{ err };
+            const auto  header = reply.header;
+            if (net::BeginSend(socket, std::move(reply)))
+                m_Metrics.RecordOut(header);
+            net::Socket_Dispose(socket);
+            return;
+        }
+
+        const auto info       = parsed.Unwrap();
+        const bool subscribed = info.flags & net::ReadyFlags_Subscribe;
+        const bool ping       = info.flags & net::ReadyFlags_Ping;
+
+        // Resume the session the Endpoint presented, or open a new one if it's unknown or gone.
+        SessionLease                  lease;
+        std::optional<ResumedSession> resumed;
+        if (info.flags & net::ReadyFlags_Session)
+        {
+            if (info.sessionToken != 0)
+                resumed = m_Sessions.Resume(info.sessionToken, info.nodeId);
+
+            if (resumed)
+            {
+                lease = resumed->lease;
+                m_Metrics.sessionsResumed.Add();
+            }
+            else
+                lease = m_Sessions.Open(SessionState{ info.nodeId, subscribed });
+            m_Metrics.sessions.Set(static_cast<i64>(m_Sessions.Size()));
+        }
+
+        PMGRD_LOG_LIMITED(m_Logger, Info, "EP#{} connected as ({}:{}){}{}{}.", info.nodeId,
+                          socket->remote_ep.address.str, socket->remote_ep.port,
+                          (subscribed) ? " and subscribed to config updates" : "",
+                          (info.legacy) ? " using the legacy handshake" : "",
+                          (resumed) ? ", resuming its session" : "");
+
+        // Acknowledge the InitCon, along with the session if the Endpoint asked for one and the flags we honour if
+        // it can tell them apart from a legacy acknowledgement.
+        net::Packet ok = net::Packet::Ok();
+        if (info.flags & net::ReadyFlags_Session)
+            ok << lease.token << static_cast<u8>(resumed.has_value());
+        if (info.flags & net::ReadyFlags_Tags)
+            ok << static_cast<u8>(info.flags & net::ReadyFlags_Supported);
+        const auto ok_header = ok.header;
+        if (net::BeginSend(socket, std::move(ok)))
+            m_Metrics.RecordOut(ok_header);
+
+        // Reap the threads of the Endpoints that disconnected since.
+        JoinFinishedThreads();
+
+        auto ep = std::make_shared<Endpoint>(info.nodeId, socket, subscribed, &m_Metrics);
+        ep->SetSession(lease);
+        ep->SetStreaming(info.flags & net::ReadyFlags_Stream);
+        ep->SetTagged(info.flags & net::ReadyFlags_Tags);
+        if (resumed)
+        {
+            ep->SetConfigKind(resumed->state.configKind);
+            ep->SetConfigVersion(resumed->state.configVersion);
+        }
+
+        // Setup as an endpoint for communication.
+        {
+            std::scoped_lock lock{ m_EndpointMutex };
+
+            // The session was still attached to a connection the Endpoint gave up on, e.g. a half-open one whose
+            // loss we haven't noticed yet. Disconnect it, its lease is stale so it won't detach the session.
+            if (resumed && resumed->takenOver)
+                DisconnectSessionHolders(info.nodeId, lease.token);
+
+            const auto       handle = m_Endpoints.Emplace(EndpointSlot{ ep, {} });
+            m_EndpointsByNode[info.nodeId].push_back(handle);
+            m_Endpoints.Get(handle)->thread =
+                std::thread{ &NetHandler::HandleEndpoint, this, handle, ep, ping, resumed.has_value() };
+
+            m_Metrics.endpoints.Add(1);
+            m_Metrics.endpointSlots.Set(static_cast<i64>(m_Endpoints.Capacity()));
+        }
+    }
+
+    void NetHandler::BeginPacketDispatch() noexcept
+    {
+        m_PacketDispatcherThread = std::thread{
+            [this]()
+            {
+                SetupThread(m_DispatcherCpus, "Dispatcher");
+
+                auto                         next_report = Clock::now() + NetHandler::LatencyReportInterval;
+                auto                         next_sweep  = Clock::now() + NetHandler::SessionSweepInterval;
+                std::unique_lock<std::mutex> lock{ m_PacketQueueMutex };
+                while (m_Run.load())
                 {
-                    u8 id;
-                    initcon.Unwrap() >> id;
+                    // Sleep until there's work instead of spinning, a spinning SCHED_FIFO thread would starve
+                    // every other thread on its CPU.
+                    m_PacketQueueCV.wait_until(lock, std::min(next_report, next_sweep),
+                                               [this]() { return !m_PacketQueue.empty() || !m_Run.load(); });
 
-                    m_Logger.Log(__func__, lgx::Level::Info, "EP#{} connected as ({}:{}).", id,
-                                 potential_ep->remote_ep.address.str, potential_ep->remote_ep.port);
+                    while (!m_PacketQueue.empty())
+                    {
+                        auto [handle, packet, received_at] = std::move(m_PacketQueue.front());
+                        m_PacketQueue.pop();
+                        m_Metrics.queueDepth.Set(static_cast<i64>(m_PacketQueue.size()));
 
-                    // Acknowledge the InitCon.
-                    net::BeginSend(potential_ep, Ok());
+                        // Let the Endpoint threads keep queueing while the handler runs.
+                        lock.unlock();
+                        trace::Tracer::Get().RecordAsync("net", "Queued", received_at, Clock::now());
 
-                    // Setup as an endpoint for communication.
-                    m_ConnectedEndpoints.emplace_back(id, potential_ep);
-                    m_EndpointThreads.emplace_back(&NetHandler::HandleEndpoint, this,
-                                                   std::ref(m_ConnectedEndpoints.back()));
+                        // Nobody is left to reply to if the Endpoint disconnected in the meantime.
+                        if (const auto owner = FindEndpoint(handle))
+                            Dispatch(*owner, std::move(packet), received_at);
+                        else
+                        {
+                            PMGRD_LOG_LIMITED(m_Logger, Info, "Dropped {} packet of a disconnected endpoint.",
+                                              net::TypeToStr(packet.header.type));
+                            m_Metrics.stalePackets.Add();
+                        }
+
+                        lock.lock();
+                    }
+
+                    if (const auto now = Clock::now(); now >= next_report)
+                    {
+                        ReportLatency();
+                        next_report = now + NetHandler::LatencyReportInterval;
+                    }
+
+                    if (const auto now = Clock::now(); now >= next_sweep)
+                    {
+                        lock.unlock();
+                        ExpireSessions();
+                        // Don't leave suppressed counts waiting on the next message of their call site.
+                        m_Logger.FlushSuppressed();
+                        lock.lock();
+                        next_sweep = now + NetHandler::SessionSweepInterval;
+                    }
                 }
+
+                ReportLatency();
             }
+        };
+    }
+
+    void NetHandler::Dispatch(Endpoint& owner, net::Packet&& packet, const Clock::time_point received_at) noexcept
+    {
+        const auto type = packet.header.type;
+        const auto it   = m_PacketMap.find(type);
+        if (it == m_PacketMap.end())
+        {
+            PMGRD_LOG_LIMITED(m_Logger, Info, "Dropped {} packet.", net::TypeToStr(type));
+            return;
         }
-        return Ok();
+
+        const trace::Span span{ "handler", net::TypeToStr(type) };
+        const auto        handler_start = Clock::now();
+        owner.SetRequestTag(packet.header.tag);
+        if (auto result = (it->second)(owner, std::move(packet)); !result)
+        {
+            const auto err = result.UnwrapErr();
+            PMGRD_LOG(m_Logger, Error, "An Error Occured!\n\t{}", err);
+            m_Metrics.RecordError(err.Type());
+
+            // Send the error to the client.
+            owner.Reply(err);
+        }
+        // else
+        //  Tell the client that everything went well.
+        //  net::BeginSend(owner.GetSocket(), net::Packet::Ok());
+
+        const auto handled_at = Clock::now();
+        m_Metrics.handlerLatency.Record(static_cast<u64>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(handled_at - handler_start).count()));
+        m_Metrics.dispatchLatency.Record(
+            static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(handled_at - received_at).count()));
     }
 
-    void NetHandler::BeginPacketDispatch() noexcept
+    [[nodiscard]] std::shared_ptr<Endpoint> NetHandler::FindEndpoint(const EndpointHandle handle) noexcept
+    {
+        std::scoped_lock lock{ m_EndpointMutex };
+        const auto*      slot = m_Endpoints.Get(handle);
+        return (slot) ? slot->endpoint : nullptr;
+    }
+
+    void NetHandler::ForEachEndpoint(const std::function<void(Endpoint&)>& fn) noexcept
+    {
+        std::scoped_lock lock{ m_EndpointMutex };
+        m_Endpoints.ForEach([&fn](EndpointHandle, EndpointSlot& slot) { fn(*slot.endpoint); });
+    }
+
+    void NetHandler::ForEachEndpoint(const NodeID node_id, const std::function<void(Endpoint&)>& fn) noexcept
+    {
+        std::scoped_lock lock{ m_EndpointMutex };
+        const auto       it = m_EndpointsByNode.find(node_id);
+        if (it == m_EndpointsByNode.end())
+            return;
+
+        for (const auto handle : it->second)
+        {
+            if (auto* slot = m_Endpoints.Get(handle))
+                fn(*slot->endpoint);
+        }
+    }
+
+    void NetHandler::HandleEndpoint(const EndpointHandle handle, std::shared_ptr<Endpoint> ep, const bool ping,
+                                    const bool resumed) noexcept
     {
-        m_PacketDispatcherThread =
-            std::thread{ [this]()
-                         {
-                             while (m_Run.load())
-                             {
-                                 std::scoped_lock lock{ m_PacketQueueMutex };
-
-                                 while (!m_PacketQueue.empty())
-                                 {
-                                     auto [owner, packet] = std::move(m_PacketQueue.front());
-                                     const auto type      = packet.header.type;
-                                     m_PacketQueue.pop();
-
-                                     if (const auto it = m_PacketMap.find(packet.header.type); it != m_PacketMap.end())
-                                     {
-                                         if (auto result = (it->second)(owner, std::move(packet)); !result)
-                                         {
-                                             const auto err = result.UnwrapErr();
-                                             m_Logger.Log(lgx::Level::Error, "An Error Occured!\n\t{}", err);
-
-                                             // Send the error to the client.
-                                             net::BeginSend(owner.GetSocket(), err);
-                                         }
-                                         // else
-                                         //  Tell the client that everything went well.
-                                         //  net::BeginSend(owner.GetSocket(), net::Packet::Ok());
-                                     }
-                                     else
-                                         m_Logger.Log(__func__, lgx::Level::Info, "Dropped {} packet.",
-                                                      net::TypeToStr(type));
-                                 }
-                             }
-                         } };
-    }
-
-    void NetHandler::HandleEndpoint(Endpoint& ep) noexcept
-    {
-        while (ep.IsConnected())
-        {
-            auto packet = net::BeginReceive(ep.GetSocket());
+        SetupThread(m_IOCpus, fmt::format("EP#{}", ep->GetID()));
+
+        // Catch the Endpoint up on whatever it missed while it was away. From its own thread, a push stuck on a
+        // full socket buffer must not hold up the handshakes of everyone else.
+        if (resumed && m_OnResumed)
+            m_OnResumed(*ep);
+
+        // Pinging from the Endpoint's own thread times the Pong before it could wait in the queue.
+        auto next_ping = (ping) ? Clock::now() : net::NoDeadline;
+        while (ep->IsConnected())
+        {
+            if (Clock::now() >= next_ping)
+            {
+                SendPing(*ep);
+                next_ping = Clock::now() + NetHandler::PingInterval;
+            }
+
+            auto packet = net::BeginReceive(ep->GetSocket(), next_ping);
             if (packet)
             {
-                std::scoped_lock lock{ m_PacketQueueMutex };
+                const auto received_at = Clock::now();
+                auto       received    = packet.Unwrap();
+                m_Metrics.RecordIn(received.header);
+                if (received.Type() == net::PacketType::Pong)
+                {
+                    RecordPong(*ep, std::move(received), net::ClockSync::Now());
+                    continue;
+                }
 
-                m_PacketQueue.emplace(ep, packet.Unwrap());
+                {
+                    const trace::Span span{ "net", "Enqueue" };
+                    std::scoped_lock  lock{ m_PacketQueueMutex };
+                    m_PacketQueue.push({ handle, std::move(received), received_at });
+                    m_Metrics.queueDepth.Set(static_cast<i64>(m_PacketQueue.size()));
+                }
+                m_PacketQueueCV.notify_one();
             }
         }
+
+        ReleaseEndpoint(handle, *ep);
+    }
+
+    void NetHandler::SendPing(Endpoint& ep) noexcept
+    {
+        net::Packet ping{ net::PacketType::Ping };
+        ping << net::ClockSync::Now();
+        if (ep.Send(std::move(ping)))
+            ep.GetClock().Sent();
+    }
+
+    void NetHandler::RecordPong(Endpoint& ep, net::Packet&& pong, const i64 received_at) noexcept
+    {
+        if (pong.data.size() != sizeof(i64) * 3)
+        {
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "EP#{} sent a malformed Pong of {} bytes.", ep.GetID(),
+                              pong.data.size());
+            return;
+        }
+
+        i64 sent_at, arrived_at, answered_at;
+        pong >> answered_at >> arrived_at >> sent_at;
+        auto& clock  = ep.GetClock();
+        auto  sample = clock.Record(sent_at, arrived_at, answered_at, received_at);
+        if (!sample)
+        {
+            const auto err = sample.UnwrapErr();
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "Discarded a Pong of EP#{}.\n\t{}", ep.GetID(), err);
+            return;
+        }
+        m_Metrics.RecordClock(ep.GetID(), sample.Unwrap(), clock.Estimate());
+    }
+
+    void NetHandler::DisconnectSessionHolders(const NodeID node_id, const u64 token) noexcept
+    {
+        const auto it = m_EndpointsByNode.find(node_id);
+        if (it == m_EndpointsByNode.end())
+            return;
+
+        for (const auto handle : it->second)
+        {
+            const auto* slot = m_Endpoints.Get(handle);
+            if (!slot || slot->endpoint->GetSession().token != token)
+                continue;
+
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "EP#{} took its session over from a stale connection ({}:{}).", node_id,
+                              slot->endpoint->GetSocket()->remote_ep.address.str,
+                              slot->endpoint->GetSocket()->remote_ep.port);
+            shutdown(static_cast<i32>(slot->endpoint->GetSocket()->_native_handle), SHUT_RDWR);
+        }
+    }
+
+    void NetHandler::ReleaseEndpoint(const EndpointHandle handle, const Endpoint& ep) noexcept
+    {
+        // Keep what the Endpoint needs to pick up where it left off should it reconnect in time.
+        if (const auto& lease = ep.GetSession(); lease.token != 0)
+            m_Sessions.Detach(lease, SessionStateOf(ep));
+
+        const NodeID     node_id = ep.GetID();
+        std::scoped_lock lock{ m_EndpointMutex };
+        auto*            slot = m_Endpoints.Get(handle);
+        if (!slot)
+            return;
+
+        // A thread can't join itself, the next registration or the destructor does.
+        if (slot->thread.joinable())
+            m_FinishedThreads.push_back(std::move(slot->thread));
+        m_Endpoints.Erase(handle);
+
+        if (const auto it = m_EndpointsByNode.find(node_id); it != m_EndpointsByNode.end())
+        {
+            auto& handles = it->second;
+            std::erase(handles, handle);
+            if (handles.empty())
+            {
+                m_EndpointsByNode.erase(it);
+                m_Metrics.ForgetClock(node_id);
+            }
+        }
+
+        m_Metrics.endpoints.Add(-1);
+    }
+
+    void NetHandler::SyncSession(const Endpoint& ep) noexcept
+    {
+        if (const auto& lease = ep.GetSession(); lease.token != 0)
+            m_Sessions.Update(lease, SessionStateOf(ep));
+    }
+
+    void NetHandler::RestoreSession(const u64 token, const SessionState& state) noexcept
+    {
+        m_Sessions.Restore(token, state);
+        m_Metrics.sessions.Set(static_cast<i64>(m_Sessions.Size()));
+    }
+
+    void NetHandler::ExpireSessions() noexcept
+    {
+        if (const auto expired = m_Sessions.Expire(); expired > 0)
+        {
+            PMGRD_LOG_LIMITED(m_Logger, Info, "{} session(s) expired before being resumed.", expired);
+            m_Metrics.sessionsExpired.Add(expired);
+            m_Metrics.sessions.Set(static_cast<i64>(m_Sessions.Size()));
+        }
+    }
+
+    void NetHandler::JoinFinishedThreads() noexcept
+    {
+        std::vector<std::thread> finished;
+        {
+            std::scoped_lock lock{ m_EndpointMutex };
+            finished.swap(m_FinishedThreads);
+        }
+        for (auto& thread : finished)
+            thread.join();
+    }
+
+    void NetHandler::SetupThread(const std::vector<u16>& cpus, const std::string_view name) noexcept
+    {
+        trace::Tracer::Get().SetThreadName(std::string{ name });
+        if (!cpus.empty())
+        {
+            if (const auto result = utils::sys::SetThreadAffinity(cpus); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Warn, "{} thread will not be pinned.\n\t{}", name, err);
+            }
+            else
+                PMGRD_LOG_LIMITED(m_Logger, Info, "{} thread (TID {}) pinned to CPUs {}.", name, gettid(),
+                                  utils::sys::ProcStatusField(gettid(), "Cpus_allowed_list"));
+        }
+
+        if (m_RealtimePriority > 0)
+        {
+            if (const auto result = utils::sys::SetThreadRealtime(m_RealtimePriority); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Warn, "{} thread will not run in real-time.\n\t{}", name, err);
+                return;
+            }
+
+            utils::sys::PrefaultStack(NetHandler::RealtimeStackPrefault);
+            PMGRD_LOG_LIMITED(m_Logger, Info, "{} thread (TID {}) runs under SCHED_FIFO at priority {}.", name,
+                              gettid(), m_RealtimePriority);
+        }
+    }
+
+    void NetHandler::ReportLatency() noexcept
+    {
+        // Nothing new since the last report.
+        const auto& h = m_Metrics.dispatchLatency;
+        if (h.Count() == m_ReportedCount)
+            return;
+        m_ReportedCount = h.Count();
+
+        const auto us = [](const u64 ns) { return static_cast<double>(ns) / 1000.0; };
+        PMGRD_LOG(m_Logger, Info,
+                  "Dispatch latency over {} packet(s): p50 {:.1f} us, p99 {:.1f} us, p999 {:.1f} us, max {:.1f} us.",
+                  h.Count(), us(h.Percentile(0.5)), us(h.Percentile(0.99)), us(h.Percentile(0.999)), us(h.Max()));
     }
 } // namespace pmgrd::net
@@ -2,51 +2,202 @@
 
 #include <CommonDef.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <unordered_map>
-
-#include <Logex.h>
+#include <vector>
 
 #include <Core/Error.h>
+#include <Core/Histogram.h>
+#include <Core/Ids.h>
+#include <Core/Metrics.h>
 #include <Core/Result.h>
+#include <Core/SlotMap.h>
 #include <Endpoint/Endpoint.h>
+#include <Log/Logger.h>
+#include <Net/HandshakeReactor.h>
+#include <Net/NetMetrics.h>
 #include <Net/NetPacket.h>
+#include <Net/SessionTable.h>
 
 namespace pmgrd::net {
     class NetHandler
     {
     public:
-        using PacketDelegate = std::function<Result<Err>(Endpoint&, net::Packet&&)>;
+        using PacketDelegate  = std::function<Result<Err>(Endpoint&, net::Packet&&)>;
+        using SessionDelegate = std::function<void(Endpoint&)>;
+        using Clock           = std::chrono::steady_clock;
+        using EndpointHandle  = SlotHandle;
+
+    public:
+        /**
+         * @brief How often the dispatch latency percentiles are logged.
+         * */
+        static constexpr auto LatencyReportInterval = std::chrono::seconds{ 30 };
+        /**
+         * @brief How much stack real-time threads pre-fault.
+         * */
+        static constexpr usize RealtimeStackPrefault = 256 * 1024;
+        /**
+         * @brief How often expired sessions are dropped.
+         * */
+        static constexpr auto SessionSweepInterval = std::chrono::seconds{ 5 };
+        /**
+         * @brief How often Endpoints announcing @ref net::ReadyFlags_Ping are pinged.
+         * */
+        static constexpr auto PingInterval = std::chrono::seconds{ 5 };
+
+    private:
+        struct QueuedPacket
+        {
+            EndpointHandle    owner;
+            net::Packet       packet;
+            Clock::time_point receivedAt;
+        };
+
+        /**
+         * @brief A connected Endpoint and the thread receiving from it.
+         *
+         * @details Whoever works with the Endpoint holds on to a reference, so it outlives its slot when it
+         * disconnects while a packet of it is being handled.
+         * */
+        struct EndpointSlot
+        {
+            std::shared_ptr<Endpoint> endpoint;
+            std::thread               thread;
+        };
 
     private:
-        lgx::Logger&                                        m_Logger;
-        net::Socket*                                        m_Socket;
-        std::atomic<bool>                                   m_Run;
-        std::queue<std::pair<Endpoint&, net::Packet>>       m_PacketQueue;
-        std::mutex                                          m_PacketQueueMutex;
-        std::thread                                         m_PacketDispatcherThread;
-        std::unordered_map<net::PacketType, PacketDelegate> m_PacketMap;
-        std::mutex                                          m_EndpointThreadMutex;
-        std::list<std::thread>                              m_EndpointThreads;
-        std::list<Endpoint>                                 m_ConnectedEndpoints;
+        Logger&                                                 m_Logger;
+        net::Socket*                                            m_Socket;
+        std::atomic<bool>                                       m_Run;
+        std::queue<QueuedPacket>                                m_PacketQueue;
+        std::mutex                                              m_PacketQueueMutex;
+        std::condition_variable                                 m_PacketQueueCV;
+        std::thread                                             m_PacketDispatcherThread;
+        std::unordered_map<net::PacketType, PacketDelegate>     m_PacketMap;
+        std::mutex                                              m_EndpointMutex;
+        SlotMap<EndpointSlot>                                   m_Endpoints;
+        std::unordered_map<NodeID, std::vector<EndpointHandle>> m_EndpointsByNode;
+        std::vector<std::thread>                                m_FinishedThreads;
+        std::vector<u16>                                        m_DispatcherCpus;
+        std::vector<u16>                                        m_IOCpus;
+        i32                                                     m_RealtimePriority;
+        NetMetrics                                              m_Metrics;
+        HandshakeReactor                                        m_Handshakes;
+        SessionTable                                            m_Sessions;
+        SessionDelegate                                         m_OnResumed;
+        u64                                                     m_ReportedCount;
 
     public:
-        NetHandler(lgx::Logger& logger, net::Socket* socket) noexcept;
+        NetHandler(Logger& logger, MetricsRegistry& metrics, net::Socket* socket);
         ~NetHandler() noexcept;
 
     public:
-        void Stop() noexcept { m_Run.store(false); }
+        void Stop() noexcept;
+
+        /**
+         * @brief Time from a packet being received until its handler returned, in nanoseconds.
+         * */
+        [[nodiscard]] const Histogram& GetDispatchLatency() const noexcept { return m_Metrics.dispatchLatency; }
 
     public:
         void        AddPacket(const net::PacketType type, PacketDelegate delegate) noexcept;
         Result<Err> BeginAccept() noexcept;
         void        BeginPacketDispatch() noexcept;
 
+        /**
+         * @brief Invoked with every Endpoint that resumed its session, once its state has been restored. Runs on
+         * the Endpoint's own thread before it starts receiving, so it may block on the Endpoint.
+         * Must be called before @ref BeginAccept.
+         * */
+        void SetResumeDelegate(SessionDelegate delegate) noexcept { m_OnResumed = std::move(delegate); }
+
+        /**
+         * @brief The sessions of the Endpoints that opened one.
+         * */
+        [[nodiscard]] SessionTable& GetSessions() noexcept { return m_Sessions; }
+
+        /**
+         * @brief Stores the current state of @p ep in its session, if it has one.
+         * */
+        void SyncSession(const Endpoint& ep) noexcept;
+
+        /**
+         * @brief Adds a session taken over from another RC, resumable by its Endpoint once it reconnects.
+         * */
+        void RestoreSession(const u64 token, const SessionState& state) noexcept;
+
+        /**
+         * @brief Runs the handler of @p packet's type on the calling thread and records its latency, replying with
+         * the error if the handler fails. The dispatcher thread calls this for every queued packet.
+         *
+         * @param received_at When @p packet was received, the start of its dispatch latency.
+         * */
+        void Dispatch(Endpoint& owner, net::Packet&& packet, const Clock::time_point received_at) noexcept;
+
+        /**
+         * @brief Looks up a connected Endpoint.
+         *
+         * @returns The Endpoint or nullptr if @p handle is stale, i.e. the Endpoint has disconnected since.
+         * */
+        [[nodiscard]] std::shared_ptr<Endpoint> FindEndpoint(const EndpointHandle handle) noexcept;
+
+        /**
+         * @brief Invokes @p fn on every connected Endpoint while holding the Endpoint registry lock.
+         * */
+        void ForEachEndpoint(const std::function<void(Endpoint&)>& fn) noexcept;
+
+        /**
+         * @brief Invokes @p fn on every connected Endpoint of node @p node_id while holding the Endpoint registry
+         * lock.
+         * */
+        void ForEachEndpoint(const NodeID node_id, const std::function<void(Endpoint&)>& fn) noexcept;
+
+        /**
+         * @brief Pins the packet dispatcher thread to @p cpus. Must be called before @ref BeginPacketDispatch.
+         * */
+        void SetDispatcherAffinity(std::vector<u16> cpus) noexcept { m_DispatcherCpus = std::move(cpus); }
+
+        /**
+         * @brief Pins the accepting thread and every Endpoint thread to @p cpus. Must be called before
+         * @ref BeginAccept.
+         * */
+        void SetIOAffinity(std::vector<u16> cpus) noexcept { m_IOCpus = std::move(cpus); }
+
+        /**
+         * @brief Runs the dispatcher, accepting and Endpoint threads under SCHED_FIFO at @p priority.
+         * 0 keeps the default scheduling policy. Must be called before @ref BeginPacketDispatch.
+         * */
+        void SetRealtimePriority(const i32 priority) noexcept { m_RealtimePriority = priority; }
+
     private:
-        void HandleEndpoint(Endpoint& ep) noexcept;
+        void SetupThread(const std::vector<u16>& cpus, const std::string_view name) noexcept;
+        void ReportLatency() noexcept;
+        void RegisterEndpoint(net::Socket* socket, net::Packet&& ready) noexcept;
+        void HandleEndpoint(const EndpointHandle handle, std::shared_ptr<Endpoint> ep, const bool ping,
+                            const bool resumed) noexcept;
+        void SendPing(Endpoint& ep) noexcept;
+
+        /**
+         * @brief Adds the round answered by @p pong to the estimate of @p ep.
+         *
+         * @param received_at When @p pong was received, see @ref ClockSync::Now.
+         * */
+        void RecordPong(Endpoint& ep, net::Packet&& pong, const i64 received_at) noexcept;
+        void ReleaseEndpoint(const EndpointHandle handle, const Endpoint& ep) noexcept;
+
+        /**
+         * @brief Disconnects the Endpoints of @p node_id still holding session @p token. m_EndpointMutex must be held.
+         * */
+        void DisconnectSessionHolders(const NodeID node_id, const u64 token) noexcept;
+        void ExpireSessions() noexcept;
+        void JoinFinishedThreads() noexcept;
         void ThreadHandler() noexcept;
     };
 } // namespace pmgrd::net
@@ -0,0 +1,72 @@
+#include "NetMetrics.h"
+
+#include <fmt/format.h>
+
+namespace pmgrd::net {
+    NetMetrics::NetMetrics(MetricsRegistry& registry)
+        : bytesIn(registry.AddCounter("pmgrd_received_bytes", "Bytes received from Endpoints."))
+        , bytesOut(registry.AddCounter("pmgrd_sent_bytes", "Bytes sent to Endpoints."))
+        , dispatchLatency(registry.AddHistogram("pmgrd_dispatch_latency_seconds",
+                                                "Time from a packet being received until it was handled."))
+        , handlerLatency(registry.AddHistogram("pmgrd_handler_latency_seconds", "Time spent handling a packet."))
+        , queueDepth(registry.AddGauge("pmgrd_packet_queue_depth", "Packets waiting to be dispatched."))
+        , endpoints(registry.AddGauge("pmgrd_endpoints", "Connected Endpoints."))
+        , endpointSlots(registry.AddGauge("pmgrd_endpoint_slots", "Slots allocated in the Endpoint registry."))
+        , stalePackets(registry.AddCounter("pmgrd_stale_packets",
+                                           "Packets dropped because their Endpoint disconnected before dispatch."))
+        , handshakeLatency(registry.AddHistogram("pmgrd_handshake_latency_seconds",
+                                                 "Time from a connection being accepted until its Ready arrived."))
+        , pendingHandshakes(registry.AddGauge("pmgrd_pending_handshakes", "Connections waiting to send their Ready."))
+        , handshakeFailures(registry.AddCounter("pmgrd_handshake_failures",
+                                                "Connections dropped before completing their handshake."))
+        , sessions(registry.AddGauge("pmgrd_sessions", "Attached and detached Endpoint sessions."))
+        , sessionsResumed(registry.AddCounter("pmgrd_sessions_resumed", "Sessions resumed by a reconnecting Endpoint."))
+        , sessionsExpired(registry.AddCounter("pmgrd_sessions_expired",
+                                              "Detached sessions dropped before being resumed."))
+        , pingRtt(registry.AddHistogram("pmgrd_ping_rtt_seconds", "Round-trip time of Pings to Endpoints."))
+        , m_Registry(registry)
+    {
+        for (usize i = 0; i < net::PacketTypeCount; ++i)
+        {
+            const auto labels = fmt::format("type=\"{}\"", net::TypeToStr(static_cast<PacketType>(i)));
+            packetsIn[i]  = &registry.AddCounter("pmgrd_packets_received", "Packets received from Endpoints.", labels);
+            packetsOut[i] = &registry.AddCounter("pmgrd_packets_sent", "Packets sent to Endpoints.", labels);
+        }
+        for (usize i = 0; i < ErrTypeCount; ++i)
+        {
+            errors[i] = &registry.AddCounter("pmgrd_errors", "Errors returned by packet handlers.",
+                                             fmt::format("type=\"{}\"", ErrTypeToStr(static_cast<ErrType>(i))));
+        }
+    }
+
+    void NetMetrics::RecordClock(const NodeID node_id, const ClockSample& sample, const ClockEstimate& estimate)
+    {
+        pingRtt.Record(static_cast<u64>(sample.rtt));
+
+        std::scoped_lock lock{ m_NodeClocksMutex };
+        auto             it = m_NodeClocks.find(node_id);
+        if (it == m_NodeClocks.end())
+        {
+            const auto labels = fmt::format("node=\"{}\"", node_id);
+            auto&      rtt    = m_Registry.AddGauge("pmgrd_node_rtt_microseconds",
+                                                    "Smoothed round-trip time to a node's Endpoints.", labels);
+            auto&      offset = m_Registry.AddGauge("pmgrd_node_clock_offset_microseconds",
+                                                    "How far a node's clock is ahead of the RC's.", labels);
+            it                = m_NodeClocks.emplace(node_id, NodeClock{ rtt, offset }).first;
+        }
+        it->second.rtt.Set(estimate.rtt / 1000);
+        it->second.offset.Set(estimate.offset / 1000);
+    }
+
+    void NetMetrics::ForgetClock(const NodeID node_id)
+    {
+        std::scoped_lock lock{ m_NodeClocksMutex };
+        const auto       it = m_NodeClocks.find(node_id);
+        if (it == m_NodeClocks.end())
+            return;
+
+        m_Registry.RemoveGauge("pmgrd_node_rtt_microseconds", it->second.rtt);
+        m_Registry.RemoveGauge("pmgrd_node_clock_offset_microseconds", it->second.offset);
+        m_NodeClocks.erase(it);
+    }
+} // namespace pmgrd::net
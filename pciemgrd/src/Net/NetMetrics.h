@@ -0,0 +1,92 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+#include <Core/Error.h>
+#include <Core/Histogram.h>
+#include <Core/Ids.h>
+#include <Core/Metrics.h>
+#include <Net/ClockSync.h>
+#include <Net/NetPacket.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief Traffic metrics of the RC's network threads.
+     *
+     * @details Registered once in a @ref MetricsRegistry, recording only touches the per-thread shards of the
+     * counters so it is safe and cheap from every Endpoint thread. The clock gauges of a node are registered the
+     * first time it is measured and removed once its last Endpoint disconnects, so that nodes coming and going
+     * don't grow the registry.
+     * */
+    struct NetMetrics
+    {
+    private:
+        struct NodeClock
+        {
+            Gauge& rtt;
+            Gauge& offset;
+        };
+
+    public:
+        std::array<Counter*, net::PacketTypeCount> packetsIn;
+        std::array<Counter*, net::PacketTypeCount> packetsOut;
+        std::array<Counter*, ErrTypeCount>         errors;
+        Counter&                                   bytesIn;
+        Counter&                                   bytesOut;
+        Histogram&                                 dispatchLatency; ///< From being received until handled, in ns.
+        Histogram&                                 handlerLatency;  ///< Time spent in the handler, in ns.
+        Gauge&                                     queueDepth;
+        Gauge&                                     endpoints;
+        Gauge&                                     endpointSlots;
+        Counter&                                   stalePackets;
+        Histogram&                                 handshakeLatency; ///< From being accepted until Ready, in ns.
+        Gauge&                                     pendingHandshakes;
+        Counter&                                   handshakeFailures;
+        Gauge&                                     sessions;
+        Counter&                                   sessionsResumed;
+        Counter&                                   sessionsExpired;
+        Histogram&                                 pingRtt; ///< Round-trip time of every Ping, in ns.
+
+    private:
+        MetricsRegistry&                      m_Registry;
+        std::mutex                            m_NodeClocksMutex;
+        std::unordered_map<NodeID, NodeClock> m_NodeClocks;
+
+    public:
+        explicit NetMetrics(MetricsRegistry& registry);
+
+    public:
+        /**
+         * @brief Records a Ping round of node @p node_id and its resulting @p estimate.
+         * */
+        void RecordClock(const NodeID node_id, const ClockSample& sample, const ClockEstimate& estimate);
+
+        /**
+         * @brief Removes the clock gauges of node @p node_id, its last Endpoint went away.
+         * */
+        void ForgetClock(const NodeID node_id);
+
+    public:
+        void RecordIn(const net::PacketHeader& header) noexcept { Record(packetsIn, bytesIn, header); }
+        void RecordOut(const net::PacketHeader& header) noexcept { Record(packetsOut, bytesOut, header); }
+        void RecordError(const ErrType type) noexcept
+        {
+            if (static_cast<usize>(type) < errors.size())
+                errors[static_cast<usize>(type)]->Add();
+        }
+
+    private:
+        static void Record(const std::array<Counter*, net::PacketTypeCount>& packets, Counter& bytes,
+                           const net::PacketHeader& header) noexcept
+        {
+            // Unknown types still count towards the bytes.
+            if (static_cast<usize>(header.type) < packets.size())
+                packets[static_cast<usize>(header.type)]->Add();
+            bytes.Add(sizeof(net::PacketHeader) + header.dataLen);
+        }
+    };
+} // namespace pmgrd::net
@@ -1,66 +1,396 @@
 #include "NetPacket.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <Core/Tracer.h>
+#include <Utils/Utils.h>
+
 namespace pmgrd::net {
     /* clang-format off */
     static std::string_view s_PacketTypeStr[] =
     {
     "NoOp",
-    "InitConn",
+    "Ready",
     "Ok",
     "Reboot",
     "String",
     "Error",
-    "GetConfig",
+    "GetCrewConfig",
+    "GetCtrConfig",
     "Join",
-    "Leave"
+    "Leave",
+    "ConfigUpdate",
+    "NotModified",
+    "Stats",
+    "Trace",
+    "Replicate",
+    "Replication",
+    "Ping",
+    "Pong",
+    "Clocks",
+    "StreamBegin",
+    "StreamChunk",
+    "StreamEnd",
+    "Config"
     };
     /* clang-format on */
+    static_assert(std::size(s_PacketTypeStr) == PacketTypeCount, "Every PacketType needs a string.");
 
-    ValuedResult<Packet, Err> BeginReceive(csnet::Socket* socket) noexcept
-    {
-        Packet incoming_packet{};
+    namespace {
+        /**
+         * @brief Waits for @p fd to be ready for @p events until @p deadline.
+         *
+         * @returns @ref Result of @ref Err, @ref ErrType::Timeout if @p deadline passed first.
+         * */
+        [[nodiscard]] Result<Err> WaitFor(const i32 fd, const i16 events, const Deadline deadline) noexcept
+        {
+            while (true)
+            {
+                i32 timeout = -1;
+                if (deadline != NoDeadline)
+                {
+                    const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+                    timeout = static_cast<i32>(std::clamp<i64>(left.count(), 0, std::numeric_limits<i32>::max()));
+                }
+
+                // Errors and hang-ups show up as readiness, the next recv or send reports them.
+                pollfd pfd{};
+                pfd.fd     = fd;
+                pfd.events = events;
+                if (const i32 ready = poll(&pfd, 1, timeout); ready > 0)
+                    return Ok();
+                else if (ready == 0)
+                    return Err{ ErrType::Timeout };
+                else if (errno != EINTR)
+                    return Err{ ErrType::NetSocketError, "Failed to poll socket {}: {}", fd, std::strerror(errno) };
+            }
+        }
+
+        /**
+         * @brief Gives up on a connection whose stream can't be trusted anymore, as Socket_Receive does.
+         * */
+        [[nodiscard]] Err Disconnect(csnet::Socket* socket, Err err) noexcept
+        {
+            socket->connected = false;
+            shutdown(socket->_native_handle, CS_SD_BOTH);
+            return err;
+        }
 
-        // Receive the header.
-        if (Socket_Receive(socket, reinterpret_cast<u8*>(&incoming_packet.header), sizeof(incoming_packet.header), 0) !=
-            CS_SOCKET_ERROR)
+        [[nodiscard]] Result<Err> ReceiveExactly(csnet::Socket* socket, u8* data, const usize size,
+                                                 const Deadline deadline) noexcept
         {
-            // Receive the payload (if any).
-            if (incoming_packet.header.dataLen > 0)
+            const auto fd       = static_cast<i32>(socket->_native_handle);
+            usize      received = 0;
+            while (received < size)
+            {
+                const auto n = recv(fd, data + received, size - received, MSG_DONTWAIT);
+                if (n > 0)
+                {
+                    received += static_cast<usize>(n);
+                    continue;
+                }
+
+                if (n == 0)
+                    return Disconnect(socket, Err{ ErrType::NetReadFailure, "The connection was closed." });
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return Disconnect(socket,
+                                      Err{ ErrType::NetReadFailure, "Failed to receive: {}", std::strerror(errno) });
+
+                if (auto ready = WaitFor(fd, POLLIN, deadline); !ready)
+                {
+                    const auto err = ready.UnwrapErr();
+                    if (err.Type() != ErrType::Timeout)
+                        return Disconnect(socket, err);
+                    return Disconnect(socket,
+                                      Err{ ErrType::Timeout, "Timed out after {} of {} bytes.", received, size });
+                }
+            }
+            return Ok();
+        }
+
+        /**
+         * @brief Sends @p header followed by the @p size bytes at @p data in a single write.
+         * */
+        [[nodiscard]] Result<Err> SendPayload(csnet::Socket* socket, PacketHeader header, const u8* data,
+                                              const usize size, const Deadline deadline) noexcept
+        {
+            const auto fd = static_cast<i32>(socket->_native_handle);
+
+            // The header always tells the size that actually follows.
+            header.dataLen = static_cast<u32>(size);
+
+            iovec iov[2];
+            iov[0].iov_base = &header;
+            iov[0].iov_len  = sizeof(header);
+            iov[1].iov_base = const_cast<u8*>(data);
+            iov[1].iov_len  = size;
+
+            usize       first = 0;
+            const usize count = (size == 0) ? 1 : 2;
+            while (first < count)
             {
-                incoming_packet.data.resize(incoming_packet.header.dataLen);
-                if (Socket_Receive(socket, reinterpret_cast<u8*>(incoming_packet.data.data()),
-                                   incoming_packet.header.dataLen, 0) != CS_SOCKET_ERROR)
-                    return std::move(incoming_packet);
+                msghdr msg{};
+                msg.msg_iov    = iov + first;
+                msg.msg_iovlen = count - first;
+                const auto n   = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                        return Disconnect(socket,
+                                          Err{ ErrType::NetWriteFailure, "Failed to send: {}", std::strerror(errno) });
+                    if (auto ready = WaitFor(fd, POLLOUT, deadline); !ready)
+                        return Disconnect(socket, ready.UnwrapErr());
+                    continue;
+                }
+
+                // Skip past what went out, a short write leaves the rest for the next round.
+                auto sent = static_cast<usize>(n);
+                while (first < count && sent >= iov[first].iov_len)
+                    sent -= iov[first++].iov_len;
+                if (first < count)
+                {
+                    iov[first].iov_base = static_cast<u8*>(iov[first].iov_base) + sent;
+                    iov[first].iov_len -= sent;
+                }
             }
+            return Ok();
+        }
+    } // namespace
+
+    [[nodiscard]] Timeouts& Timeouts::Defaults() noexcept
+    {
+        static Timeouts s_Defaults;
+        return s_Defaults;
+    }
+
+    [[nodiscard]] ValuedResult<Timeouts, Err> Timeouts::Parse(const std::string_view spec,
+                                                              const Timeouts&        base) noexcept
+    {
+        const auto parse_ms = [](const std::string_view value) -> ValuedResult<std::chrono::milliseconds, Err>
+        {
+            i64        ms;
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), ms);
+            if (ec != std::errc{} || ptr != value.data() + value.size() || ms <= 0)
+                return Err{ ErrType::InvalidOperation, "Invalid timeout '{}'.", value };
+            return std::chrono::milliseconds{ ms };
+        };
+
+        // A single number applies to every operation.
+        if (spec.find(':') == std::string_view::npos)
+        {
+            const auto ms = parse_ms(spec);
+            if (!ms)
+                return ms.UnwrapErr();
+            return Timeouts{ ms.Unwrap(), ms.Unwrap(), ms.Unwrap() };
+        }
+
+        Timeouts timeouts = base;
+        for (const auto entry : utils::StrSplit(spec, ','))
+        {
+            const auto colon = entry.find(':');
+            if (colon == std::string_view::npos)
+                return Err{ ErrType::InvalidOperation, "Expected <operation>:<ms>, got '{}'.", entry };
+
+            const auto ms = parse_ms(entry.substr(colon + 1));
+            if (!ms)
+                return ms.UnwrapErr();
+
+            const auto op = entry.substr(0, colon);
+            if (op == "connect")
+                timeouts.connect = ms.Unwrap();
+            else if (op == "send")
+                timeouts.send = ms.Unwrap();
+            else if (op == "receive")
+                timeouts.receive = ms.Unwrap();
             else
-                return std::move(incoming_packet);
+                return Err{ ErrType::InvalidOperation, "Unknown operation '{}', expected connect, send or receive.",
+                            op };
         }
-        return Err{ ErrType::NetBadPacket };
+        return timeouts;
+    }
+
+    [[nodiscard]] ValuedResult<SocketOptions, Err> SocketProfile(const std::string_view name) noexcept
+    {
+        SocketOptions options;
+        if (SocketOptions_FromProfile(std::string{ name }.c_str(), &options) == CS_SOCKET_ERROR)
+            return Err{ ErrType::InvalidOperation, "Unknown socket profile '{}', expected {}, {} or {}.", name,
+                        CS_PROFILE_CONTROL_LOW_LATENCY, CS_PROFILE_CONTROL_BUSY_POLL, CS_PROFILE_BULK_CONFIG };
+        return options;
+    }
+
+    [[nodiscard]] Result<Err> SetSocketOptions(csnet::Socket* socket, const SocketOptions& options) noexcept
+    {
+        if (Socket_SetOptions(socket, &options) == CS_SOCKET_ERROR)
+            return Err{ ErrType::NetSocketError, "Failed to apply the socket options: {}", std::strerror(errno) };
+        return Ok();
+    }
+
+    ValuedResult<Packet, Err> BeginReceive(csnet::Socket* socket, const Deadline deadline) noexcept
+    {
+        Packet     incoming_packet{};
+        const auto fd = static_cast<i32>(socket->_native_handle);
+
+        // Waiting for the header is idle time and leaves the connection intact should it time out.
+        TRY_UNWRAP(WaitFor(fd, POLLIN, deadline));
+
+        // The span starts once a packet is actually coming in, and so does its own deadline.
+        const trace::Span span{ "net", "Receive" };
+        const auto        rest = Clock::now() + Timeouts::Defaults().receive;
+        TRY_UNWRAP(ReceiveExactly(socket, reinterpret_cast<u8*>(&incoming_packet.header),
+                                  sizeof(incoming_packet.header), rest));
+
+        // Nothing is allocated for a payload no packet may carry, nor can the stream be followed past it.
+        if (incoming_packet.header.dataLen > MaxPacketSize)
+            return Disconnect(socket,
+                              Err{ ErrType::NetBadPacket, "A {} packet of {} bytes exceeds the limit of {} bytes.",
+                                   TypeToStr(incoming_packet), incoming_packet.header.dataLen, MaxPacketSize });
+
+        // Receive the payload (if any).
+        if (incoming_packet.header.dataLen > 0)
+        {
+            incoming_packet.data.resize(incoming_packet.header.dataLen);
+            TRY_UNWRAP(ReceiveExactly(socket, incoming_packet.data.data(), incoming_packet.data.size(), rest));
+        }
+
+        // The kernel falls back to delayed ACKs on its own, the next packet should be acknowledged right away too.
+        if (socket->options.quick_ack)
+            Socket_RearmQuickAck(socket);
+        return std::move(incoming_packet);
+    }
+
+    Result<Err> BeginSend(csnet::Socket* socket, Packet&& packet, const Deadline deadline) noexcept
+    {
+        // Nothing went out yet, the connection is still usable.
+        if (packet.data.size() > MaxPacketSize)
+            return Err{ ErrType::NetBadPacket, "A {} packet of {} bytes exceeds the limit of {} bytes.",
+                        TypeToStr(packet), packet.data.size(), MaxPacketSize };
+
+        const trace::Span span{ "net", "Send" };
+        return SendPayload(socket, packet.header, packet.Data(), packet.data.size(), deadline);
     }
 
     Result<Err> BeginSend(csnet::Socket* socket, Packet&& packet) noexcept
     {
-        if (Socket_Send(socket, reinterpret_cast<u8*>(&packet.header), sizeof(packet.header), 0) != CS_SOCKET_ERROR)
+        return BeginSend(socket, std::move(packet), Clock::now() + Timeouts::Defaults().send);
+    }
+
+    Result<Err> SendStream(csnet::Socket* socket, const PacketHeader& header, const u8* data,
+                           const usize size) noexcept
+    {
+        const trace::Span span{ "net", "SendStream" };
+        if (!IsStreamable(header.type))
+            return Err{ ErrType::InvalidOperation, "A {} packet can't be streamed.", TypeToStr(header.type) };
+
+        Packet begin{ PacketType::StreamBegin };
+        begin << header.type << static_cast<u64>(size);
+        begin.header.tag = header.tag;
+        TRY_UNWRAP(BeginSend(socket, std::move(begin)));
+
+        // Every chunk gets a deadline of its own, a stream only fails once it stops making progress.
+        const PacketHeader chunk{ PacketType::StreamChunk, 0, header.tag, 0 };
+        for (usize sent = 0; sent < size; sent += StreamChunkSize)
         {
-            if (packet.header.dataLen > 0)
-            {
-                const auto res = Socket_Send(socket, reinterpret_cast<u8*>(packet.data.data()), packet.data.size(), 0);
-                if (res != CS_SOCKET_ERROR)
-                    return Ok();
+            const usize chunk_size = std::min<usize>(size - sent, StreamChunkSize);
+            TRY_UNWRAP(SendPayload(socket, chunk, data + sent, chunk_size, Clock::now() + Timeouts::Defaults().send));
+        }
+
+        Packet end{ PacketType::StreamEnd };
+        end.header.tag = header.tag;
+        return BeginSend(socket, std::move(end));
+    }
+
+    [[nodiscard]] Packet MakeReady(const NodeID node_id, const u8 flags, const u64 session_token) noexcept
+    {
+        Packet ready{ PacketType::Ready };
+        if (flags & ReadyFlags_Session)
+            ready << session_token;
+        ready << node_id << flags << ReadyVersion;
+        return ready;
+    }
+
+    [[nodiscard]] ValuedResult<ReadyInfo, Err> ParseReady(Packet&& packet) noexcept
+    {
+        ReadyInfo   info;
+        const usize size = packet.data.size();
+
+        // Legacy layouts, the node id optionally followed by the flags.
+        if (size == sizeof(u8) || size == sizeof(u8) * 2)
+        {
+            if (size == sizeof(u8) * 2)
+                packet >> info.flags;
+
+            u8 node_id;
+            packet >> node_id;
+            info.nodeId = node_id;
+            info.legacy = true;
+            return info;
+        }
+
+        if (size < sizeof(NodeID) + sizeof(u8) * 2)
+            return Err{ ErrType::NetBadPacket, "Malformed Ready packet of {} bytes.", size };
+
+        u8 version;
+        packet >> version;
+        if (version != ReadyVersion)
+            return Err{ ErrType::NetBadPacket, "Unsupported Ready version {}.", version };
+        packet >> info.flags >> info.nodeId;
+
+        const usize token_size = (info.flags & ReadyFlags_Session) ? sizeof(u64) : 0;
+        if (packet.data.size() != token_size)
+            return Err{ ErrType::NetBadPacket, "Malformed Ready packet of {} bytes.", size };
+        if (token_size)
+            packet >> info.sessionToken;
+        return info;
+    }
+
+    [[nodiscard]] ValuedResult<GroupID, Err> ParseGroupID(Packet&& packet) noexcept
+    {
+        switch (packet.data.size())
+        {
+            case sizeof(u8): {
+                u8 group_id;
+                packet >> group_id;
+                return static_cast<GroupID>(group_id);
             }
-            else
-                return Ok();
+            case sizeof(GroupID): {
+                GroupID group_id;
+                packet >> group_id;
+                return group_id;
+            }
+            case sizeof(i32): {
+                i32 group_id;
+                packet >> group_id;
+                if (group_id < 0 || group_id > MaxGroupID)
+                    return Err{ ErrType::InvalidOperation, "Group {} is out of range.", group_id };
+                return static_cast<GroupID>(group_id);
+            }
+            default: return Err{ ErrType::NetBadPacket, "Malformed group id of {} bytes.", packet.data.size() };
         }
-        return Err{ ErrType::NetWriteFailure };
     }
 
     [[nodiscard]] std::string_view TypeToStr(const PacketType type) noexcept
     {
+        // The type of a packet comes straight off the wire.
+        if (static_cast<usize>(type) >= PacketTypeCount)
+            return "Unknown";
         return s_PacketTypeStr[static_cast<u8>(type)];
     }
 
     [[nodiscard]] std::string_view TypeToStr(const Packet& packet) noexcept
     {
-        return s_PacketTypeStr[static_cast<u8>(packet.header.type)];
+        return TypeToStr(packet.header.type);
     }
 } // namespace pmgrd::net
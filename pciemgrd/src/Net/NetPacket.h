@@ -1,6 +1,7 @@
 #pragma once
 #include <CommonDef.h>
 
+#include <chrono>
 #include <cstring>
 #include <optional>
 #include <string>
@@ -10,6 +11,7 @@
 #include "CSSocket.h"
 
 #include <Core/Error.h>
+#include <Core/Ids.h>
 #include <Core/Result.h>
 
 /**
@@ -37,7 +39,72 @@ namespace pmgrd::net {
         GetCrewConfig, ///< Requests the crew station configuration.
         GetCtrConfig,  ///< Requests the concentrator configuration.
         Join,          ///< Packet indicating to join a multicast group.
-        Leave          ///< Packet indicating to leave a multicast group.
+        Leave,         ///< Packet indicating to leave a multicast group.
+        ConfigUpdate,  ///< Pushed by the RC to subscribed Endpoints when their configuration has changed.
+        NotModified,   ///< The configuration version sent by the Endpoint is still current.
+        Stats,         ///< Requests a snapshot of the RC's metrics, answered in the OpenMetrics text format.
+        Trace,         ///< Requests the RC's recorded spans, answered in the Chrome trace-event JSON format.
+        Replicate,     ///< Sent by a standby RC to follow the state of the RC, answered by a stream of Replication.
+        Replication,   ///< Batch of changes to the RC's state streamed to standby RCs, see @ref ReplicationRecord.
+        Ping,          ///< Sent by the RC to Endpoints with @ref ReadyFlags_Ping, carries the i64 time it left.
+        Pong,          ///< Answers a Ping with its time followed by the i64 times it arrived and the Pong left.
+        Clocks,        ///< Requests the RC's round-trip time and clock offset estimates of its Endpoints.
+        StreamBegin,   ///< Starts a packet sent in chunks, carries its u8 type followed by its u64 size.
+        StreamChunk,   ///< Next part of the payload of the packet being streamed, at most @ref StreamChunkSize.
+        StreamEnd,     ///< Completes the packet being streamed.
+        Config         ///< Answers a configuration request carrying a version, the configuration then its u64 version.
+    };
+
+    /**
+     * @brief Number of @ref PacketType s, must follow the last one.
+     * */
+    inline constexpr usize PacketTypeCount = static_cast<usize>(PacketType::Config) + 1;
+
+    /**
+     * @brief Optional flags an Endpoint can append to its @ref PacketType::Ready packet.
+     *
+     * @note Legacy Endpoints only send their node id, so their flags byte is only present when it is non-zero.
+     * */
+    enum ReadyFlags : u8
+    {
+        ReadyFlags_None      = 0,      ///< No flags.
+        ReadyFlags_Subscribe = 1 << 0, ///< Push @ref PacketType::ConfigUpdate packets whenever the config changes.
+        ReadyFlags_Session   = 1 << 1, ///< Open or resume a session, the Ready packet carries a session token.
+        ReadyFlags_Ping      = 1 << 2, ///< Answers @ref PacketType::Ping packets, see @ref ClockSync.
+        ReadyFlags_Stream    = 1 << 3, ///< Takes large packets in chunks, see @ref PacketType::StreamBegin.
+        ReadyFlags_Tags      = 1 << 4, ///< Matches replies by @ref PacketHeader::tag once the RC acknowledged it.
+    };
+
+    /**
+     * @brief The @ref ReadyFlags this RC honours, acknowledged to Endpoints announcing @ref ReadyFlags_Tags.
+     * */
+    inline constexpr u8 ReadyFlags_Supported =
+        ReadyFlags_Subscribe | ReadyFlags_Session | ReadyFlags_Ping | ReadyFlags_Stream | ReadyFlags_Tags;
+
+    /**
+     * @brief Trailing byte of a versioned @ref PacketType::Ready packet.
+     *
+     * @details A versioned Ready packet carries the @ref NodeID, the @ref ReadyFlags and this version in that
+     * order, preceded by a u64 session token with @ref ReadyFlags_Session. Legacy Endpoints send a single byte
+     * node id optionally followed by the flags, since their payload is never longer than two bytes both layouts
+     * can be told apart by size alone.
+     *
+     * The RC acknowledges a Ready packet with @ref PacketType::Ok, which carries the session token followed by
+     * a byte telling whether the session was resumed when @ref ReadyFlags_Session was set. When
+     * @ref ReadyFlags_Tags was set it is followed by the announced flags the RC honours, which RCs predating tags
+     * don't send.
+     * */
+    inline constexpr u8 ReadyVersion = 2;
+
+    /**
+     * @brief What an Endpoint announced in its @ref PacketType::Ready packet.
+     * */
+    struct ReadyInfo
+    {
+        NodeID nodeId       = 0;               ///< The node id of the Endpoint.
+        u8     flags        = ReadyFlags_None; ///< @ref ReadyFlags of the Endpoint.
+        u64    sessionToken = 0;               ///< The session to resume, 0 to open a new one.
+        bool   legacy       = false;           ///< Whether the Endpoint sent the unversioned, single byte id layout.
     };
 
     /**
@@ -49,12 +116,52 @@ namespace pmgrd::net {
      * After receiving the packet header, the receiving side then decodes the packet to determine how many bytes
      * is the payload.
      * The bytes coming after a @ref PacketHeader is guaranteed to be the payload itself.
+     *
+     * A request may carry a non-zero @ref tag which the RC echoes in its reply, letting a client keep several
+     * requests in flight on one connection. The tag used to be padding which older peers may have left
+     * uninitialised, so a client only trusts it once the RC acknowledged @ref ReadyFlags_Tags, and otherwise
+     * takes the replies in order.
      * */
     struct PacketHeader
     {
-        PacketType type    = PacketType::NoOp;
-        u32        dataLen = 0;
+        PacketType type     = PacketType::NoOp;
+        u8         reserved = 0;
+        u16        tag      = 0; ///< Matches a reply to its request, 0 for untagged requests and pushes.
+        u32        dataLen  = 0;
     };
+    static_assert(sizeof(PacketHeader) == 8, "PacketHeader is part of the wire format.");
+
+    /**
+     * @brief Largest payload a single packet may carry.
+     *
+     * @details A header advertising more is rejected before anything is allocated for it, packets that don't fit
+     * are streamed instead, see @ref PacketType::StreamBegin. A streamed packet is only reassembled up to this size
+     * as well, larger ones have to be consumed as their chunks arrive.
+     * */
+    inline constexpr u32 MaxPacketSize = 16 * 1024 * 1024;
+
+    /**
+     * @brief Payload size of a @ref PacketType::StreamChunk, and the size from which a packet is streamed.
+     * */
+    inline constexpr u32 StreamChunkSize = 64 * 1024;
+
+    /**
+     * @brief Whether packets of @p type may be streamed, the replies and pushes that can grow large. A stream
+     * announcing any other type is refused.
+     * */
+    [[nodiscard]] constexpr bool IsStreamable(const PacketType type) noexcept
+    {
+        switch (type)
+        {
+            case PacketType::String:
+            case PacketType::Config:
+            case PacketType::ConfigUpdate:
+            case PacketType::Stats:
+            case PacketType::Trace:
+            case PacketType::Clocks: return true;
+            default: return false;
+        }
+    }
 
     /**
      * @brief The packet iself. Contains the packet header (@see PacketHeader) and the data.
@@ -75,7 +182,7 @@ namespace pmgrd::net {
             : data(std::move(data))
         {
             header.type    = type;
-            header.dataLen = data.size();
+            header.dataLen = this->data.size();
         }
         constexpr Packet(const PacketType type, const std::string_view str) noexcept
         {
@@ -114,7 +221,7 @@ namespace pmgrd::net {
         [[nodiscard]] PacketType Type() const noexcept { return header.type; }
         [[nodiscard]] u8*        Data() noexcept { return data.data(); }
         [[nodiscard]] const u8*  Data() const noexcept { return data.data(); }
-        [[nodiscard]] u8         Size() const noexcept { return data.size(); }
+        [[nodiscard]] u32        Size() const noexcept { return static_cast<u32>(data.size()); }
         [[nodiscard]] constexpr  operator bool() const noexcept { return Type() != PacketType::Err; }
 
     public:
@@ -195,23 +302,124 @@ namespace pmgrd::net {
         [[nodiscard]] static inline Packet Ok() noexcept { return Packet{ PacketType::Ok }; }
     };
 
+    /**
+     * @brief Builds the versioned @ref PacketType::Ready packet.
+     *
+     * @param session_token The session to resume, only sent with @ref ReadyFlags_Session.
+     * */
+    [[nodiscard]] Packet MakeReady(const NodeID node_id, const u8 flags, const u64 session_token = 0) noexcept;
+
+    /**
+     * @brief Decodes a @ref PacketType::Ready packet of either layout, see @ref ReadyVersion.
+     *
+     * @returns @ref ValuedResult of @ref ReadyInfo or @ref Err if the payload matches neither layout.
+     * */
+    [[nodiscard]] ValuedResult<ReadyInfo, Err> ParseReady(Packet&& packet) noexcept;
+
+    /**
+     * @brief Decodes the group id of a @ref PacketType::Join or @ref PacketType::Leave packet.
+     *
+     * @details Current Endpoints send a @ref GroupID. Older ones sent either a single byte or, from the CLI, an
+     * i32, both are still accepted.
+     *
+     * @returns @ref ValuedResult of @ref GroupID or @ref Err if the payload is malformed or out of range.
+     * */
+    [[nodiscard]] ValuedResult<GroupID, Err> ParseGroupID(Packet&& packet) noexcept;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Point in time after which a network operation fails with @ref ErrType::Timeout.
+     * */
+    using Deadline = Clock::time_point;
+
+    /**
+     * @brief Waits as long as it takes.
+     * */
+    inline constexpr Deadline NoDeadline = Deadline::max();
+
+    /**
+     * @brief How long each kind of network operation may take before it fails with @ref ErrType::Timeout.
+     * */
+    struct Timeouts
+    {
+        std::chrono::milliseconds connect = std::chrono::milliseconds{ 3000 }; ///< Establishing a connection.
+        std::chrono::milliseconds send    = std::chrono::milliseconds{ 5000 }; ///< Getting a packet out.
+        std::chrono::milliseconds receive = std::chrono::milliseconds{ 5000 }; ///< A reply, or the rest of a packet.
+
+    public:
+        /**
+         * @brief The defaults of the process, only to be changed on startup before any connection is made.
+         * */
+        [[nodiscard]] static Timeouts& Defaults() noexcept;
+
+        /**
+         * @brief Parses either a number of milliseconds applying to every operation, or a comma separated list of
+         * connect, send or receive followed by a colon and a number of milliseconds, e.g. "connect:500,receive:2000".
+         *
+         * @returns @ref ValuedResult of @ref Timeouts, starting from @p base, or @ref Err if @p spec is malformed.
+         * */
+        [[nodiscard]] static ValuedResult<Timeouts, Err> Parse(const std::string_view spec,
+                                                               const Timeouts&        base) noexcept;
+    };
+
+    /**
+     * @brief Looks up the named socket profile, see @ref SocketOptions_FromProfile.
+     *
+     * @returns @ref ValuedResult of @ref SocketOptions or @ref Err if there's no such profile.
+     * */
+    [[nodiscard]] ValuedResult<SocketOptions, Err> SocketProfile(const std::string_view name) noexcept;
+
+    /**
+     * @brief Applies @p options to @p socket, see @ref Socket_SetOptions.
+     *
+     * @returns @ref Result of @ref Err, the connection is still usable if an option failed to apply.
+     * */
+    [[nodiscard]] Result<Err> SetSocketOptions(csnet::Socket* socket, const SocketOptions& options) noexcept;
+
     /**
      * @brief Utility function for receiving @ref Packet s.
      *
+     * @details Waiting for a packet to start coming in is bounded by @p deadline, once its first byte arrived the
+     * rest of it has to arrive within @ref Timeouts::receive. A socket whose peer stalls in the middle of a packet
+     * or announces a payload larger than @ref MaxPacketSize can't be read from anymore and is disconnected.
+     * Streamed packets arrive as their @ref PacketType::StreamBegin, see @ref ReceiveStream.
+     *
      * @returns @ref ValuedResult of @ref Packet or @ref Err.
      * The packet failed to be retrieved, then an @see Err is returned,
      * otherwise @ref Packet is returned.
      * */
-    ValuedResult<Packet, Err> BeginReceive(csnet::Socket* socket) noexcept;
+    ValuedResult<Packet, Err> BeginReceive(csnet::Socket* socket, const Deadline deadline = NoDeadline) noexcept;
 
     /**
      * @brief Utility function for sending @ref Packet s.
      *
+     * @details The header and payload go out in a single write. A peer that doesn't take all of it by
+     * @p deadline is disconnected, since part of the packet may already be on its way. Payloads larger than
+     * @ref MaxPacketSize are refused, they have to go through @ref SendStream.
+     *
      * @returns @ref Result of @ref Err.
      * The packet failed to be sent, then an @see Err is returned.
      * */
+    Result<Err> BeginSend(csnet::Socket* socket, Packet&& packet, const Deadline deadline) noexcept;
+
+    /**
+     * @brief Sends @p packet within @ref Timeouts::send, see @ref BeginSend.
+     * */
     Result<Err> BeginSend(csnet::Socket* socket, Packet&& packet) noexcept;
 
+    /**
+     * @brief Sends the @p size bytes at @p data as the payload of a packet of the type and tag of @p header, in
+     * chunks of at most @ref StreamChunkSize, see @ref PacketStream.
+     *
+     * @details Every chunk has @ref Timeouts::send to go out. The peer must have announced @ref ReadyFlags_Stream
+     * and nothing else may be sent to it until the stream ended.
+     *
+     * @returns @ref Result of @ref Err, which is also returned if @p header isn't of a type @ref IsStreamable.
+     * */
+    Result<Err> SendStream(csnet::Socket* socket, const PacketHeader& header, const u8* data,
+                           const usize size) noexcept;
+
     /**
      * @brief Utility function for retriving the string representation
      * of a packet type.
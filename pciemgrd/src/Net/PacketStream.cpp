@@ -0,0 +1,123 @@
+#include "PacketStream.h"
+
+namespace pmgrd::net {
+    PacketStream::PacketStream() noexcept
+        : m_Header{}
+        , m_Size(0)
+        , m_Received(0)
+        , m_Active(false)
+    {
+    }
+
+    [[nodiscard]] Result<Err> PacketStream::Begin(Packet&& begin, ChunkDelegate on_chunk) noexcept
+    {
+        if (begin.Type() != PacketType::StreamBegin || begin.data.size() != sizeof(u8) + sizeof(u64))
+            return Err{ ErrType::NetBadPacket, "Malformed {} packet of {} bytes.", TypeToStr(begin),
+                        begin.data.size() };
+
+        u64 size;
+        u8  type;
+        begin >> size >> type;
+        if (type >= PacketTypeCount || !IsStreamable(static_cast<PacketType>(type)))
+            return Err{ ErrType::NetBadPacket, "A packet of type {} can't be streamed.", type };
+        if (!on_chunk && size > MaxPacketSize)
+            return Err{ ErrType::NetBadPacket, "A streamed {} packet of {} bytes exceeds the limit of {} bytes.",
+                        TypeToStr(static_cast<PacketType>(type)), size, MaxPacketSize };
+
+        m_Header   = PacketHeader{ static_cast<PacketType>(type), 0, begin.header.tag, 0 };
+        m_Size     = size;
+        m_Received = 0;
+        m_OnChunk  = std::move(on_chunk);
+        m_Active   = true;
+        m_Data.clear();
+
+        // Announcing a reassembled stream commits no more memory than a single packet could.
+        if (!m_OnChunk)
+            m_Data.reserve(size);
+        return Ok();
+    }
+
+    [[nodiscard]] ValuedResult<bool, Err> PacketStream::Feed(Packet&& packet) noexcept
+    {
+        if (!m_Active)
+            return Err{ ErrType::InvalidState, "A {} packet arrived outside of a stream.", TypeToStr(packet) };
+        if (packet.header.tag != m_Header.tag)
+            return Err{ ErrType::NetBadPacket, "The {} stream of tag {} was interrupted by a packet of tag {}.",
+                        TypeToStr(m_Header.type), m_Header.tag, packet.header.tag };
+
+        switch (packet.Type())
+        {
+            case PacketType::StreamChunk: {
+                const usize size = packet.data.size();
+                if (m_Received + size > m_Size)
+                    return Err{ ErrType::NetBadPacket, "The {} stream brought more than the {} bytes announced.",
+                                TypeToStr(m_Header.type), m_Size };
+
+                m_Received += size;
+                if (!m_OnChunk)
+                {
+                    m_Data.insert(m_Data.end(), packet.data.begin(), packet.data.end());
+                    return false;
+                }
+                TRY_UNWRAP(m_OnChunk(packet.Data(), size));
+                return false;
+            }
+            case PacketType::StreamEnd: {
+                if (m_Received != m_Size)
+                    return Err{ ErrType::NetBadPacket, "The {} stream ended after {} of the {} bytes announced.",
+                                TypeToStr(m_Header.type), m_Received, m_Size };
+                return true;
+            }
+            default:
+                return Err{ ErrType::NetBadPacket, "The {} stream was interrupted by a {} packet.",
+                            TypeToStr(m_Header.type), TypeToStr(packet) };
+        }
+    }
+
+    [[nodiscard]] Packet PacketStream::Take() noexcept
+    {
+        Packet packet{ m_Header.type };
+        packet.header.tag     = m_Header.tag;
+        packet.data           = std::move(m_Data);
+        packet.header.dataLen = static_cast<u32>(packet.data.size());
+
+        m_OnChunk = {};
+        m_Active  = false;
+        m_Data.clear();
+        return packet;
+    }
+
+    void PacketStream::Discard() noexcept
+    {
+        m_OnChunk = [](const u8*, const usize) -> Result<Err> { return Ok(); };
+    }
+
+    [[nodiscard]] ValuedResult<Packet, Err> ReceiveStream(csnet::Socket* socket, Packet&& begin,
+                                                          ChunkDelegate on_chunk) noexcept
+    {
+        // Whatever remains of a stream that can't be followed would be taken for packets, as BeginReceive does.
+        const auto disconnect = [socket](Err err) -> Err
+        {
+            socket->connected = false;
+            Socket_Shutdown(socket, CS_SD_BOTH);
+            return err;
+        };
+
+        PacketStream stream;
+        if (auto begun = stream.Begin(std::move(begin), std::move(on_chunk)); !begun)
+            return disconnect(begun.UnwrapErr());
+
+        while (true)
+        {
+            auto packet = BeginReceive(socket, Clock::now() + Timeouts::Defaults().receive);
+            if (!packet)
+                return disconnect(packet.UnwrapErr());
+
+            const auto done = stream.Feed(packet.Unwrap());
+            if (!done)
+                return disconnect(done.UnwrapErr());
+            if (done.Unwrap())
+                return stream.Take();
+        }
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <functional>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Net/NetPacket.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief Consumes the payload of a streamed packet as its chunks arrive, an @ref Err aborts the stream.
+     * */
+    using ChunkDelegate = std::function<Result<Err>(const u8* data, const usize size)>;
+
+    /**
+     * @brief Receiving end of a packet sent with @ref SendStream.
+     *
+     * @details A stream is made of a @ref PacketType::StreamBegin packet announcing the type and size of the
+     * packet, the @ref PacketType::StreamChunk packets carrying its payload and a @ref PacketType::StreamEnd packet,
+     * all tagged like the packet. The chunks are either handed to a @ref ChunkDelegate as they arrive, which keeps
+     * the memory needed down to a single chunk and bounds nothing else, or reassembled into the packet, which can't
+     * grow past @ref MaxPacketSize like any other packet. A peer streams one packet at a time, nothing else arrives
+     * on the connection until the stream ended.
+     *
+     * @note Not thread-safe.
+     * */
+    class PacketStream
+    {
+    private:
+        PacketHeader    m_Header;
+        u64             m_Size;
+        u64             m_Received;
+        ChunkDelegate   m_OnChunk;
+        std::vector<u8> m_Data;
+        bool            m_Active;
+
+    public:
+        PacketStream() noexcept;
+
+    public:
+        /**
+         * @brief Starts receiving the stream announced by @p begin, handing its chunks to @p on_chunk if any.
+         *
+         * @returns @ref Result of @ref Err if @p begin is malformed, announces a type that isn't
+         * @ref IsStreamable, or more than @ref MaxPacketSize without a @p on_chunk to take it.
+         * */
+        [[nodiscard]] Result<Err> Begin(Packet&& begin, ChunkDelegate on_chunk = {}) noexcept;
+
+        /**
+         * @brief Adds the next @ref PacketType::StreamChunk or @ref PacketType::StreamEnd packet of the stream.
+         *
+         * @returns @ref ValuedResult of whether the stream ended, or @ref Err if @p packet doesn't belong to the
+         * stream, brings more than was announced or was refused by the @ref ChunkDelegate.
+         * */
+        [[nodiscard]] ValuedResult<bool, Err> Feed(Packet&& packet) noexcept;
+
+        /**
+         * @brief The streamed packet, without payload if it went to the @ref ChunkDelegate. Ends the stream.
+         * */
+        [[nodiscard]] Packet Take() noexcept;
+
+        /**
+         * @brief Drops the rest of the stream instead of handing it to the @ref ChunkDelegate, e.g. once whoever
+         * it belonged to stopped waiting for it.
+         * */
+        void Discard() noexcept;
+
+        [[nodiscard]] bool                IsActive() const noexcept { return m_Active; }
+        [[nodiscard]] const PacketHeader& Header() const noexcept { return m_Header; }
+    };
+
+    /**
+     * @brief Receives the rest of the stream started by @p begin, see @ref PacketStream.
+     *
+     * @details Every packet of the stream has to arrive within @ref Timeouts::receive of the previous one. A stream
+     * that can't be followed to its end leaves the connection unusable, which is disconnected.
+     *
+     * @returns @ref ValuedResult of the streamed @ref Packet or @ref Err.
+     * */
+    [[nodiscard]] ValuedResult<Packet, Err> ReceiveStream(csnet::Socket* socket, Packet&& begin,
+                                                          ChunkDelegate on_chunk = {}) noexcept;
+} // namespace pmgrd::net
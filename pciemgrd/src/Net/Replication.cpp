@@ -0,0 +1,437 @@
+#include "Replication.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+
+#include <Core/Tracer.h>
+
+namespace pmgrd::net {
+    namespace {
+        /**
+         * @brief Size of the fields every record starts with, the op and when it was published.
+         * */
+        constexpr usize RecordHeaderSize = sizeof(u8) + sizeof(u64);
+
+        [[nodiscard]] u64 NowSinceEpoch() noexcept
+        {
+            return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::system_clock::now().time_since_epoch())
+                                        .count());
+        }
+
+        [[nodiscard]] usize RecordBodySize(const ReplicationOp op) noexcept
+        {
+            switch (op)
+            {
+                case ReplicationOp::Join:
+                case ReplicationOp::Leave: return sizeof(GroupID) + sizeof(NodeID);
+                case ReplicationOp::SessionUpsert: return sizeof(u64) + sizeof(NodeID) + sizeof(u8) * 2 + sizeof(u64);
+                case ReplicationOp::SessionDrop: return sizeof(u64);
+                default: return 0;
+            }
+        }
+    } // namespace
+
+    [[nodiscard]] ReplicationRecord ReplicationRecord::Marker(const ReplicationOp op) noexcept
+    {
+        ReplicationRecord record;
+        record.op          = op;
+        record.publishedAt = NowSinceEpoch();
+        return record;
+    }
+
+    [[nodiscard]] ReplicationRecord ReplicationRecord::Group(const ReplicationOp op, const GroupID group_id,
+                                                             const NodeID node_id) noexcept
+    {
+        auto record    = ReplicationRecord::Marker(op);
+        record.groupId = group_id;
+        record.nodeId  = node_id;
+        return record;
+    }
+
+    [[nodiscard]] ReplicationRecord ReplicationRecord::Session(const u64 token, const SessionState* state) noexcept
+    {
+        auto record = ReplicationRecord::Marker((state) ? ReplicationOp::SessionUpsert : ReplicationOp::SessionDrop);
+        record.sessionToken = token;
+        if (state)
+            record.session = *state;
+        return record;
+    }
+
+    void EncodeRecord(Packet& packet, const ReplicationRecord& record) noexcept
+    {
+        switch (record.op)
+        {
+            case ReplicationOp::Join:
+            case ReplicationOp::Leave: packet << record.groupId << record.nodeId; break;
+            case ReplicationOp::SessionUpsert:
+                packet << record.sessionToken << record.session.nodeId << static_cast<u8>(record.session.subscribed)
+                       << static_cast<u8>(record.session.configKind) << record.session.configVersion;
+                break;
+            case ReplicationOp::SessionDrop: packet << record.sessionToken; break;
+            default: break;
+        }
+        packet << record.publishedAt << static_cast<u8>(record.op);
+    }
+
+    [[nodiscard]] ValuedResult<std::vector<ReplicationRecord>, Err> DecodeRecords(Packet&& packet) noexcept
+    {
+        // Records are popped from the back, last one first.
+        std::vector<ReplicationRecord> records;
+        while (!packet.data.empty())
+        {
+            if (packet.data.size() < RecordHeaderSize)
+                return Err{ ErrType::NetBadPacket, "Truncated replication record." };
+
+            ReplicationRecord record;
+            u8                op;
+            packet >> op >> record.publishedAt;
+            if (op > static_cast<u8>(ReplicationOp::SnapshotEnd))
+                return Err{ ErrType::NetBadPacket, "Unknown replication op {}.", op };
+            record.op = static_cast<ReplicationOp>(op);
+
+            if (packet.data.size() < RecordBodySize(record.op))
+                return Err{ ErrType::NetBadPacket, "Truncated replication record." };
+
+            switch (record.op)
+            {
+                case ReplicationOp::Join:
+                case ReplicationOp::Leave: packet >> record.nodeId >> record.groupId; break;
+                case ReplicationOp::SessionUpsert: {
+                    u8 kind, subscribed;
+                    packet >> record.session.configVersion >> kind >> subscribed >> record.session.nodeId >>
+                        record.sessionToken;
+                    record.session.configKind = static_cast<ConfigKind>(kind);
+                    record.session.subscribed = subscribed;
+                    break;
+                }
+                case ReplicationOp::SessionDrop: packet >> record.sessionToken; break;
+                default: break;
+            }
+            records.push_back(record);
+        }
+
+        std::reverse(records.begin(), records.end());
+        return records;
+    }
+
+    ReplicationMetrics::ReplicationMetrics(MetricsRegistry& registry)
+        : standbys(registry.AddGauge("pmgrd_standbys", "Standby RCs following this RC."))
+        , recordsSent(registry.AddCounter("pmgrd_replication_records_sent", "Replication records sent to standbys."))
+        , recordsApplied(registry.AddCounter("pmgrd_replication_records_applied",
+                                             "Replication records applied while standing by."))
+        , lag(registry.AddHistogram("pmgrd_replication_lag_seconds",
+                                    "Time from a change being published by the primary until applied by the standby."))
+        , failover(registry.AddHistogram("pmgrd_failover_seconds",
+                                         "Time from the primary last being heard from until the standby listens."))
+        , failovers(registry.AddCounter("pmgrd_failovers", "Times this RC took over from its primary."))
+    {
+    }
+
+    ReplicationPublisher::ReplicationPublisher(Logger& logger, ReplicationMetrics& metrics)
+        : m_Logger(logger)
+        , m_Metrics(metrics)
+        , m_Run(false)
+    {
+    }
+
+    ReplicationPublisher::~ReplicationPublisher() noexcept
+    {
+        Stop();
+    }
+
+    void ReplicationPublisher::Start() noexcept
+    {
+        if (m_Thread.joinable())
+            return;
+
+        m_Run    = true;
+        m_Thread = std::thread{ &ReplicationPublisher::ThreadHandler, this };
+    }
+
+    void ReplicationPublisher::Stop() noexcept
+    {
+        {
+            std::scoped_lock lock{ m_Mutex };
+            m_Run = false;
+        }
+        m_CV.notify_all();
+
+        if (m_Thread.joinable())
+            m_Thread.join();
+    }
+
+    void ReplicationPublisher::Attach(std::shared_ptr<Endpoint>      endpoint,
+                                      std::vector<ReplicationRecord> snapshot) noexcept
+    {
+        {
+            std::scoped_lock lock{ m_Mutex };
+            m_Standbys.push_back(Standby{ std::move(endpoint), std::move(snapshot), Clock::now() });
+            m_Metrics.standbys.Set(static_cast<i64>(m_Standbys.size()));
+        }
+        m_CV.notify_all();
+    }
+
+    void ReplicationPublisher::Publish(const ReplicationRecord& record) noexcept
+    {
+        {
+            std::scoped_lock lock{ m_Mutex };
+            if (m_Standbys.empty())
+                return;
+
+            for (auto& standby : m_Standbys)
+                standby.pending.push_back(record);
+        }
+        m_CV.notify_all();
+    }
+
+    void ReplicationPublisher::ThreadHandler() noexcept
+    {
+        trace::Tracer::Get().SetThreadName("Replication");
+
+        struct Batch
+        {
+            std::shared_ptr<Endpoint>      endpoint;
+            std::vector<ReplicationRecord> records;
+        };
+
+        std::vector<Batch> batches;
+        std::unique_lock   lock{ m_Mutex };
+        while (m_Run)
+        {
+            m_CV.wait_for(lock, ReplicationPublisher::HeartbeatInterval,
+                          [this]()
+                          {
+                              return !m_Run || std::any_of(m_Standbys.begin(), m_Standbys.end(),
+                                                           [](const Standby& s) { return !s.pending.empty(); });
+                          });
+
+            // Take the pending records and send them outside the lock, publishing never waits on the network.
+            const auto now = Clock::now();
+            for (auto& standby : m_Standbys)
+            {
+                if (standby.pending.empty() && now - standby.lastSent < ReplicationPublisher::HeartbeatInterval)
+                    continue;
+
+                if (standby.pending.empty())
+                    standby.pending.push_back(ReplicationRecord::Marker(ReplicationOp::Heartbeat));
+                batches.push_back(Batch{ standby.endpoint, std::move(standby.pending) });
+                standby.pending  = {};
+                standby.lastSent = now;
+            }
+            lock.unlock();
+
+            std::vector<Endpoint*> failed;
+            for (auto& [endpoint, records] : batches)
+            {
+                for (usize begin = 0; begin < records.size(); begin += ReplicationPublisher::MaxBatchRecords)
+                {
+                    const usize end = std::min(records.size(), begin + ReplicationPublisher::MaxBatchRecords);
+                    Packet      packet{ PacketType::Replication };
+                    for (usize i = begin; i < end; ++i)
+                        EncodeRecord(packet, records[i]);
+
+                    if (!endpoint->Send(std::move(packet)))
+                    {
+                        failed.push_back(endpoint.get());
+                        break;
+                    }
+                    m_Metrics.recordsSent.Add(end - begin);
+                }
+            }
+            batches.clear();
+
+            lock.lock();
+            if (!failed.empty())
+            {
+                std::erase_if(m_Standbys,
+                              [this, &failed](const Standby& standby)
+                              {
+                                  if (std::find(failed.begin(), failed.end(), standby.endpoint.get()) == failed.end())
+                                      return false;
+
+                                  m_Logger.Log(lgx::Level::Warn, "Standby ({}:{}) went away.",
+                                               standby.endpoint->GetSocket()->remote_ep.address.str,
+                                               standby.endpoint->GetSocket()->remote_ep.port);
+                                  return true;
+                              });
+                m_Metrics.standbys.Set(static_cast<i64>(m_Standbys.size()));
+            }
+        }
+
+        m_Standbys.clear();
+        m_Metrics.standbys.Set(0);
+    }
+
+    ReplicationFollower::ReplicationFollower(Logger& logger, ReplicationMetrics& metrics)
+        : m_Logger(logger)
+        , m_Metrics(metrics)
+    {
+    }
+
+    void ReplicationFollower::Follow(const std::string_view address, const u16 port) noexcept
+    {
+        const std::string addr{ address };
+        const auto primary = IPEndPoint_New(IPAddress_Parse(addr.c_str()), AddressFamily_InterNetwork, port);
+
+        // There's nothing to take over before the primary has been followed, wait for it to come up.
+        Socket* socket = nullptr;
+        while (true)
+        {
+            socket = Socket_New(AddressFamily_InterNetwork, SocketType_Stream, ProtocolType_Tcp);
+            if (const auto result = Attach(socket, primary, Timeouts::Defaults()); result)
+                break;
+            else
+            {
+                const auto err = result.UnwrapErr();
+                PMGRD_LOG_LIMITED(m_Logger, Info, "Waiting for the primary RC at ({}:{}).\n\t{}", addr, port, err);
+            }
+
+            Socket_Dispose(socket);
+            std::this_thread::sleep_for(ReplicationFollower::RetryInterval);
+        }
+
+        m_Logger.Log(lgx::Level::Info, "Following the primary RC at ({}:{}).", addr, port);
+        m_LastHeard = Clock::now();
+        while (socket)
+        {
+            if (const auto result = Stream(socket); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Error, "Discarded a corrupt batch from the primary RC.\n\t{}", err);
+            }
+            Socket_Dispose(socket);
+
+            // The snapshot sent on attaching replaces whatever the lost connection left half applied.
+            socket = Reattach(primary);
+            if (socket)
+                m_Logger.Log(lgx::Level::Info, "Following the primary RC at ({}:{}) again.", addr, port);
+        }
+    }
+
+    Socket* ReplicationFollower::Reattach(const IPEndPoint& primary) noexcept
+    {
+        const Timeouts probe{ ReplicationFollower::ProbeTimeout, ReplicationFollower::ProbeTimeout,
+                              ReplicationFollower::ProbeTimeout };
+        for (u32 attempt = 1; attempt <= ReplicationFollower::ReattachAttempts; ++attempt)
+        {
+            auto* socket = Socket_New(AddressFamily_InterNetwork, SocketType_Stream, ProtocolType_Tcp);
+            if (const auto result = Attach(socket, primary, probe); result)
+            {
+                m_LastHeard = Clock::now();
+                return socket;
+            }
+            else
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Warn, "Probe {}/{} of the primary RC failed.\n\t{}", attempt,
+                             ReplicationFollower::ReattachAttempts, err);
+            }
+
+            Socket_Dispose(socket);
+            std::this_thread::sleep_for(ReplicationFollower::ReattachInterval);
+        }
+        return nullptr;
+    }
+
+    Result<Err> ReplicationFollower::Attach(Socket* socket, const IPEndPoint& primary,
+                                            const Timeouts& timeouts) noexcept
+    {
+        if (!socket)
+            return Err{ ErrType::NetSocketError, "Failed to create a socket for the primary RC." };
+
+        // Buffers have to be sized before connecting to count towards the window scale.
+        if (const auto applied = SetSocketOptions(socket, SocketProfile(CS_PROFILE_BULK_CONFIG).Unwrap()); !applied)
+        {
+            const auto err = applied.UnwrapErr();
+            PMGRD_LOG_LIMITED(m_Logger, Warn, "Following the primary RC with the default socket options.\n\t{}", err);
+        }
+
+        socket->timeout = static_cast<u16>(std::min<i64>(timeouts.connect.count(), UINT16_MAX));
+        if (Socket_Connect(socket, primary) == CS_SOCKET_ERROR)
+            return Err{ ErrType::NetConnectionTimeout, "Failed to connect to the primary RC: {}",
+                        std::strerror(errno) };
+
+        // Standbys aren't nodes, they register as node 0 without subscribing.
+        TRY_UNWRAP(BeginSend(socket, MakeReady(0, ReadyFlags_None)));
+        const auto ack = BeginReceive(socket, Clock::now() + timeouts.receive);
+        if (!ack || ack.Unwrap().Type() != PacketType::Ok)
+            return Err{ ErrType::NetReadyFailure };
+
+        return BeginSend(socket, Packet{ PacketType::Replicate });
+    }
+
+    Result<Err> ReplicationFollower::Stream(Socket* socket) noexcept
+    {
+        const auto timeout_ms = static_cast<i32>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(ReplicationFollower::Timeout).count());
+
+        pollfd pfd{};
+        pfd.fd     = static_cast<i32>(socket->_native_handle);
+        pfd.events = POLLIN;
+        while (true)
+        {
+            const i32 ready = poll(&pfd, 1, timeout_ms);
+            if (ready == -1 && errno == EINTR)
+                continue;
+            if (ready == 0)
+            {
+                m_Logger.Log(lgx::Level::Warn, "The primary RC has been silent for {} ms.", timeout_ms);
+                return Ok();
+            }
+
+            auto packet = BeginReceive(socket);
+            if (ready == -1 || !packet)
+            {
+                m_Logger.Log(lgx::Level::Warn, "Lost the connection to the primary RC.");
+                return Ok();
+            }
+            m_LastHeard = Clock::now();
+
+            auto received = packet.Unwrap();
+            if (received.Type() != PacketType::Replication)
+            {
+                PMGRD_LOG_LIMITED(m_Logger, Warn, "Ignoring a {} packet from the primary RC.", TypeToStr(received));
+                continue;
+            }
+
+            auto records = DecodeRecords(std::move(received));
+            if (!records)
+                return records.UnwrapErr();
+
+            const trace::Span span{ "replication", "Apply" };
+            for (const auto& record : records.Unwrap())
+                Apply(record);
+        }
+    }
+
+    void ReplicationFollower::Apply(const ReplicationRecord& record) noexcept
+    {
+        const u64 now = NowSinceEpoch();
+        m_Metrics.lag.Record((now > record.publishedAt) ? now - record.publishedAt : 0);
+
+        switch (record.op)
+        {
+            case ReplicationOp::Heartbeat: return;
+            case ReplicationOp::Join: m_State.groups[record.groupId].insert(record.nodeId); break;
+            case ReplicationOp::Leave: {
+                const auto it = m_State.groups.find(record.groupId);
+                if (it != m_State.groups.end() && it->second.erase(record.nodeId) && it->second.empty())
+                    m_State.groups.erase(it);
+                break;
+            }
+            case ReplicationOp::SessionUpsert: m_State.sessions[record.sessionToken] = record.session; break;
+            case ReplicationOp::SessionDrop: m_State.sessions.erase(record.sessionToken); break;
+            case ReplicationOp::SnapshotBegin: m_State = State{}; break;
+            case ReplicationOp::SnapshotEnd:
+                m_State.synced = true;
+                m_Logger.Log(lgx::Level::Info, "In sync with the primary RC, {} group(s) and {} session(s).",
+                             m_State.groups.size(), m_State.sessions.size());
+                break;
+        }
+        m_Metrics.recordsApplied.Add();
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Core/Error.h>
+#include <Core/Histogram.h>
+#include <Core/Ids.h>
+#include <Core/Metrics.h>
+#include <Core/Result.h>
+#include <Endpoint/Endpoint.h>
+#include <Log/Logger.h>
+#include <Net/NetPacket.h>
+#include <Net/SessionTable.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief What a @ref ReplicationRecord changes.
+     * */
+    enum class ReplicationOp : u8
+    {
+        Heartbeat,     ///< Nothing changed, the primary is alive.
+        Join,          ///< A node joined a group.
+        Leave,         ///< A node left a group.
+        SessionUpsert, ///< A session was opened or its state changed.
+        SessionDrop,   ///< A session expired.
+        SnapshotBegin, ///< The records up to @ref SnapshotEnd replace the whole state.
+        SnapshotEnd,   ///< The standby is in sync with the primary.
+    };
+
+    /**
+     * @brief A single change to the state a standby RC takes over, carried by @ref PacketType::Replication.
+     * */
+    struct ReplicationRecord
+    {
+        ReplicationOp op           = ReplicationOp::Heartbeat;
+        u64           publishedAt  = 0; ///< When the change was published, in ns since the epoch.
+        GroupID       groupId      = 0;
+        NodeID        nodeId       = 0;
+        u64           sessionToken = 0;
+        SessionState  session;
+
+    public:
+        [[nodiscard]] static ReplicationRecord Marker(const ReplicationOp op) noexcept;
+        [[nodiscard]] static ReplicationRecord Group(const ReplicationOp op, const GroupID group_id,
+                                                     const NodeID node_id) noexcept;
+
+        /**
+         * @returns A @ref ReplicationOp::SessionUpsert record, or a @ref ReplicationOp::SessionDrop one if
+         * @p state is nullptr.
+         * */
+        [[nodiscard]] static ReplicationRecord Session(const u64 token, const SessionState* state) noexcept;
+    };
+
+    /**
+     * @brief Appends @p record to a @ref PacketType::Replication packet.
+     * */
+    void EncodeRecord(Packet& packet, const ReplicationRecord& record) noexcept;
+
+    /**
+     * @brief Decodes every record of a @ref PacketType::Replication packet in the order they were encoded.
+     * */
+    [[nodiscard]] ValuedResult<std::vector<ReplicationRecord>, Err> DecodeRecords(Packet&& packet) noexcept;
+
+    /**
+     * @brief Replication and failover metrics of the primary and standby RCs.
+     * */
+    struct ReplicationMetrics
+    {
+        Gauge&     standbys;
+        Counter&   recordsSent;
+        Counter&   recordsApplied;
+        Histogram& lag;      ///< From a change being published on the primary until applied on the standby, in ns.
+        Histogram& failover; ///< From the primary last being heard from until the standby listens, in ns.
+        Counter&   failovers;
+
+    public:
+        explicit ReplicationMetrics(MetricsRegistry& registry);
+    };
+
+    /**
+     * @brief Streams the changes of the primary RC's state to the standby RCs following it.
+     *
+     * @details Every standby gets a snapshot of the whole state when it attaches, followed by every change
+     * published since. Changes are queued per standby and sent in batches by a thread of its own so that a slow
+     * standby never holds up the thread making the change. A heartbeat is sent whenever a standby has had nothing
+     * to receive for @ref HeartbeatInterval, which is also how standbys that went away are noticed.
+     * */
+    class ReplicationPublisher
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    public:
+        /**
+         * @brief Longest a standby goes without hearing from the primary.
+         * */
+        static constexpr auto HeartbeatInterval = std::chrono::milliseconds{ 250 };
+        /**
+         * @brief Most records sent in a single @ref PacketType::Replication packet.
+         * */
+        static constexpr usize MaxBatchRecords = 4096;
+
+    private:
+        struct Standby
+        {
+            std::shared_ptr<Endpoint>      endpoint;
+            std::vector<ReplicationRecord> pending;
+            Clock::time_point              lastSent;
+        };
+
+    private:
+        Logger&                 m_Logger;
+        ReplicationMetrics&     m_Metrics;
+        std::mutex              m_Mutex;
+        std::condition_variable m_CV;
+        std::vector<Standby>    m_Standbys;
+        bool                    m_Run;
+        std::thread             m_Thread;
+
+    public:
+        ReplicationPublisher(Logger& logger, ReplicationMetrics& metrics);
+        ReplicationPublisher(const ReplicationPublisher&)            = delete;
+        ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+        ~ReplicationPublisher() noexcept;
+
+    public:
+        void Start() noexcept;
+        void Stop() noexcept;
+
+        /**
+         * @brief Starts streaming to @p endpoint, beginning with @p snapshot.
+         *
+         * @note The caller must make sure no change is published between taking @p snapshot and attaching.
+         * */
+        void Attach(std::shared_ptr<Endpoint> endpoint, std::vector<ReplicationRecord> snapshot) noexcept;
+
+        /**
+         * @brief Queues @p record for every attached standby.
+         *
+         * @note Thread-safe, records published by one thread are sent in the order they were published.
+         * */
+        void Publish(const ReplicationRecord& record) noexcept;
+
+    private:
+        void ThreadHandler() noexcept;
+    };
+
+    /**
+     * @brief Follows the state of the primary RC on a standby RC.
+     * */
+    class ReplicationFollower
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct State
+        {
+            std::unordered_map<GroupID, std::unordered_set<NodeID>> groups;
+            std::unordered_map<u64, SessionState>                   sessions;
+            bool                                                    synced = false;
+        };
+
+    public:
+        /**
+         * @brief How long the primary can stay silent before it is considered failed.
+         * */
+        static constexpr auto Timeout = ReplicationPublisher::HeartbeatInterval * 4;
+        /**
+         * @brief How often to retry reaching a primary that isn't up yet.
+         * */
+        static constexpr auto RetryInterval = std::chrono::seconds{ 1 };
+        /**
+         * @brief How many times a primary that dropped the connection or went silent is probed by attaching again
+         * before it is considered failed.
+         * */
+        static constexpr u32 ReattachAttempts = 3;
+        /**
+         * @brief How long to wait between two probes.
+         * */
+        static constexpr auto ReattachInterval = std::chrono::milliseconds{ 100 };
+        /**
+         * @brief How long a probe may take to connect and to be acknowledged.
+         * */
+        static constexpr auto ProbeTimeout = std::chrono::milliseconds{ 500 };
+
+    private:
+        Logger&             m_Logger;
+        ReplicationMetrics& m_Metrics;
+        State               m_State;
+        Clock::time_point   m_LastHeard;
+
+    public:
+        ReplicationFollower(Logger& logger, ReplicationMetrics& metrics);
+
+    public:
+        /**
+         * @brief Connects to the primary RC at @p address and applies its changes until it fails.
+         *
+         * @details Waits for the primary to come up first. Once followed, a dropped connection, @ref Timeout of
+         * silence or a corrupt batch make the standby attach again, starting over from a snapshot. The primary is
+         * only considered failed once @ref ReattachAttempts probes in a row couldn't reach it, so that a blip on
+         * the network doesn't make the standby take over from a primary that is still serving.
+         * */
+        void Follow(const std::string_view address, const u16 port) noexcept;
+
+        /**
+         * @brief The state replicated so far.
+         * */
+        [[nodiscard]] State& GetState() noexcept { return m_State; }
+
+        /**
+         * @brief When the primary was last heard from.
+         * */
+        [[nodiscard]] Clock::time_point GetLastHeard() const noexcept { return m_LastHeard; }
+
+    private:
+        Result<Err> Attach(Socket* socket, const IPEndPoint& primary, const Timeouts& timeouts) noexcept;
+        Socket*     Reattach(const IPEndPoint& primary) noexcept;
+        Result<Err> Stream(Socket* socket) noexcept;
+        void        Apply(const ReplicationRecord& record) noexcept;
+    };
+} // namespace pmgrd::net
@@ -0,0 +1,140 @@
+#include "SessionTable.h"
+
+#include <cerrno>
+#include <random>
+
+#include <sys/random.h>
+
+namespace pmgrd::net {
+    namespace {
+        [[nodiscard]] u64 RandomToken() noexcept
+        {
+            // Tokens are credentials, they mustn't be predictable from the ones handed out before.
+            u64 token = 0;
+            for (;;)
+            {
+                if (getrandom(&token, sizeof(token), 0) == sizeof(token))
+                    return token;
+                if (errno != EINTR)
+                    break;
+            }
+
+            // Kernels without getrandom().
+            std::random_device rd;
+            return (static_cast<u64>(rd()) << 32) | rd();
+        }
+    } // namespace
+
+    void SessionTable::SetChangeDelegate(ChangeDelegate delegate) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        m_OnChange = std::move(delegate);
+    }
+
+    [[nodiscard]] SessionLease SessionTable::Open(const SessionState& state) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+
+        u64 token;
+        do
+            token = RandomToken();
+        while (token == 0 || m_Sessions.contains(token));
+
+        const SessionLease lease{ token, ++m_Attachments };
+        m_Sessions.emplace(token, Session{ state, true, lease.attachment, {} });
+        if (m_OnChange)
+            m_OnChange(token, &state);
+        return lease;
+    }
+
+    [[nodiscard]] std::optional<ResumedSession> SessionTable::Resume(const u64 token, const NodeID node_id) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        const auto       it = m_Sessions.find(token);
+        if (it == m_Sessions.end())
+            return std::nullopt;
+
+        auto& session = it->second;
+        if (session.state.nodeId != node_id)
+            return std::nullopt;
+
+        // Not swept yet.
+        if (!session.attached && session.expiresAt <= Clock::now())
+        {
+            m_Sessions.erase(it);
+            if (m_OnChange)
+                m_OnChange(token, nullptr);
+            return std::nullopt;
+        }
+
+        const bool taken_over = session.attached;
+        session.attached      = true;
+        session.attachment    = ++m_Attachments;
+        return ResumedSession{ SessionLease{ token, session.attachment }, session.state, taken_over };
+    }
+
+    void SessionTable::Detach(const SessionLease& lease, const SessionState& state,
+                              const Clock::time_point now) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        const auto       it = m_Sessions.find(lease.token);
+        if (it == m_Sessions.end() || it->second.attachment != lease.attachment)
+            return;
+
+        it->second = Session{ state, false, 0, now + SessionTable::TTL };
+        if (m_OnChange)
+            m_OnChange(lease.token, &state);
+    }
+
+    void SessionTable::Update(const SessionLease& lease, const SessionState& state) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        const auto       it = m_Sessions.find(lease.token);
+        if (it == m_Sessions.end() || !it->second.attached || it->second.attachment != lease.attachment)
+            return;
+
+        it->second.state = state;
+        if (m_OnChange)
+            m_OnChange(lease.token, &state);
+    }
+
+    void SessionTable::Restore(const u64 token, const SessionState& state, const Clock::time_point now) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        m_Sessions[token] = Session{ state, false, 0, now + SessionTable::TTL };
+        if (m_OnChange)
+            m_OnChange(token, &state);
+    }
+
+    void SessionTable::Snapshot(
+        const std::function<void(const std::vector<std::pair<u64, SessionState>>&)>& fn) noexcept
+    {
+        std::scoped_lock                          lock{ m_Mutex };
+        std::vector<std::pair<u64, SessionState>> sessions;
+        sessions.reserve(m_Sessions.size());
+        for (const auto& [token, session] : m_Sessions)
+            sessions.emplace_back(token, session.state);
+        fn(sessions);
+    }
+
+    usize SessionTable::Expire(const Clock::time_point now) noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        return std::erase_if(m_Sessions,
+                             [this, now](const auto& entry)
+                             {
+                                 if (entry.second.attached || entry.second.expiresAt > now)
+                                     return false;
+
+                                 if (m_OnChange)
+                                     m_OnChange(entry.first, nullptr);
+                                 return true;
+                             });
+    }
+
+    [[nodiscard]] usize SessionTable::Size() noexcept
+    {
+        std::scoped_lock lock{ m_Mutex };
+        return m_Sessions.size();
+    }
+} // namespace pmgrd::net
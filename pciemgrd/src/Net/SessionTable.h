@@ -0,0 +1,160 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Camera/CamConfigSnapshot.h>
+#include <Core/Ids.h>
+
+namespace pmgrd::net {
+    /**
+     * @brief What the RC knows about an Endpoint that has to survive a reconnect.
+     *
+     * @note Group memberships are kept per node regardless of sessions, they don't need to be part of it.
+     * */
+    struct SessionState
+    {
+        NodeID     nodeId        = 0;
+        bool       subscribed    = false;
+        ConfigKind configKind    = ConfigKind::None;
+        u64        configVersion = 0; ///< The version of the last configuration sent to the Endpoint.
+    };
+
+    /**
+     * @brief A session as held by one connection of its Endpoint.
+     *
+     * @details Every attach gets a new @ref attachment, so that once a session has been taken over the connection
+     * it was taken from can no longer detach or update it.
+     * */
+    struct SessionLease
+    {
+        u64 token      = 0; ///< 0 if the Endpoint didn't open a session.
+        u64 attachment = 0;
+    };
+
+    /**
+     * @brief A session attached again by @ref SessionTable::Resume.
+     * */
+    struct ResumedSession
+    {
+        SessionLease lease;
+        SessionState state;
+        bool         takenOver; ///< Whether the session was still attached to another connection.
+    };
+
+    /**
+     * @brief Keeps the sessions of Endpoints that opened one with @ref ReadyFlags_Session.
+     *
+     * @details A session is attached while its Endpoint is connected. Once it disconnects the session is detached
+     * and kept for @ref TTL, a Ready packet presenting its token within that time resumes it, skipping the
+     * configuration round trips a fresh Endpoint would have to make. Tokens are drawn from getrandom() and never 0,
+     * which a Ready packet uses to ask for a new session.
+     *
+     * An Endpoint whose connection went half-open reconnects while the RC still sees the old connection, so a
+     * session that is still attached is taken over by its own node rather than refused.
+     *
+     * @note Thread-safe.
+     * */
+    class SessionTable
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Invoked with the new state of a session whenever it changes, or nullptr once it's dropped.
+         * */
+        using ChangeDelegate = std::function<void(const u64 token, const SessionState* state)>;
+
+    public:
+        /**
+         * @brief How long a detached session can be resumed.
+         * */
+        static constexpr auto TTL = std::chrono::seconds{ 60 };
+
+    private:
+        struct Session
+        {
+            SessionState      state;
+            bool              attached;
+            u64               attachment;
+            Clock::time_point expiresAt;
+        };
+
+    private:
+        std::mutex                       m_Mutex;
+        std::unordered_map<u64, Session> m_Sessions;
+        u64                              m_Attachments = 0;
+        ChangeDelegate                   m_OnChange;
+
+    public:
+        /**
+         * @brief Sets the delegate told about every change, e.g. to replicate them.
+         *
+         * @note The delegate runs under the table's lock so that changes are reported in the order they are made,
+         * it must not call back into the table.
+         * */
+        void SetChangeDelegate(ChangeDelegate delegate) noexcept;
+
+    public:
+        /**
+         * @brief Opens an attached session for @p state.
+         *
+         * @returns The lease of the new session.
+         * */
+        [[nodiscard]] SessionLease Open(const SessionState& state) noexcept;
+
+        /**
+         * @brief Attaches the session @p token again, taking it over if it's still attached.
+         *
+         * @returns The new lease and the last known state of the session, or nothing if it doesn't exist, has
+         * expired or belongs to a node other than @p node_id. The caller must disconnect the connection a session
+         * was taken over from.
+         * */
+        [[nodiscard]] std::optional<ResumedSession> Resume(const u64 token, const NodeID node_id) noexcept;
+
+        /**
+         * @brief Detaches the session of @p lease, keeping @p state until @ref TTL has passed.
+         *
+         * @note Ignored if the session has been taken over since.
+         * */
+        void Detach(const SessionLease& lease, const SessionState& state,
+                    const Clock::time_point now = Clock::now()) noexcept;
+
+        /**
+         * @brief Replaces the state of the session of @p lease, e.g. once another configuration was sent.
+         *
+         * @note Ignored if the session has been taken over since.
+         * */
+        void Update(const SessionLease& lease, const SessionState& state) noexcept;
+
+        /**
+         * @brief Adds a detached session taken over from another RC, resumable until @ref TTL has passed.
+         * */
+        void Restore(const u64 token, const SessionState& state, const Clock::time_point now = Clock::now()) noexcept;
+
+        /**
+         * @brief Invokes @p fn with every session while holding the table's lock, so that no change can be made
+         * until @p fn returns.
+         * */
+        void Snapshot(const std::function<void(const std::vector<std::pair<u64, SessionState>>&)>& fn) noexcept;
+
+        /**
+         * @brief Drops every detached session that has expired by @p now.
+         *
+         * @returns The number of sessions dropped.
+         * */
+        usize Expire(const Clock::time_point now = Clock::now()) noexcept;
+
+        /**
+         * @brief Number of attached and detached sessions.
+         * */
+        [[nodiscard]] usize Size() noexcept;
+    };
+} // namespace pmgrd::net
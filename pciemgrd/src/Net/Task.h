@@ -0,0 +1,200 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief @ref TRY_UNWRAP for coroutines, which can't use return.
+ *
+ * @note A single statement, so that it can be the body of an if or else without taking over what follows.
+ * */
+#define CO_TRY_UNWRAP(x)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (auto result = x; !result)                                                                                  \
+            co_return result.UnwrapErr();                                                                              \
+    } while (false)
+
+namespace pmgrd::net {
+    /**
+     * @brief A coroutine producing a @p T, typically a @ref Result or @ref ValuedResult.
+     *
+     * @details Tasks are lazy, nothing runs until the task is awaited or handed to @ref EventLoop::Run. Once it
+     * completes, the coroutine awaiting it is resumed right away. A task is awaited at most once and owns its
+     * coroutine frame.
+     * */
+    template <typename T>
+    class [[nodiscard]] Task
+    {
+    public:
+        struct promise_type
+        {
+            std::optional<T>        value;
+            std::coroutine_handle<> continuation;
+
+        public:
+            Task get_return_object() noexcept
+            {
+                return Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            auto final_suspend() noexcept
+            {
+                struct FinalAwaiter
+                {
+                    bool await_ready() noexcept { return false; }
+                    void await_resume() noexcept {}
+
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                    {
+                        const auto continuation = handle.promise().continuation;
+                        return (continuation) ? continuation : std::noop_coroutine();
+                    }
+                };
+                return FinalAwaiter{};
+            }
+
+            template <typename U>
+            void return_value(U&& value) noexcept
+            {
+                this->value.emplace(std::forward<U>(value));
+            }
+
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> m_Handle;
+
+    public:
+        Task() noexcept = default;
+        explicit Task(const std::coroutine_handle<promise_type> handle) noexcept
+            : m_Handle(handle)
+        {
+        }
+        Task(Task&& other) noexcept
+            : m_Handle(std::exchange(other.m_Handle, nullptr))
+        {
+        }
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (m_Handle)
+                    m_Handle.destroy();
+                m_Handle = std::exchange(other.m_Handle, nullptr);
+            }
+            return *this;
+        }
+        Task(const Task&)            = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() noexcept
+        {
+            if (m_Handle)
+                m_Handle.destroy();
+        }
+
+    public:
+        [[nodiscard]] bool IsDone() const noexcept { return !m_Handle || m_Handle.done(); }
+
+        /**
+         * @brief The coroutine of the task, to be resumed by whoever starts it.
+         * */
+        [[nodiscard]] std::coroutine_handle<promise_type> GetHandle() const noexcept { return m_Handle; }
+
+        /**
+         * @brief Takes the value the task completed with.
+         * */
+        [[nodiscard]] T TakeValue() noexcept { return std::move(*m_Handle.promise().value); }
+
+    public:
+        bool await_ready() const noexcept { return IsDone(); }
+
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+        {
+            m_Handle.promise().continuation = awaiting;
+            return m_Handle;
+        }
+
+        T await_resume() noexcept { return TakeValue(); }
+    };
+
+    /**
+     * @brief A coroutine that starts right away and frees itself once it completes, nobody awaits it.
+     * */
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() noexcept
+            {
+                return Detached{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+
+        std::coroutine_handle<> handle; ///< Dangles once the coroutine completes, only its owner can tell when.
+    };
+
+    namespace detail {
+        template <typename T>
+        Detached AwaitInto(Task<T>& task, std::optional<T>& out, usize& left,
+                           const std::coroutine_handle<> parent) noexcept
+        {
+            out.emplace(co_await task);
+            if (--left == 0)
+                parent.resume();
+        }
+    } // namespace detail
+
+    /**
+     * @brief Runs every task of @p tasks concurrently and completes once all of them have.
+     *
+     * @returns The values of @p tasks in the same order.
+     * */
+    template <typename T>
+    Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks) noexcept
+    {
+        struct Awaiter
+        {
+            std::vector<Task<T>>&          tasks;
+            std::vector<std::optional<T>>& values;
+            usize                          left;
+
+        public:
+            bool await_ready() const noexcept { return tasks.empty(); }
+            void await_resume() const noexcept {}
+
+            bool await_suspend(const std::coroutine_handle<> parent) noexcept
+            {
+                // One extra count held until every task started, so that tasks completing right away don't resume
+                // the parent while it is still starting the others.
+                left = tasks.size() + 1;
+                for (usize i = 0; i < tasks.size(); ++i)
+                    detail::AwaitInto(tasks[i], values[i], left, parent);
+                return --left != 0;
+            }
+        };
+
+        std::vector<std::optional<T>> values(tasks.size());
+        co_await Awaiter{ tasks, values, 0 };
+
+        std::vector<T> results;
+        results.reserve(values.size());
+        for (auto& value : values)
+            results.push_back(std::move(*value));
+        co_return results;
+    }
+} // namespace pmgrd::net
@@ -0,0 +1,460 @@
+#include "PipelineSupervisor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <Utils/Utils.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+extern char** environ;
+
+namespace pmgrd {
+    namespace {
+        // The signal handler can only reach the supervisor through a global.
+        std::atomic<PipelineSupervisor*> s_SignalSupervisor{ nullptr };
+    } // namespace
+
+    [[nodiscard]] PipelineSpec BuildGstPipeline(const Camera& cam, const std::string& launcher)
+    {
+        // The CPU list has been validated when the configuration was loaded.
+        auto cpus = utils::sys::ParseCpuList(cam.cpuSet);
+
+        return PipelineSpec{ .cameraId = cam.id,
+                             .args     = {
+                                 launcher,
+                                 "nvv4l2camerasrc",
+                                 fmt::format("device=/dev/video{}", cam.videoDev),
+                                 "!",
+                                 "'video/x-raw(memory:NVMM)',",
+                                 fmt::format("width={},", cam.width),
+                                 fmt::format("height={},", cam.height),
+                                 fmt::format("framerate={}/1,", cam.fps),
+                                 fmt::format("'format=(string){}", cam.videoFmt),
+                                 "!",
+                                 "nvvidconv",
+                                 "flip-method=0",
+                                 "!",
+                                 "videoconvert",
+                                 "!",
+                                 "video/x-raw,",
+                                 fmt::format("width={},", cam.width),
+                                 fmt::format("height={},", cam.height),
+                                 fmt::format("framerate={}/1,", cam.fps),
+                                 fmt::format("'format=(string){}", cam.videoFmt),
+                                 "!",
+                                 "ttmcastsink",
+                                 "camera-id=1",
+                                 fmt::format("device=/dev/video{}", cam.videoDev),
+                             },
+                             .cpus   = (cpus) ? cpus.Unwrap() : std::vector<u16>{},
+                             .cgroup = cam.cgroup };
+    }
+
+    PipelineSupervisor::PipelineSupervisor(Logger& logger) noexcept
+        : m_Logger(logger)
+        , m_Launcher(PipelineSupervisor::DefaultLauncher)
+        , m_Run(true)
+        , m_WakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , m_StopOnSignals(false)
+    {
+        if (const char* launcher = std::getenv("PCIEMGR_GST_LAUNCH"); launcher && *launcher)
+            m_Launcher = launcher;
+    }
+
+    PipelineSupervisor::~PipelineSupervisor() noexcept
+    {
+        if (m_StopOnSignals)
+        {
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            s_SignalSupervisor.store(nullptr);
+        }
+        TerminateAll();
+        if (m_WakeFd != -1)
+            close(m_WakeFd);
+    }
+
+    [[nodiscard]] Result<Err> PipelineSupervisor::Start(std::vector<PipelineSpec> specs) noexcept
+    {
+        const auto start   = Clock::now();
+        usize      spawned = 0;
+
+        // Spawn everything back to back, nothing waits for a previous pipeline to come up.
+        for (auto& spec : specs)
+        {
+            auto& p = m_Pipelines.emplace_back(Pipeline{ .spec = std::move(spec) });
+            if (Spawn(p))
+            {
+                p.startLatency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+                ++spawned;
+            }
+        }
+
+        if (spawned == 0 && !m_Pipelines.empty())
+            return Err{ ErrType::ForkFailed, "Failed to spawn any pipeline." };
+
+        for (const auto& p : m_Pipelines)
+            m_Logger.Log(lgx::Level::Info, "Camera#{} pipeline start latency: {} us.", p.spec.cameraId,
+                         p.startLatency.count());
+        return Ok();
+    }
+
+    void PipelineSupervisor::Run(const bool wait_for_reloads) noexcept
+    {
+        std::vector<pollfd>    pfds;
+        std::vector<Pipeline*> owners;
+
+        while (m_Run.load())
+        {
+            ApplyPending();
+
+            pfds.clear();
+            owners.clear();
+            pfds.push_back({ .fd = m_WakeFd, .events = POLLIN, .revents = 0 });
+            owners.push_back(nullptr);
+
+            // Sleep until a pipeline exits, a restart is due or we're woken up.
+            const auto now     = Clock::now();
+            i32        timeout = -1;
+            for (auto& p : m_Pipelines)
+            {
+                if (p.pidfd != -1)
+                {
+                    pfds.push_back({ .fd = p.pidfd, .events = POLLIN, .revents = 0 });
+                    owners.push_back(&p);
+                }
+                else if (p.restartAt)
+                {
+                    const auto due = std::max<i64>(
+                        0, std::chrono::duration_cast<std::chrono::milliseconds>(*p.restartAt - now).count());
+                    timeout = (timeout == -1) ? static_cast<i32>(due) : std::min(timeout, static_cast<i32>(due));
+                }
+            }
+
+            // Nothing left to supervise, only a reload could still bring cameras up.
+            if (owners.size() == 1 && timeout == -1 && !wait_for_reloads)
+                break;
+
+            if (poll(pfds.data(), pfds.size(), timeout) == -1 && errno != EINTR)
+            {
+                m_Logger.Log(lgx::Level::Error, "Pipeline supervisor failed to poll: {}", std::strerror(errno));
+                break;
+            }
+
+            if (pfds[0].revents & POLLIN)
+            {
+                u64 value;
+                [[maybe_unused]] const auto res = read(m_WakeFd, &value, sizeof(value));
+            }
+
+            for (usize i = 1; i < pfds.size(); ++i)
+            {
+                if (pfds[i].revents & (POLLIN | POLLHUP))
+                    Reap(*owners[i]);
+            }
+
+            const auto after = Clock::now();
+            for (auto& p : m_Pipelines)
+            {
+                if (p.restartAt && *p.restartAt <= after && m_Run.load())
+                {
+                    p.restartAt.reset();
+                    ++p.restarts;
+                    Spawn(p);
+                }
+            }
+
+            m_Pipelines.remove_if([](const Pipeline& p) { return p.retire && p.pidfd == -1; });
+        }
+
+        TerminateAll();
+
+        for (const auto& p : m_Pipelines)
+            m_Logger.Log(lgx::Level::Info, "Camera#{} pipeline was restarted {} time(s).", p.spec.cameraId,
+                         p.restarts);
+    }
+
+    void PipelineSupervisor::Stop() noexcept
+    {
+        m_Run.store(false);
+        Wake();
+    }
+
+    [[nodiscard]] Result<Err> PipelineSupervisor::StopOnSignals() noexcept
+    {
+        PipelineSupervisor* expected = nullptr;
+        if (!s_SignalSupervisor.compare_exchange_strong(expected, this))
+            return Err{ ErrType::InvalidState, "Another pipeline supervisor already stops on signals." };
+
+        struct sigaction action{};
+        action.sa_handler = &PipelineSupervisor::OnSignal;
+        action.sa_flags   = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGTERM, &action, nullptr) == -1 || sigaction(SIGINT, &action, nullptr) == -1)
+        {
+            const i32 error = errno;
+            signal(SIGTERM, SIG_DFL);
+            s_SignalSupervisor.store(nullptr);
+            return Err{ ErrType::InvalidOperation, "Failed to install the SIGTERM and SIGINT handlers: {}",
+                        std::strerror(error) };
+        }
+
+        m_StopOnSignals = true;
+        return Ok();
+    }
+
+    void PipelineSupervisor::Reload(std::vector<PipelineSpec> specs) noexcept
+    {
+        {
+            std::scoped_lock lock{ m_PendingMutex };
+            m_PendingSpecs = std::move(specs);
+        }
+        Wake();
+    }
+
+    void PipelineSupervisor::Wake() noexcept
+    {
+        const u64                   value = 1;
+        [[maybe_unused]] const auto res   = write(m_WakeFd, &value, sizeof(value));
+    }
+
+    bool PipelineSupervisor::Spawn(Pipeline& p) noexcept
+    {
+        auto argv = std::vector<char*>{};
+        for (auto& e : p.spec.args)
+            argv.push_back(e.data());
+        argv.push_back(nullptr);
+
+        // posix_spawn has no affinity attribute, but the child inherits the affinity of the spawning thread.
+        // Pinning ourselves for the duration of the spawn means the pipeline never runs a single instruction
+        // outside of its CPU set.
+        cpu_set_t  previous_cpus;
+        const bool pinned = !p.spec.cpus.empty() &&
+                            pthread_getaffinity_np(pthread_self(), sizeof(previous_cpus), &previous_cpus) == 0;
+        if (pinned)
+        {
+            if (const auto result = utils::sys::SetThreadAffinity(p.spec.cpus); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Warn, "Camera#{} pipeline will not be pinned.\n\t{}", p.spec.cameraId, err);
+            }
+        }
+
+        // posix_spawn reports exec failures synchronously, so a missing launcher fails right here.
+        pid_t     pid;
+        const i32 res = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+
+        if (pinned)
+            pthread_setaffinity_np(pthread_self(), sizeof(previous_cpus), &previous_cpus);
+
+        if (res != 0)
+        {
+            m_Logger.Log(lgx::Level::Error, "Failed to spawn the pipeline of Camera#{}: {}", p.spec.cameraId,
+                         std::strerror(res));
+            ScheduleRestart(p, Clock::now());
+            return false;
+        }
+
+        const i32 pidfd = static_cast<i32>(syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd == -1)
+        {
+            // Without a pidfd we would never notice the exit, don't leave an unsupervised pipeline behind.
+            m_Logger.Log(lgx::Level::Error, "Failed to open a pidfd for PID {}: {}", pid, std::strerror(errno));
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            ScheduleRestart(p, Clock::now());
+            return false;
+        }
+
+        p.pid       = pid;
+        p.pidfd     = pidfd;
+        p.startedAt = Clock::now();
+
+        std::string cmdline;
+        for (const auto& e : p.spec.args)
+        {
+            cmdline += e;
+            cmdline += ' ';
+        }
+        m_Logger.Log(lgx::Level::Info, "GST ({}) Arguments: {}", pid, cmdline);
+
+        Place(p);
+        return true;
+    }
+
+    void PipelineSupervisor::Place(const Pipeline& p) noexcept
+    {
+        if (!p.spec.cgroup.empty())
+        {
+            if (const auto result = utils::sys::MoveToCgroup(p.pid, p.spec.cgroup); !result)
+            {
+                const auto err = result.UnwrapErr();
+                m_Logger.Log(lgx::Level::Warn, "Camera#{} pipeline was not placed into its cgroup.\n\t{}",
+                             p.spec.cameraId, err);
+            }
+        }
+
+        if (p.spec.cpus.empty() && p.spec.cgroup.empty())
+            return;
+
+        // Read the placement back from the kernel rather than trusting what we asked for.
+        auto cgroup = utils::fs::ReadToString(fmt::format("/proc/{}/cgroup", p.pid));
+        auto cpus   = utils::sys::ProcStatusField(p.pid, "Cpus_allowed_list");
+        m_Logger.Log(lgx::Level::Info, "Camera#{} pipeline (PID {}) runs on CPUs {} in cgroup {}.", p.spec.cameraId,
+                     p.pid, cpus, (cgroup) ? utils::StrSplit(cgroup.Unwrap(), '\n').front() : "?");
+    }
+
+    void PipelineSupervisor::Reap(Pipeline& p) noexcept
+    {
+        i32 status = 0;
+        waitpid(p.pid, &status, 0);
+        close(p.pidfd);
+
+        const auto now    = Clock::now();
+        const auto uptime = std::chrono::duration_cast<std::chrono::milliseconds>(now - p.startedAt);
+        m_Logger.Log(lgx::Level::Info, "PID {} (Camera#{}) exited with status code: {} after {} ms.", p.pid,
+                     p.spec.cameraId, status, uptime.count());
+
+        p.pid   = -1;
+        p.pidfd = -1;
+
+        if (p.retire || !m_Run.load())
+            return;
+
+        // The spec changed while it was running, bring the new one up immediately.
+        if (p.next)
+        {
+            p.spec     = std::move(*p.next);
+            p.restarts = 0;
+            p.backoff  = std::chrono::milliseconds{ PipelineSupervisor::InitialBackoffMs };
+            p.next.reset();
+            Spawn(p);
+            return;
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            m_Logger.Log(lgx::Level::Info, "Camera#{} pipeline finished.", p.spec.cameraId);
+            return;
+        }
+
+        if (uptime >= std::chrono::milliseconds{ PipelineSupervisor::StableRunMs })
+            p.backoff = std::chrono::milliseconds{ PipelineSupervisor::InitialBackoffMs };
+
+        m_Logger.Log(lgx::Level::Warn, "Camera#{} pipeline crashed, restarting in {} ms.", p.spec.cameraId,
+                     p.backoff.count());
+        ScheduleRestart(p, now);
+    }
+
+    void PipelineSupervisor::ScheduleRestart(Pipeline& p, const Clock::time_point now) noexcept
+    {
+        p.restartAt = now + p.backoff;
+        p.backoff   = std::min(p.backoff * 2, std::chrono::milliseconds{ PipelineSupervisor::MaxBackoffMs });
+    }
+
+    void PipelineSupervisor::ApplyPending() noexcept
+    {
+        std::optional<std::vector<PipelineSpec>> specs;
+        {
+            std::scoped_lock lock{ m_PendingMutex };
+            specs.swap(m_PendingSpecs);
+        }
+        if (!specs)
+            return;
+
+        for (auto& p : m_Pipelines)
+        {
+            const auto it = std::find_if(specs->begin(), specs->end(),
+                                         [&p](const auto& spec) { return spec.cameraId == p.spec.cameraId; });
+            if (it == specs->end())
+            {
+                m_Logger.Log(lgx::Level::Info, "Camera#{} was removed, stopping its pipeline.", p.spec.cameraId);
+                p.retire = true;
+                p.restartAt.reset();
+                if (p.pid != -1)
+                    kill(p.pid, SIGTERM);
+                continue;
+            }
+
+            if (*it != p.spec)
+            {
+                m_Logger.Log(lgx::Level::Info, "Camera#{} was reconfigured, restarting its pipeline.",
+                             p.spec.cameraId);
+                if (p.pid != -1)
+                {
+                    // Reap() brings the new spec up.
+                    p.next = std::move(*it);
+                    kill(p.pid, SIGTERM);
+                }
+                else
+                {
+                    p.spec = std::move(*it);
+                    p.restartAt.reset();
+                    p.backoff = std::chrono::milliseconds{ PipelineSupervisor::InitialBackoffMs };
+                    Spawn(p);
+                }
+            }
+            specs->erase(it);
+        }
+
+        // Whatever is left is new.
+        for (auto& spec : *specs)
+        {
+            m_Logger.Log(lgx::Level::Info, "Camera#{} was added, starting its pipeline.", spec.cameraId);
+            Spawn(m_Pipelines.emplace_back(Pipeline{ .spec = std::move(spec) }));
+        }
+
+        m_Pipelines.remove_if([](const Pipeline& p) { return p.retire && p.pidfd == -1; });
+    }
+
+    void PipelineSupervisor::TerminateAll() noexcept
+    {
+        for (auto& p : m_Pipelines)
+        {
+            if (p.pid != -1)
+                kill(p.pid, SIGTERM);
+        }
+
+        // Give the pipelines a chance to shut down gracefully, then force them.
+        const auto deadline = Clock::now() + std::chrono::milliseconds{ PipelineSupervisor::StopTimeoutMs };
+        for (auto& p : m_Pipelines)
+        {
+            if (p.pidfd == -1)
+                continue;
+
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+            pollfd     pfd{ .fd = p.pidfd, .events = POLLIN, .revents = 0 };
+            if (poll(&pfd, 1, std::max<i32>(0, static_cast<i32>(left.count()))) <= 0)
+                kill(p.pid, SIGKILL);
+
+            waitpid(p.pid, nullptr, 0);
+            close(p.pidfd);
+            p.pid   = -1;
+            p.pidfd = -1;
+        }
+    }
+
+    void PipelineSupervisor::OnSignal(int) noexcept
+    {
+        // Stop() only stores a flag and writes to the eventfd, both async-signal-safe.
+        const int saved_errno = errno;
+        if (auto* const supervisor = s_SignalSupervisor.load())
+            supervisor->Stop();
+        errno = saved_errno;
+    }
+} // namespace pmgrd
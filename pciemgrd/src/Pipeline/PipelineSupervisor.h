@@ -0,0 +1,143 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <Camera/CamCrewStation.h>
+#include <Core/Error.h>
+#include <Core/Result.h>
+#include <Log/Logger.h>
+
+namespace pmgrd {
+    /**
+     * @brief Describes the process running the pipeline of a single camera.
+     * */
+    struct PipelineSpec
+    {
+        u16                      cameraId; ///< The camera streamed by the pipeline.
+        std::vector<std::string> args;     ///< argv of the pipeline, args[0] being the launcher.
+        std::vector<u16>         cpus;     ///< CPUs the pipeline is pinned to, empty for no pinning.
+        std::string              cgroup;   ///< cgroup v2 the pipeline is placed into, empty to inherit ours.
+
+    public:
+        [[nodiscard]] bool operator==(const PipelineSpec&) const noexcept = default;
+    };
+
+    /**
+     * @brief Builds the gst-launch-1.0 pipeline for a camera.
+     *
+     * @param cam The camera.
+     * @param launcher The binary used to launch the pipeline.
+     * */
+    [[nodiscard]] PipelineSpec BuildGstPipeline(const Camera& cam, const std::string& launcher);
+
+    /**
+     * @brief Launches the camera pipelines and keeps them alive.
+     *
+     * @details Every pipeline is spawned with posix_spawn without waiting for the others, and watched through a
+     * pidfd from a single poll based event loop, so exits are handled in the order they happen. Crashed pipelines
+     * are restarted with an exponential backoff, which is reset once a pipeline has been running stably.
+     * Pipelines exiting successfully are considered finished and aren't restarted.
+     *
+     * Pipelines are pinned to their CPU set before they start running, since the affinity is inherited from the
+     * spawning thread, and are moved into their cgroup right after being spawned.
+     *
+     * The launcher can be overridden with the PCIEMGR_GST_LAUNCH environment variable, e.g. with a stub script.
+     * */
+    class PipelineSupervisor
+    {
+    public:
+        static constexpr auto DefaultLauncher  = "gst-launch-1.0";
+        static constexpr auto InitialBackoffMs = 500;
+        static constexpr auto MaxBackoffMs     = 30000;
+        static constexpr auto StableRunMs      = 10000;
+        static constexpr auto StopTimeoutMs    = 5000;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Pipeline
+        {
+            PipelineSpec                     spec;
+            pid_t                            pid      = -1;
+            i32                              pidfd    = -1;
+            u32                              restarts = 0;
+            std::chrono::milliseconds        backoff{ PipelineSupervisor::InitialBackoffMs };
+            std::chrono::microseconds        startLatency{ 0 };
+            Clock::time_point                startedAt{};
+            std::optional<Clock::time_point> restartAt{};
+            std::optional<PipelineSpec>      next{};
+            bool                             retire = false;
+        };
+
+    private:
+        Logger&                                  m_Logger;
+        std::string                              m_Launcher;
+        std::list<Pipeline>                      m_Pipelines;
+        std::atomic<bool>                        m_Run;
+        i32                                      m_WakeFd;
+        std::mutex                               m_PendingMutex;
+        std::optional<std::vector<PipelineSpec>> m_PendingSpecs;
+        bool                                     m_StopOnSignals;
+
+    public:
+        PipelineSupervisor(Logger& logger) noexcept;
+        ~PipelineSupervisor() noexcept;
+
+    public:
+        [[nodiscard]] const std::string& GetLauncher() const noexcept { return m_Launcher; }
+
+    public:
+        /**
+         * @brief Spawns a pipeline for every spec.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates that not a single pipeline could be spawned.
+         * */
+        [[nodiscard]] Result<Err> Start(std::vector<PipelineSpec> specs) noexcept;
+
+        /**
+         * @brief Runs the event loop until @ref Stop is called.
+         *
+         * @param wait_for_reloads Whether to keep running once no pipeline is left to supervise, for as long as a
+         * @ref Reload may still bring some up.
+         * */
+        void Run(const bool wait_for_reloads) noexcept;
+
+        /**
+         * @brief Asks the event loop to terminate the pipelines and return. Thread-safe.
+         * */
+        void Stop() noexcept;
+
+        /**
+         * @brief Calls @ref Stop on SIGTERM and SIGINT, so that the pipelines are terminated rather than orphaned.
+         * The default handlers are restored once the supervisor is destroyed.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> StopOnSignals() noexcept;
+
+        /**
+         * @brief Replaces the set of pipelines, only the pipelines whose spec changed are restarted. Thread-safe.
+         * */
+        void Reload(std::vector<PipelineSpec> specs) noexcept;
+
+    private:
+        void Wake() noexcept;
+        bool Spawn(Pipeline& p) noexcept;
+        void ScheduleRestart(Pipeline& p, Clock::time_point now) noexcept;
+        void Place(const Pipeline& p) noexcept;
+        void Reap(Pipeline& p) noexcept;
+        void ApplyPending() noexcept;
+        void TerminateAll() noexcept;
+        static void OnSignal(int) noexcept;
+    };
+} // namespace pmgrd
@@ -0,0 +1,98 @@
+#include "FileWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace pmgrd::utils {
+    FileWatcher::FileWatcher(std::string path, Callback callback) noexcept
+        : m_Path(std::move(path))
+        , m_Callback(std::move(callback))
+        , m_Run(false)
+        , m_Fd(-1)
+    {
+    }
+
+    FileWatcher::~FileWatcher() noexcept
+    {
+        Stop();
+    }
+
+    [[nodiscard]] Result<Err> FileWatcher::Start() noexcept
+    {
+        const auto path = std::filesystem::path{ m_Path };
+        const auto dir  = path.has_parent_path() ? path.parent_path() : std::filesystem::path{ "." };
+
+        m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_Fd == -1)
+            return Err{ ErrType::IOError, "Failed to initialise inotify for '{}'.", m_Path };
+
+        if (inotify_add_watch(m_Fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+        {
+            close(m_Fd);
+            m_Fd = -1;
+            return Err{ ErrType::IOError, "Failed to watch '{}'.", m_Path };
+        }
+
+        m_Run.store(true);
+        m_Thread = std::thread{ &FileWatcher::ThreadHandler, this };
+        return Ok();
+    }
+
+    void FileWatcher::Stop() noexcept
+    {
+        m_Run.store(false);
+        if (m_Thread.joinable())
+            m_Thread.join();
+
+        if (m_Fd != -1)
+        {
+            close(m_Fd);
+            m_Fd = -1;
+        }
+    }
+
+    void FileWatcher::ThreadHandler() noexcept
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const auto file_name = std::filesystem::path{ m_Path }.filename().string();
+
+        // inotify_event is followed by a variable length name.
+        alignas(inotify_event) char buffer[4096];
+        bool                        pending = false;
+        Clock::time_point           last_event;
+
+        while (m_Run.load())
+        {
+            pollfd pfd{ .fd = m_Fd, .events = POLLIN, .revents = 0 };
+            if (poll(&pfd, 1, FileWatcher::DebounceMs) > 0 && (pfd.revents & POLLIN))
+            {
+                ssize_t len;
+                while ((len = read(m_Fd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* ptr = buffer; ptr < buffer + len;)
+                    {
+                        const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                        if (event->len > 0 && file_name == event->name)
+                        {
+                            pending    = true;
+                            last_event = Clock::now();
+                        }
+                        ptr += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+
+            // Wait for the file to settle before notifying.
+            if (pending && Clock::now() - last_event >= std::chrono::milliseconds{ FileWatcher::DebounceMs })
+            {
+                pending = false;
+                m_Callback();
+            }
+        }
+    }
+} // namespace pmgrd::utils
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <Core/Error.h>
+#include <Core/Result.h>
+
+namespace pmgrd::utils {
+    /**
+     * @brief Watches a single file for modifications through inotify and invokes a callback on a background
+     * thread whenever it changes.
+     *
+     * @details The parent directory is watched instead of the file itself so that editors replacing the file
+     * (write to a temporary and rename) are picked up as well. Bursts of events are debounced.
+     * */
+    class FileWatcher
+    {
+    public:
+        using Callback = std::function<void()>;
+
+    public:
+        /**
+         * @brief Time to wait for the file to settle before invoking the callback.
+         * */
+        static constexpr auto DebounceMs = 100;
+
+    private:
+        std::string       m_Path;
+        Callback          m_Callback;
+        std::atomic<bool> m_Run;
+        std::thread       m_Thread;
+        i32               m_Fd;
+
+    public:
+        FileWatcher(std::string path, Callback callback) noexcept;
+        ~FileWatcher() noexcept;
+
+    public:
+        /**
+         * @brief Starts watching the file.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> Start() noexcept;
+
+        /**
+         * @brief Stops watching the file and joins the background thread.
+         * */
+        void Stop() noexcept;
+
+    private:
+        void ThreadHandler() noexcept;
+    };
+} // namespace pmgrd::utils
@@ -3,10 +3,23 @@
 #include <CommonDef.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iterator>
 #include <sstream>
 
+#include <alloca.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace pmgrd::utils {
     [[nodiscard]] std::vector<std::string> StrSplit(const std::string& str, const char delim) noexcept
     {
@@ -51,5 +64,215 @@ namespace pmgrd::utils {
             else
                 return Err{ ErrType::IOError, "Unable to open '{}' for reading.", path };
         }
+
+        [[nodiscard]] Result<Err> WriteAtomic(const std::string& path, const std::string_view content) noexcept
+        {
+            const auto tmp_path = path + ".tmp";
+            const i32  fd       = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd == -1)
+                return Err{ ErrType::IOError, "Unable to open '{}' for writing.", tmp_path };
+
+            usize written = 0;
+            while (written < content.size())
+            {
+                const auto res = write(fd, content.data() + written, content.size() - written);
+                if (res == -1 && errno == EINTR)
+                    continue;
+                else if (res == -1)
+                    break;
+                written += static_cast<usize>(res);
+            }
+
+            if (written != content.size() || fsync(fd) == -1)
+            {
+                close(fd);
+                unlink(tmp_path.c_str());
+                return Err{ ErrType::IOError, "Failed to write '{}'.", tmp_path };
+            }
+            close(fd);
+
+            if (rename(tmp_path.c_str(), path.c_str()) == -1)
+            {
+                unlink(tmp_path.c_str());
+                return Err{ ErrType::IOError, "Failed to replace '{}'.", path };
+            }
+
+            // Make the rename itself durable.
+            const auto parent = std::filesystem::path{ path }.parent_path();
+            if (const i32 dir_fd = open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                dir_fd != -1)
+            {
+                fsync(dir_fd);
+                close(dir_fd);
+            }
+
+            return Ok();
+        }
     } // namespace fs
+
+    namespace sys {
+        [[nodiscard]] ValuedResult<std::vector<u16>, Err> ParseCpuList(const std::string_view list) noexcept
+        {
+            const auto parse_cpu = [](const std::string_view str, u16& cpu)
+            {
+                const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), cpu);
+                return ec == std::errc{} && ptr == str.data() + str.size() && cpu < CPU_SETSIZE;
+            };
+
+            std::vector<u16> cpus;
+            for (const auto range : StrSplit(list, ','))
+            {
+                const auto dash = range.find('-');
+                u16        first, last;
+                if (!parse_cpu(range.substr(0, dash), first))
+                    return Err{ ErrType::InvalidOperation, "Invalid CPU list '{}'.", list };
+
+                last = first;
+                if (dash != std::string_view::npos && (!parse_cpu(range.substr(dash + 1), last) || last < first))
+                    return Err{ ErrType::InvalidOperation, "Invalid CPU list '{}'.", list };
+
+                for (u32 cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(static_cast<u16>(cpu));
+            }
+
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+            return cpus;
+        }
+
+        [[nodiscard]] Result<Err> SetThreadAffinity(const std::vector<u16>& cpus) noexcept
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (cpus.empty())
+            {
+                for (i32 cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                    CPU_SET(cpu, &set);
+            }
+            for (const auto cpu : cpus)
+                CPU_SET(cpu, &set);
+
+            if (const i32 res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); res != 0)
+                return Err{ ErrType::InvalidOperation, "Failed to set the thread affinity: {}", std::strerror(res) };
+            return Ok();
+        }
+
+        [[nodiscard]] Result<Err> SetThreadRealtime(const i32 priority) noexcept
+        {
+            const i32 min = sched_get_priority_min(SCHED_FIFO);
+            const i32 max = sched_get_priority_max(SCHED_FIFO);
+            if (priority < min || priority > max)
+                return Err{ ErrType::InvalidOperation, "Real-time priority must be within [{}, {}].", min, max };
+
+            sched_param param{};
+            param.sched_priority = priority;
+            if (const i32 res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); res != 0)
+                return Err{ ErrType::InvalidOperation, "Failed to switch to SCHED_FIFO: {}", std::strerror(res) };
+            return Ok();
+        }
+
+        [[nodiscard]] Result<Err> LockMemory(const usize heap_bytes) noexcept
+        {
+            // Populate and lock what is mapped now, the binary and the heap so far.
+            if (mlockall(MCL_CURRENT) == -1)
+                return Err{ ErrType::InvalidOperation, "Failed to lock memory: {}", std::strerror(errno) };
+
+            // Plain MCL_FUTURE populates every new mapping in full, i.e. the whole 8 MiB default stack of each
+            // thread, one per Endpoint on the RC. MCL_ONFAULT only locks pages once they're touched, so a thread
+            // costs the stack it actually uses; the real-time thread pre-faults its own with PrefaultStack.
+            if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == -1)
+                return Err{ ErrType::InvalidOperation, "Failed to lock future memory: {}", std::strerror(errno) };
+
+            // Keep freed memory inside the heap and serve every allocation from it rather than from fresh mmaps.
+            mallopt(M_TRIM_THRESHOLD, -1);
+            mallopt(M_MMAP_MAX, 0);
+
+            // Fault the heap in once, free() hands it back to malloc but it stays resident and locked.
+            if (heap_bytes != 0)
+            {
+                auto* const pool = static_cast<volatile u8*>(std::malloc(heap_bytes));
+                if (!pool)
+                    return Err{ ErrType::InvalidOperation, "Failed to pre-fault {} bytes of heap.", heap_bytes };
+
+                const auto page = static_cast<usize>(sysconf(_SC_PAGESIZE));
+                for (usize i = 0; i < heap_bytes; i += page)
+                    pool[i] = 0;
+                std::free(const_cast<u8*>(pool));
+            }
+            return Ok();
+        }
+
+        void PrefaultStack(const usize bytes) noexcept
+        {
+            auto* const stack = static_cast<volatile u8*>(alloca(bytes));
+            const auto  page  = static_cast<usize>(sysconf(_SC_PAGESIZE));
+            for (usize i = 0; i < bytes; i += page)
+                stack[i] = 0;
+        }
+
+        [[nodiscard]] ValuedResult<std::filesystem::path, Err> CgroupPath(const std::string_view cgroup) noexcept
+        {
+            const auto relative = std::filesystem::path{ cgroup };
+            if (cgroup.empty() || relative.is_absolute())
+                return Err{ ErrType::InvalidOperation, "Invalid cgroup '{}', expected a path relative to {}.", cgroup,
+                            CgroupRoot };
+
+            // Reject ".." outright rather than resolving it, "a/../b" is as suspicious as "../b".
+            for (const auto& component : relative)
+            {
+                if (component == "..")
+                    return Err{ ErrType::InvalidOperation, "Invalid cgroup '{}', '..' is not allowed.", cgroup };
+            }
+
+            const auto root = std::filesystem::path{ CgroupRoot };
+            const auto path = (root / relative).lexically_normal();
+            const auto rest = path.lexically_relative(root);
+            if (rest.empty() || rest == "." || *rest.begin() == "..")
+                return Err{ ErrType::InvalidOperation, "Invalid cgroup '{}', it must be below {}.", cgroup, CgroupRoot };
+            return path;
+        }
+
+        [[nodiscard]] Result<Err> MoveToCgroup(const pid_t pid, const std::string& cgroup) noexcept
+        {
+            auto resolved = CgroupPath(cgroup);
+            if (!resolved)
+                return resolved.UnwrapErr();
+            const auto path = resolved.Unwrap();
+
+            std::error_code ec;
+            std::filesystem::create_directories(path, ec);
+            if (ec)
+                return Err{ ErrType::IOError, "Failed to create cgroup '{}': {}", path.string(), ec.message() };
+
+            // Writing the pid migrates the whole process, threads included.
+            const auto procs_path = path / "cgroup.procs";
+            const i32  fd         = open(procs_path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd == -1)
+                return Err{ ErrType::IOError, "Unable to open '{}' for writing.", procs_path.string() };
+
+            const auto pid_str = std::to_string(pid);
+            const auto res     = write(fd, pid_str.data(), pid_str.size());
+            const i32  error   = errno;
+            close(fd);
+            if (res != static_cast<ssize_t>(pid_str.size()))
+                return Err{ ErrType::IOError, "Failed to move PID {} into '{}': {}", pid, path.string(),
+                            std::strerror(error) };
+            return Ok();
+        }
+
+        [[nodiscard]] std::string ProcStatusField(const pid_t pid, const std::string_view field) noexcept
+        {
+            std::ifstream fs{ fmt::format("/proc/{}/status", pid) };
+            std::string   line;
+            while (std::getline(fs, line))
+            {
+                if (line.size() > field.size() && line.starts_with(field) && line[field.size()] == ':')
+                {
+                    const auto start = line.find_first_not_of(" \t", field.size() + 1);
+                    return (start != std::string::npos) ? line.substr(start) : std::string{};
+                }
+            }
+            return {};
+        }
+    } // namespace sys
 } // namespace pmgrd::utils
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <filesystem>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include <sys/types.h>
+
 #include <Core/Error.h>
 #include <Core/Result.h>
 
@@ -12,10 +15,103 @@ namespace pmgrd::utils {
     [[nodiscard]] std::vector<std::string_view> StrSplit(const std::string_view str, const char delim = ' ') noexcept;
     [[nodiscard]] std::string                   StrLower(const std::string_view str) noexcept;
 
+    /**
+     * @brief 64-bit FNV-1a hash, used as a cheap content hash.
+     * */
+    [[nodiscard]] constexpr u64 Fnv1a64(const std::string_view str) noexcept
+    {
+        u64 hash = 0xcbf29ce484222325;
+        for (const char c : str)
+        {
+            hash ^= static_cast<u8>(c);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
     namespace fs {
         [[nodiscard]] ValuedResult<std::string, Err> ReadToString(const std::string& path) noexcept;
+
+        /**
+         * @brief Atomically replaces the content of a file.
+         *
+         * @details The content is written and synced to a temporary file which is then renamed over @p path,
+         * so readers either see the old or the new content, even after a power loss.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> WriteAtomic(const std::string& path, const std::string_view content) noexcept;
     } // namespace fs
 
+    namespace sys {
+        /**
+         * @brief Parses a Linux CPU list such as "0-2,5" into the CPU indices it contains.
+         *
+         * @returns @ref ValuedResult of the sorted, de-duplicated CPU indices or @ref Err.
+         * */
+        [[nodiscard]] ValuedResult<std::vector<u16>, Err> ParseCpuList(const std::string_view list) noexcept;
+
+        /**
+         * @brief Pins the calling thread to @p cpus. An empty list allows every CPU again.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> SetThreadAffinity(const std::vector<u16>& cpus) noexcept;
+
+        /**
+         * @brief Moves the calling thread to SCHED_FIFO at @p priority.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> SetThreadRealtime(const i32 priority) noexcept;
+
+        /**
+         * @brief Locks every current and future page of the process into RAM and pre-faults @p heap_bytes of heap.
+         *
+         * @details Current pages are populated right away, future ones are locked once first touched, so thread
+         * stacks don't get faulted in whole. The heap is never trimmed afterwards, so memory freed back to malloc
+         * stays mapped and faulted in for the next allocation.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> LockMemory(const usize heap_bytes) noexcept;
+
+        /**
+         * @brief Touches @p bytes of the calling thread's stack so that it doesn't page fault later on.
+         * */
+        void PrefaultStack(const usize bytes) noexcept;
+
+        /**
+         * @brief Resolves @p cgroup to its directory under @ref CgroupRoot.
+         *
+         * @details Absolute paths and ".." components are rejected, so the result never escapes @ref CgroupRoot.
+         *
+         * @returns @ref ValuedResult of the path and @ref Err where @ref Err indicates an invalid cgroup.
+         * */
+        [[nodiscard]] ValuedResult<std::filesystem::path, Err> CgroupPath(const std::string_view cgroup) noexcept;
+
+        /**
+         * @brief Moves the process @p pid into the cgroup v2 @p cgroup, creating the cgroup if needed.
+         *
+         * @param cgroup Path to the cgroup relative to @ref CgroupRoot, see @ref CgroupPath.
+         *
+         * @returns @ref Result of @ref Err where @ref Err indicates an error has occured.
+         * */
+        [[nodiscard]] Result<Err> MoveToCgroup(const pid_t pid, const std::string& cgroup) noexcept;
+
+        /**
+         * @brief Reads a field of /proc/<pid>/status, e.g. "Cpus_allowed_list".
+         *
+         * @returns The value of the field or an empty string if it couldn't be read.
+         * */
+        [[nodiscard]] std::string ProcStatusField(const pid_t pid, const std::string_view field) noexcept;
+
+        /**
+         * @brief Where the cgroup v2 hierarchy is mounted.
+         * */
+        inline constexpr auto CgroupRoot = "/sys/fs/cgroup";
+    } // namespace sys
+
     template <typename Fn>
     constexpr auto BindDelegate(auto* self, Fn delegate)
     {
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Registers @p fn as a benchmark, run once for every argument following it, e.g.
+ * PMGRD_BENCHMARK(BM_Packet, 64, 4096).
+ * */
+#define PMGRD_BENCHMARK(fn, ...)                                                                                       \
+    [[maybe_unused]] static const bool pmgrd_bench_registered_##fn = ::pmgrd::bench::Register(#fn, fn, { __VA_ARGS__ })
+
+/**
+ * @namespace pmgrd::bench
+ * @brief A minimal benchmark harness, whose JSON output follows Google Benchmark's so that its tools can compare
+ * runs.
+ * */
+namespace pmgrd::bench {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Handed to a benchmark, which times the body of its loop:
+     *
+     * @code
+     * for ([[maybe_unused]] auto _ : state)
+     *     DoNotOptimize(Work(state.Arg()));
+     * @endcode
+     *
+     * Everything before the loop is setup and isn't timed.
+     * */
+    class State
+    {
+    public:
+        struct Iterator
+        {
+            State* state;
+            u64    remaining;
+
+            bool operator!=(const Iterator&) noexcept
+            {
+                if (remaining != 0)
+                    return true;
+                state->StopTimer();
+                return false;
+            }
+            Iterator& operator++() noexcept
+            {
+                --remaining;
+                return *this;
+            }
+            [[nodiscard]] u64 operator*() const noexcept { return remaining; }
+        };
+
+    private:
+        u64               m_Iterations;
+        i64               m_Arg;
+        u64               m_BytesProcessed;
+        Clock::time_point m_Start;
+        Clock::duration   m_Elapsed;
+        i64               m_CpuStartNs;
+        i64               m_CpuNs;
+        bool              m_Failed;
+        std::string       m_Error;
+
+    public:
+        State(const u64 iterations, const i64 arg) noexcept
+            : m_Iterations(iterations)
+            , m_Arg(arg)
+            , m_BytesProcessed(0)
+            , m_Elapsed(0)
+            , m_CpuStartNs(0)
+            , m_CpuNs(0)
+            , m_Failed(false)
+        {
+        }
+
+    public:
+        [[nodiscard]] Iterator begin() noexcept
+        {
+            StartTimer();
+            return { this, m_Iterations };
+        }
+        [[nodiscard]] Iterator end() noexcept { return { this, 0 }; }
+
+    public:
+        [[nodiscard]] u64                Iterations() const noexcept { return m_Iterations; }
+        [[nodiscard]] i64                Arg() const noexcept { return m_Arg; }
+        [[nodiscard]] u64                BytesProcessed() const noexcept { return m_BytesProcessed; }
+        [[nodiscard]] Clock::duration    Elapsed() const noexcept { return m_Elapsed; }
+        [[nodiscard]] i64                CpuNs() const noexcept { return m_CpuNs; }
+        [[nodiscard]] bool               Failed() const noexcept { return m_Failed; }
+        [[nodiscard]] const std::string& Error() const noexcept { return m_Error; }
+
+        /**
+         * @brief Total amount of bytes processed by every iteration, reported as a throughput.
+         * */
+        void SetBytesProcessed(const u64 bytes) noexcept { m_BytesProcessed = bytes; }
+
+        /**
+         * @brief Marks the benchmark as failed, it shouldn't enter its loop afterwards.
+         * */
+        void SkipWithError(std::string error) noexcept
+        {
+            m_Failed = true;
+            m_Error  = std::move(error);
+        }
+
+    private:
+        [[nodiscard]] static i64 ThreadCpuNs() noexcept
+        {
+            timespec ts{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return static_cast<i64>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+        }
+
+        void StartTimer() noexcept
+        {
+            m_CpuStartNs = ThreadCpuNs();
+            m_Start      = Clock::now();
+        }
+
+        void StopTimer() noexcept
+        {
+            m_Elapsed = Clock::now() - m_Start;
+            m_CpuNs   = ThreadCpuNs() - m_CpuStartNs;
+        }
+    };
+
+    using BenchmarkFn = void (*)(State&);
+
+    struct Benchmark
+    {
+        std::string      name;
+        BenchmarkFn      fn;
+        std::vector<i64> args;
+    };
+
+    /**
+     * @brief Adds a benchmark to the ones run by the harness, see @ref PMGRD_BENCHMARK.
+     * */
+    bool Register(std::string name, BenchmarkFn fn, std::vector<i64> args);
+
+    /**
+     * @brief Keeps the compiler from optimising away the computation of @p value.
+     * */
+    template <typename T>
+    inline void DoNotOptimize(T&& value) noexcept
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+} // namespace pmgrd::bench
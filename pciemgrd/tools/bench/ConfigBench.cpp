@@ -0,0 +1,114 @@
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <string>
+
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <Camera/CamConfigLoader.h>
+#include <Camera/CamConfigSnapshot.h>
+#include <Camera/CamCrewStation.h>
+
+#include "Bench.h"
+
+using namespace pmgrd;
+
+namespace {
+    /**
+     * @brief Cameras per concentrator in the generated configurations.
+     * */
+    constexpr u8 CamerasPerNode = 4;
+
+    /**
+     * @brief Writes a camera configuration with @p nodes concentrators and crew stations to a temporary file,
+     * removed when the object goes out of scope.
+     * */
+    struct ConfigFile
+    {
+        std::string path;
+        usize       size = 0;
+
+        explicit ConfigFile(const u8 nodes)
+            : path((std::filesystem::temp_directory_path() / ("pciemgrd_bench_" + std::to_string(getpid()) + ".json"))
+                       .string())
+        {
+            auto concentrators = nlohmann::json::array();
+            auto crew_stations = nlohmann::json::array();
+            for (u8 node = 1; node <= nodes; ++node)
+            {
+                auto cameras = nlohmann::json::array();
+                auto groups  = nlohmann::json::array();
+                for (u8 i = 0; i < CamerasPerNode; ++i)
+                {
+                    const u8 id = static_cast<u8>((node * CamerasPerNode + i) % 16 + 1);
+                    cameras.push_back({ { "id", id },
+                                        { "width", 1920 },
+                                        { "height", 1080 },
+                                        { "fps", 30 },
+                                        { "depth", 12 },
+                                        { "bufferCount", 2 },
+                                        { "comprFmt", "MJPEG" },
+                                        { "videoFmt", "UYVY" },
+                                        { "videoDev", i } });
+                    groups.push_back(id);
+                }
+                concentrators.push_back({ { "nodeId", node }, { "cameras", std::move(cameras) } });
+                crew_stations.push_back({ { "nodeId", node }, { "groups", std::move(groups) } });
+            }
+
+            const auto text =
+                nlohmann::json{ { "concentrators", concentrators }, { "crewStations", crew_stations } }.dump(4);
+            std::ofstream{ path, std::ios::trunc } << text;
+            size = text.size();
+        }
+        ~ConfigFile() noexcept
+        {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    };
+
+    void BM_LoadCamConfig(bench::State& state)
+    {
+        const ConfigFile file{ static_cast<u8>(state.Arg()) };
+        for ([[maybe_unused]] auto _ : state)
+        {
+            std::list<Camera>      cameras;
+            std::list<CrewStation> crew_stations;
+            if (const auto result = LoadCamConfig(file.path, cameras, crew_stations); !result)
+            {
+                state.SkipWithError(fmt::format("{}", result.UnwrapErr()));
+                return;
+            }
+            bench::DoNotOptimize(cameras);
+        }
+        state.SetBytesProcessed(state.Iterations() * file.size);
+    }
+    PMGRD_BENCHMARK(BM_LoadCamConfig, 1, 8, 63);
+
+    void BM_BuildConfigSnapshot(bench::State& state)
+    {
+        const ConfigFile       file{ static_cast<u8>(state.Arg()) };
+        std::list<Camera>      cameras;
+        std::list<CrewStation> crew_stations;
+        if (const auto result = LoadCamConfig(file.path, cameras, crew_stations); !result)
+        {
+            state.SkipWithError(fmt::format("{}", result.UnwrapErr()));
+            return;
+        }
+
+        usize bytes = 0;
+        for ([[maybe_unused]] auto _ : state)
+        {
+            auto snapshot = CamConfigSnapshot::Build(cameras, crew_stations);
+            for (const auto& [node_id, config] : snapshot.concentrators)
+                bytes += config->json.size();
+            bench::DoNotOptimize(snapshot);
+        }
+        state.SetBytesProcessed(bytes);
+    }
+    PMGRD_BENCHMARK(BM_BuildConfigSnapshot, 1, 8, 63);
+} // namespace
@@ -0,0 +1,333 @@
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include <Core/Metrics.h>
+#include <Core/SlotMap.h>
+#include <Endpoint/Endpoint.h>
+#include <Log/Logger.h>
+#include <Net/NetHandler.h>
+#include <Net/NetPacket.h>
+#include <Net/PacketStream.h>
+
+#include "Bench.h"
+
+using namespace pmgrd;
+
+namespace {
+    /**
+     * @brief Wraps both ends of a Unix socketpair into connected sockets, disposed like accepted ones.
+     * */
+    struct SocketPair
+    {
+        net::Socket* a = nullptr;
+        net::Socket* b = nullptr;
+
+        SocketPair() noexcept
+        {
+            net::CSSocket_Init();
+
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+                return;
+
+            a = Wrap(fds[0]);
+            b = Wrap(fds[1]);
+        }
+        ~SocketPair() noexcept
+        {
+            if (a)
+                net::Socket_Dispose(a);
+            if (b)
+                net::Socket_Dispose(b);
+        }
+
+        [[nodiscard]] static net::Socket* Wrap(const int fd) noexcept
+        {
+            auto* s           = static_cast<net::Socket*>(std::calloc(1, sizeof(net::Socket)));
+            s->stype          = net::SocketType_Stream;
+            s->connected      = true;
+            s->_native_handle = fd;
+            return s;
+        }
+    };
+
+    /**
+     * @brief Both ends of a loopback TCP connection using the same socket options, like the RC and an Endpoint.
+     * */
+    struct TcpPair
+    {
+        net::Socket* client = nullptr;
+        net::Socket* server = nullptr;
+
+        explicit TcpPair(const net::SocketOptions& options) noexcept
+        {
+            net::CSSocket_Init();
+
+            auto* listener = net::Socket_New(net::AddressFamily_InterNetwork, net::SocketType_Stream,
+                                             net::ProtocolType_Tcp);
+            if (!listener)
+                return;
+
+            // Whatever can't be applied, e.g. busy polling without CAP_NET_ADMIN, is measured without.
+            [[maybe_unused]] const auto listener_options = net::SetSocketOptions(listener, options);
+            const auto any = net::IPEndPoint_New(net::IPAddress_New(net::IPAddressType_Any),
+                                                 net::AddressFamily_InterNetwork, 0);
+            if (net::Socket_Bind(listener, any) == CS_SOCKET_ERROR ||
+                net::Socket_Listen(listener, 1) == CS_SOCKET_ERROR)
+            {
+                std::free(listener);
+                return;
+            }
+
+            sockaddr_in bound{};
+            socklen_t   bound_len = sizeof(bound);
+            getsockname(static_cast<int>(listener->_native_handle), reinterpret_cast<sockaddr*>(&bound), &bound_len);
+
+            client = net::Socket_New(net::AddressFamily_InterNetwork, net::SocketType_Stream, net::ProtocolType_Tcp);
+            [[maybe_unused]] const auto client_options = net::SetSocketOptions(client, options);
+            const auto loopback = net::IPEndPoint_New(net::IPAddress_Parse("127.0.0.1"),
+                                                      net::AddressFamily_InterNetwork, ntohs(bound.sin_port));
+            if (net::Socket_Connect(client, loopback) != CS_SOCKET_ERROR)
+                server = net::Socket_Accept(listener);
+            net::Socket_Dispose(listener);
+        }
+        ~TcpPair() noexcept
+        {
+            if (client)
+                net::Socket_Dispose(client);
+            if (server)
+                net::Socket_Dispose(server);
+        }
+    };
+
+    /**
+     * @brief Answers every request with @p reply until the NoOp sent once done, or until the connection fails.
+     *
+     * @param stream Whether to stream @p reply in chunks, like the RC does for Endpoints with ReadyFlags_Stream.
+     * */
+    void Respond(net::Socket* server, const std::string& reply, const bool stream) noexcept
+    {
+        const net::PacketHeader header{ net::PacketType::String };
+        while (true)
+        {
+            auto request = net::BeginReceive(server);
+            if (!request || request.Unwrap().Type() == net::PacketType::NoOp)
+                return;
+
+            const auto* data = reinterpret_cast<const u8*>(reply.data());
+            const auto  sent = (stream) ? net::SendStream(server, header, data, reply.size())
+                                        : net::BeginSend(server, net::Packet{ net::PacketType::String, reply });
+            if (!sent)
+                return;
+        }
+    }
+
+    /**
+     * @brief Times a small request answered by Arg() bytes over loopback TCP, the shape of a configuration fetch.
+     *
+     * @details Streamed replies are consumed chunk by chunk, the way `rc trace` prints them.
+     * */
+    void TcpRoundTrip(bench::State& state, const net::SocketOptions& options, const bool stream = false)
+    {
+        TcpPair pair{ options };
+        if (!pair.client || !pair.server)
+        {
+            state.SkipWithError("Failed to connect over loopback.");
+            return;
+        }
+
+        const std::string reply(static_cast<usize>(state.Arg()), 'x');
+        std::thread       responder{ Respond, pair.server, std::cref(reply), stream };
+
+        usize                    consumed = 0;
+        const net::ChunkDelegate consume  = [&consumed](const u8*, const usize size) -> Result<Err>
+        {
+            consumed += size;
+            return Ok();
+        };
+
+        for ([[maybe_unused]] auto _ : state)
+        {
+            net::Packet request{ net::PacketType::GetCtrConfig };
+            request << u64{ 0 };
+            if (!net::BeginSend(pair.client, std::move(request)))
+            {
+                state.SkipWithError("BeginSend failed.");
+                break;
+            }
+
+            auto received = net::BeginReceive(pair.client);
+            if (received && received.Unwrap().Type() == net::PacketType::StreamBegin)
+                received = net::ReceiveStream(pair.client, received.Unwrap(), consume);
+            if (!received)
+            {
+                state.SkipWithError("BeginReceive failed.");
+                break;
+            }
+            bench::DoNotOptimize(received);
+        }
+        bench::DoNotOptimize(consumed);
+
+        [[maybe_unused]] const auto stopped = net::BeginSend(pair.client, net::Packet{ net::PacketType::NoOp });
+        responder.join();
+        state.SetBytesProcessed(state.Iterations() * (reply.size() + sizeof(net::PacketHeader)));
+    }
+
+    void BM_TcpRoundTripDefault(bench::State& state)
+    {
+        TcpRoundTrip(state, net::SocketOptions{});
+    }
+    PMGRD_BENCHMARK(BM_TcpRoundTripDefault, 64, 16384, 262144);
+
+    void BM_TcpRoundTripLowLatency(bench::State& state)
+    {
+        TcpRoundTrip(state, net::SocketProfile(CS_PROFILE_CONTROL_LOW_LATENCY).Unwrap());
+    }
+    PMGRD_BENCHMARK(BM_TcpRoundTripLowLatency, 64, 16384, 262144);
+
+    void BM_TcpRoundTripBusyPoll(bench::State& state)
+    {
+        TcpRoundTrip(state, net::SocketProfile(CS_PROFILE_CONTROL_BUSY_POLL).Unwrap());
+    }
+    PMGRD_BENCHMARK(BM_TcpRoundTripBusyPoll, 64, 16384, 262144);
+
+    void BM_TcpRoundTripBulk(bench::State& state)
+    {
+        TcpRoundTrip(state, net::SocketProfile(CS_PROFILE_BULK_CONFIG).Unwrap());
+    }
+    PMGRD_BENCHMARK(BM_TcpRoundTripBulk, 64, 16384, 262144);
+
+    void BM_TcpStreamBulk(bench::State& state)
+    {
+        TcpRoundTrip(state, net::SocketProfile(CS_PROFILE_BULK_CONFIG).Unwrap(), true);
+    }
+    PMGRD_BENCHMARK(BM_TcpStreamBulk, 262144, 4194304);
+
+    void BM_PacketConstruct(bench::State& state)
+    {
+        const std::string payload(static_cast<usize>(state.Arg()), 'x');
+        for ([[maybe_unused]] auto _ : state)
+        {
+            net::Packet packet{ net::PacketType::String, payload };
+            bench::DoNotOptimize(packet);
+        }
+        state.SetBytesProcessed(state.Iterations() * payload.size());
+    }
+    PMGRD_BENCHMARK(BM_PacketConstruct, 0, 64, 1024, 16384);
+
+    void BM_PacketPushPop(bench::State& state)
+    {
+        // Arg() u64 fields pushed and then popped back, the way handlers pack and unpack ids and versions.
+        const auto fields = static_cast<u64>(state.Arg());
+        for ([[maybe_unused]] auto _ : state)
+        {
+            net::Packet packet{ net::PacketType::Join };
+            for (u64 i = 0; i < fields; ++i)
+                packet << i;
+
+            u64 sum = 0;
+            for (u64 i = 0; i < fields; ++i)
+            {
+                u64 value;
+                packet >> value;
+                sum += value;
+            }
+            bench::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(state.Iterations() * fields * sizeof(u64));
+    }
+    PMGRD_BENCHMARK(BM_PacketPushPop, 1, 2, 8, 64);
+
+    void BM_SendReceive(bench::State& state)
+    {
+        SocketPair pair;
+        if (!pair.a || !pair.b)
+        {
+            state.SkipWithError("Failed to create a socketpair.");
+            return;
+        }
+
+        // Small enough to fit the socket buffer, so that a single thread can do both ends.
+        const std::string payload(static_cast<usize>(state.Arg()), 'x');
+        for ([[maybe_unused]] auto _ : state)
+        {
+            if (!net::BeginSend(pair.a, net::Packet{ net::PacketType::String, payload }))
+            {
+                state.SkipWithError("BeginSend failed.");
+                return;
+            }
+
+            auto received = net::BeginReceive(pair.b);
+            if (!received)
+            {
+                state.SkipWithError("BeginReceive failed.");
+                return;
+            }
+            bench::DoNotOptimize(received);
+        }
+        state.SetBytesProcessed(state.Iterations() * (payload.size() + sizeof(net::PacketHeader)));
+    }
+    PMGRD_BENCHMARK(BM_SendReceive, 0, 64, 1024, 4096);
+
+    void BM_Dispatch(bench::State& state)
+    {
+        lgx::Logger::Properties properties;
+        properties.outputStreams = { &std::cerr };
+
+        Logger          logger{ properties };
+        MetricsRegistry registry;
+        net::NetHandler handler{ logger, registry, nullptr };
+
+        // Register a handler for every type like the RC does, so the lookup runs against a full map.
+        u64 handled = 0;
+        for (usize type = 0; type < net::PacketTypeCount; ++type)
+        {
+            handler.AddPacket(static_cast<net::PacketType>(type),
+                              [&handled](Endpoint&, net::Packet&& packet) -> Result<Err>
+                              {
+                                  handled += packet.data.size();
+                                  return Ok();
+                              });
+        }
+
+        Endpoint          ep{ 1, nullptr };
+        const std::string payload(static_cast<usize>(state.Arg()), 'x');
+        for ([[maybe_unused]] auto _ : state)
+            handler.Dispatch(ep, net::Packet{ net::PacketType::String, payload }, net::NetHandler::Clock::now());
+
+        bench::DoNotOptimize(handled);
+        state.SetBytesProcessed(handled);
+    }
+    PMGRD_BENCHMARK(BM_Dispatch, 0, 64, 1024);
+
+    void BM_SlotMapChurn(bench::State& state)
+    {
+        // Keep Arg() values alive and replace the oldest one per iteration, like Endpoints reconnecting.
+        const auto              live = static_cast<usize>(state.Arg());
+        SlotMap<u64>            map;
+        std::vector<SlotHandle> handles;
+        for (usize i = 0; i < live; ++i)
+            handles.push_back(map.Emplace(i));
+
+        usize oldest = 0;
+        u64   sum    = 0;
+        for ([[maybe_unused]] auto _ : state)
+        {
+            map.Erase(handles[oldest]);
+            handles[oldest] = map.Emplace(sum);
+            oldest          = (oldest + 1) % live;
+            sum += *map.Get(handles[oldest]);
+        }
+
+        bench::DoNotOptimize(sum);
+        if (map.Capacity() != live)
+            state.SkipWithError("The slot map grew while churning.");
+    }
+    PMGRD_BENCHMARK(BM_SlotMapChurn, 16, 1024, 65536);
+} // namespace
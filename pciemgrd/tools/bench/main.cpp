@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include "Bench.h"
+
+using namespace pmgrd;
+
+namespace pmgrd::bench {
+    namespace {
+        std::vector<Benchmark>& Registry()
+        {
+            static std::vector<Benchmark> s_Benchmarks;
+            return s_Benchmarks;
+        }
+
+        struct Options
+        {
+            std::string filter;
+            std::string jsonPath;
+            double      minTime = 0.5;
+        };
+
+        struct Run
+        {
+            std::string name;
+            u64         iterations;
+            double      realNs;
+            double      cpuNs;
+            double      bytesPerSecond;
+            std::string error;
+        };
+
+        /**
+         * @brief Grows the iteration count until a run lasts at least @p min_time seconds, as Google Benchmark does.
+         * */
+        [[nodiscard]] Run Measure(const Benchmark& benchmark, const i64 arg, const double min_time)
+        {
+            const auto name = benchmark.args.empty() ? benchmark.name : fmt::format("{}/{}", benchmark.name, arg);
+
+            u64 iterations = 1;
+            while (true)
+            {
+                State state{ iterations, arg };
+                benchmark.fn(state);
+                if (state.Failed())
+                    return { name, 0, 0.0, 0.0, 0.0, state.Error() };
+
+                const double seconds = std::chrono::duration<double>(state.Elapsed()).count();
+                if (seconds >= min_time || iterations >= 1'000'000'000)
+                {
+                    const double n = static_cast<double>(iterations);
+                    return { name,
+                             iterations,
+                             seconds * 1e9 / n,
+                             static_cast<double>(state.CpuNs()) / n,
+                             (seconds > 0.0) ? static_cast<double>(state.BytesProcessed()) / seconds : 0.0,
+                             {} };
+                }
+
+                // Aim a bit past the minimum, but never grow by more than 10x from a run that was too short to trust.
+                const double multiplier = (seconds <= min_time / 10.0) ? 10.0 : std::max(min_time * 1.4 / seconds, 2.0);
+                iterations = static_cast<u64>(std::ceil(static_cast<double>(iterations) * std::min(multiplier, 10.0)));
+            }
+        }
+
+        [[nodiscard]] nlohmann::json Context(const std::string_view executable)
+        {
+            char host[256] = {};
+            gethostname(host, sizeof(host) - 1);
+
+            const auto now = std::time(nullptr);
+            std::tm    tm{};
+            localtime_r(&now, &tm);
+            char date[64];
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &tm);
+
+            return { { "date", date },
+                     { "host_name", host },
+                     { "executable", executable },
+                     { "num_cpus", std::thread::hardware_concurrency() },
+#ifdef NDEBUG
+                     { "library_build_type", "release" }
+#else
+                     { "library_build_type", "debug" }
+#endif
+            };
+        }
+
+        [[nodiscard]] nlohmann::json ToJson(const Run& run)
+        {
+            nlohmann::json j = { { "name", run.name },
+                                 { "run_name", run.name },
+                                 { "run_type", "iteration" },
+                                 { "repetitions", 1 },
+                                 { "repetition_index", 0 },
+                                 { "threads", 1 },
+                                 { "iterations", run.iterations },
+                                 { "real_time", run.realNs },
+                                 { "cpu_time", run.cpuNs },
+                                 { "time_unit", "ns" } };
+            if (run.bytesPerSecond > 0.0)
+                j["bytes_per_second"] = run.bytesPerSecond;
+            if (!run.error.empty())
+            {
+                j["error_occurred"] = true;
+                j["error_message"]  = run.error;
+            }
+            return j;
+        }
+
+        [[nodiscard]] bool ParseOptions(const int argc, const char** argv, Options& options)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                const std::string_view arg{ argv[i] };
+                if (arg.starts_with("--filter="))
+                    options.filter = arg.substr(std::string_view{ "--filter=" }.size());
+                else if (arg.starts_with("--json="))
+                    options.jsonPath = arg.substr(std::string_view{ "--json=" }.size());
+                else if (arg.starts_with("--min-time="))
+                {
+                    const auto value = arg.substr(std::string_view{ "--min-time=" }.size());
+                    if (std::from_chars(value.data(), value.data() + value.size(), options.minTime).ec != std::errc{} ||
+                        options.minTime <= 0.0)
+                    {
+                        fmt::print(stderr, "Invalid --min-time '{}'.\n", value);
+                        return false;
+                    }
+                }
+                else
+                {
+                    fmt::print(stderr,
+                               "Usage: {} [--filter=<substring>] [--min-time=<seconds>] [--json=<path>]\n\n"
+                               "Runs every benchmark whose name contains <substring> for at least <seconds> (0.5 by "
+                               "default)\nand writes the results to <path> in Google Benchmark's JSON format.\n",
+                               argv[0]);
+                    return false;
+                }
+            }
+            return true;
+        }
+    } // namespace
+
+    bool Register(std::string name, BenchmarkFn fn, std::vector<i64> args)
+    {
+        Registry().push_back({ std::move(name), fn, std::move(args) });
+        return true;
+    }
+} // namespace pmgrd::bench
+
+int main(const int argc, const char** argv)
+{
+    bench::Options options;
+    if (!bench::ParseOptions(argc, argv, options))
+        return 1;
+
+    auto& benchmarks = bench::Registry();
+    std::sort(benchmarks.begin(), benchmarks.end(),
+              [](const bench::Benchmark& a, const bench::Benchmark& b) { return a.name < b.name; });
+
+    fmt::print("{:<40} {:>14} {:>14} {:>12} {:>14}\n", "Benchmark", "Time", "CPU", "Iterations", "Throughput");
+    fmt::print("{:-<98}\n", "");
+
+    auto json = nlohmann::json::array();
+    bool ok   = true;
+    for (const auto& benchmark : benchmarks)
+    {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos)
+            continue;
+
+        const auto args = benchmark.args.empty() ? std::vector<i64>{ 0 } : benchmark.args;
+        for (const auto arg : args)
+        {
+            const auto run = bench::Measure(benchmark, arg, options.minTime);
+            json.push_back(bench::ToJson(run));
+
+            if (!run.error.empty())
+            {
+                fmt::print("{:<40} ERROR: {}\n", run.name, run.error);
+                ok = false;
+                continue;
+            }
+
+            const auto throughput =
+                (run.bytesPerSecond > 0.0) ? fmt::format("{:.1f} MiB/s", run.bytesPerSecond / (1024.0 * 1024.0)) : "";
+            fmt::print("{:<40} {:>11.0f} ns {:>11.0f} ns {:>12} {:>14}\n", run.name, run.realNs, run.cpuNs,
+                       run.iterations, throughput);
+        }
+    }
+
+    if (!options.jsonPath.empty())
+    {
+        std::ofstream out{ options.jsonPath, std::ios::trunc };
+        out << nlohmann::json{ { "context", bench::Context(argv[0]) }, { "benchmarks", json } }.dump(2) << '\n';
+        if (!out)
+        {
+            fmt::print(stderr, "Failed to write '{}'.\n", options.jsonPath);
+            return 1;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
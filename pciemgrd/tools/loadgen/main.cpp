@@ -0,0 +1,811 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <Core/Error.h>
+#include <Core/Histogram.h>
+#include <Net/NetPacket.h>
+
+using namespace pmgrd;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief The requests an endpoint can be made to send.
+     * */
+    enum class Op : u8
+    {
+        Join,
+        Leave,
+        GetCtrConfig,
+        GetCrewConfig,
+        String
+    };
+    constexpr usize                                 OpCount = static_cast<usize>(Op::String) + 1;
+    constexpr std::array<std::string_view, OpCount> OpNames = { "join", "leave", "ctr", "crew", "string" };
+
+    /**
+     * @brief Highest group count a legacy endpoint can address with its single byte group ids.
+     * */
+    constexpr usize LegacyGroupCount = 256;
+
+    /**
+     * @brief Requests a connection may have in flight, further requests due on it are counted as missed.
+     * */
+    constexpr usize MaxPendingPerConnection = 64;
+
+    /**
+     * @brief How long replies are still waited for once the run is over.
+     * */
+    constexpr auto DrainTimeout = std::chrono::seconds{ 2 };
+
+    /**
+     * @brief How long a connection may take to be accepted and have its Ready acknowledged.
+     * */
+    constexpr auto HandshakeTimeout = std::chrono::seconds{ 5 };
+
+    struct Options
+    {
+        std::string                 host        = "127.0.0.1";
+        u16                         port        = 7779;
+        usize                       connections = 100;
+        double                      rate        = 1000.0;
+        double                      duration    = 10.0;
+        usize                       handshakes  = 8;
+        NodeID                      firstId     = 1;
+        usize                       groups      = 1024; ///< Group ids are drawn from [0, groups).
+        bool                        legacy      = false;
+        double                      churn       = 0.0; ///< Endpoints reconnected per second during the run.
+        usize                       stringSize  = 32;
+        std::array<double, OpCount> mix         = { 1.0, 1.0, 1.0, 1.0, 1.0 };
+    };
+
+    enum class ConnState : u8
+    {
+        Connecting,
+        Handshaking,
+        Ready,
+        Closed
+    };
+
+    struct Pending
+    {
+        Op                op;
+        Clock::time_point sentAt;
+        u16               tag;
+    };
+
+    struct Connection
+    {
+        i32                 fd        = -1;
+        NodeID              id        = 0;
+        ConnState           state     = ConnState::Closed;
+        bool                wantWrite = false;
+        Clock::time_point   startedAt;
+        std::vector<u8>     in;
+        std::vector<u8>     out;
+        usize               outPos = 0;
+        std::deque<Pending> pending;
+        bool                tagged  = false; ///< Whether the RC acknowledged tags, replies come in order otherwise.
+        u16                 lastTag = 0;
+        std::vector<bool>   groups;           ///< Whether the endpoint is a member of each group.
+        usize               joinedGroups = 0; ///< Number of set entries in @ref groups.
+        std::array<u64, 2>  versions{};       ///< Last config versions received, crew station and concentrator.
+    };
+
+    struct OpStats
+    {
+        u64       sent    = 0;
+        u64       replies = 0;
+        u64       errors  = 0;
+        Histogram latency;
+    };
+
+    [[nodiscard]] double Us(const u64 ns) noexcept
+    {
+        return static_cast<double>(ns) / 1000.0;
+    }
+
+    /**
+     * @brief Simulates a swarm of endpoints from a single epoll loop, sending requests at a fixed rate whether or
+     * not the previous ones were answered so that a slow RC shows up as latency instead of a lower send rate.
+     * */
+    class LoadGen
+    {
+    private:
+        const Options&                     m_Options;
+        i32                                m_Epoll;
+        sockaddr_in                        m_Addr;
+        std::vector<Connection>            m_Connections;
+        usize                              m_NextConnection;
+        usize                              m_Handshaking;
+        usize                              m_Established;
+        usize                              m_HandshakeFailures;
+        usize                              m_Disconnects;
+        u64                                m_Reconnects;
+        usize                              m_ChurnCursor;
+        Histogram                          m_HandshakeLatency;
+        std::array<OpStats, OpCount>       m_Stats;
+        std::array<u64, ErrTypeCount>      m_ErrorTypes{};
+        u64                                m_Missed;
+        u64                                m_Unanswered;
+        std::mt19937                       m_Rng;
+        std::discrete_distribution<usize>  m_OpDist;
+        std::uniform_int_distribution<u32> m_GroupDist;
+        std::string                        m_Payload;
+        usize                              m_RoundRobin;
+
+    public:
+        explicit LoadGen(const Options& options)
+            : m_Options(options)
+            , m_Epoll(epoll_create1(EPOLL_CLOEXEC))
+            , m_Addr{}
+            , m_Connections(options.connections)
+            , m_NextConnection(0)
+            , m_Handshaking(0)
+            , m_Established(0)
+            , m_HandshakeFailures(0)
+            , m_Disconnects(0)
+            , m_Reconnects(0)
+            , m_ChurnCursor(0)
+            , m_Missed(0)
+            , m_Unanswered(0)
+            , m_Rng(std::random_device{}())
+            , m_OpDist(options.mix.begin(), options.mix.end())
+            , m_GroupDist(0, static_cast<u32>(options.groups - 1))
+            , m_Payload(options.stringSize, 'x')
+            , m_RoundRobin(0)
+        {
+            m_Addr.sin_family = AF_INET;
+            m_Addr.sin_port   = htons(options.port);
+        }
+        LoadGen(const LoadGen&)            = delete;
+        LoadGen& operator=(const LoadGen&) = delete;
+        ~LoadGen() noexcept
+        {
+            for (auto& conn : m_Connections)
+            {
+                if (conn.fd != -1)
+                    close(conn.fd);
+            }
+            if (m_Epoll != -1)
+                close(m_Epoll);
+        }
+
+    public:
+        [[nodiscard]] bool Run()
+        {
+            if (m_Epoll == -1)
+            {
+                fmt::print(stderr, "Failed to create the epoll instance: {}\n", std::strerror(errno));
+                return false;
+            }
+            if (inet_pton(AF_INET, m_Options.host.c_str(), &m_Addr.sin_addr) != 1)
+            {
+                fmt::print(stderr, "Invalid IPv4 address '{}'.\n", m_Options.host);
+                return false;
+            }
+
+            // Ramp up with a bounded number of handshakes in flight, the RC accepts one connection at a time.
+            const auto ramp_start = Clock::now();
+            while (m_NextConnection < m_Connections.size() || m_Handshaking != 0)
+            {
+                while (m_Handshaking < m_Options.handshakes && m_NextConnection < m_Connections.size())
+                    Connect(m_NextConnection++);
+                Poll(10);
+                ExpireHandshakes(Clock::now());
+            }
+            const double ramp = std::chrono::duration<double>(Clock::now() - ramp_start).count();
+            fmt::print("Connected {} endpoint(s) in {:.2f} s, {} failed, handshake p50 {:.1f} us, p99 {:.1f} us.\n",
+                       m_Established, ramp, m_HandshakeFailures, Us(m_HandshakeLatency.Percentile(0.5)),
+                       Us(m_HandshakeLatency.Percentile(0.99)));
+            if (m_Established == 0)
+                return false;
+
+            const auto start    = Clock::now();
+            const auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>{ m_Options.duration });
+            auto       next_report = start + std::chrono::seconds{ 1 };
+            u64        issued      = 0;
+            u64        churned     = 0;
+            u64        last_sent = 0, last_replies = 0;
+            for (auto now = start; now < deadline; now = Clock::now())
+            {
+                const double since_start = std::chrono::duration<double>(now - start).count();
+                const auto   due         = static_cast<u64>(since_start * m_Options.rate) + 1;
+                for (; issued < due; ++issued)
+                    Issue(now);
+
+                const auto churn_due = static_cast<u64>(since_start * m_Options.churn);
+                for (; churned < churn_due; ++churned)
+                    Churn();
+
+                Poll(1);
+                if (m_Handshaking != 0)
+                    ExpireHandshakes(now);
+
+                if (now >= next_report)
+                {
+                    const auto [sent, replies, errors] = Totals();
+                    fmt::print("[{:>5.1f} s] {} endpoint(s), sent {}/s, replied {}/s, in flight {}, errors {}, "
+                               "reconnects {}.\n",
+                               since_start, m_Established, sent - last_sent, replies - last_replies, sent - replies,
+                               errors, m_Reconnects);
+                    last_sent    = sent;
+                    last_replies = replies;
+                    next_report += std::chrono::seconds{ 1 };
+                }
+            }
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+            // Give the replies still in flight a chance to come in.
+            const auto drain_deadline = Clock::now() + DrainTimeout;
+            while (Clock::now() < drain_deadline && InFlight() != 0)
+                Poll(10);
+            for (const auto& conn : m_Connections)
+                m_Unanswered += conn.pending.size();
+
+            Report(elapsed);
+            return true;
+        }
+
+    private:
+        void Connect(const usize index)
+        {
+            auto& conn     = m_Connections[index];
+            conn.id        = static_cast<NodeID>(m_Options.firstId + index);
+            conn.startedAt = Clock::now();
+            conn.fd        = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+            if (conn.fd == -1)
+            {
+                fmt::print(stderr, "EP#{}: failed to create a socket: {}\n", conn.id, std::strerror(errno));
+                ++m_HandshakeFailures;
+                return;
+            }
+
+            const i32 one = 1;
+            setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            if (connect(conn.fd, reinterpret_cast<const sockaddr*>(&m_Addr), sizeof(m_Addr)) == -1 &&
+                errno != EINPROGRESS)
+            {
+                fmt::print(stderr, "EP#{}: failed to connect: {}\n", conn.id, std::strerror(errno));
+                close(conn.fd);
+                conn.fd = -1;
+                ++m_HandshakeFailures;
+                return;
+            }
+
+            conn.state     = ConnState::Connecting;
+            conn.wantWrite = true;
+            ++m_Handshaking;
+
+            // The RC keeps the memberships of a node across reconnects.
+            if (conn.groups.empty())
+                conn.groups.assign(m_Options.groups, false);
+
+            epoll_event ev{};
+            ev.events   = EPOLLIN | EPOLLOUT;
+            ev.data.u64 = index;
+            epoll_ctl(m_Epoll, EPOLL_CTL_ADD, conn.fd, &ev);
+        }
+
+        void ExpireHandshakes(const Clock::time_point now)
+        {
+            for (usize i = 0; i < m_NextConnection; ++i)
+            {
+                const auto state = m_Connections[i].state;
+                if ((state == ConnState::Connecting || state == ConnState::Handshaking) &&
+                    now - m_Connections[i].startedAt > HandshakeTimeout)
+                    Close(i, "timed out");
+            }
+        }
+
+        /**
+         * @brief Disconnects the next idle endpoint and connects it again under the same node id.
+         * */
+        void Churn()
+        {
+            for (usize tries = 0; tries < m_Connections.size(); ++tries)
+            {
+                const usize index = m_ChurnCursor;
+                m_ChurnCursor     = (m_ChurnCursor + 1) % m_Connections.size();
+
+                // Only idle endpoints, so that no reply goes missing.
+                auto& conn = m_Connections[index];
+                if (conn.state != ConnState::Ready || !conn.pending.empty())
+                    continue;
+
+                // Reset instead of closing gracefully, thousands of reconnects per second would otherwise run out
+                // of local ports to TIME_WAIT.
+                const linger reset{ .l_onoff = 1, .l_linger = 0 };
+                setsockopt(conn.fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+
+                epoll_ctl(m_Epoll, EPOLL_CTL_DEL, conn.fd, nullptr);
+                close(conn.fd);
+                conn.fd    = -1;
+                conn.state = ConnState::Closed;
+                conn.in.clear();
+                conn.out.clear();
+                conn.outPos = 0;
+                --m_Established;
+                ++m_Reconnects;
+
+                Connect(index);
+                return;
+            }
+        }
+
+        void Poll(const i32 timeout_ms)
+        {
+            std::array<epoll_event, 256> events;
+            const i32                    n = epoll_wait(m_Epoll, events.data(), events.size(), timeout_ms);
+            for (i32 i = 0; i < n; ++i)
+            {
+                const usize index = events[i].data.u64;
+                auto&       conn  = m_Connections[index];
+                if (conn.state == ConnState::Closed)
+                    continue;
+
+                if (conn.state == ConnState::Connecting)
+                {
+                    i32       err = 0;
+                    socklen_t len = sizeof(err);
+                    getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                    if (err != 0 || (events[i].events & (EPOLLERR | EPOLLHUP)))
+                    {
+                        Close(index, fmt::format("failed to connect: {}", std::strerror(err)));
+                        continue;
+                    }
+
+                    conn.state = ConnState::Handshaking;
+                    if (m_Options.legacy)
+                    {
+                        // Legacy Ready packet, the single byte node id without any flags.
+                        net::Packet ready{ net::PacketType::Ready };
+                        ready << static_cast<u8>(conn.id);
+                        Queue(conn, ready);
+                    }
+                    else
+                        Queue(conn, net::MakeReady(conn.id, net::ReadyFlags_Tags));
+                    Flush(index);
+                    continue;
+                }
+
+                if (events[i].events & EPOLLIN)
+                    Read(index);
+                if (conn.state != ConnState::Closed && (events[i].events & EPOLLOUT))
+                    Flush(index);
+                if (conn.state != ConnState::Closed && (events[i].events & (EPOLLERR | EPOLLHUP)))
+                    Close(index, "connection reset");
+            }
+        }
+
+        void Issue(const Clock::time_point now)
+        {
+            // Find a connection that can take one more request.
+            for (usize tries = 0; tries < m_Connections.size(); ++tries)
+            {
+                const usize index = m_RoundRobin;
+                m_RoundRobin      = (m_RoundRobin + 1) % m_Connections.size();
+
+                auto& conn = m_Connections[index];
+                if (conn.state != ConnState::Ready || conn.pending.size() >= MaxPendingPerConnection)
+                    continue;
+
+                auto op = static_cast<Op>(m_OpDist(m_Rng));
+                if (op == Op::Leave && conn.joinedGroups == 0)
+                    op = Op::Join;
+                else if (op == Op::Join && conn.joinedGroups == conn.groups.size())
+                    op = Op::Leave;
+
+                net::Packet packet;
+                switch (op)
+                {
+                    case Op::Join:
+                    case Op::Leave: {
+                        // Join a group the endpoint isn't in and leave one it is in, so the RC only refuses
+                        // requests that raced with each other.
+                        const bool joining = op == Op::Join;
+                        auto       group   = static_cast<GroupID>(m_GroupDist(m_Rng));
+                        while (conn.groups[group] == joining)
+                            group = static_cast<GroupID>((group + 1) % conn.groups.size());
+                        conn.groups[group] = joining;
+                        if (joining)
+                            ++conn.joinedGroups;
+                        else
+                            --conn.joinedGroups;
+                        packet = net::Packet{ joining ? net::PacketType::Join : net::PacketType::Leave };
+                        if (m_Options.legacy)
+                            packet << static_cast<u8>(group);
+                        else
+                            packet << group;
+                        break;
+                    }
+                    case Op::GetCrewConfig:
+                        packet = net::Packet{ net::PacketType::GetCrewConfig };
+                        packet << conn.versions[0];
+                        break;
+                    case Op::GetCtrConfig:
+                        packet = net::Packet{ net::PacketType::GetCtrConfig };
+                        packet << conn.versions[1];
+                        break;
+                    case Op::String: packet = net::Packet{ net::PacketType::String, m_Payload }; break;
+                }
+
+                // Tag 0 marks untagged packets, so tags wrap around past it.
+                conn.lastTag      = static_cast<u16>(conn.lastTag % UINT16_MAX + 1);
+                packet.header.tag = (conn.tagged) ? conn.lastTag : 0;
+                conn.pending.push_back({ op, now, packet.header.tag });
+                ++m_Stats[static_cast<usize>(op)].sent;
+                Queue(conn, packet);
+                Flush(index);
+                return;
+            }
+            ++m_Missed;
+        }
+
+        void Queue(Connection& conn, const net::Packet& packet)
+        {
+            const auto* header = reinterpret_cast<const u8*>(&packet.header);
+            conn.out.insert(conn.out.end(), header, header + sizeof(packet.header));
+            conn.out.insert(conn.out.end(), packet.data.begin(), packet.data.end());
+        }
+
+        void Flush(const usize index)
+        {
+            auto& conn = m_Connections[index];
+            while (conn.outPos < conn.out.size())
+            {
+                const auto res =
+                    send(conn.fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+                if (res == -1 && errno == EINTR)
+                    continue;
+                if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // Level-triggered, only ask for writability while there's something left to write.
+                    WatchWrite(index, true);
+                    return;
+                }
+                if (res == -1)
+                {
+                    Close(index, fmt::format("failed to send: {}", std::strerror(errno)));
+                    return;
+                }
+                conn.outPos += static_cast<usize>(res);
+            }
+            conn.out.clear();
+            conn.outPos = 0;
+            WatchWrite(index, false);
+        }
+
+        void WatchWrite(const usize index, const bool write)
+        {
+            auto& conn = m_Connections[index];
+            if (conn.wantWrite == write)
+                return;
+
+            epoll_event ev{};
+            ev.events   = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+            ev.data.u64 = index;
+            epoll_ctl(m_Epoll, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.wantWrite = write;
+        }
+
+        void Read(const usize index)
+        {
+            auto& conn = m_Connections[index];
+            u8    buffer[16384];
+            while (true)
+            {
+                const auto res = recv(conn.fd, buffer, sizeof(buffer), 0);
+                if (res == -1 && errno == EINTR)
+                    continue;
+                if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                if (res <= 0)
+                {
+                    Close(index, (res == 0) ? "closed by the RC" : std::strerror(errno));
+                    return;
+                }
+                conn.in.insert(conn.in.end(), buffer, buffer + res);
+            }
+
+            usize offset = 0;
+            while (conn.in.size() - offset >= sizeof(net::PacketHeader))
+            {
+                net::PacketHeader header;
+                std::memcpy(&header, conn.in.data() + offset, sizeof(header));
+                if (conn.in.size() - offset - sizeof(header) < header.dataLen)
+                    break;
+
+                const auto* data = conn.in.data() + offset + sizeof(header);
+                offset += sizeof(header) + header.dataLen;
+                if (!OnPacket(index, header, data))
+                    return;
+            }
+            conn.in.erase(conn.in.begin(), conn.in.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        [[nodiscard]] bool OnPacket(const usize index, const net::PacketHeader& header, const u8* data)
+        {
+            auto&      conn = m_Connections[index];
+            const auto now  = Clock::now();
+            if (conn.state == ConnState::Handshaking)
+            {
+                if (header.type != net::PacketType::Ok)
+                {
+                    Close(index, fmt::format("Ready was answered with {}", net::TypeToStr(header.type)));
+                    return false;
+                }
+
+                // An RC honouring tags appends the flags it accepted. Replies of one that doesn't come in order, a
+                // journaling RC answers Join and Leave after the requests that followed them otherwise.
+                conn.tagged  = header.dataLen == sizeof(u8) && (data[0] & net::ReadyFlags_Tags);
+                conn.lastTag = 0;
+                conn.state   = ConnState::Ready;
+                --m_Handshaking;
+                ++m_Established;
+                m_HandshakeLatency.Record(static_cast<u64>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - conn.startedAt).count()));
+                return true;
+            }
+
+            // Not subscribed, but pushes aren't replies either way.
+            if (header.type == net::PacketType::ConfigUpdate || conn.pending.empty())
+                return true;
+
+            auto it = conn.pending.begin();
+            if (conn.tagged)
+            {
+                it = std::find_if(conn.pending.begin(), conn.pending.end(),
+                                  [&header](const Pending& pending) { return pending.tag == header.tag; });
+                if (it == conn.pending.end())
+                    return true;
+            }
+            const auto request = *it;
+            conn.pending.erase(it);
+
+            auto& stats = m_Stats[static_cast<usize>(request.op)];
+            ++stats.replies;
+            stats.latency.Record(static_cast<u64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - request.sentAt).count()));
+
+            if (header.type == net::PacketType::Err)
+            {
+                ++stats.errors;
+                if (header.dataLen >= sizeof(ErrType) && static_cast<usize>(data[0]) < ErrTypeCount)
+                    ++m_ErrorTypes[data[0]];
+            }
+            else if (header.type == net::PacketType::Config && header.dataLen >= sizeof(u64) &&
+                     (request.op == Op::GetCrewConfig || request.op == Op::GetCtrConfig))
+            {
+                // The version trails the configuration, the next request only gets NotModified.
+                std::memcpy(&conn.versions[request.op == Op::GetCrewConfig ? 0 : 1],
+                            data + header.dataLen - sizeof(u64), sizeof(u64));
+            }
+            return true;
+        }
+
+        void Close(const usize index, const std::string_view reason)
+        {
+            auto& conn = m_Connections[index];
+            if (conn.state == ConnState::Connecting || conn.state == ConnState::Handshaking)
+            {
+                fmt::print(stderr, "EP#{}: handshake failed, {}.\n", conn.id, reason);
+                --m_Handshaking;
+                ++m_HandshakeFailures;
+            }
+            else if (conn.state == ConnState::Ready)
+            {
+                fmt::print(stderr, "EP#{}: disconnected, {}.\n", conn.id, reason);
+                --m_Established;
+                ++m_Disconnects;
+                m_Unanswered += conn.pending.size();
+                conn.pending.clear();
+            }
+
+            epoll_ctl(m_Epoll, EPOLL_CTL_DEL, conn.fd, nullptr);
+            close(conn.fd);
+            conn.fd    = -1;
+            conn.state = ConnState::Closed;
+        }
+
+        [[nodiscard]] std::array<u64, 3> Totals() const noexcept
+        {
+            std::array<u64, 3> totals{};
+            for (const auto& stats : m_Stats)
+            {
+                totals[0] += stats.sent;
+                totals[1] += stats.replies;
+                totals[2] += stats.errors;
+            }
+            return totals;
+        }
+
+        [[nodiscard]] usize InFlight() const noexcept
+        {
+            usize in_flight = 0;
+            for (const auto& conn : m_Connections)
+                in_flight += conn.pending.size();
+            return in_flight;
+        }
+
+        void Report(const double elapsed) const
+        {
+            const auto [sent, replies, errors] = Totals();
+            fmt::print("\nEndpoints: {} connected, {} failed to connect, {} disconnected, {} reconnected.\n",
+                       m_Established, m_HandshakeFailures, m_Disconnects, m_Reconnects);
+            fmt::print("Requests:  {} sent, {} answered, {} unanswered, {} missed (every endpoint had {} in flight).\n",
+                       sent, replies, m_Unanswered, m_Missed, MaxPendingPerConnection);
+            fmt::print("Throughput: {:.0f} replies/s over {:.2f} s (target {:.0f}/s), error rate {:.2f}%.\n\n",
+                       static_cast<double>(replies) / elapsed, elapsed, m_Options.rate,
+                       (replies != 0) ? 100.0 * static_cast<double>(errors) / static_cast<double>(replies) : 0.0);
+
+            fmt::print("{:<8} {:>10} {:>10} {:>8} {:>8} {:>11} {:>11} {:>11} {:>11}\n", "Request", "Sent", "Replies",
+                       "Errors", "Error%", "p50 (us)", "p99 (us)", "p999 (us)", "max (us)");
+            for (usize i = 0; i < OpCount; ++i)
+            {
+                const auto& stats = m_Stats[i];
+                if (stats.sent == 0)
+                    continue;
+
+                const double error_rate =
+                    (stats.replies != 0) ? 100.0 * static_cast<double>(stats.errors) / stats.replies : 0.0;
+                fmt::print("{:<8} {:>10} {:>10} {:>8} {:>7.2f}% {:>11.1f} {:>11.1f} {:>11.1f} {:>11.1f}\n", OpNames[i],
+                           stats.sent, stats.replies, stats.errors, error_rate, Us(stats.latency.Percentile(0.5)),
+                           Us(stats.latency.Percentile(0.99)), Us(stats.latency.Percentile(0.999)),
+                           Us(stats.latency.Max()));
+            }
+
+            std::string by_type;
+            for (usize i = 0; i < ErrTypeCount; ++i)
+            {
+                if (m_ErrorTypes[i] != 0)
+                    by_type += fmt::format(" {} {},", ErrTypeToStr(static_cast<ErrType>(i)), m_ErrorTypes[i]);
+            }
+            if (!by_type.empty())
+            {
+                by_type.pop_back();
+                fmt::print("\nErrors by type:{}\n", by_type);
+            }
+        }
+    };
+
+    template <typename T>
+    [[nodiscard]] bool ParseNumber(const std::string_view str, T& value) noexcept
+    {
+        return std::from_chars(str.data(), str.data() + str.size(), value).ec == std::errc{};
+    }
+
+    [[nodiscard]] bool ParseMix(const std::string_view str, std::array<double, OpCount>& mix) noexcept
+    {
+        mix.fill(0.0);
+        usize pos = 0;
+        while (pos <= str.size())
+        {
+            const auto end   = std::min(str.find(',', pos), str.size());
+            const auto item  = str.substr(pos, end - pos);
+            const auto colon = item.find(':');
+            if (colon == std::string_view::npos)
+                return false;
+
+            const auto it = std::find(OpNames.begin(), OpNames.end(), item.substr(0, colon));
+            if (it == OpNames.end())
+                return false;
+
+            auto& weight = mix[static_cast<usize>(it - OpNames.begin())];
+            if (!ParseNumber(item.substr(colon + 1), weight) || weight < 0.0)
+                return false;
+            pos = end + 1;
+        }
+        return std::any_of(mix.begin(), mix.end(), [](const double w) { return w > 0.0; });
+    }
+
+    [[nodiscard]] bool ParseOptions(const int argc, const char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg{ argv[i] };
+            const auto             eq    = arg.find('=');
+            const auto             key   = arg.substr(0, eq);
+            const auto             value = (eq != std::string_view::npos) ? arg.substr(eq + 1) : std::string_view{};
+
+            bool ok = eq != std::string_view::npos;
+            if (arg == "--legacy")
+            {
+                options.legacy = true;
+                ok             = true;
+            }
+            else if (ok && key == "--host")
+                options.host = value;
+            else if (ok && key == "--port")
+                ok = ParseNumber(value, options.port);
+            else if (ok && key == "--connections")
+                ok = ParseNumber(value, options.connections) && options.connections > 0;
+            else if (ok && key == "--rate")
+                ok = ParseNumber(value, options.rate) && options.rate > 0.0;
+            else if (ok && key == "--duration")
+                ok = ParseNumber(value, options.duration) && options.duration > 0.0;
+            else if (ok && key == "--handshakes")
+                ok = ParseNumber(value, options.handshakes) && options.handshakes > 0;
+            else if (ok && key == "--first-id")
+                ok = ParseNumber(value, options.firstId);
+            else if (ok && key == "--churn")
+                ok = ParseNumber(value, options.churn) && options.churn >= 0.0;
+            else if (ok && key == "--groups")
+                ok = ParseNumber(value, options.groups) && options.groups > 0 && options.groups <= MaxGroupID + 1ull;
+            else if (ok && key == "--string-size")
+                ok = ParseNumber(value, options.stringSize);
+            else if (ok && key == "--mix")
+                ok = ParseMix(value, options.mix);
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                fmt::print(stderr,
+                           "Usage: {} [--host=127.0.0.1] [--port=7779] [--connections=100] [--rate=1000] "
+                           "[--duration=10]\n"
+                           "          [--mix=join:1,leave:1,ctr:1,crew:1,string:1] [--handshakes=8] [--first-id=1] "
+                           "[--groups=1024]\n          [--string-size=32] [--churn=0] [--legacy]\n\n"
+                           "Connects <connections> simulated endpoints to the RC, <handshakes> at a time, then sends "
+                           "<rate> requests/s\nspread over them for <duration> seconds, picking each request from "
+                           "the weighted <mix>.\n--churn reconnects that many idle endpoints per second, --legacy "
+                           "speaks the single byte node and\ngroup id protocol and takes replies in order, tags match "
+                           "them otherwise.\n",
+                           argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+int main(const int argc, const char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    // Every endpoint is a socket, thousands of them don't fit the default soft limit.
+    if (rlimit limit{}; getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (options.legacy && options.groups > LegacyGroupCount)
+    {
+        fmt::print(stderr, "Legacy endpoints can only address {} groups.\n", LegacyGroupCount);
+        options.groups = LegacyGroupCount;
+    }
+
+    const usize id_count = (options.legacy) ? 256 : MaxNodeID + 1ull;
+    if (options.connections > id_count)
+        fmt::print(stderr, "Only {} node ids exist, {} endpoints will share ids.\n", id_count, options.connections);
+
+    LoadGen loadgen{ options };
+    return loadgen.Run() ? 0 : 1;
+}
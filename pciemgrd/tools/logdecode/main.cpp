@@ -0,0 +1,282 @@
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include <Log/BinaryLogFormat.h>
+
+using namespace pmgrd;
+
+namespace {
+    struct Format
+    {
+        binlog::Level level;
+        std::string   fmt;
+        std::string   func;
+    };
+
+    /**
+     * @brief Bounds checked reader over a record.
+     * */
+    class Reader
+    {
+    private:
+        const u8* m_Pos;
+        const u8* m_End;
+
+    public:
+        Reader(const u8* begin, const u8* end) noexcept
+            : m_Pos(begin)
+            , m_End(end)
+        {
+        }
+
+    public:
+        template <typename T>
+        bool Get(T& value) noexcept
+        {
+            if (static_cast<usize>(m_End - m_Pos) < sizeof(T))
+                return false;
+            std::memcpy(&value, m_Pos, sizeof(T));
+            m_Pos += sizeof(T);
+            return true;
+        }
+
+        bool GetString(std::string& str, const usize size) noexcept
+        {
+            if (static_cast<usize>(m_End - m_Pos) < size)
+                return false;
+            str.assign(reinterpret_cast<const char*>(m_Pos), size);
+            m_Pos += size;
+            return true;
+        }
+
+        [[nodiscard]] bool AtEnd() const noexcept { return m_Pos >= m_End; }
+    };
+
+    [[nodiscard]] std::string FormatTime(const binlog::FileHeader& header, const u64 timestamp)
+    {
+        const i64  ns   = header.realtimeBaseNs + (static_cast<i64>(timestamp) - header.monotonicBaseNs);
+        const auto secs = static_cast<std::time_t>(ns / 1'000'000'000);
+
+        std::tm tm{};
+        localtime_r(&secs, &tm);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        return fmt::format("{}.{:06}", buf, (ns % 1'000'000'000) / 1000);
+    }
+
+    bool DecodeFormat(Reader reader, std::unordered_map<u32, Format>& formats)
+    {
+        u32 id;
+        u8  level, reserved;
+        u16 fmt_len, func_len;
+        if (!reader.Get(id) || !reader.Get(level) || !reader.Get(reserved) || !reader.Get(fmt_len) ||
+            !reader.Get(func_len))
+            return false;
+
+        Format format{ static_cast<binlog::Level>(level), {}, {} };
+        if (!reader.GetString(format.fmt, fmt_len) || !reader.GetString(format.func, func_len))
+            return false;
+
+        formats[id] = std::move(format);
+        return true;
+    }
+
+    bool DecodeEvent(Reader reader, const binlog::FileHeader& header, const std::unordered_map<u32, Format>& formats)
+    {
+        u32 id, reserved;
+        u64 timestamp;
+        if (!reader.Get(id) || !reader.Get(reserved) || !reader.Get(timestamp))
+            return false;
+
+        const auto it = formats.find(id);
+        if (it == formats.end())
+            return false;
+        const auto& format = it->second;
+
+        fmt::dynamic_format_arg_store<fmt::format_context> args;
+        while (!reader.AtEnd())
+        {
+            u8 type;
+            if (!reader.Get(type))
+                return false;
+
+            if (static_cast<binlog::ArgType>(type) == binlog::ArgType::String)
+            {
+                u32         size;
+                std::string str;
+                if (!reader.Get(size) || !reader.GetString(str, size))
+                    return false;
+                args.push_back(std::move(str));
+                continue;
+            }
+
+            u64 raw;
+            if (!reader.Get(raw))
+                return false;
+
+            switch (static_cast<binlog::ArgType>(type))
+            {
+                case binlog::ArgType::Bool: args.push_back(raw != 0); break;
+                case binlog::ArgType::Char: args.push_back(static_cast<char>(raw)); break;
+                case binlog::ArgType::Int: args.push_back(static_cast<i64>(raw)); break;
+                case binlog::ArgType::UInt: args.push_back(raw); break;
+                case binlog::ArgType::Float: {
+                    double value;
+                    std::memcpy(&value, &raw, sizeof(value));
+                    args.push_back(value);
+                    break;
+                }
+                default: return false;
+            }
+        }
+
+        std::string msg;
+        try
+        {
+            msg = fmt::vformat(format.fmt, args);
+        }
+        catch (const fmt::format_error& e)
+        {
+            msg = fmt::format("<{}: {}>", e.what(), format.fmt);
+        }
+
+        if (format.func.empty())
+            fmt::print("[{}] [{}]: {}\n", FormatTime(header, timestamp), binlog::LevelToStr(format.level), msg);
+        else
+            fmt::print("[{}] [{}] {}: {}\n", FormatTime(header, timestamp), binlog::LevelToStr(format.level),
+                       format.func, msg);
+        return true;
+    }
+
+    /**
+     * @brief Decodes the records of the format region or the event ring.
+     * */
+    class Decoder
+    {
+    private:
+        const binlog::FileHeader&       m_Header;
+        std::unordered_map<u32, Format> m_Formats;
+        usize                           m_Corrupt;
+
+    public:
+        explicit Decoder(const binlog::FileHeader& header) noexcept
+            : m_Header(header)
+            , m_Corrupt(0)
+        {
+        }
+
+    public:
+        /**
+         * @brief Decodes the records between @p begin and @p end of a region whose start is at @p base of it.
+         *
+         * @details Space that doesn't hold a whole record at the position it was reserved at is skipped until one
+         * is found: the part of an older lap the current one wrapped over, or a record the process died writing.
+         * */
+        void DecodeRegion(const u8* const region, usize begin, const usize end, const u64 base)
+        {
+            while (begin + sizeof(binlog::RecordHeader) <= end)
+            {
+                binlog::RecordHeader record;
+                std::memcpy(&record, region + begin, sizeof(record));
+
+                if (record.position != base + begin || record.size < sizeof(record) + record.padding ||
+                    record.size % binlog::RecordAlignment != 0 || begin + record.size > end)
+                {
+                    begin += binlog::RecordAlignment;
+                    continue;
+                }
+
+                const Reader body{ region + begin + sizeof(record), region + begin + record.size - record.padding };
+                bool         ok = true;
+                switch (static_cast<binlog::RecordKind>(record.kind))
+                {
+                    case binlog::RecordKind::Format: ok = DecodeFormat(body, m_Formats); break;
+                    case binlog::RecordKind::Event: ok = DecodeEvent(body, m_Header, m_Formats); break;
+                    case binlog::RecordKind::Skip: break;
+                    // Never committed, the process died while writing it.
+                    default: ok = false; break;
+                }
+                if (!ok)
+                    ++m_Corrupt;
+
+                begin += record.size;
+            }
+        }
+
+        [[nodiscard]] usize GetCorrupt() const noexcept { return m_Corrupt; }
+    };
+} // namespace
+
+int main(const int argc, const char** argv)
+{
+    if (argc != 2)
+    {
+        fmt::print(stderr, "Usage:\n\t{} <binary log>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream fs{ argv[1], std::ios_base::in | std::ios_base::binary };
+    if (!fs.is_open())
+    {
+        fmt::print(stderr, "Unable to open '{}' for reading.\n", argv[1]);
+        return 1;
+    }
+    const std::vector<u8> data{ std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>() };
+
+    binlog::FileHeader header;
+    if (data.size() < sizeof(header))
+    {
+        fmt::print(stderr, "'{}' is not a binary log.\n", argv[1]);
+        return 1;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, binlog::Magic, sizeof(header.magic)) != 0 || header.version != binlog::Version)
+    {
+        fmt::print(stderr, "'{}' is not a version {} binary log.\n", argv[1], binlog::Version);
+        return 1;
+    }
+
+    if (header.headerSize > header.ringOffset || header.ringOffset + header.ringSize > data.size() ||
+        header.ringSize == 0)
+    {
+        fmt::print(stderr, "'{}' is truncated.\n", argv[1]);
+        return 1;
+    }
+
+    Decoder decoder{ header };
+
+    // Formats first, the events left in the ring may refer to any of them.
+    const u8* const formats     = data.data() + header.headerSize;
+    const usize     format_size = header.ringOffset - header.headerSize;
+    decoder.DecodeRegion(formats, 0, std::min<usize>(header.formatOffset, format_size), 0);
+
+    // Once the ring wrapped, the oldest events left are past the newest ones up to its end, followed by the
+    // current lap from its start.
+    const u8* const ring = data.data() + header.ringOffset;
+    const u64       lap  = header.writeOffset - header.writeOffset % header.ringSize;
+    const usize     head = header.writeOffset % header.ringSize;
+    if (lap != 0)
+    {
+        decoder.DecodeRegion(ring, head, header.ringSize, lap - header.ringSize);
+        fmt::print(stderr, "The log wrapped, events older than the last {} bytes were overwritten.\n",
+                   header.ringSize);
+    }
+    decoder.DecodeRegion(ring, 0, head, lap);
+
+    const usize corrupt = decoder.GetCorrupt();
+    if (corrupt != 0)
+        fmt::print(stderr, "{} record(s) could not be decoded.\n", corrupt);
+    if (header.dropped != 0)
+        fmt::print(stderr, "{} record(s) were dropped, the format region was full or they didn't fit into the ring.\n",
+                   header.dropped);
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_set>
+
+#include <Core/MembershipJournal.h>
+#include <Core/Metrics.h>
+#include <Log/Logger.h>
+
+#include "Test.h"
+
+using namespace pmgrd;
+
+namespace {
+    // Layout of membership.wal, see MembershipJournal.cpp.
+    constexpr usize LogRecordSize = 24;
+
+    /**
+     * @brief A directory of its own for every test, removed along with everything the test left in it.
+     * */
+    struct TempDir
+    {
+        std::filesystem::path path;
+
+        TempDir()
+        {
+            std::string tmpl = (std::filesystem::temp_directory_path() / "pciemgrd_test.XXXXXX").string();
+            if (mkdtemp(tmpl.data()))
+                path = tmpl;
+        }
+        ~TempDir() noexcept
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(path, ec);
+        }
+
+        [[nodiscard]] std::filesystem::path Wal() const { return path / "membership.wal"; }
+        [[nodiscard]] std::filesystem::path Snapshot() const { return path / "membership.snap"; }
+    };
+
+    struct Journal
+    {
+        Logger            logger;
+        MetricsRegistry   registry;
+        MembershipJournal journal;
+
+        explicit Journal(const TempDir& dir)
+            : logger(Properties())
+            , journal(logger, registry, dir.path.string())
+        {
+        }
+
+        [[nodiscard]] static lgx::Logger::Properties Properties()
+        {
+            lgx::Logger::Properties properties;
+            properties.outputStreams = { &std::cerr };
+            return properties;
+        }
+    };
+
+    /**
+     * @brief Journals node 1 to @p nodes joining group 1 and keeps only the log, as if the RC died before it
+     * stopped and left a snapshot behind.
+     * */
+    [[nodiscard]] bool WriteLog(const TempDir& dir, const NodeID nodes)
+    {
+        const auto kept = dir.path / "membership.wal.kept";
+        {
+            Journal j{ dir };
+            if (!j.journal.Recover())
+                return false;
+            j.journal.Start();
+
+            // Changes complete in the order they were appended, the last one follows the others to disk.
+            std::promise<bool> done;
+            for (NodeID node_id = 1; node_id <= nodes; ++node_id)
+            {
+                j.journal.Append(MembershipOp::Join, 1, node_id,
+                                 [&done, last = node_id == nodes](const Result<Err>& result)
+                                 {
+                                     if (last)
+                                         done.set_value(static_cast<bool>(result));
+                                 });
+            }
+            if (!done.get_future().get())
+                return false;
+
+            std::filesystem::copy_file(dir.Wal(), kept);
+        }
+
+        std::filesystem::remove(dir.Snapshot());
+        std::filesystem::rename(kept, dir.Wal());
+        return std::filesystem::file_size(dir.Wal()) == nodes * LogRecordSize;
+    }
+
+    void AppendBytes(const std::filesystem::path& path, const std::string& bytes)
+    {
+        std::ofstream out{ path, std::ios::binary | std::ios::app };
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    [[nodiscard]] std::string ReadBytes(const std::filesystem::path& path)
+    {
+        std::ifstream in{ path, std::ios::binary };
+        return std::string{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+    }
+
+    void FlipByte(const std::filesystem::path& path, const usize offset)
+    {
+        std::fstream file{ path, std::ios::binary | std::ios::in | std::ios::out };
+        file.seekg(static_cast<std::streamoff>(offset));
+        const char byte = static_cast<char>(file.get() ^ 0xff);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.put(byte);
+    }
+
+    void Journal_TornRecord()
+    {
+        TempDir dir;
+        if (!PMGRD_EXPECT(WriteLog(dir, 3)))
+            return;
+
+        // Half a record, the RC died while appending it.
+        AppendBytes(dir.Wal(), std::string(LogRecordSize / 2, '\x5a'));
+        {
+            Journal    j{ dir };
+            const auto groups = j.journal.Recover();
+            if (!PMGRD_EXPECT(groups))
+                return;
+            PMGRD_EXPECT(groups.Unwrap().at(1) == (std::unordered_set<NodeID>{ 1, 2, 3 }));
+            PMGRD_EXPECT(std::filesystem::file_size(dir.Wal()) == 3 * LogRecordSize);
+        }
+
+        // A whole record whose checksum doesn't match, replay stops before it.
+        FlipByte(dir.Wal(), 2 * LogRecordSize + 8);
+        {
+            Journal    j{ dir };
+            const auto groups = j.journal.Recover();
+            if (!PMGRD_EXPECT(groups))
+                return;
+            PMGRD_EXPECT(groups.Unwrap().at(1) == (std::unordered_set<NodeID>{ 1, 2 }));
+            PMGRD_EXPECT(std::filesystem::file_size(dir.Wal()) == 2 * LogRecordSize);
+        }
+    }
+    PMGRD_TEST(Journal_TornRecord);
+
+    void Journal_OutOfSequence()
+    {
+        TempDir dir;
+        if (!PMGRD_EXPECT(WriteLog(dir, 3)))
+            return;
+
+        // The first record again, valid on its own but not the one following the third.
+        AppendBytes(dir.Wal(), ReadBytes(dir.Wal()).substr(0, LogRecordSize));
+
+        Journal    j{ dir };
+        const auto groups = j.journal.Recover();
+        if (!PMGRD_EXPECT(groups))
+            return;
+        PMGRD_EXPECT(groups.Unwrap().at(1) == (std::unordered_set<NodeID>{ 1, 2, 3 }));
+        PMGRD_EXPECT(std::filesystem::file_size(dir.Wal()) == 3 * LogRecordSize);
+    }
+    PMGRD_TEST(Journal_OutOfSequence);
+
+    void Journal_SnapshotChecksum()
+    {
+        TempDir dir;
+        {
+            Journal j{ dir };
+            if (!PMGRD_EXPECT(j.journal.Recover()))
+                return;
+            j.journal.Start();
+            j.journal.Append(MembershipOp::Join, 4, 2, {});
+            j.journal.Append(MembershipOp::Join, 5, 3, {});
+            j.journal.Stop();
+        }
+
+        {
+            Journal    j{ dir };
+            const auto groups = j.journal.Recover();
+            if (!PMGRD_EXPECT(groups))
+                return;
+            PMGRD_EXPECT(groups.Unwrap().size() == 2);
+        }
+
+        // Corrupt the last entry, the header still matches but the checksum doesn't.
+        FlipByte(dir.Snapshot(), std::filesystem::file_size(dir.Snapshot()) - 1);
+        Journal j{ dir };
+        PMGRD_EXPECT(!j.journal.Recover());
+    }
+    PMGRD_TEST(Journal_SnapshotChecksum);
+} // namespace
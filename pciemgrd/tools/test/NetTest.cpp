@@ -0,0 +1,198 @@
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <Net/NetPacket.h>
+#include <Net/PacketStream.h>
+#include <Net/Replication.h>
+
+#include "Test.h"
+
+using namespace pmgrd;
+
+namespace {
+    void ParseReady_Legacy()
+    {
+        net::Packet id_only{ net::PacketType::Ready };
+        id_only << u8{ 7 };
+        const auto info = net::ParseReady(std::move(id_only));
+        if (PMGRD_EXPECT(info))
+        {
+            PMGRD_EXPECT(info.Unwrap().nodeId == 7);
+            PMGRD_EXPECT(info.Unwrap().flags == net::ReadyFlags_None);
+            PMGRD_EXPECT(info.Unwrap().legacy);
+        }
+
+        net::Packet with_flags{ net::PacketType::Ready };
+        with_flags << u8{ 9 } << u8{ net::ReadyFlags_Subscribe };
+        const auto flagged = net::ParseReady(std::move(with_flags));
+        if (PMGRD_EXPECT(flagged))
+        {
+            PMGRD_EXPECT(flagged.Unwrap().nodeId == 9);
+            PMGRD_EXPECT(flagged.Unwrap().flags == net::ReadyFlags_Subscribe);
+            PMGRD_EXPECT(flagged.Unwrap().legacy);
+        }
+    }
+    PMGRD_TEST(ParseReady_Legacy);
+
+    void ParseReady_Versioned()
+    {
+        const auto plain = net::ParseReady(net::MakeReady(300, net::ReadyFlags_Ping));
+        if (PMGRD_EXPECT(plain))
+        {
+            PMGRD_EXPECT(plain.Unwrap().nodeId == 300);
+            PMGRD_EXPECT(plain.Unwrap().flags == net::ReadyFlags_Ping);
+            PMGRD_EXPECT(plain.Unwrap().sessionToken == 0);
+            PMGRD_EXPECT(!plain.Unwrap().legacy);
+        }
+
+        const auto session = net::ParseReady(net::MakeReady(12, net::ReadyFlags_Session, 0xfeedface));
+        if (PMGRD_EXPECT(session))
+        {
+            PMGRD_EXPECT(session.Unwrap().nodeId == 12);
+            PMGRD_EXPECT(session.Unwrap().sessionToken == 0xfeedface);
+        }
+
+        auto unknown_version = net::MakeReady(12, net::ReadyFlags_None);
+        unknown_version.data.back() = net::ReadyVersion + 1;
+        PMGRD_EXPECT(!net::ParseReady(std::move(unknown_version)));
+
+        // The session flag without the token.
+        auto missing_token = net::MakeReady(12, net::ReadyFlags_None);
+        missing_token.data[sizeof(NodeID)] = net::ReadyFlags_Session;
+        PMGRD_EXPECT(!net::ParseReady(std::move(missing_token)));
+
+        // Longer than a legacy packet, shorter than the versioned layout.
+        net::Packet truncated{ net::PacketType::Ready };
+        truncated << u8{ 1 } << u8{ 0 } << net::ReadyVersion;
+        PMGRD_EXPECT(!net::ParseReady(std::move(truncated)));
+    }
+    PMGRD_TEST(ParseReady_Versioned);
+
+    [[nodiscard]] net::Packet StreamBegin(const net::PacketType type, const u64 size)
+    {
+        net::Packet begin{ net::PacketType::StreamBegin };
+        begin << static_cast<u8>(type) << size;
+        return begin;
+    }
+
+    [[nodiscard]] net::Packet StreamChunk(const usize size)
+    {
+        return net::Packet{ net::PacketType::StreamChunk, std::vector<u8>(size, 0x2a) };
+    }
+
+    void PacketStream_Reassembles()
+    {
+        net::PacketStream stream;
+        if (!PMGRD_EXPECT(stream.Begin(StreamBegin(net::PacketType::Stats, 10))))
+            return;
+
+        const auto first = stream.Feed(StreamChunk(6));
+        PMGRD_EXPECT(first && !first.Unwrap());
+        const auto second = stream.Feed(StreamChunk(4));
+        PMGRD_EXPECT(second && !second.Unwrap());
+        const auto end = stream.Feed(net::Packet{ net::PacketType::StreamEnd });
+        PMGRD_EXPECT(end && end.Unwrap());
+
+        const auto packet = stream.Take();
+        PMGRD_EXPECT(packet.Type() == net::PacketType::Stats);
+        PMGRD_EXPECT(packet.data.size() == 10);
+        PMGRD_EXPECT(!stream.IsActive());
+    }
+    PMGRD_TEST(PacketStream_Reassembles);
+
+    void PacketStream_Overrun()
+    {
+        net::PacketStream stream;
+        if (!PMGRD_EXPECT(stream.Begin(StreamBegin(net::PacketType::Stats, 10))))
+            return;
+
+        PMGRD_EXPECT(stream.Feed(StreamChunk(8)));
+        PMGRD_EXPECT(!stream.Feed(StreamChunk(3)));
+    }
+    PMGRD_TEST(PacketStream_Overrun);
+
+    void PacketStream_Underrun()
+    {
+        net::PacketStream stream;
+        if (!PMGRD_EXPECT(stream.Begin(StreamBegin(net::PacketType::Stats, 10))))
+            return;
+
+        PMGRD_EXPECT(stream.Feed(StreamChunk(9)));
+        PMGRD_EXPECT(!stream.Feed(net::Packet{ net::PacketType::StreamEnd }));
+    }
+    PMGRD_TEST(PacketStream_Underrun);
+
+    void PacketStream_RefusesBegin()
+    {
+        net::PacketStream stream;
+        PMGRD_EXPECT(!stream.Begin(StreamBegin(net::PacketType::Join, 10)));
+        PMGRD_EXPECT(!stream.Begin(StreamBegin(net::PacketType::Stats, u64{ net::MaxPacketSize } + 1)));
+        PMGRD_EXPECT(!stream.IsActive());
+
+        // Handed to a delegate instead, the size is only bounded by what was announced.
+        u64 received = 0;
+        PMGRD_EXPECT(stream.Begin(StreamBegin(net::PacketType::Stats, u64{ net::MaxPacketSize } + 1),
+                                  [&received](const u8*, const usize size) -> Result<Err>
+                                  {
+                                      received += size;
+                                      return Ok();
+                                  }));
+        PMGRD_EXPECT(stream.Feed(StreamChunk(net::StreamChunkSize)));
+        PMGRD_EXPECT(received == net::StreamChunkSize);
+    }
+    PMGRD_TEST(PacketStream_RefusesBegin);
+
+    void DecodeRecords_RoundTrip()
+    {
+        net::SessionState state;
+        state.nodeId        = 3;
+        state.subscribed    = true;
+        state.configKind    = ConfigKind::Concentrator;
+        state.configVersion = 77;
+
+        net::Packet packet{ net::PacketType::Replication };
+        net::EncodeRecord(packet, net::ReplicationRecord::Group(net::ReplicationOp::Join, 7, 3));
+        net::EncodeRecord(packet, net::ReplicationRecord::Session(42, &state));
+        net::EncodeRecord(packet, net::ReplicationRecord::Marker(net::ReplicationOp::Heartbeat));
+
+        const auto records = net::DecodeRecords(std::move(packet));
+        if (!PMGRD_EXPECT(records) || !PMGRD_EXPECT(records.Unwrap().size() == 3))
+            return;
+
+        const auto decoded = records.Unwrap();
+        PMGRD_EXPECT(decoded[0].op == net::ReplicationOp::Join);
+        PMGRD_EXPECT(decoded[0].groupId == 7 && decoded[0].nodeId == 3);
+        PMGRD_EXPECT(decoded[1].op == net::ReplicationOp::SessionUpsert);
+        PMGRD_EXPECT(decoded[1].sessionToken == 42);
+        PMGRD_EXPECT(decoded[1].session.nodeId == 3 && decoded[1].session.subscribed);
+        PMGRD_EXPECT(decoded[1].session.configKind == ConfigKind::Concentrator);
+        PMGRD_EXPECT(decoded[1].session.configVersion == 77);
+        PMGRD_EXPECT(decoded[2].op == net::ReplicationOp::Heartbeat);
+    }
+    PMGRD_TEST(DecodeRecords_RoundTrip);
+
+    void DecodeRecords_Truncated()
+    {
+        net::Packet packet{ net::PacketType::Replication };
+        net::EncodeRecord(packet, net::ReplicationRecord::Group(net::ReplicationOp::Leave, 7, 3));
+        const usize first = packet.data.size();
+        net::EncodeRecord(packet, net::ReplicationRecord::Session(42, nullptr));
+
+        // Records are decoded from the back, whatever is cut from the front leaves the first one short of its
+        // header or its body.
+        for (usize cut = 1; cut < first; ++cut)
+        {
+            net::Packet truncated{ net::PacketType::Replication,
+                                   std::vector<u8>{ packet.data.begin() + static_cast<std::ptrdiff_t>(cut),
+                                                    packet.data.end() } };
+            if (!PMGRD_EXPECT(!net::DecodeRecords(std::move(truncated))))
+                return;
+        }
+
+        net::Packet unknown_op{ net::PacketType::Replication };
+        unknown_op << u64{ 0 } << u8{ 0xff };
+        PMGRD_EXPECT(!net::DecodeRecords(std::move(unknown_op)));
+    }
+    PMGRD_TEST(DecodeRecords_Truncated);
+} // namespace
@@ -0,0 +1,35 @@
+#include <string>
+
+#include <Core/SlotMap.h>
+
+#include "Test.h"
+
+using namespace pmgrd;
+
+namespace {
+    void SlotMap_GenerationReuse()
+    {
+        SlotMap<std::string> map;
+        const auto           first = map.Emplace("first");
+        const auto           other = map.Emplace("other");
+
+        PMGRD_EXPECT(map.Erase(first));
+        PMGRD_EXPECT(!map.Erase(first));
+        PMGRD_EXPECT(map.Get(first) == nullptr);
+
+        // The vacated slot is reused, but the stale handle never resolves to what took its place.
+        const auto second = map.Emplace("second");
+        PMGRD_EXPECT(second.index == first.index);
+        PMGRD_EXPECT(second.generation != first.generation);
+        PMGRD_EXPECT(map.Get(first) == nullptr);
+        PMGRD_EXPECT(!map.Erase(first));
+        if (PMGRD_EXPECT(map.Get(second) != nullptr))
+            PMGRD_EXPECT(*map.Get(second) == "second");
+
+        PMGRD_EXPECT(map.Get(SlotHandle{}) == nullptr);
+        PMGRD_EXPECT(map.Size() == 2);
+        PMGRD_EXPECT(map.Capacity() == 2);
+        PMGRD_EXPECT(*map.Get(other) == "other");
+    }
+    PMGRD_TEST(SlotMap_GenerationReuse);
+} // namespace
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <CommonDef.h>
+
+#include <string>
+
+/**
+ * @brief Registers @p fn as a test, e.g. PMGRD_TEST(Journal_TornRecord).
+ * */
+#define PMGRD_TEST(fn) [[maybe_unused]] static const bool pmgrd_test_registered_##fn = ::pmgrd::test::Register(#fn, fn)
+
+/**
+ * @brief Fails the running test if @p cond doesn't hold and evaluates to it, so that a test can stop at a failure
+ * later checks depend on:
+ *
+ * @code
+ * if (!PMGRD_EXPECT(result))
+ *     return;
+ * @endcode
+ * */
+#define PMGRD_EXPECT(cond) ::pmgrd::test::Expect(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
+
+/**
+ * @namespace pmgrd::test
+ * @brief A minimal test harness, every registered test is run by pciemgrd_tests and a failing one fails the run.
+ * */
+namespace pmgrd::test {
+    using TestFn = void (*)();
+
+    /**
+     * @brief Adds a test to the ones run by the harness, see @ref PMGRD_TEST.
+     * */
+    bool Register(std::string name, TestFn fn);
+
+    /**
+     * @brief Reports @p expr as failed unless @p ok, see @ref PMGRD_EXPECT.
+     * */
+    bool Expect(const bool ok, const char* expr, const char* file, const int line);
+} // namespace pmgrd::test
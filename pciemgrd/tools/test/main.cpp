@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "Test.h"
+
+using namespace pmgrd;
+
+namespace pmgrd::test {
+    namespace {
+        struct Test
+        {
+            std::string name;
+            TestFn      fn;
+        };
+
+        std::vector<Test>& Registry()
+        {
+            static std::vector<Test> s_Tests;
+            return s_Tests;
+        }
+
+        usize s_Failures = 0; ///< Failed expectations of the running test.
+    } // namespace
+
+    bool Register(std::string name, TestFn fn)
+    {
+        Registry().push_back({ std::move(name), fn });
+        return true;
+    }
+
+    bool Expect(const bool ok, const char* expr, const char* file, const int line)
+    {
+        if (!ok)
+        {
+            fmt::print(stderr, "{}:{}: Expected {}\n", file, line, expr);
+            ++s_Failures;
+        }
+        return ok;
+    }
+} // namespace pmgrd::test
+
+int main(const int argc, const char** argv)
+{
+    std::string_view filter;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{ argv[i] };
+        if (!arg.starts_with("--filter="))
+        {
+            fmt::print(stderr, "Usage: {} [--filter=<substring>]\n\nRuns every test whose name contains <substring>.\n",
+                       argv[0]);
+            return 1;
+        }
+        filter = arg.substr(std::string_view{ "--filter=" }.size());
+    }
+
+    auto& tests = test::Registry();
+    std::sort(tests.begin(), tests.end(), [](const test::Test& a, const test::Test& b) { return a.name < b.name; });
+
+    usize run    = 0;
+    usize failed = 0;
+    for (const auto& t : tests)
+    {
+        if (!filter.empty() && t.name.find(filter) == std::string::npos)
+            continue;
+
+        test::s_Failures = 0;
+        t.fn();
+        ++run;
+
+        if (test::s_Failures != 0)
+            ++failed;
+        fmt::print("[{}] {}\n", (test::s_Failures == 0) ? "  OK  " : " FAIL ", t.name);
+    }
+
+    fmt::print("{} of {} test(s) passed.\n", run - failed, run);
+    return (failed == 0) ? 0 : 1;
+}